@@ -0,0 +1,616 @@
+/*
+    Loopback end-to-end benchmark.
+
+    The plugin is hosted by the mock plugin host and N in-process clients
+    (the signaling client of bench-utils) run the whole signaling flow
+    against it (AUTH, DESC, CAND, READY, CONN). After all handshakes have
+    finished, every client sends timestamped messages on all of its channels
+    and the host echoes them back, so that both one-way latencies can be
+    measured with the same monotonic clock.
+
+    Clients and server share the process, so the reported CPU figures include
+    both sides of the loopback.
+*/
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include "plugin.h"
+#include "mock-plugin.h"
+#include "bench-utils.h"
+
+
+/// Magic byte of benchmark payloads
+#define BENCH_PAYLOAD_MAGIC 0xB7
+
+/// Header of payload: magic + send time + client index + sequence
+#define BENCH_PAYLOAD_HEADER_SIZE (1 + 8 + 4 + 4)
+
+/// Maximum payload size
+#define BENCH_PAYLOAD_MAX_SIZE 16384
+
+/// Maximum time to wait for all handshakes (ms)
+#define BENCH_HANDSHAKE_TIMEOUT_MS 30000
+
+
+/// @brief Benchmark options
+struct BenchOptions {
+    size_t clients = 16;
+    std::vector<pomelo_channel_mode> modes = {
+        POMELO_CHANNEL_MODE_UNRELIABLE,
+        POMELO_CHANNEL_MODE_SEQUENCED,
+        POMELO_CHANNEL_MODE_RELIABLE
+    };
+    unsigned duration_s = 10;
+    unsigned rate = 50; // Messages per second, per client and channel
+    size_t size = 64;
+    unsigned port = 18888;
+    unsigned connect_rate = 0; // Handshakes per second, 0 = all at once
+    uint64_t executor_latency_us = 0;
+    uint64_t token_cost_us = 0;
+};
+
+
+/// @brief Traffic and latency of a channel, in both directions
+struct ChannelStats {
+    pomelo_histogram_t c2s;
+    pomelo_histogram_t s2c;
+    std::atomic<uint64_t> c2s_bytes{0};
+    std::atomic<uint64_t> s2c_bytes{0};
+    std::atomic<uint64_t> send_failures{0};
+};
+
+
+/// @brief In-process client
+struct BenchClient {
+    size_t index = 0;
+    pomelo_webrtc_bench_client_t client;
+    std::atomic<bool> connected{false};
+    std::atomic<bool> failed{false};
+    uint64_t start_ns = 0;
+    uint64_t connected_ns = 0;
+    uint32_t sequence = 0;
+
+    BenchClient() { pomelo_webrtc_bench_client_init(&client); }
+    ~BenchClient() { pomelo_webrtc_bench_client_cleanup(&client); }
+};
+
+
+/// @brief Global state of benchmark
+struct Bench {
+    BenchOptions options;
+    pomelo_webrtc_mock_t * mock = nullptr;
+    rtc_context_t * rtc_context = nullptr;
+    std::string url;
+    std::vector<std::unique_ptr<BenchClient>> clients;
+    std::vector<std::unique_ptr<ChannelStats>> channels;
+    std::mutex sessions_mutex;
+    std::vector<pomelo_session_t *> sessions; // Indexed by client index
+    pomelo_histogram_t handshake;
+    std::atomic<size_t> handshakes_done{0};
+    std::atomic<size_t> handshakes_failed{0};
+    std::atomic<uint64_t> c2s_messages{0};
+    std::atomic<uint64_t> s2c_messages{0};
+};
+
+static Bench bench;
+
+
+static const char * mode_name(pomelo_channel_mode mode) {
+    switch (mode) {
+        case POMELO_CHANNEL_MODE_RELIABLE: return "reliable";
+        case POMELO_CHANNEL_MODE_SEQUENCED: return "sequenced";
+        default: return "unreliable";
+    }
+}
+
+
+static std::vector<std::string> split(const std::string & str, char sep) {
+    std::vector<std::string> parts;
+    size_t begin = 0;
+    for (;;) {
+        size_t pos = str.find(sep, begin);
+        if (pos == std::string::npos) {
+            parts.push_back(str.substr(begin));
+            return parts;
+        }
+        parts.push_back(str.substr(begin, pos - begin));
+        begin = pos + 1;
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+/*                                Server side                                 */
+/* -------------------------------------------------------------------------- */
+
+static void server_on_session_created(
+    pomelo_webrtc_mock_t * mock,
+    pomelo_session_t * session
+) {
+    (void) mock;
+    int64_t client_id = pomelo_webrtc_mock_session_client_id(session);
+    size_t index = (size_t) (client_id - 1);
+
+    std::lock_guard<std::mutex> lock(bench.sessions_mutex);
+    if (index < bench.sessions.size()) {
+        bench.sessions[index] = session;
+    }
+}
+
+
+static void server_on_session_destroyed(
+    pomelo_webrtc_mock_t * mock,
+    pomelo_session_t * session
+) {
+    (void) mock;
+    int64_t client_id = pomelo_webrtc_mock_session_client_id(session);
+    size_t index = (size_t) (client_id - 1);
+
+    std::lock_guard<std::mutex> lock(bench.sessions_mutex);
+    if (index < bench.sessions.size() && bench.sessions[index] == session) {
+        bench.sessions[index] = nullptr;
+    }
+}
+
+
+static void server_on_receive(
+    pomelo_webrtc_mock_t * mock,
+    pomelo_session_t * session,
+    size_t channel_index,
+    const uint8_t * data,
+    size_t length
+) {
+    uint64_t now = pomelo_webrtc_bench_now_ns();
+    if (channel_index >= bench.channels.size()) return;
+    if (length < BENCH_PAYLOAD_HEADER_SIZE || length > BENCH_PAYLOAD_MAX_SIZE) {
+        return;
+    }
+    if (data[0] != BENCH_PAYLOAD_MAGIC) return;
+
+    ChannelStats * stats = bench.channels[channel_index].get();
+    uint64_t sent = pomelo_webrtc_bench_read_u64(data + 1);
+    pomelo_histogram_record(&stats->c2s, now - sent);
+    stats->c2s_bytes.fetch_add(length, std::memory_order_relaxed);
+    bench.c2s_messages.fetch_add(1, std::memory_order_relaxed);
+
+    // Echo back with a new timestamp
+    uint8_t echo[BENCH_PAYLOAD_MAX_SIZE];
+    memcpy(echo, data, length);
+    pomelo_webrtc_bench_write_u64(echo + 1, pomelo_webrtc_bench_now_ns());
+    pomelo_webrtc_mock_send(mock, session, channel_index, echo, length);
+}
+
+
+/* -------------------------------------------------------------------------- */
+/*                                Client side                                 */
+/* -------------------------------------------------------------------------- */
+
+static void client_fail(BenchClient * client) {
+    if (client->connected.load() || client->failed.exchange(true)) return;
+    bench.handshakes_failed.fetch_add(1);
+}
+
+
+static void client_on_connected(pomelo_webrtc_bench_client_t * base) {
+    BenchClient * client = static_cast<BenchClient *>(base->options.data);
+    client->connected_ns = pomelo_webrtc_bench_now_ns();
+    if (!client->failed.load() && !client->connected.exchange(true)) {
+        pomelo_histogram_record(
+            &bench.handshake,
+            client->connected_ns - client->start_ns
+        );
+        bench.handshakes_done.fetch_add(1);
+    }
+}
+
+
+static void client_on_failed(
+    pomelo_webrtc_bench_client_t * base,
+    pomelo_webrtc_bench_client_error error
+) {
+    (void) error;
+    client_fail(static_cast<BenchClient *>(base->options.data));
+}
+
+
+static void client_on_server_message(
+    pomelo_webrtc_bench_client_t * base,
+    size_t channel_index,
+    const uint8_t * data,
+    size_t size
+) {
+    (void) base;
+    uint64_t now = pomelo_webrtc_bench_now_ns();
+    if (channel_index >= bench.channels.size()) return;
+    if (size < BENCH_PAYLOAD_HEADER_SIZE) return;
+    if (data[0] != BENCH_PAYLOAD_MAGIC) return;
+
+    ChannelStats * stats = bench.channels[channel_index].get();
+    uint64_t sent = pomelo_webrtc_bench_read_u64(data + 1);
+    pomelo_histogram_record(&stats->s2c, now - sent);
+    stats->s2c_bytes.fetch_add(size, std::memory_order_relaxed);
+    bench.s2c_messages.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+static void client_start(BenchClient * client) {
+    pomelo_webrtc_bench_client_options_t options;
+    memset(&options, 0, sizeof(options));
+    options.rtc_context = bench.rtc_context;
+    options.url = bench.url.c_str();
+    options.client_id = (int64_t) client->index + 1;
+    options.token_timeout_s = BENCH_HANDSHAKE_TIMEOUT_MS / 1000;
+    options.nchannels = bench.options.modes.size();
+    options.modes = bench.options.modes.data();
+    options.on_connected = client_on_connected;
+    options.on_failed = client_on_failed;
+    options.on_message = client_on_server_message;
+    options.data = client;
+
+    // A failure is counted by the failed callback
+    client->start_ns = pomelo_webrtc_bench_now_ns();
+    pomelo_webrtc_bench_client_start(&client->client, &options);
+}
+
+
+static void client_close(BenchClient * client) {
+    pomelo_webrtc_bench_client_stop(&client->client, true);
+}
+
+
+static void client_send_data(BenchClient * client, uint8_t * payload) {
+    size_t size = bench.options.size;
+    pomelo_webrtc_bench_client_lock(&client->client);
+    for (size_t i = 0; i < bench.channels.size(); i++) {
+        payload[0] = BENCH_PAYLOAD_MAGIC;
+        pomelo_webrtc_bench_write_u32(payload + 9, (uint32_t) client->index);
+        pomelo_webrtc_bench_write_u32(payload + 13, client->sequence++);
+        pomelo_webrtc_bench_write_u64(payload + 1, pomelo_webrtc_bench_now_ns());
+
+        int ret =
+            pomelo_webrtc_bench_client_send(&client->client, i, payload, size);
+        if (ret < 0) {
+            bench.channels[i]->send_failures.fetch_add(1);
+        }
+    }
+    pomelo_webrtc_bench_client_unlock(&client->client);
+}
+
+
+/* -------------------------------------------------------------------------- */
+/*                                  Driver                                    */
+/* -------------------------------------------------------------------------- */
+
+static void print_usage(const char * program) {
+    printf(
+        "Usage: %s [options]\n"
+        "  --clients N        Number of clients (default 16)\n"
+        "  --modes MODES      Channel modes, e.g. u,s,r (default u,s,r)\n"
+        "  --duration S       Traffic duration in seconds (default 10)\n"
+        "  --rate N           Messages/s per client and channel (default 50)\n"
+        "  --size N           Payload size in bytes (default 64)\n"
+        "  --port N           Listening port (default 18888)\n"
+        "  --connect-rate N   Handshakes started per second (default all)\n"
+        "  --executor-latency US  Simulated executor latency (default 0)\n"
+        "  --token-cost US    Simulated token decoding cost (default 0)\n",
+        program
+    );
+}
+
+
+static bool parse_modes(const char * str, std::vector<pomelo_channel_mode> & modes) {
+    modes.clear();
+    for (const std::string & mode : split(str, ',')) {
+        if (mode == "u" || mode == "unreliable") {
+            modes.push_back(POMELO_CHANNEL_MODE_UNRELIABLE);
+        } else if (mode == "s" || mode == "sequenced") {
+            modes.push_back(POMELO_CHANNEL_MODE_SEQUENCED);
+        } else if (mode == "r" || mode == "reliable") {
+            modes.push_back(POMELO_CHANNEL_MODE_RELIABLE);
+        } else {
+            return false;
+        }
+    }
+    return !modes.empty() && modes.size() <= POMELO_WEBRTC_MOCK_MAX_CHANNELS;
+}
+
+
+static bool parse_options(int argc, char * argv[], BenchOptions & options) {
+    for (int i = 1; i < argc; i++) {
+        const char * arg = argv[i];
+        const char * value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (!value) return false;
+
+        if (strcmp(arg, "--clients") == 0) {
+            options.clients = strtoul(value, nullptr, 10);
+        } else if (strcmp(arg, "--modes") == 0) {
+            if (!parse_modes(value, options.modes)) return false;
+        } else if (strcmp(arg, "--duration") == 0) {
+            options.duration_s = (unsigned) strtoul(value, nullptr, 10);
+        } else if (strcmp(arg, "--rate") == 0) {
+            options.rate = (unsigned) strtoul(value, nullptr, 10);
+        } else if (strcmp(arg, "--size") == 0) {
+            options.size = strtoul(value, nullptr, 10);
+        } else if (strcmp(arg, "--port") == 0) {
+            options.port = (unsigned) strtoul(value, nullptr, 10);
+        } else if (strcmp(arg, "--connect-rate") == 0) {
+            options.connect_rate = (unsigned) strtoul(value, nullptr, 10);
+        } else if (strcmp(arg, "--executor-latency") == 0) {
+            options.executor_latency_us = strtoull(value, nullptr, 10);
+        } else if (strcmp(arg, "--token-cost") == 0) {
+            options.token_cost_us = strtoull(value, nullptr, 10);
+        } else {
+            return false;
+        }
+        i++;
+    }
+
+    return options.clients > 0 &&
+        options.size >= BENCH_PAYLOAD_HEADER_SIZE &&
+        options.size <= BENCH_PAYLOAD_MAX_SIZE;
+}
+
+
+static void run_handshakes(void) {
+    BenchOptions & options = bench.options;
+    uint64_t interval_ns =
+        options.connect_rate ? 1000000000ULL / options.connect_rate : 0;
+    uint64_t begin = pomelo_webrtc_bench_now_ns();
+
+    for (size_t i = 0; i < options.clients; i++) {
+        if (interval_ns) {
+            uint64_t due = begin + i * interval_ns;
+            uint64_t now = pomelo_webrtc_bench_now_ns();
+            if (due > now) {
+                std::this_thread::sleep_for(std::chrono::nanoseconds(due - now));
+            }
+        }
+        client_start(bench.clients[i].get());
+    }
+
+    uint64_t deadline =
+        begin + BENCH_HANDSHAKE_TIMEOUT_MS * 1000000ULL;
+    while (bench.handshakes_done.load() + bench.handshakes_failed.load() <
+        options.clients && pomelo_webrtc_bench_now_ns() < deadline
+    ) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+}
+
+
+static void run_traffic(void) {
+    BenchOptions & options = bench.options;
+    if (options.rate == 0 || options.duration_s == 0) return;
+
+    std::vector<uint8_t> payload(options.size, 0);
+    uint64_t interval_ns = 1000000000ULL / options.rate;
+    uint64_t begin = pomelo_webrtc_bench_now_ns();
+    uint64_t end = begin + options.duration_s * 1000000000ULL;
+    uint64_t next = begin;
+
+    while (next < end) {
+        for (auto & client : bench.clients) {
+            if (client->connected.load()) {
+                client_send_data(client.get(), payload.data());
+            }
+        }
+
+        next += interval_ns;
+        uint64_t now = pomelo_webrtc_bench_now_ns();
+        if (next > now) {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(next - now));
+        }
+    }
+
+    // Let the in-flight echoes arrive
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+}
+
+
+static void print_handshake_report(
+    const pomelo_webrtc_bench_usage_t & before,
+    const pomelo_webrtc_bench_usage_t & after
+) {
+    size_t done = bench.handshakes_done.load();
+    uint64_t last = 0;
+    uint64_t first = UINT64_MAX;
+    for (auto & client : bench.clients) {
+        if (!client->connected.load()) continue;
+        if (client->start_ns < first) first = client->start_ns;
+        if (client->connected_ns > last) last = client->connected_ns;
+    }
+
+    double elapsed = (done > 0) ? (last - first) / 1e9 : 0.0;
+    double cpu = (after.cpu_ns - before.cpu_ns) / 1e9;
+
+    printf("Handshakes\n");
+    printf(
+        "  done=%zu failed=%zu rate=%.1f/s cpu/session=%.2fms "
+        "rss/session=%.1fKiB\n",
+        done,
+        bench.handshakes_failed.load(),
+        elapsed > 0 ? done / elapsed : 0.0,
+        done > 0 ? cpu * 1000.0 / done : 0.0,
+        done > 0 ? ((double) after.rss - (double) before.rss) / 1024.0 / done
+            : 0.0
+    );
+    pomelo_webrtc_bench_print_histogram("handshake", &bench.handshake);
+
+    static const char * phase_names[POMELO_WEBRTC_HANDSHAKE_PHASE_COUNT] = {
+        "ws_accepted",
+        "auth_received",
+        "token_decoded",
+        "offer_sent",
+        "remote_description",
+        "first_remote_cand",
+        "pc_connected",
+        "channels_opened",
+        "ready_received",
+        "session_created"
+    };
+
+    pomelo_plugin_t * plugin = pomelo_webrtc_mock_plugin(bench.mock);
+    for (int i = 0; i < POMELO_WEBRTC_HANDSHAKE_PHASE_COUNT; i++) {
+        pomelo_webrtc_handshake_phase_stats_t stats;
+        pomelo_webrtc_handshake_phase phase = (pomelo_webrtc_handshake_phase) i;
+        if (pomelo_webrtc_get_handshake_stats(plugin, phase, &stats) < 0) {
+            continue;
+        }
+        printf(
+            "  phase %-20s count=%llu p50=%lluus p99=%lluus failed=%llu "
+            "timeout=%llu\n",
+            phase_names[i],
+            (unsigned long long) stats.count,
+            (unsigned long long) stats.p50_us,
+            (unsigned long long) stats.p99_us,
+            (unsigned long long) stats.failed,
+            (unsigned long long) stats.timeout
+        );
+    }
+}
+
+
+static void print_traffic_report(
+    const pomelo_webrtc_bench_usage_t & before,
+    const pomelo_webrtc_bench_usage_t & after
+) {
+    double wall = (after.wall_ns - before.wall_ns) / 1e9;
+    double cpu = (after.cpu_ns - before.cpu_ns) / 1e9;
+    uint64_t messages = bench.c2s_messages.load() + bench.s2c_messages.load();
+    uint64_t bytes = 0;
+    for (auto & channel : bench.channels) {
+        bytes += channel->c2s_bytes.load() + channel->s2c_bytes.load();
+    }
+
+    printf("Traffic (client and server share the process)\n");
+    printf(
+        "  wall=%.2fs cpu=%.2fs cores=%u msgs=%llu (%.0f/s, %.0f/cpu-s) "
+        "bytes=%llu (%.0f/s, %.0f/cpu-s)\n",
+        wall,
+        cpu,
+        pomelo_webrtc_bench_ncores(),
+        (unsigned long long) messages,
+        wall > 0 ? messages / wall : 0.0,
+        cpu > 0 ? messages / cpu : 0.0,
+        (unsigned long long) bytes,
+        wall > 0 ? bytes / wall : 0.0,
+        cpu > 0 ? bytes / cpu : 0.0
+    );
+
+    for (size_t i = 0; i < bench.channels.size(); i++) {
+        ChannelStats * stats = bench.channels[i].get();
+        char name[64];
+        printf(
+            "  channel %zu (%s) send_failures=%llu\n",
+            i,
+            mode_name(bench.options.modes[i]),
+            (unsigned long long) stats->send_failures.load()
+        );
+        snprintf(name, sizeof(name), "c2s");
+        pomelo_webrtc_bench_print_histogram(name, &stats->c2s);
+        snprintf(name, sizeof(name), "s2c");
+        pomelo_webrtc_bench_print_histogram(name, &stats->s2c);
+    }
+}
+
+
+int main(int argc, char * argv[]) {
+    if (!parse_options(argc, argv, bench.options)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    BenchOptions & options = bench.options;
+    pomelo_histogram_reset(&bench.handshake);
+    bench.sessions.assign(options.clients, nullptr);
+    for (size_t i = 0; i < options.modes.size(); i++) {
+        auto stats = std::make_unique<ChannelStats>();
+        pomelo_histogram_reset(&stats->c2s);
+        pomelo_histogram_reset(&stats->s2c);
+        bench.channels.push_back(std::move(stats));
+    }
+    for (size_t i = 0; i < options.clients; i++) {
+        auto client = std::make_unique<BenchClient>();
+        client->index = i;
+        bench.clients.push_back(std::move(client));
+    }
+
+    std::string address = "127.0.0.1:" + std::to_string(options.port);
+    bench.url = "ws://" + address;
+    pomelo_webrtc_mock_options_t mock_options;
+    memset(&mock_options, 0, sizeof(mock_options));
+    mock_options.address = address.c_str();
+    mock_options.nchannels = options.modes.size();
+    for (size_t i = 0; i < options.modes.size(); i++) {
+        mock_options.channel_modes[i] = options.modes[i];
+    }
+    mock_options.on_session_created = server_on_session_created;
+    mock_options.on_session_destroyed = server_on_session_destroyed;
+    mock_options.on_receive = server_on_receive;
+    mock_options.executor_latency_us = options.executor_latency_us;
+    mock_options.token_decode_cost_us = options.token_cost_us;
+
+    bench.mock = pomelo_webrtc_mock_create(&mock_options);
+    if (!bench.mock) {
+        fprintf(stderr, "Failed to create mock plugin host\n");
+        return 1;
+    }
+
+    if (pomelo_webrtc_mock_listen(bench.mock) < 0) {
+        fprintf(stderr, "Failed to listen on %s\n", address.c_str());
+        pomelo_webrtc_mock_destroy(bench.mock);
+        return 1;
+    }
+
+    bench.rtc_context = pomelo_webrtc_bench_client_context_create();
+    if (!bench.rtc_context) {
+        fprintf(stderr, "Failed to create RTC context\n");
+        pomelo_webrtc_mock_destroy(bench.mock);
+        return 1;
+    }
+
+    // Let the WS server start
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    printf(
+        "clients=%zu channels=%zu rate=%u/s size=%zu duration=%us\n",
+        options.clients,
+        options.modes.size(),
+        options.rate,
+        options.size,
+        options.duration_s
+    );
+
+    pomelo_webrtc_bench_usage_t usage_begin;
+    pomelo_webrtc_bench_usage_t usage_connected;
+    pomelo_webrtc_bench_usage_t usage_end;
+
+    pomelo_webrtc_bench_usage(&usage_begin);
+    run_handshakes();
+    pomelo_webrtc_bench_usage(&usage_connected);
+    run_traffic();
+    pomelo_webrtc_bench_usage(&usage_end);
+
+    print_handshake_report(usage_begin, usage_connected);
+    print_traffic_report(usage_connected, usage_end);
+
+    for (auto & client : bench.clients) {
+        client_close(client.get());
+    }
+    bench.clients.clear();
+
+    // Clients must be gone before the server, and both RTC contexts clean up
+    // the shared libdatachannel state, so the client context goes last.
+    pomelo_webrtc_mock_destroy(bench.mock);
+    bench.mock = nullptr;
+    rtc_context_destroy(bench.rtc_context);
+    bench.rtc_context = nullptr;
+    return 0;
+}
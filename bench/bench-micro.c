@@ -0,0 +1,601 @@
+/*
+    Micro-benchmarks of the context layer.
+
+    The plugin is hosted by the mock plugin host without any socket, so no
+    WebRTC stack is involved. Every benchmark which touches non-threadsafe
+    state of the context runs inside a task of plugin thread.
+
+    Benchmarks:
+    - submit_task: cross-thread and in-loop submission of tasks, with the
+      latency from submitting to executing.
+    - string_buffer: acquire, format and release of pooled string buffers.
+    - rtc_buffer: prepare and release of RTC buffers from several threads.
+    - recv_command: the round trip of a received message through the host
+      executor and back to plugin thread.
+*/
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "uv.h"
+#include "context.h"
+#include "channel/channel.h"
+#include "channel/channel-int.h"
+#include "session/session.h"
+#include "utils/string-buffer.h"
+#include "utils/common-macro.h"
+#include "mock-plugin.h"
+#include "bench-utils.h"
+
+
+/// Maximum number of producer threads
+#define BENCH_MAX_THREADS 64
+
+
+/// @brief Options of micro-benchmarks
+typedef struct bench_options_s {
+    /// @brief Number of iterations of every benchmark
+    uint64_t iterations;
+
+    /// @brief Number of producer threads
+    unsigned threads;
+
+    /// @brief Simulated executor latency of host (us)
+    uint64_t executor_latency_us;
+
+    /// @brief Size of messages (bytes)
+    size_t message_size;
+
+    /// @brief Only run the benchmark with this name (NULL = all)
+    const char * only;
+} bench_options_t;
+
+
+/// @brief Shared state of a benchmark
+typedef struct bench_state_s {
+    /// @brief The context of plugin
+    pomelo_webrtc_context_t * context;
+
+    /// @brief Options
+    bench_options_t * options;
+
+    /// @brief Number of executed tasks
+    pomelo_atomic_uint64_t executed;
+
+    /// @brief Number of expected tasks
+    uint64_t expected;
+
+    /// @brief Latency from submitting to executing
+    pomelo_histogram_t latency;
+
+    /// @brief Posted when a benchmark step has finished
+    uv_sem_t done;
+
+    /// @brief Elapsed time of a loop-side step (ns)
+    uint64_t elapsed;
+} bench_state_t;
+
+
+/// @brief Producer thread
+typedef struct bench_producer_s {
+    /// @brief Thread
+    uv_thread_t thread;
+
+    /// @brief State
+    bench_state_t * state;
+
+    /// @brief Number of iterations of this producer
+    uint64_t iterations;
+} bench_producer_t;
+
+
+static bench_state_t bench;
+
+
+static void bench_report(
+    const char * name,
+    uint64_t operations,
+    uint64_t elapsed_ns
+) {
+    double seconds = elapsed_ns / 1e9;
+    printf(
+        "%-32s ops=%llu elapsed=%.3fs %.1f ns/op %.0f ops/s\n",
+        name,
+        (unsigned long long) operations,
+        seconds,
+        operations > 0 ? (double) elapsed_ns / operations : 0.0,
+        seconds > 0 ? operations / seconds : 0.0
+    );
+}
+
+
+static bool bench_enabled(const char * name) {
+    return !bench.options->only || strcmp(bench.options->only, name) == 0;
+}
+
+
+/// @brief Run a callback in plugin thread and wait for it to complete
+static void bench_run_in_loop(pomelo_webrtc_task_cb callback) {
+    pomelo_webrtc_variant_t args[] = {{ .ptr = &bench }};
+    pomelo_webrtc_context_submit_task(
+        bench.context,
+        callback,
+        POMELO_ARRAY_LENGTH(args),
+        args
+    );
+    uv_sem_wait(&bench.done);
+}
+
+
+/* -------------------------------------------------------------------------- */
+/*                               submit_task                                  */
+/* -------------------------------------------------------------------------- */
+
+static void bench_submit_task_callback(
+    size_t argc,
+    pomelo_webrtc_variant_t * args
+) {
+    assert(argc == 1);
+    uint64_t now = uv_hrtime();
+    pomelo_histogram_record(&bench.latency, now - args[0].u64);
+
+    uint64_t executed = pomelo_atomic_uint64_fetch_add(&bench.executed, 1) + 1;
+    if (executed == bench.expected) {
+        uv_sem_post(&bench.done);
+    }
+}
+
+
+static void bench_submit_task_producer(void * data) {
+    bench_producer_t * producer = data;
+    pomelo_webrtc_context_t * context = producer->state->context;
+
+    for (uint64_t i = 0; i < producer->iterations; i++) {
+        pomelo_webrtc_variant_t args[] = {{ .u64 = uv_hrtime() }};
+        pomelo_webrtc_task_t * task = pomelo_webrtc_context_submit_task(
+            context,
+            bench_submit_task_callback,
+            POMELO_ARRAY_LENGTH(args),
+            args
+        );
+        if (!task) {
+            // Count the failed submission as executed
+            uint64_t executed =
+                pomelo_atomic_uint64_fetch_add(&bench.executed, 1) + 1;
+            if (executed == bench.expected) {
+                uv_sem_post(&bench.done);
+            }
+        }
+    }
+}
+
+
+static void bench_submit_task_cross_thread(unsigned nthreads) {
+    bench_producer_t producers[BENCH_MAX_THREADS];
+    uint64_t iterations = bench.options->iterations;
+
+    pomelo_histogram_reset(&bench.latency);
+    pomelo_atomic_uint64_store(&bench.executed, 0);
+    bench.expected = (iterations / nthreads) * nthreads;
+    if (bench.expected == 0) return;
+
+    uint64_t begin = uv_hrtime();
+    for (unsigned i = 0; i < nthreads; i++) {
+        producers[i].state = &bench;
+        producers[i].iterations = iterations / nthreads;
+        uv_thread_create(
+            &producers[i].thread,
+            bench_submit_task_producer,
+            &producers[i]
+        );
+    }
+
+    uv_sem_wait(&bench.done);
+    uint64_t elapsed = uv_hrtime() - begin;
+    for (unsigned i = 0; i < nthreads; i++) {
+        uv_thread_join(&producers[i].thread);
+    }
+
+    char name[64];
+    snprintf(name, sizeof(name), "submit_task/cross_thread/%u", nthreads);
+    bench_report(name, bench.expected, elapsed);
+    pomelo_webrtc_bench_print_histogram("submit->exec", &bench.latency);
+}
+
+
+static void bench_submit_task_in_loop_callback(
+    size_t argc,
+    pomelo_webrtc_variant_t * args
+) {
+    assert(argc == 1);
+    (void) args;
+
+    // Tasks which are submitted in plugin thread are run in the same drain
+    uint64_t iterations = bench.expected;
+    for (uint64_t i = 0; i < iterations; i++) {
+        pomelo_webrtc_variant_t task_args[] = {{ .u64 = uv_hrtime() }};
+        pomelo_webrtc_context_submit_task(
+            bench.context,
+            bench_submit_task_callback,
+            POMELO_ARRAY_LENGTH(task_args),
+            task_args
+        );
+    }
+}
+
+
+static void bench_submit_task_in_loop(void) {
+    pomelo_histogram_reset(&bench.latency);
+    pomelo_atomic_uint64_store(&bench.executed, 0);
+    bench.expected = bench.options->iterations;
+
+    uint64_t begin = uv_hrtime();
+    pomelo_webrtc_variant_t args[] = {{ .ptr = &bench }};
+    pomelo_webrtc_context_submit_task(
+        bench.context,
+        bench_submit_task_in_loop_callback,
+        POMELO_ARRAY_LENGTH(args),
+        args
+    );
+    uv_sem_wait(&bench.done);
+    uint64_t elapsed = uv_hrtime() - begin;
+
+    bench_report("submit_task/in_loop", bench.expected, elapsed);
+    pomelo_webrtc_bench_print_histogram("submit->exec", &bench.latency);
+}
+
+
+static void bench_submit_task(void) {
+    bench_submit_task_cross_thread(1);
+    if (bench.options->threads > 1) {
+        bench_submit_task_cross_thread(bench.options->threads);
+    }
+    bench_submit_task_in_loop();
+}
+
+
+/* -------------------------------------------------------------------------- */
+/*                              string_buffer                                 */
+/* -------------------------------------------------------------------------- */
+
+static void bench_string_buffer_callback(
+    size_t argc,
+    pomelo_webrtc_variant_t * args
+) {
+    assert(argc == 1);
+    (void) args;
+
+    // Typical candidate message
+    static const char candidate[] =
+        "candidate:1 1 UDP 2122317823 192.168.1.10 51234 typ host";
+
+    uint64_t iterations = bench.options->iterations;
+    uint64_t begin = uv_hrtime();
+    for (uint64_t i = 0; i < iterations; i++) {
+        pomelo_string_buffer_t * buffer =
+            pomelo_webrtc_context_acquire_string_buffer(bench.context);
+        if (!buffer) break;
+
+        pomelo_string_buffer_append_str(buffer, "CAND");
+        pomelo_string_buffer_append_chr(buffer, '|');
+        pomelo_string_buffer_append_u64(buffer, i & 0x3);
+        pomelo_string_buffer_append_chr(buffer, '|');
+        pomelo_string_buffer_append_str(buffer, candidate);
+
+        const char * message = NULL;
+        size_t length = 0;
+        pomelo_string_buffer_to_binary(buffer, &message, &length);
+
+        pomelo_webrtc_context_release_string_buffer(bench.context, buffer);
+    }
+    bench.elapsed = uv_hrtime() - begin;
+    uv_sem_post(&bench.done);
+}
+
+
+static void bench_string_buffer(void) {
+    bench_run_in_loop(bench_string_buffer_callback);
+    bench_report(
+        "string_buffer/acquire_format_release",
+        bench.options->iterations,
+        bench.elapsed
+    );
+}
+
+
+/* -------------------------------------------------------------------------- */
+/*                               rtc_buffer                                   */
+/* -------------------------------------------------------------------------- */
+
+static void bench_rtc_buffer_producer(void * data) {
+    bench_producer_t * producer = data;
+    rtc_context_t * rtc_context = producer->state->context->rtc_context;
+    size_t size = producer->state->options->message_size;
+
+    for (uint64_t i = 0; i < producer->iterations; i++) {
+        uint8_t * buffer_data = NULL;
+        rtc_buffer_t * buffer =
+            rtc_buffer_prepare(rtc_context, size, &buffer_data);
+        if (!buffer) continue;
+
+        buffer_data[0] = (uint8_t) i;
+        rtc_buffer_unref(buffer);
+    }
+}
+
+
+static void bench_rtc_buffer_threads(unsigned nthreads) {
+    bench_producer_t producers[BENCH_MAX_THREADS];
+    uint64_t iterations = bench.options->iterations / nthreads;
+
+    uint64_t begin = uv_hrtime();
+    for (unsigned i = 0; i < nthreads; i++) {
+        producers[i].state = &bench;
+        producers[i].iterations = iterations;
+        uv_thread_create(
+            &producers[i].thread,
+            bench_rtc_buffer_producer,
+            &producers[i]
+        );
+    }
+
+    for (unsigned i = 0; i < nthreads; i++) {
+        uv_thread_join(&producers[i].thread);
+    }
+    uint64_t elapsed = uv_hrtime() - begin;
+
+    char name[64];
+    snprintf(name, sizeof(name), "rtc_buffer/prepare_unref/%u", nthreads);
+    bench_report(name, iterations * nthreads, elapsed);
+}
+
+
+static void bench_rtc_buffer(void) {
+    bench_rtc_buffer_threads(1);
+    if (bench.options->threads > 1) {
+        bench_rtc_buffer_threads(bench.options->threads);
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+/*                              recv_command                                  */
+/* -------------------------------------------------------------------------- */
+
+/// @brief Number of received messages which are in flight at the same time
+#define BENCH_RECV_BATCH 256
+
+
+/// @brief Fake channel and session which receive the messages
+static pomelo_webrtc_session_t bench_session;
+static pomelo_webrtc_channel_t bench_channel;
+
+/// @brief Native session of the fake session
+static pomelo_session_t * bench_native_session;
+
+
+static void bench_recv_on_channel_finalize(pomelo_webrtc_channel_t * channel) {
+    (void) channel; // The fake channel is never released
+}
+
+
+static void bench_recv_on_receive(
+    pomelo_webrtc_mock_t * mock,
+    pomelo_session_t * session,
+    size_t channel_index,
+    const uint8_t * data,
+    size_t length
+) {
+    (void) mock;
+    (void) session;
+    (void) channel_index;
+    if (length < 8) return;
+
+    uint64_t sent = pomelo_webrtc_bench_read_u64(data);
+    pomelo_histogram_record(&bench.latency, uv_hrtime() - sent);
+}
+
+
+static void bench_recv_complete_callback(
+    size_t argc,
+    pomelo_webrtc_variant_t * args
+) {
+    assert(argc == 1);
+    (void) args;
+
+    // This task is submitted after all messages have been delivered, so that
+    // all the completions of commands have been run before it.
+    bench.elapsed = uv_hrtime() - bench.elapsed;
+    uv_sem_post(&bench.done);
+}
+
+
+static void bench_recv_fence(pomelo_plugin_t * plugin, void * data) {
+    (void) data;
+    pomelo_webrtc_context_t * context = plugin->get_data(plugin);
+    pomelo_webrtc_variant_t args[] = {{ .ptr = &bench }};
+    pomelo_webrtc_context_submit_task(
+        context,
+        bench_recv_complete_callback,
+        POMELO_ARRAY_LENGTH(args),
+        args
+    );
+}
+
+
+static void bench_recv_batch_callback(
+    size_t argc,
+    pomelo_webrtc_variant_t * args
+) {
+    assert(argc == 1);
+    uint64_t count = args[0].u64;
+    size_t size = bench.options->message_size;
+    rtc_context_t * rtc_context = bench.context->rtc_context;
+
+    for (uint64_t i = 0; i < count; i++) {
+        uint8_t * data = NULL;
+        rtc_buffer_t * message = rtc_buffer_prepare(rtc_context, size, &data);
+        if (!message) continue;
+
+        memset(data, 0, size);
+        pomelo_webrtc_bench_write_u64(data, uv_hrtime());
+        pomelo_webrtc_channel_receive(&bench_channel, message, 0);
+        rtc_buffer_unref(message);
+    }
+    uv_sem_post(&bench.done);
+}
+
+
+static void bench_recv_command(pomelo_webrtc_mock_t * mock) {
+    pomelo_plugin_t * plugin = pomelo_webrtc_mock_plugin(mock);
+    uint64_t iterations = bench.options->iterations;
+    if (bench.options->message_size < 8) return;
+
+    // Create a native session to receive the messages
+    pomelo_address_t address;
+    pomelo_address_from_string(&address, "127.0.0.1:1");
+    bench_native_session = plugin->session_create(plugin, NULL, 1, &address);
+    if (!bench_native_session) return;
+
+    memset(&bench_session, 0, sizeof(bench_session));
+    bench_session.context = bench.context;
+    bench_session.native_session = bench_native_session;
+
+    memset(&bench_channel, 0, sizeof(bench_channel));
+    pomelo_reference_init(
+        &bench_channel.ref,
+        (pomelo_ref_finalize_cb) bench_recv_on_channel_finalize
+    );
+    bench_channel.context = bench.context;
+    bench_channel.session = &bench_session;
+    bench_channel.index = 0;
+
+    pomelo_histogram_reset(&bench.latency);
+    bench.elapsed = uv_hrtime();
+
+    for (uint64_t sent = 0; sent < iterations; sent += BENCH_RECV_BATCH) {
+        uint64_t count = iterations - sent;
+        if (count > BENCH_RECV_BATCH) count = BENCH_RECV_BATCH;
+
+        pomelo_webrtc_variant_t args[] = {{ .u64 = count }};
+        pomelo_webrtc_context_submit_task(
+            bench.context,
+            bench_recv_batch_callback,
+            POMELO_ARRAY_LENGTH(args),
+            args
+        );
+
+        // Keep the number of in-flight messages bounded
+        uv_sem_wait(&bench.done);
+        pomelo_webrtc_mock_drain(mock);
+    }
+
+    // Wait for all completions in plugin thread
+    plugin->executor_submit(plugin, bench_recv_fence, NULL);
+    uv_sem_wait(&bench.done);
+
+    bench_report("recv_command/round_trip", iterations, bench.elapsed);
+    pomelo_webrtc_bench_print_histogram("loop->host", &bench.latency);
+
+    plugin->session_destroy(plugin, bench_native_session);
+    bench_native_session = NULL;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/*                                  Driver                                    */
+/* -------------------------------------------------------------------------- */
+
+static void print_usage(const char * program) {
+    printf(
+        "Usage: %s [options]\n"
+        "  --iterations N         Iterations of every benchmark (default 1000000)\n"
+        "  --threads N            Producer threads (default 4)\n"
+        "  --executor-latency US  Simulated executor latency (default 0)\n"
+        "  --size N               Message size in bytes (default 64)\n"
+        "  --only NAME            submit_task, string_buffer, rtc_buffer or\n"
+        "                         recv_command\n",
+        program
+    );
+}
+
+
+static int parse_options(int argc, char * argv[], bench_options_t * options) {
+    for (int i = 1; i < argc; i += 2) {
+        const char * arg = argv[i];
+        const char * value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (!value) return -1;
+
+        if (strcmp(arg, "--iterations") == 0) {
+            options->iterations = strtoull(value, NULL, 10);
+        } else if (strcmp(arg, "--threads") == 0) {
+            options->threads = (unsigned) strtoul(value, NULL, 10);
+        } else if (strcmp(arg, "--executor-latency") == 0) {
+            options->executor_latency_us = strtoull(value, NULL, 10);
+        } else if (strcmp(arg, "--size") == 0) {
+            options->message_size = strtoul(value, NULL, 10);
+        } else if (strcmp(arg, "--only") == 0) {
+            options->only = value;
+        } else {
+            return -1;
+        }
+    }
+
+    if (options->iterations == 0) return -1;
+    if (options->threads == 0 || options->threads > BENCH_MAX_THREADS) {
+        return -1;
+    }
+    if (options->message_size == 0) return -1;
+    return 0;
+}
+
+
+int main(int argc, char * argv[]) {
+    bench_options_t options = {
+        .iterations = 1000000,
+        .threads = 4,
+        .executor_latency_us = 0,
+        .message_size = 64,
+        .only = NULL
+    };
+    if (parse_options(argc, argv, &options) < 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    pomelo_webrtc_mock_options_t mock_options;
+    memset(&mock_options, 0, sizeof(mock_options));
+    mock_options.nchannels = 1;
+    mock_options.channel_modes[0] = POMELO_CHANNEL_MODE_UNRELIABLE;
+    mock_options.executor_latency_us = options.executor_latency_us;
+    mock_options.on_receive = bench_recv_on_receive;
+
+    pomelo_webrtc_mock_t * mock = pomelo_webrtc_mock_create(&mock_options);
+    if (!mock) {
+        fprintf(stderr, "Failed to create mock plugin host\n");
+        return 1;
+    }
+
+    pomelo_plugin_t * plugin = pomelo_webrtc_mock_plugin(mock);
+    memset(&bench, 0, sizeof(bench));
+    bench.context = plugin->get_data(plugin);
+    bench.options = &options;
+    uv_sem_init(&bench.done, 0);
+
+    printf(
+        "iterations=%llu threads=%u executor_latency=%lluus size=%zu\n",
+        (unsigned long long) options.iterations,
+        options.threads,
+        (unsigned long long) options.executor_latency_us,
+        options.message_size
+    );
+
+    if (bench_enabled("submit_task")) bench_submit_task();
+    if (bench_enabled("string_buffer")) bench_string_buffer();
+    if (bench_enabled("rtc_buffer")) bench_rtc_buffer();
+    if (bench_enabled("recv_command")) bench_recv_command(mock);
+
+    pomelo_webrtc_mock_destroy(mock);
+    uv_sem_destroy(&bench.done);
+    return 0;
+}
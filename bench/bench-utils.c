@@ -0,0 +1,789 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "uv.h"
+#include "utils/common-macro.h"
+#include "bench-utils.h"
+
+
+/// Label of system channel
+#define BENCH_CLIENT_SYSTEM_LABEL "system"
+
+/// Prefixes of labels
+#define BENCH_CLIENT_SERVER_CHANNEL_PREFIX "server-channel-"
+#define BENCH_CLIENT_CLIENT_CHANNEL_PREFIX "client-channel-"
+
+/// Index of system channel
+#define BENCH_CLIENT_SYSTEM_INDEX SIZE_MAX
+
+/// Maximum size of a signaling message
+#define BENCH_CLIENT_WS_MESSAGE_MAX_SIZE 16384
+
+
+static const char base64_alphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+
+uint64_t pomelo_webrtc_bench_now_ns(void) {
+    return uv_hrtime();
+}
+
+
+void pomelo_webrtc_bench_usage(pomelo_webrtc_bench_usage_t * usage) {
+    assert(usage != NULL);
+    memset(usage, 0, sizeof(pomelo_webrtc_bench_usage_t));
+    usage->wall_ns = uv_hrtime();
+
+    uv_rusage_t rusage;
+    if (uv_getrusage(&rusage) == 0) {
+        uint64_t user_us = (uint64_t) rusage.ru_utime.tv_sec * 1000000ULL +
+            (uint64_t) rusage.ru_utime.tv_usec;
+        uint64_t sys_us = (uint64_t) rusage.ru_stime.tv_sec * 1000000ULL +
+            (uint64_t) rusage.ru_stime.tv_usec;
+        usage->cpu_ns = (user_us + sys_us) * 1000ULL;
+    }
+
+    size_t rss = 0;
+    if (uv_resident_set_memory(&rss) == 0) {
+        usage->rss = rss;
+    }
+}
+
+
+unsigned pomelo_webrtc_bench_ncores(void) {
+    unsigned ncores = uv_available_parallelism();
+    return ncores > 0 ? ncores : 1;
+}
+
+
+void pomelo_webrtc_bench_write_u64(uint8_t * buffer, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        buffer[i] = (uint8_t) (value >> (i * 8));
+    }
+}
+
+
+uint64_t pomelo_webrtc_bench_read_u64(const uint8_t * buffer) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+        value |= ((uint64_t) buffer[i]) << (i * 8);
+    }
+    return value;
+}
+
+
+void pomelo_webrtc_bench_write_u32(uint8_t * buffer, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        buffer[i] = (uint8_t) (value >> (i * 8));
+    }
+}
+
+
+uint32_t pomelo_webrtc_bench_read_u32(const uint8_t * buffer) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+        value |= ((uint32_t) buffer[i]) << (i * 8);
+    }
+    return value;
+}
+
+
+size_t pomelo_webrtc_bench_base64_encode(
+    char * output,
+    const uint8_t * data,
+    size_t length
+) {
+    assert(output != NULL);
+    size_t n = 0;
+    size_t i = 0;
+    for (; i + 2 < length; i += 3) {
+        uint32_t v = ((uint32_t) data[i] << 16) |
+            ((uint32_t) data[i + 1] << 8) | data[i + 2];
+        output[n++] = base64_alphabet[(v >> 18) & 0x3F];
+        output[n++] = base64_alphabet[(v >> 12) & 0x3F];
+        output[n++] = base64_alphabet[(v >> 6) & 0x3F];
+        output[n++] = base64_alphabet[v & 0x3F];
+    }
+
+    size_t remain = length - i;
+    if (remain > 0) {
+        uint32_t v = (uint32_t) data[i] << 16;
+        if (remain == 2) {
+            v |= (uint32_t) data[i + 1] << 8;
+        }
+        output[n++] = base64_alphabet[(v >> 18) & 0x3F];
+        output[n++] = base64_alphabet[(v >> 12) & 0x3F];
+        output[n++] = (remain == 2) ? base64_alphabet[(v >> 6) & 0x3F] : '=';
+        output[n++] = '=';
+    }
+
+    output[n] = '\0';
+    return n;
+}
+
+
+void pomelo_webrtc_bench_print_histogram(
+    const char * name,
+    pomelo_histogram_t * histogram
+) {
+    assert(histogram != NULL);
+    uint64_t count = pomelo_histogram_count(histogram);
+    if (count == 0) {
+        printf("  %-24s count=0\n", name);
+        return;
+    }
+
+    printf(
+        "  %-24s count=%llu mean=%.1fus p50=%.1fus p99=%.1fus p999=%.1fus "
+        "max=%.1fus\n",
+        name,
+        (unsigned long long) count,
+        pomelo_histogram_mean(histogram) / 1000.0,
+        pomelo_histogram_quantile(histogram, 0.5) / 1000.0,
+        pomelo_histogram_quantile(histogram, 0.99) / 1000.0,
+        pomelo_histogram_quantile(histogram, 0.999) / 1000.0,
+        pomelo_histogram_max(histogram) / 1000.0
+    );
+}
+
+
+/* -------------------------------------------------------------------------- */
+/*                          Signaling client helpers                          */
+/* -------------------------------------------------------------------------- */
+
+/// @brief Parse the channel index of a server data channel label
+static bool bench_client_parse_label(const char * label, size_t * index) {
+    if (strcmp(label, BENCH_CLIENT_SYSTEM_LABEL) == 0) {
+        *index = BENCH_CLIENT_SYSTEM_INDEX;
+        return true;
+    }
+
+    size_t prefix_length = sizeof(BENCH_CLIENT_SERVER_CHANNEL_PREFIX) - 1;
+    if (strncmp(label, BENCH_CLIENT_SERVER_CHANNEL_PREFIX, prefix_length)) {
+        return false;
+    }
+
+    char * end = NULL;
+    unsigned long value = strtoul(label + prefix_length, &end, 10);
+    if (end == label + prefix_length || *end != '\0') return false;
+    *index = (size_t) value;
+    return true;
+}
+
+
+/// @brief Mark the client as failed. The client must be locked.
+static void bench_client_fail(
+    pomelo_webrtc_bench_client_t * client,
+    pomelo_webrtc_bench_client_error error
+) {
+    if (client->state != POMELO_WEBRTC_BENCH_CLIENT_CONNECTING &&
+        client->state != POMELO_WEBRTC_BENCH_CLIENT_CONNECTED
+    ) {
+        return; // Already failed or stopped
+    }
+
+    client->state = POMELO_WEBRTC_BENCH_CLIENT_FAILED;
+    if (client->options.on_failed) {
+        client->options.on_failed(client, error);
+    }
+}
+
+
+/// @brief Check if the client is running. The client must be locked.
+static bool bench_client_is_running(pomelo_webrtc_bench_client_t * client) {
+    return client->state == POMELO_WEBRTC_BENCH_CLIENT_CONNECTING ||
+        client->state == POMELO_WEBRTC_BENCH_CLIENT_CONNECTED;
+}
+
+
+/// @brief Send a signaling message. The client must be locked.
+static void bench_client_send_ws(
+    pomelo_webrtc_bench_client_t * client,
+    const char * message
+) {
+    if (!client->ws) return;
+    if (rtc_websocket_client_send_string(client->ws, message) < 0) {
+        bench_client_fail(client, POMELO_WEBRTC_BENCH_CLIENT_ERROR_WS);
+    }
+}
+
+
+/// @brief Check if a data channel has been created by client. The client must
+/// be locked.
+static bool bench_client_owns_dc(
+    pomelo_webrtc_bench_client_t * client,
+    rtc_data_channel_t * dc
+) {
+    for (size_t i = 0; i < client->options.nchannels; i++) {
+        if (client->dcs[i] == dc) return true;
+    }
+    return false;
+}
+
+
+/// @brief Create the data channels of client. The client must be locked.
+static void bench_client_create_channels(
+    pomelo_webrtc_bench_client_t * client
+) {
+    char label[64];
+    rtc_data_channel_options_t options;
+
+    for (size_t i = 0; i < client->options.nchannels; i++) {
+        rtc_data_channel_options_init(&options);
+        snprintf(
+            label,
+            sizeof(label),
+            BENCH_CLIENT_CLIENT_CHANNEL_PREFIX "%zu",
+            i
+        );
+        options.label = label;
+        options.data = client;
+
+        switch (client->modes[i]) {
+            case POMELO_CHANNEL_MODE_SEQUENCED:
+                options.reliability.unreliable = true;
+                options.reliability.unordered = false;
+                break;
+
+            case POMELO_CHANNEL_MODE_RELIABLE:
+                options.reliability.unreliable = false;
+                options.reliability.unordered = false;
+                break;
+
+            default: // UNRELIABLE
+                options.reliability.unreliable = true;
+                options.reliability.unordered = true;
+        }
+
+        client->dcs[i] =
+            rtc_peer_connection_create_data_channel(client->pc, &options);
+        if (!client->dcs[i]) {
+            bench_client_fail(client, POMELO_WEBRTC_BENCH_CLIENT_ERROR_PC);
+            return;
+        }
+    }
+}
+
+
+/// @brief Process AUTH result. The client must be locked.
+static void bench_client_on_auth(
+    pomelo_webrtc_bench_client_t * client,
+    const char * result
+) {
+    if (strncmp(result, "OK", 2) != 0) {
+        bench_client_fail(client, POMELO_WEBRTC_BENCH_CLIENT_ERROR_AUTH);
+        return;
+    }
+
+    rtc_peer_connection_options_t options;
+    rtc_peer_connection_options_init(&options);
+    options.context = client->options.rtc_context;
+    options.data = client;
+
+    client->pc = rtc_peer_connection_create(&options);
+    if (!client->pc) {
+        bench_client_fail(client, POMELO_WEBRTC_BENCH_CLIENT_ERROR_CREATE);
+    }
+}
+
+
+/// @brief Process the offer of server. The client must be locked.
+static void bench_client_on_description(
+    pomelo_webrtc_bench_client_t * client,
+    char * args
+) {
+    // Format: <type>|<sdp>
+    char * separator = strchr(args, '|');
+    if (!separator || !client->pc) {
+        bench_client_fail(client, POMELO_WEBRTC_BENCH_CLIENT_ERROR_PC);
+        return;
+    }
+    *separator = '\0';
+
+    rtc_peer_connection_set_remote_description(
+        client->pc,
+        separator + 1,
+        args
+    );
+
+    // Negotiation is manual, so the answer must be created explicitly
+    rtc_peer_connection_set_local_description(client->pc, "answer");
+    const char * sdp =
+        rtc_peer_connection_get_local_description_sdp(client->pc);
+    if (!sdp) {
+        bench_client_fail(client, POMELO_WEBRTC_BENCH_CLIENT_ERROR_PC);
+        return;
+    }
+
+    char message[BENCH_CLIENT_WS_MESSAGE_MAX_SIZE];
+    int length = snprintf(message, sizeof(message), "DESC|answer|%s", sdp);
+    if (length < 0 || (size_t) length >= sizeof(message)) {
+        bench_client_fail(client, POMELO_WEBRTC_BENCH_CLIENT_ERROR_PC);
+        return;
+    }
+
+    bench_client_send_ws(client, message);
+    bench_client_create_channels(client);
+}
+
+
+/// @brief Process candidates of server. The client must be locked.
+static void bench_client_on_candidates(
+    pomelo_webrtc_bench_client_t * client,
+    char * args
+) {
+    // Format: <mid>|<cand>|<mid>|<cand>...
+    if (!client->pc) return;
+
+    char * cursor = args;
+    while (cursor && *cursor) {
+        char * mid = cursor;
+        char * cand = strchr(mid, '|');
+        if (!cand) return;
+        *cand++ = '\0';
+
+        cursor = strchr(cand, '|');
+        if (cursor) *cursor++ = '\0';
+        rtc_peer_connection_add_remote_candidate(client->pc, cand, mid);
+    }
+}
+
+
+/// @brief Process CONN. The client must be locked.
+static void bench_client_on_connected(pomelo_webrtc_bench_client_t * client) {
+    if (client->state != POMELO_WEBRTC_BENCH_CLIENT_CONNECTING) return;
+
+    client->state = POMELO_WEBRTC_BENCH_CLIENT_CONNECTED;
+    if (client->options.on_connected) {
+        client->options.on_connected(client);
+    }
+}
+
+
+/// @brief Reply a ping of server. The client must be locked.
+static void bench_client_on_ping(
+    rtc_data_channel_t * dc,
+    const uint8_t * data,
+    size_t size
+) {
+    if ((data[0] >> 6) != 0) return; // Not a ping
+
+    size_t sequence_bytes = ((data[0] >> 3) & 0x07) + 1;
+    if (size < sequence_bytes + 1) return;
+
+    uint8_t pong[1 + 8 + 8];
+    size_t time_bytes = 8;
+    pong[0] = (uint8_t) (
+        (1 << 6) | ((sequence_bytes - 1) << 3) | (time_bytes - 1)
+    );
+    memcpy(pong + 1, data + 1, sequence_bytes);
+    pomelo_webrtc_bench_write_u64(
+        pong + 1 + sequence_bytes,
+        pomelo_webrtc_bench_now_ns()
+    );
+    rtc_data_channel_send(dc, pong, 1 + sequence_bytes + time_bytes);
+}
+
+
+/* -------------------------------------------------------------------------- */
+/*                       Signaling client RTC callbacks                       */
+/* -------------------------------------------------------------------------- */
+
+static void bench_client_ws_on_open(rtc_websocket_client_t * wsc) {
+    pomelo_webrtc_bench_client_t * client = rtc_websocket_client_get_data(wsc);
+    if (!client) return;
+
+    uv_mutex_lock(&client->mutex);
+    if (client->ws == wsc &&
+        client->state == POMELO_WEBRTC_BENCH_CLIENT_CONNECTING
+    ) {
+        char token[POMELO_WEBRTC_MOCK_TOKEN_BASE64_LENGTH + 1];
+        pomelo_webrtc_mock_token_encode(
+            token,
+            client->options.client_id,
+            client->options.token_timeout_s
+        );
+
+        char message[sizeof(token) + 16];
+        snprintf(message, sizeof(message), "AUTH|%s|cands", token);
+        bench_client_send_ws(client, message);
+    }
+    uv_mutex_unlock(&client->mutex);
+}
+
+
+static void bench_client_ws_on_closed(rtc_websocket_client_t * wsc) {
+    pomelo_webrtc_bench_client_t * client = rtc_websocket_client_get_data(wsc);
+    if (!client) return;
+
+    uv_mutex_lock(&client->mutex);
+    if (client->ws == wsc) {
+        bench_client_fail(client, POMELO_WEBRTC_BENCH_CLIENT_ERROR_CLOSED);
+    }
+    uv_mutex_unlock(&client->mutex);
+}
+
+
+static void bench_client_ws_on_error(
+    rtc_websocket_client_t * wsc,
+    const char * error
+) {
+    (void) error;
+    pomelo_webrtc_bench_client_t * client = rtc_websocket_client_get_data(wsc);
+    if (!client) return;
+
+    uv_mutex_lock(&client->mutex);
+    if (client->ws == wsc) {
+        bench_client_fail(client, POMELO_WEBRTC_BENCH_CLIENT_ERROR_WS);
+    }
+    uv_mutex_unlock(&client->mutex);
+}
+
+
+static void bench_client_ws_on_message(
+    rtc_websocket_client_t * wsc,
+    rtc_buffer_t * buffer
+) {
+    pomelo_webrtc_bench_client_t * client = rtc_websocket_client_get_data(wsc);
+    if (!client) return;
+
+    // Copy the message, so that it can be tokenized in place
+    size_t size = rtc_buffer_size(buffer);
+    const uint8_t * data = rtc_buffer_data(buffer);
+    if (size > 0 && data[size - 1] == '\0') size--;
+    if (size >= BENCH_CLIENT_WS_MESSAGE_MAX_SIZE) return;
+
+    char message[BENCH_CLIENT_WS_MESSAGE_MAX_SIZE];
+    memcpy(message, data, size);
+    message[size] = '\0';
+
+    uv_mutex_lock(&client->mutex);
+    if (client->ws != wsc || !bench_client_is_running(client)) {
+        uv_mutex_unlock(&client->mutex);
+        return;
+    }
+
+    if (strncmp(message, "AUTH|", 5) == 0) {
+        bench_client_on_auth(client, message + 5);
+    } else if (strncmp(message, "DESC|", 5) == 0) {
+        bench_client_on_description(client, message + 5);
+    } else if (strncmp(message, "CANDS|", 6) == 0) {
+        bench_client_on_candidates(client, message + 6);
+    } else if (strncmp(message, "CAND|", 5) == 0) {
+        bench_client_on_candidates(client, message + 5);
+    } else if (strcmp(message, "CONN") == 0) {
+        bench_client_on_connected(client);
+    } else if (strncmp(message, "CLOSE", 5) == 0) {
+        bench_client_fail(client, POMELO_WEBRTC_BENCH_CLIENT_ERROR_CLOSED);
+    }
+    uv_mutex_unlock(&client->mutex);
+}
+
+
+static void bench_client_pc_on_local_candidate(
+    rtc_peer_connection_t * pc,
+    rtc_buffer_t * cand,
+    rtc_buffer_t * mid
+) {
+    pomelo_webrtc_bench_client_t * client = rtc_peer_connection_get_data(pc);
+    if (!client) return;
+
+    char message[BENCH_CLIENT_WS_MESSAGE_MAX_SIZE];
+    int length = snprintf(
+        message,
+        sizeof(message),
+        "CAND|%s|%s",
+        (const char *) rtc_buffer_data(mid),
+        (const char *) rtc_buffer_data(cand)
+    );
+    if (length < 0 || (size_t) length >= sizeof(message)) return;
+
+    uv_mutex_lock(&client->mutex);
+    if (client->pc == pc &&
+        client->state == POMELO_WEBRTC_BENCH_CLIENT_CONNECTING
+    ) {
+        bench_client_send_ws(client, message);
+    }
+    uv_mutex_unlock(&client->mutex);
+}
+
+
+static void bench_client_pc_on_state_change(
+    rtc_peer_connection_t * pc,
+    rtc_peer_connection_state state
+) {
+    if (state != RTC_PEER_CONNECTION_STATE_DISCONNECTED &&
+        state != RTC_PEER_CONNECTION_STATE_FAILED &&
+        state != RTC_PEER_CONNECTION_STATE_CLOSED
+    ) {
+        return;
+    }
+
+    pomelo_webrtc_bench_client_t * client = rtc_peer_connection_get_data(pc);
+    if (!client) return;
+
+    uv_mutex_lock(&client->mutex);
+    if (client->pc == pc) {
+        bench_client_fail(client, POMELO_WEBRTC_BENCH_CLIENT_ERROR_PC);
+    }
+    uv_mutex_unlock(&client->mutex);
+}
+
+
+static void bench_client_pc_on_data_channel(
+    rtc_peer_connection_t * pc,
+    rtc_data_channel_t * dc
+) {
+    pomelo_webrtc_bench_client_t * client = rtc_peer_connection_get_data(pc);
+    const char * label = rtc_data_channel_get_label(dc);
+    size_t index = 0;
+    bool accepted = false;
+
+    if (client && bench_client_parse_label(label, &index)) {
+        uv_mutex_lock(&client->mutex);
+        if (client->pc == pc &&
+            client->nserver_dcs < POMELO_ARRAY_LENGTH(client->server_dcs)
+        ) {
+            rtc_data_channel_set_data(dc, client);
+            client->server_dcs[client->nserver_dcs] = dc;
+            client->server_dc_indices[client->nserver_dcs] = index;
+            client->nserver_dcs++;
+            accepted = true;
+        }
+        uv_mutex_unlock(&client->mutex);
+    }
+
+    if (!accepted) {
+        rtc_data_channel_destroy(dc);
+    }
+}
+
+
+static void bench_client_dc_on_open(rtc_data_channel_t * dc) {
+    pomelo_webrtc_bench_client_t * client = rtc_data_channel_get_data(dc);
+    if (!client) return;
+
+    uv_mutex_lock(&client->mutex);
+    if (client->state == POMELO_WEBRTC_BENCH_CLIENT_CONNECTING &&
+        bench_client_owns_dc(client, dc)
+    ) {
+        client->opened_dcs++;
+        if (client->opened_dcs == client->options.nchannels) {
+            bench_client_send_ws(client, "READY");
+        }
+    }
+    uv_mutex_unlock(&client->mutex);
+}
+
+
+static void bench_client_dc_on_closed(rtc_data_channel_t * dc) {
+    pomelo_webrtc_bench_client_t * client = rtc_data_channel_get_data(dc);
+    if (!client) return;
+
+    uv_mutex_lock(&client->mutex);
+    if (bench_client_owns_dc(client, dc)) {
+        bench_client_fail(client, POMELO_WEBRTC_BENCH_CLIENT_ERROR_CLOSED);
+    }
+    uv_mutex_unlock(&client->mutex);
+}
+
+
+static void bench_client_dc_on_error(
+    rtc_data_channel_t * dc,
+    const char * error
+) {
+    (void) error;
+    pomelo_webrtc_bench_client_t * client = rtc_data_channel_get_data(dc);
+    if (!client) return;
+
+    uv_mutex_lock(&client->mutex);
+    if (bench_client_owns_dc(client, dc)) {
+        bench_client_fail(client, POMELO_WEBRTC_BENCH_CLIENT_ERROR_PC);
+    }
+    uv_mutex_unlock(&client->mutex);
+}
+
+
+static void bench_client_dc_on_message(
+    rtc_data_channel_t * dc,
+    rtc_buffer_t * buffer
+) {
+    pomelo_webrtc_bench_client_t * client = rtc_data_channel_get_data(dc);
+    if (!client) return; // Not registered yet
+
+    size_t size = rtc_buffer_size(buffer);
+    const uint8_t * data = rtc_buffer_data(buffer);
+    if (size == 0) return;
+
+    uv_mutex_lock(&client->mutex);
+    for (size_t i = 0; i < client->nserver_dcs; i++) {
+        if (client->server_dcs[i] != dc) continue;
+
+        size_t index = client->server_dc_indices[i];
+        if (index == BENCH_CLIENT_SYSTEM_INDEX) {
+            bench_client_on_ping(dc, data, size);
+        } else if (client->options.on_message) {
+            client->options.on_message(client, index, data, size);
+        }
+        break;
+    }
+    uv_mutex_unlock(&client->mutex);
+}
+
+
+/* -------------------------------------------------------------------------- */
+/*                              Signaling client                              */
+/* -------------------------------------------------------------------------- */
+
+rtc_context_t * pomelo_webrtc_bench_client_context_create(void) {
+    rtc_options_t options;
+    memset(&options, 0, sizeof(options));
+    options.log_level = RTC_LOG_LEVEL_NONE;
+    options.ws_open_callback = bench_client_ws_on_open;
+    options.ws_closed_callback = bench_client_ws_on_closed;
+    options.ws_error_callback = bench_client_ws_on_error;
+    options.ws_message_callback = bench_client_ws_on_message;
+    options.pc_local_candidate_callback = bench_client_pc_on_local_candidate;
+    options.pc_state_change_callback = bench_client_pc_on_state_change;
+    options.pc_data_channel_callback = bench_client_pc_on_data_channel;
+    options.dc_open_callback = bench_client_dc_on_open;
+    options.dc_closed_callback = bench_client_dc_on_closed;
+    options.dc_error_callback = bench_client_dc_on_error;
+    options.dc_message_callback = bench_client_dc_on_message;
+    return rtc_context_create(&options);
+}
+
+
+void pomelo_webrtc_bench_client_init(pomelo_webrtc_bench_client_t * client) {
+    assert(client != NULL);
+    memset(client, 0, sizeof(pomelo_webrtc_bench_client_t));
+    uv_mutex_init(&client->mutex);
+    client->state = POMELO_WEBRTC_BENCH_CLIENT_IDLE;
+}
+
+
+void pomelo_webrtc_bench_client_cleanup(
+    pomelo_webrtc_bench_client_t * client
+) {
+    assert(client != NULL);
+    assert(client->state == POMELO_WEBRTC_BENCH_CLIENT_IDLE);
+    uv_mutex_destroy(&client->mutex);
+}
+
+
+int pomelo_webrtc_bench_client_start(
+    pomelo_webrtc_bench_client_t * client,
+    pomelo_webrtc_bench_client_options_t * options
+) {
+    assert(client != NULL);
+    assert(options != NULL);
+    assert(options->nchannels <= POMELO_WEBRTC_MOCK_MAX_CHANNELS);
+
+    uv_mutex_lock(&client->mutex);
+    assert(client->state == POMELO_WEBRTC_BENCH_CLIENT_IDLE);
+    client->options = *options;
+    memcpy(
+        client->modes,
+        options->modes,
+        options->nchannels * sizeof(pomelo_channel_mode)
+    );
+    client->options.modes = client->modes;
+    client->opened_dcs = 0;
+    client->nserver_dcs = 0;
+    client->state = POMELO_WEBRTC_BENCH_CLIENT_CONNECTING;
+
+    rtc_websocket_client_options_t ws_options;
+    rtc_websocket_client_options_init(&ws_options);
+    ws_options.context = options->rtc_context;
+    ws_options.data = client;
+    ws_options.url = options->url;
+
+    // The client is locked, so callbacks of new websocket wait for assignment
+    client->ws = rtc_websocket_client_create(&ws_options);
+    int ret = 0;
+    if (!client->ws) {
+        bench_client_fail(client, POMELO_WEBRTC_BENCH_CLIENT_ERROR_CREATE);
+        ret = -1;
+    }
+    uv_mutex_unlock(&client->mutex);
+    return ret;
+}
+
+
+void pomelo_webrtc_bench_client_stop(
+    pomelo_webrtc_bench_client_t * client,
+    bool graceful
+) {
+    assert(client != NULL);
+    rtc_data_channel_t * dcs[POMELO_WEBRTC_MOCK_MAX_CHANNELS];
+    rtc_data_channel_t * server_dcs[POMELO_WEBRTC_MOCK_MAX_CHANNELS + 1];
+
+    // Detach the objects, then release them without holding the lock. The
+    // destroying waits for running callbacks, which may wait for the lock.
+    uv_mutex_lock(&client->mutex);
+    rtc_websocket_client_t * ws = client->ws;
+    rtc_peer_connection_t * pc = client->pc;
+    size_t nchannels = client->options.nchannels;
+    size_t nserver_dcs = client->nserver_dcs;
+    memcpy(dcs, client->dcs, sizeof(rtc_data_channel_t *) * nchannels);
+    memcpy(
+        server_dcs,
+        client->server_dcs,
+        sizeof(rtc_data_channel_t *) * nserver_dcs
+    );
+
+    client->ws = NULL;
+    client->pc = NULL;
+    memset(client->dcs, 0, sizeof(client->dcs));
+    client->nserver_dcs = 0;
+    client->state = POMELO_WEBRTC_BENCH_CLIENT_IDLE;
+    uv_mutex_unlock(&client->mutex);
+
+    if (graceful) {
+        for (size_t i = 0; i < nchannels; i++) {
+            if (dcs[i]) rtc_data_channel_close(dcs[i]);
+        }
+        if (pc) rtc_peer_connection_close(pc);
+        if (ws) rtc_websocket_client_close(ws);
+    }
+
+    for (size_t i = 0; i < nchannels; i++) {
+        if (dcs[i]) rtc_data_channel_destroy(dcs[i]);
+    }
+    for (size_t i = 0; i < nserver_dcs; i++) {
+        rtc_data_channel_destroy(server_dcs[i]);
+    }
+    if (pc) rtc_peer_connection_destroy(pc);
+    if (ws) rtc_websocket_client_destroy(ws);
+}
+
+
+void pomelo_webrtc_bench_client_lock(pomelo_webrtc_bench_client_t * client) {
+    assert(client != NULL);
+    uv_mutex_lock(&client->mutex);
+}
+
+
+void pomelo_webrtc_bench_client_unlock(
+    pomelo_webrtc_bench_client_t * client
+) {
+    assert(client != NULL);
+    uv_mutex_unlock(&client->mutex);
+}
+
+
+int pomelo_webrtc_bench_client_send(
+    pomelo_webrtc_bench_client_t * client,
+    size_t channel_index,
+    const uint8_t * data,
+    size_t size
+) {
+    assert(client != NULL);
+    if (client->state != POMELO_WEBRTC_BENCH_CLIENT_CONNECTED) return -1;
+    if (channel_index >= client->options.nchannels) return -1;
+
+    rtc_data_channel_t * dc = client->dcs[channel_index];
+    if (!dc) return -1;
+    return rtc_data_channel_send(dc, data, size);
+}
@@ -0,0 +1,273 @@
+#ifndef POMELO_WEBRTC_BENCH_UTILS_H
+#define POMELO_WEBRTC_BENCH_UTILS_H
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "uv.h"
+#include "rtc-api/rtc-api.h"
+#include "utils/histogram.h"
+#include "mock-plugin.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/// @brief Resource usage snapshot of the process
+typedef struct pomelo_webrtc_bench_usage_s {
+    /// @brief Wall clock time (ns)
+    uint64_t wall_ns;
+
+    /// @brief User + system CPU time (ns)
+    uint64_t cpu_ns;
+
+    /// @brief Resident set size (bytes)
+    size_t rss;
+} pomelo_webrtc_bench_usage_t;
+
+
+/// @brief Get monotonic time in nanoseconds
+uint64_t pomelo_webrtc_bench_now_ns(void);
+
+
+/// @brief Take a resource usage snapshot
+void pomelo_webrtc_bench_usage(pomelo_webrtc_bench_usage_t * usage);
+
+
+/// @brief Get the number of available CPU cores
+unsigned pomelo_webrtc_bench_ncores(void);
+
+
+/// @brief Write a 64-bit unsigned integer in little-endian
+void pomelo_webrtc_bench_write_u64(uint8_t * buffer, uint64_t value);
+
+
+/// @brief Read a 64-bit unsigned integer in little-endian
+uint64_t pomelo_webrtc_bench_read_u64(const uint8_t * buffer);
+
+
+/// @brief Write a 32-bit unsigned integer in little-endian
+void pomelo_webrtc_bench_write_u32(uint8_t * buffer, uint32_t value);
+
+
+/// @brief Read a 32-bit unsigned integer in little-endian
+uint32_t pomelo_webrtc_bench_read_u32(const uint8_t * buffer);
+
+
+/// @brief Encode data in base64 with padding. The output is terminated.
+/// @return Length of encoded string
+size_t pomelo_webrtc_bench_base64_encode(
+    char * output,
+    const uint8_t * data,
+    size_t length
+);
+
+
+/// @brief Print a histogram of nanosecond values in microseconds
+void pomelo_webrtc_bench_print_histogram(
+    const char * name,
+    pomelo_histogram_t * histogram
+);
+
+
+/* -------------------------------------------------------------------------- */
+/*                             Signaling client                               */
+/* -------------------------------------------------------------------------- */
+
+/*
+    In-process client of the benchmarks, on top of rtc-api.
+    It runs the signaling flow against the plugin (AUTH with the "cands"
+    feature, DESC, CAND, CANDS, READY, CONN), creates one client channel per
+    configured mode, accepts the channels of server and answers the pings of
+    system channel.
+
+    All RTC callbacks of clients go through the context which is created by
+    pomelo_webrtc_bench_client_context_create. Client callbacks are called in
+    libdatachannel threads with the client locked, they must not call
+    pomelo_webrtc_bench_client_start or pomelo_webrtc_bench_client_stop.
+*/
+
+/// @brief State of a bench client
+typedef enum pomelo_webrtc_bench_client_state_e {
+    /// @brief The client has not been started or has been stopped
+    POMELO_WEBRTC_BENCH_CLIENT_IDLE,
+
+    /// @brief Signaling is in progress
+    POMELO_WEBRTC_BENCH_CLIENT_CONNECTING,
+
+    /// @brief CONN has been received
+    POMELO_WEBRTC_BENCH_CLIENT_CONNECTED,
+
+    /// @brief The client has failed, it is waiting to be stopped
+    POMELO_WEBRTC_BENCH_CLIENT_FAILED
+} pomelo_webrtc_bench_client_state;
+
+
+/// @brief Failure of a bench client
+typedef enum pomelo_webrtc_bench_client_error_e {
+    /// @brief Failed to create the websocket or the peer connection
+    POMELO_WEBRTC_BENCH_CLIENT_ERROR_CREATE,
+
+    /// @brief Websocket error
+    POMELO_WEBRTC_BENCH_CLIENT_ERROR_WS,
+
+    /// @brief Authentication has been rejected
+    POMELO_WEBRTC_BENCH_CLIENT_ERROR_AUTH,
+
+    /// @brief Peer connection or data channel failure
+    POMELO_WEBRTC_BENCH_CLIENT_ERROR_PC,
+
+    /// @brief The server has closed the session
+    POMELO_WEBRTC_BENCH_CLIENT_ERROR_CLOSED
+} pomelo_webrtc_bench_client_error;
+
+
+/// @brief Bench client
+typedef struct pomelo_webrtc_bench_client_s pomelo_webrtc_bench_client_t;
+
+/// @brief Options of bench client
+typedef struct pomelo_webrtc_bench_client_options_s
+    pomelo_webrtc_bench_client_options_t;
+
+
+/// @brief Called when CONN has been received
+typedef void (*pomelo_webrtc_bench_client_connected_cb)(
+    pomelo_webrtc_bench_client_t * client
+);
+
+
+/// @brief Called once when the client fails
+typedef void (*pomelo_webrtc_bench_client_failed_cb)(
+    pomelo_webrtc_bench_client_t * client,
+    pomelo_webrtc_bench_client_error error
+);
+
+
+/// @brief Called when a message of a server channel has been received
+typedef void (*pomelo_webrtc_bench_client_message_cb)(
+    pomelo_webrtc_bench_client_t * client,
+    size_t channel_index,
+    const uint8_t * data,
+    size_t size
+);
+
+
+struct pomelo_webrtc_bench_client_options_s {
+    /// @brief RTC context of clients
+    rtc_context_t * rtc_context;
+
+    /// @brief URL of server. It must outlive the start call.
+    const char * url;
+
+    /// @brief Client ID which is carried by the connect token
+    int64_t client_id;
+
+    /// @brief Connect timeout of the connect token (s)
+    int32_t token_timeout_s;
+
+    /// @brief Number of channels
+    size_t nchannels;
+
+    /// @brief Modes of channels
+    const pomelo_channel_mode * modes;
+
+    /// @brief Connected callback (optional)
+    pomelo_webrtc_bench_client_connected_cb on_connected;
+
+    /// @brief Failed callback (optional)
+    pomelo_webrtc_bench_client_failed_cb on_failed;
+
+    /// @brief Message callback (optional)
+    pomelo_webrtc_bench_client_message_cb on_message;
+
+    /// @brief Associated data
+    void * data;
+};
+
+
+struct pomelo_webrtc_bench_client_s {
+    /// @brief Lock of client. Callbacks come from libdatachannel threads.
+    uv_mutex_t mutex;
+
+    /// @brief State of client
+    pomelo_webrtc_bench_client_state state;
+
+    /// @brief Options of current run
+    pomelo_webrtc_bench_client_options_t options;
+
+    /// @brief Modes of channels
+    pomelo_channel_mode modes[POMELO_WEBRTC_MOCK_MAX_CHANNELS];
+
+    /// @brief Websocket client
+    rtc_websocket_client_t * ws;
+
+    /// @brief Peer connection
+    rtc_peer_connection_t * pc;
+
+    /// @brief Data channels which are created by client
+    rtc_data_channel_t * dcs[POMELO_WEBRTC_MOCK_MAX_CHANNELS];
+
+    /// @brief Number of opened client data channels
+    size_t opened_dcs;
+
+    /// @brief Data channels which are created by server
+    rtc_data_channel_t * server_dcs[POMELO_WEBRTC_MOCK_MAX_CHANNELS + 1];
+
+    /// @brief Channel indices of server data channels
+    size_t server_dc_indices[POMELO_WEBRTC_MOCK_MAX_CHANNELS + 1];
+
+    /// @brief Number of server data channels
+    size_t nserver_dcs;
+};
+
+
+/// @brief Create the RTC context of bench clients
+rtc_context_t * pomelo_webrtc_bench_client_context_create(void);
+
+
+/// @brief Initialize a client. It is idle until it is started.
+void pomelo_webrtc_bench_client_init(pomelo_webrtc_bench_client_t * client);
+
+
+/// @brief Cleanup a stopped client
+void pomelo_webrtc_bench_client_cleanup(pomelo_webrtc_bench_client_t * client);
+
+
+/// @brief Start the signaling of an idle client
+/// @return 0 on success, or -1 if the websocket cannot be created. In that
+/// case, the failed callback has been called.
+int pomelo_webrtc_bench_client_start(
+    pomelo_webrtc_bench_client_t * client,
+    pomelo_webrtc_bench_client_options_t * options
+);
+
+
+/// @brief Release all RTC objects of client, it becomes idle. A graceful stop
+/// closes the channels, the peer connection and the websocket first.
+void pomelo_webrtc_bench_client_stop(
+    pomelo_webrtc_bench_client_t * client,
+    bool graceful
+);
+
+
+/// @brief Lock the client
+void pomelo_webrtc_bench_client_lock(pomelo_webrtc_bench_client_t * client);
+
+
+/// @brief Unlock the client
+void pomelo_webrtc_bench_client_unlock(pomelo_webrtc_bench_client_t * client);
+
+
+/// @brief Send a message on a client channel. The client must be locked.
+/// @return 0 on success, or -1 on failure
+int pomelo_webrtc_bench_client_send(
+    pomelo_webrtc_bench_client_t * client,
+    size_t channel_index,
+    const uint8_t * data,
+    size_t size
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // POMELO_WEBRTC_BENCH_UTILS_H
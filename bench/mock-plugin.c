@@ -0,0 +1,798 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "uv.h"
+#include "plugin.h"
+#include "mock-plugin.h"
+#include "bench-utils.h"
+
+
+/// Offset of client ID in mock connect token
+#define MOCK_TOKEN_CLIENT_ID_OFFSET 0
+
+/// Offset of connect timeout in mock connect token
+#define MOCK_TOKEN_TIMEOUT_OFFSET 8
+
+/// Maximum time to wait for sessions to be destroyed when stopping (ms)
+#define MOCK_STOP_TIMEOUT_MS 3000
+
+
+/// @brief Executor task
+typedef struct pomelo_webrtc_mock_task_s pomelo_webrtc_mock_task_t;
+
+struct pomelo_webrtc_mock_task_s {
+    /// @brief Callback of task
+    pomelo_plugin_task_callback callback;
+
+    /// @brief Callback data
+    void * data;
+
+    /// @brief Time when the task can be run (ns)
+    uint64_t due_time;
+
+    /// @brief Next task
+    pomelo_webrtc_mock_task_t * next;
+};
+
+
+struct pomelo_socket_s {
+    /// @brief Owner of socket
+    pomelo_webrtc_mock_t * mock;
+
+    /// @brief Start time of socket
+    uint64_t start_time;
+};
+
+
+struct pomelo_session_s {
+    /// @brief Owner of session
+    pomelo_webrtc_mock_t * mock;
+
+    /// @brief Client ID
+    int64_t client_id;
+
+    /// @brief Address of session
+    pomelo_address_t address;
+
+    /// @brief Private data (set by plugin)
+    void * private_data;
+
+    /// @brief User data
+    void * data;
+
+    /// @brief Previous session in list
+    pomelo_session_t * prev;
+
+    /// @brief Next session in list
+    pomelo_session_t * next;
+};
+
+
+struct pomelo_message_s {
+    /// @brief Data of message
+    uint8_t * data;
+
+    /// @brief Length of message
+    size_t length;
+
+    /// @brief Capacity of data
+    size_t capacity;
+};
+
+
+struct pomelo_webrtc_mock_s {
+    /// @brief The plugin. This must be the first member.
+    pomelo_plugin_t plugin;
+
+    /// @brief Data of plugin
+    void * plugin_data;
+
+    /// @brief Options
+    pomelo_webrtc_mock_options_t options;
+
+    /// @brief The only socket of mock host
+    pomelo_socket_t socket;
+
+    /// @brief Whether the socket is listening
+    int listening;
+
+    /* Callbacks of plugin */
+    void (*on_unload)(pomelo_plugin_t *);
+    void (*socket_on_listening)(
+        pomelo_plugin_t *, pomelo_socket_t *, pomelo_address_t *
+    );
+    void (*socket_on_stopped)(pomelo_plugin_t *, pomelo_socket_t *);
+    void (*session_send)(
+        pomelo_plugin_t *, pomelo_session_t *, size_t, pomelo_message_t *
+    );
+    void (*session_disconnect)(pomelo_plugin_t *, pomelo_session_t *);
+
+    /* Executor */
+
+    /// @brief Executor thread
+    uv_thread_t executor_thread;
+
+    /// @brief Lock of executor queue and session list
+    uv_mutex_t mutex;
+
+    /// @brief Signaled when a task has been queued
+    uv_cond_t task_cond;
+
+    /// @brief Signaled when the executor becomes idle
+    uv_cond_t idle_cond;
+
+    /// @brief Head of task queue
+    pomelo_webrtc_mock_task_t * task_head;
+
+    /// @brief Tail of task queue
+    pomelo_webrtc_mock_task_t * task_tail;
+
+    /// @brief Whether the executor is running a task
+    int executor_busy;
+
+    /// @brief Whether the executor is going to exit
+    int executor_exiting;
+
+    /// @brief Whether the executor is started up by plugin
+    int executor_started;
+
+    /* Sessions */
+
+    /// @brief Living native sessions
+    pomelo_session_t * sessions;
+
+    /// @brief Number of living native sessions
+    size_t session_count;
+};
+
+
+/* -------------------------------------------------------------------------- */
+/*                                Executor                                    */
+/* -------------------------------------------------------------------------- */
+
+/// @brief Sleep for a short duration. Sub-millisecond durations are spun.
+static void mock_sleep_ns(uint64_t duration) {
+    uint64_t deadline = uv_hrtime() + duration;
+    if (duration >= 2000000ULL) {
+        uv_sleep((unsigned int) (duration / 1000000ULL) - 1);
+    }
+
+    while (uv_hrtime() < deadline) {
+        // Spin
+    }
+}
+
+
+static void mock_executor_run(void * data) {
+    pomelo_webrtc_mock_t * mock = data;
+
+    uv_mutex_lock(&mock->mutex);
+    for (;;) {
+        while (!mock->task_head && !mock->executor_exiting) {
+            uv_cond_broadcast(&mock->idle_cond);
+            uv_cond_wait(&mock->task_cond, &mock->mutex);
+        }
+
+        pomelo_webrtc_mock_task_t * task = mock->task_head;
+        if (!task) break; // Exiting with an empty queue
+
+        mock->task_head = task->next;
+        if (!mock->task_head) {
+            mock->task_tail = NULL;
+        }
+        mock->executor_busy = 1;
+        uv_mutex_unlock(&mock->mutex);
+
+        // Simulate the latency of executor
+        uint64_t now = uv_hrtime();
+        if (task->due_time > now) {
+            mock_sleep_ns(task->due_time - now);
+        }
+
+        task->callback(&mock->plugin, task->data);
+        free(task);
+
+        uv_mutex_lock(&mock->mutex);
+        mock->executor_busy = 0;
+    }
+    uv_cond_broadcast(&mock->idle_cond);
+    uv_mutex_unlock(&mock->mutex);
+}
+
+
+/// @brief Stop the executor thread and drop the remaining tasks
+static void mock_executor_stop(pomelo_webrtc_mock_t * mock) {
+    uv_mutex_lock(&mock->mutex);
+    pomelo_webrtc_mock_task_t * task = mock->task_head;
+    mock->task_head = NULL;
+    mock->task_tail = NULL;
+    mock->executor_exiting = 1;
+    uv_cond_signal(&mock->task_cond);
+    uv_mutex_unlock(&mock->mutex);
+
+    uv_thread_join(&mock->executor_thread);
+
+    while (task) {
+        pomelo_webrtc_mock_task_t * next = task->next;
+        free(task);
+        task = next;
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+/*                             Plugin interface                               */
+/* -------------------------------------------------------------------------- */
+
+static void mock_configure_callbacks(
+    pomelo_plugin_t * plugin,
+    void (*on_unload)(pomelo_plugin_t *),
+    void (*socket_on_created)(pomelo_plugin_t *, pomelo_socket_t *),
+    void (*socket_on_destroyed)(pomelo_plugin_t *, pomelo_socket_t *),
+    void (*socket_on_listening)(
+        pomelo_plugin_t *, pomelo_socket_t *, pomelo_address_t *
+    ),
+    void (*socket_on_connecting)(pomelo_plugin_t *, pomelo_socket_t *, uint8_t *),
+    void (*socket_on_stopped)(pomelo_plugin_t *, pomelo_socket_t *),
+    void (*session_send)(
+        pomelo_plugin_t *, pomelo_session_t *, size_t, pomelo_message_t *
+    ),
+    void (*session_disconnect)(pomelo_plugin_t *, pomelo_session_t *),
+    void (*session_get_rtt)(
+        pomelo_plugin_t *, pomelo_session_t *, uint64_t *, uint64_t *
+    ),
+    int (*session_set_mode)(
+        pomelo_plugin_t *, pomelo_session_t *, size_t, pomelo_channel_mode
+    )
+) {
+    (void) socket_on_created;
+    (void) socket_on_destroyed;
+    (void) socket_on_connecting;
+    (void) session_get_rtt;
+    (void) session_set_mode;
+
+    pomelo_webrtc_mock_t * mock = (pomelo_webrtc_mock_t *) plugin;
+    mock->on_unload = on_unload;
+    mock->socket_on_listening = socket_on_listening;
+    mock->socket_on_stopped = socket_on_stopped;
+    mock->session_send = session_send;
+    mock->session_disconnect = session_disconnect;
+}
+
+
+static int mock_connect_token_decode(
+    pomelo_plugin_t * plugin,
+    pomelo_socket_t * socket,
+    uint8_t * connect_token,
+    pomelo_plugin_token_info_t * info
+) {
+    (void) socket;
+    pomelo_webrtc_mock_t * mock = (pomelo_webrtc_mock_t *) plugin;
+    if (mock->options.token_decode_cost_us > 0) {
+        // Simulate the cost of decrypting the token
+        uint64_t deadline =
+            uv_hrtime() + mock->options.token_decode_cost_us * 1000ULL;
+        while (uv_hrtime() < deadline) {
+            // Spin
+        }
+    }
+
+    int64_t client_id = (int64_t) pomelo_webrtc_bench_read_u64(
+        connect_token + MOCK_TOKEN_CLIENT_ID_OFFSET
+    );
+    if (client_id <= 0) return -1;
+
+    if (info->client_id) {
+        *info->client_id = client_id;
+    }
+
+    if (info->timeout) {
+        *info->timeout = (int32_t) pomelo_webrtc_bench_read_u32(
+            connect_token + MOCK_TOKEN_TIMEOUT_OFFSET
+        );
+    }
+    return 0;
+}
+
+
+static void mock_executor_startup(pomelo_plugin_t * plugin) {
+    pomelo_webrtc_mock_t * mock = (pomelo_webrtc_mock_t *) plugin;
+    uv_mutex_lock(&mock->mutex);
+    mock->executor_started = 1;
+    uv_mutex_unlock(&mock->mutex);
+}
+
+
+static void mock_executor_shutdown(pomelo_plugin_t * plugin) {
+    pomelo_webrtc_mock_t * mock = (pomelo_webrtc_mock_t *) plugin;
+    uv_mutex_lock(&mock->mutex);
+    mock->executor_started = 0;
+    uv_mutex_unlock(&mock->mutex);
+}
+
+
+static int mock_executor_submit(
+    pomelo_plugin_t * plugin,
+    pomelo_plugin_task_callback callback,
+    void * data
+) {
+    pomelo_webrtc_mock_t * mock = (pomelo_webrtc_mock_t *) plugin;
+    pomelo_webrtc_mock_task_t * task = malloc(sizeof(pomelo_webrtc_mock_task_t));
+    if (!task) return -1;
+
+    task->callback = callback;
+    task->data = data;
+    task->due_time = mock->options.executor_latency_us > 0
+        ? uv_hrtime() + mock->options.executor_latency_us * 1000ULL
+        : 0;
+    task->next = NULL;
+
+    uv_mutex_lock(&mock->mutex);
+    if (mock->executor_exiting) {
+        uv_mutex_unlock(&mock->mutex);
+        free(task);
+        return -1;
+    }
+
+    if (mock->task_tail) {
+        mock->task_tail->next = task;
+    } else {
+        mock->task_head = task;
+    }
+    mock->task_tail = task;
+    uv_cond_signal(&mock->task_cond);
+    uv_mutex_unlock(&mock->mutex);
+    return 0;
+}
+
+
+static void * mock_get_data(pomelo_plugin_t * plugin) {
+    return ((pomelo_webrtc_mock_t *) plugin)->plugin_data;
+}
+
+
+static void mock_set_data(pomelo_plugin_t * plugin, void * data) {
+    ((pomelo_webrtc_mock_t *) plugin)->plugin_data = data;
+}
+
+
+static pomelo_message_t * mock_message_acquire(pomelo_plugin_t * plugin) {
+    (void) plugin;
+    return calloc(1, sizeof(pomelo_message_t));
+}
+
+
+static size_t mock_message_length(
+    pomelo_plugin_t * plugin,
+    pomelo_message_t * message
+) {
+    (void) plugin;
+    return message->length;
+}
+
+
+static int mock_message_read(
+    pomelo_plugin_t * plugin,
+    pomelo_message_t * message,
+    uint8_t * buffer,
+    size_t length
+) {
+    (void) plugin;
+    if (length > message->length) return -1;
+    memcpy(buffer, message->data, length);
+    return 0;
+}
+
+
+static int mock_message_write(
+    pomelo_plugin_t * plugin,
+    pomelo_message_t * message,
+    const uint8_t * buffer,
+    size_t length
+) {
+    (void) plugin;
+    if (message->length + length > message->capacity) {
+        size_t capacity = message->capacity ? message->capacity : 64;
+        while (capacity < message->length + length) {
+            capacity *= 2;
+        }
+
+        uint8_t * data = realloc(message->data, capacity);
+        if (!data) return -1;
+        message->data = data;
+        message->capacity = capacity;
+    }
+
+    memcpy(message->data + message->length, buffer, length);
+    message->length += length;
+    return 0;
+}
+
+
+static void mock_message_release(pomelo_message_t * message) {
+    free(message->data);
+    free(message);
+}
+
+
+static pomelo_session_t * mock_session_create(
+    pomelo_plugin_t * plugin,
+    pomelo_socket_t * socket,
+    int64_t client_id,
+    pomelo_address_t * address
+) {
+    (void) socket;
+    pomelo_webrtc_mock_t * mock = (pomelo_webrtc_mock_t *) plugin;
+    pomelo_session_t * session = calloc(1, sizeof(pomelo_session_t));
+    if (!session) return NULL;
+
+    session->mock = mock;
+    session->client_id = client_id;
+    if (address) {
+        session->address = *address;
+    }
+
+    uv_mutex_lock(&mock->mutex);
+    session->next = mock->sessions;
+    if (mock->sessions) {
+        mock->sessions->prev = session;
+    }
+    mock->sessions = session;
+    mock->session_count++;
+    uv_mutex_unlock(&mock->mutex);
+
+    if (mock->options.on_session_created) {
+        mock->options.on_session_created(mock, session);
+    }
+    return session;
+}
+
+
+static void mock_session_unlink(
+    pomelo_webrtc_mock_t * mock,
+    pomelo_session_t * session
+) {
+    if (session->prev) {
+        session->prev->next = session->next;
+    } else {
+        mock->sessions = session->next;
+    }
+
+    if (session->next) {
+        session->next->prev = session->prev;
+    }
+    mock->session_count--;
+}
+
+
+static void mock_session_destroy(
+    pomelo_plugin_t * plugin,
+    pomelo_session_t * session
+) {
+    pomelo_webrtc_mock_t * mock = (pomelo_webrtc_mock_t *) plugin;
+    if (mock->options.on_session_destroyed) {
+        mock->options.on_session_destroyed(mock, session);
+    }
+
+    uv_mutex_lock(&mock->mutex);
+    mock_session_unlink(mock, session);
+    uv_mutex_unlock(&mock->mutex);
+
+    free(session);
+}
+
+
+static void * mock_session_get_private(
+    pomelo_plugin_t * plugin,
+    pomelo_session_t * session
+) {
+    (void) plugin;
+    return session->private_data;
+}
+
+
+static void mock_session_set_private(
+    pomelo_plugin_t * plugin,
+    pomelo_session_t * session,
+    void * data
+) {
+    (void) plugin;
+    session->private_data = data;
+}
+
+
+static void mock_session_receive(
+    pomelo_plugin_t * plugin,
+    pomelo_session_t * session,
+    size_t channel_index,
+    pomelo_message_t * message
+) {
+    pomelo_webrtc_mock_t * mock = (pomelo_webrtc_mock_t *) plugin;
+    if (mock->options.on_receive) {
+        mock->options.on_receive(
+            mock,
+            session,
+            channel_index,
+            message->data,
+            message->length
+        );
+    }
+
+    // Received messages are owned by the host
+    mock_message_release(message);
+}
+
+
+static size_t mock_socket_get_nchannels(
+    pomelo_plugin_t * plugin,
+    pomelo_socket_t * socket
+) {
+    (void) socket;
+    return ((pomelo_webrtc_mock_t *) plugin)->options.nchannels;
+}
+
+
+static pomelo_channel_mode mock_socket_get_channel_mode(
+    pomelo_plugin_t * plugin,
+    pomelo_socket_t * socket,
+    size_t channel_index
+) {
+    (void) socket;
+    pomelo_webrtc_mock_t * mock = (pomelo_webrtc_mock_t *) plugin;
+    if (channel_index >= mock->options.nchannels) {
+        return POMELO_CHANNEL_MODE_UNRELIABLE;
+    }
+    return mock->options.channel_modes[channel_index];
+}
+
+
+static uint64_t mock_socket_time(
+    pomelo_plugin_t * plugin,
+    pomelo_socket_t * socket
+) {
+    (void) plugin;
+    return uv_hrtime() - socket->start_time;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/*                               Public APIs                                  */
+/* -------------------------------------------------------------------------- */
+
+pomelo_webrtc_mock_t * pomelo_webrtc_mock_create(
+    pomelo_webrtc_mock_options_t * options
+) {
+    assert(options != NULL);
+    if (options->nchannels == 0 ||
+        options->nchannels > POMELO_WEBRTC_MOCK_MAX_CHANNELS
+    ) {
+        return NULL; // Invalid number of channels
+    }
+
+    pomelo_webrtc_mock_t * mock = calloc(1, sizeof(pomelo_webrtc_mock_t));
+    if (!mock) return NULL;
+
+    mock->options = *options;
+    mock->socket.mock = mock;
+
+    pomelo_plugin_t * plugin = &mock->plugin;
+    plugin->configure_callbacks = mock_configure_callbacks;
+    plugin->connect_token_decode = mock_connect_token_decode;
+    plugin->executor_startup = mock_executor_startup;
+    plugin->executor_shutdown = mock_executor_shutdown;
+    plugin->executor_submit = mock_executor_submit;
+    plugin->get_data = mock_get_data;
+    plugin->set_data = mock_set_data;
+    plugin->message_acquire = mock_message_acquire;
+    plugin->message_length = mock_message_length;
+    plugin->message_read = mock_message_read;
+    plugin->message_write = mock_message_write;
+    plugin->session_create = mock_session_create;
+    plugin->session_destroy = mock_session_destroy;
+    plugin->session_get_private = mock_session_get_private;
+    plugin->session_set_private = mock_session_set_private;
+    plugin->session_receive = mock_session_receive;
+    plugin->socket_get_nchannels = mock_socket_get_nchannels;
+    plugin->socket_get_channel_mode = mock_socket_get_channel_mode;
+    plugin->socket_time = mock_socket_time;
+
+    uv_mutex_init(&mock->mutex);
+    uv_cond_init(&mock->task_cond);
+    uv_cond_init(&mock->idle_cond);
+    if (uv_thread_create(&mock->executor_thread, mock_executor_run, mock) < 0) {
+        uv_cond_destroy(&mock->idle_cond);
+        uv_cond_destroy(&mock->task_cond);
+        uv_mutex_destroy(&mock->mutex);
+        free(mock);
+        return NULL;
+    }
+
+    // Load the plugin
+    pomelo_webrtc_entry(plugin);
+    if (!mock->plugin_data) {
+        mock_executor_stop(mock);
+        uv_cond_destroy(&mock->idle_cond);
+        uv_cond_destroy(&mock->task_cond);
+        uv_mutex_destroy(&mock->mutex);
+        free(mock);
+        return NULL;
+    }
+
+    return mock;
+}
+
+
+void pomelo_webrtc_mock_destroy(pomelo_webrtc_mock_t * mock) {
+    assert(mock != NULL);
+    pomelo_webrtc_mock_stop(mock);
+    pomelo_webrtc_mock_drain(mock);
+
+    // Unload the plugin. This will join the thread of plugin.
+    if (mock->on_unload) {
+        mock->on_unload(&mock->plugin);
+    } else {
+        pomelo_webrtc_on_unload(&mock->plugin);
+    }
+
+    // Tasks which are submitted after unloading are dropped
+    mock_executor_stop(mock);
+
+    // Release the remaining native sessions
+    pomelo_session_t * session = mock->sessions;
+    while (session) {
+        pomelo_session_t * next = session->next;
+        free(session);
+        session = next;
+    }
+    mock->sessions = NULL;
+    mock->session_count = 0;
+
+    uv_cond_destroy(&mock->idle_cond);
+    uv_cond_destroy(&mock->task_cond);
+    uv_mutex_destroy(&mock->mutex);
+    free(mock);
+}
+
+
+int pomelo_webrtc_mock_listen(pomelo_webrtc_mock_t * mock) {
+    assert(mock != NULL);
+    if (mock->listening || !mock->socket_on_listening) return -1;
+
+    pomelo_address_t address;
+    const char * address_str =
+        mock->options.address ? mock->options.address : "127.0.0.1:8888";
+    if (pomelo_address_from_string(&address, address_str) < 0) {
+        return -1; // Invalid address
+    }
+
+    mock->socket.start_time = uv_hrtime();
+    mock->listening = 1;
+    mock->socket_on_listening(&mock->plugin, &mock->socket, &address);
+    return 0;
+}
+
+
+void pomelo_webrtc_mock_stop(pomelo_webrtc_mock_t * mock) {
+    assert(mock != NULL);
+    if (!mock->listening) return;
+    mock->listening = 0;
+
+    if (mock->socket_on_stopped) {
+        mock->socket_on_stopped(&mock->plugin, &mock->socket);
+    }
+
+    // Wait for the plugin to destroy its native sessions
+    uint64_t deadline = uv_hrtime() + MOCK_STOP_TIMEOUT_MS * 1000000ULL;
+    while (pomelo_webrtc_mock_session_count(mock) > 0 &&
+        uv_hrtime() < deadline
+    ) {
+        uv_sleep(1);
+    }
+}
+
+
+pomelo_plugin_t * pomelo_webrtc_mock_plugin(pomelo_webrtc_mock_t * mock) {
+    assert(mock != NULL);
+    return &mock->plugin;
+}
+
+
+void * pomelo_webrtc_mock_data(pomelo_webrtc_mock_t * mock) {
+    assert(mock != NULL);
+    return mock->options.data;
+}
+
+
+void pomelo_webrtc_mock_drain(pomelo_webrtc_mock_t * mock) {
+    assert(mock != NULL);
+    uv_mutex_lock(&mock->mutex);
+    while (mock->task_head || mock->executor_busy) {
+        uv_cond_wait(&mock->idle_cond, &mock->mutex);
+    }
+    uv_mutex_unlock(&mock->mutex);
+}
+
+
+size_t pomelo_webrtc_mock_session_count(pomelo_webrtc_mock_t * mock) {
+    assert(mock != NULL);
+    uv_mutex_lock(&mock->mutex);
+    size_t count = mock->session_count;
+    uv_mutex_unlock(&mock->mutex);
+    return count;
+}
+
+
+int pomelo_webrtc_mock_send(
+    pomelo_webrtc_mock_t * mock,
+    pomelo_session_t * session,
+    size_t channel_index,
+    const uint8_t * data,
+    size_t length
+) {
+    assert(mock != NULL);
+    assert(session != NULL);
+    if (!mock->session_send || length == 0) return -1;
+
+    // The message is only borrowed for the duration of the call
+    pomelo_message_t message = {
+        .data = (uint8_t *) data,
+        .length = length,
+        .capacity = length
+    };
+    mock->session_send(&mock->plugin, session, channel_index, &message);
+    return 0;
+}
+
+
+void pomelo_webrtc_mock_disconnect(
+    pomelo_webrtc_mock_t * mock,
+    pomelo_session_t * session
+) {
+    assert(mock != NULL);
+    assert(session != NULL);
+    if (mock->session_disconnect) {
+        mock->session_disconnect(&mock->plugin, session);
+    }
+}
+
+
+int64_t pomelo_webrtc_mock_session_client_id(pomelo_session_t * session) {
+    assert(session != NULL);
+    return session->client_id;
+}
+
+
+void pomelo_webrtc_mock_session_set_data(
+    pomelo_session_t * session,
+    void * data
+) {
+    assert(session != NULL);
+    session->data = data;
+}
+
+
+void * pomelo_webrtc_mock_session_get_data(pomelo_session_t * session) {
+    assert(session != NULL);
+    return session->data;
+}
+
+
+size_t pomelo_webrtc_mock_token_encode(
+    char * output,
+    int64_t client_id,
+    int32_t connect_timeout
+) {
+    assert(output != NULL);
+    uint8_t token[POMELO_CONNECT_TOKEN_BYTES];
+    memset(token, 0, sizeof(token));
+    pomelo_webrtc_bench_write_u64(
+        token + MOCK_TOKEN_CLIENT_ID_OFFSET,
+        (uint64_t) client_id
+    );
+    pomelo_webrtc_bench_write_u32(
+        token + MOCK_TOKEN_TIMEOUT_OFFSET,
+        (uint32_t) connect_timeout
+    );
+    return pomelo_webrtc_bench_base64_encode(output, token, sizeof(token));
+}
@@ -0,0 +1,174 @@
+#ifndef POMELO_WEBRTC_BENCH_MOCK_PLUGIN_H
+#define POMELO_WEBRTC_BENCH_MOCK_PLUGIN_H
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "pomelo/plugin.h"
+#include "pomelo/constants.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Mock plugin host.
+    It plays the role of pomelo-udp-native for the WebRTC plugin: it owns the
+    pomelo_plugin_t, a single listening socket, the native sessions, messages
+    and a thread-safe executor. The plugin is loaded in-process through
+    pomelo_webrtc_entry, so benchmarks can drive the whole plugin without the
+    native library.
+
+    The executor latency and the cost of decoding connect tokens can be
+    configured, so that the queueing of the plugin can be measured against a
+    slow host.
+
+    Connect tokens are not encrypted. A mock token carries the client ID and
+    the connect timeout, see pomelo_webrtc_mock_token_encode.
+*/
+
+/// Maximum number of channels of mock socket
+#define POMELO_WEBRTC_MOCK_MAX_CHANNELS 16
+
+
+/// @brief Mock plugin host
+typedef struct pomelo_webrtc_mock_s pomelo_webrtc_mock_t;
+
+/// @brief Options of mock plugin host
+typedef struct pomelo_webrtc_mock_options_s pomelo_webrtc_mock_options_t;
+
+
+/// @brief Session callback. It is called in executor thread.
+typedef void (*pomelo_webrtc_mock_session_cb)(
+    pomelo_webrtc_mock_t * mock,
+    pomelo_session_t * session
+);
+
+
+/// @brief Receive callback. It is called in executor thread.
+typedef void (*pomelo_webrtc_mock_receive_cb)(
+    pomelo_webrtc_mock_t * mock,
+    pomelo_session_t * session,
+    size_t channel_index,
+    const uint8_t * data,
+    size_t length
+);
+
+
+struct pomelo_webrtc_mock_options_s {
+    /// @brief Listening address, e.g. "127.0.0.1:8888"
+    const char * address;
+
+    /// @brief Number of channels
+    size_t nchannels;
+
+    /// @brief Modes of channels
+    pomelo_channel_mode channel_modes[POMELO_WEBRTC_MOCK_MAX_CHANNELS];
+
+    /// @brief Called when a native session has been created
+    pomelo_webrtc_mock_session_cb on_session_created;
+
+    /// @brief Called when a native session is going to be destroyed
+    pomelo_webrtc_mock_session_cb on_session_destroyed;
+
+    /// @brief Called when a message has been received
+    pomelo_webrtc_mock_receive_cb on_receive;
+
+    /// @brief Simulated latency of executor (us). Every submitted task runs no
+    /// earlier than this amount of time after it has been submitted.
+    uint64_t executor_latency_us;
+
+    /// @brief Simulated CPU cost of decoding a connect token (us). The decoder
+    /// spins for this amount of time.
+    uint64_t token_decode_cost_us;
+
+    /// @brief Associated data
+    void * data;
+};
+
+
+/// @brief Create the mock host and load the plugin
+pomelo_webrtc_mock_t * pomelo_webrtc_mock_create(
+    pomelo_webrtc_mock_options_t * options
+);
+
+
+/// @brief Stop the socket, unload the plugin and destroy the mock host
+void pomelo_webrtc_mock_destroy(pomelo_webrtc_mock_t * mock);
+
+
+/// @brief Start listening
+/// @return 0 on success, or -1 on failure
+int pomelo_webrtc_mock_listen(pomelo_webrtc_mock_t * mock);
+
+
+/// @brief Stop the socket
+void pomelo_webrtc_mock_stop(pomelo_webrtc_mock_t * mock);
+
+
+/// @brief Get the plugin
+pomelo_plugin_t * pomelo_webrtc_mock_plugin(pomelo_webrtc_mock_t * mock);
+
+
+/// @brief Get associated data
+void * pomelo_webrtc_mock_data(pomelo_webrtc_mock_t * mock);
+
+
+/// @brief Wait until all submitted executor tasks have been run
+void pomelo_webrtc_mock_drain(pomelo_webrtc_mock_t * mock);
+
+
+/// @brief Get the number of living native sessions
+size_t pomelo_webrtc_mock_session_count(pomelo_webrtc_mock_t * mock);
+
+
+/// @brief Send a message to session through the plugin
+/// @return 0 on success, or -1 on failure
+int pomelo_webrtc_mock_send(
+    pomelo_webrtc_mock_t * mock,
+    pomelo_session_t * session,
+    size_t channel_index,
+    const uint8_t * data,
+    size_t length
+);
+
+
+/// @brief Disconnect a session from server side
+void pomelo_webrtc_mock_disconnect(
+    pomelo_webrtc_mock_t * mock,
+    pomelo_session_t * session
+);
+
+
+/// @brief Get client ID of native session
+int64_t pomelo_webrtc_mock_session_client_id(pomelo_session_t * session);
+
+
+/// @brief Set user data of native session
+void pomelo_webrtc_mock_session_set_data(
+    pomelo_session_t * session,
+    void * data
+);
+
+
+/// @brief Get user data of native session
+void * pomelo_webrtc_mock_session_get_data(pomelo_session_t * session);
+
+
+/// @brief Build a mock connect token and encode it in base64.
+/// The output capacity must be at least POMELO_WEBRTC_MOCK_TOKEN_BASE64_LENGTH.
+/// @return Length of encoded token
+size_t pomelo_webrtc_mock_token_encode(
+    char * output,
+    int64_t client_id,
+    int32_t connect_timeout
+);
+
+
+/// Length of base64 mock token (with padding, without terminator)
+#define POMELO_WEBRTC_MOCK_TOKEN_BASE64_LENGTH                                 \
+    (((POMELO_CONNECT_TOKEN_BYTES + 2) / 3) * 4)
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // POMELO_WEBRTC_BENCH_MOCK_PLUGIN_H
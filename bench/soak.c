@@ -0,0 +1,1246 @@
+/*
+    Soak and load generator.
+
+    Thousands of client sessions are driven by the signaling client of
+    bench-utils, on top of the rtc-api wrapper (RTCWSClient,
+    RTCPeerConnection, RTCDataChannel), against a plugin which is hosted by
+    the mock plugin host, or against an external server.
+
+    Sessions arrive at a configurable rate up to a concurrency cap. Every
+    session lives for a random lifetime, sends messages with a configurable
+    channel mix and is then closed. A fraction of sessions disconnect
+    abruptly: they are dropped at a random moment of their life (possibly in
+    the middle of signaling) without closing their channels and websocket
+    first. Freed slots are reused by new arrivals, so the server sees
+    continuous churn.
+
+    Modes:
+    - all: the server and the clients run in this process.
+    - server: only the server runs, clients connect from other processes.
+    - client: only the clients run, against --url.
+
+    Every interval, the tool prints the client counters (handshakes, closes,
+    errors, traffic, round trip time) and the server gauges (RSS, plugin
+    objects in use, handshake failures and the lag of plugin loop). In "all"
+    mode the RSS covers both sides.
+
+    The loop gauges come from the loop monitor of plugin: the smoothed lag,
+    the depth of task queue, the busy time of iterations and the latency of
+    tasks. Distributions are reset after every report.
+*/
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include "uv.h"
+#include "plugin.h"
+#include "rtc-api/rtc-api.h"
+#include "mock-plugin.h"
+#include "bench-utils.h"
+
+
+/// Maximum number of channels
+#define SOAK_MAX_CHANNELS POMELO_WEBRTC_MOCK_MAX_CHANNELS
+
+/// Maximum number of driver threads
+#define SOAK_MAX_THREADS 64
+
+/// Magic byte of soak payloads
+#define SOAK_PAYLOAD_MAGIC 0xB8
+
+/// Header of payload: magic + send time
+#define SOAK_PAYLOAD_HEADER_SIZE (1 + 8)
+
+/// Maximum payload size
+#define SOAK_PAYLOAD_MAX_SIZE 16384
+
+/// Maximum number of messages of one session in one tick
+#define SOAK_MAX_BURST 8
+
+/// Interval of driver threads (ms)
+#define SOAK_TICK_MS 5
+
+/// Interval of main loop (ms)
+#define SOAK_POLL_INTERVAL_MS 100
+
+
+
+/// @brief Running mode
+typedef enum soak_mode_e {
+    SOAK_MODE_ALL,
+    SOAK_MODE_SERVER,
+    SOAK_MODE_CLIENT
+} soak_mode;
+
+
+/// @brief State of a client slot
+typedef enum soak_client_state_e {
+    /// @brief The slot is free
+    SOAK_CLIENT_FREE,
+
+    /// @brief Signaling is in progress
+    SOAK_CLIENT_CONNECTING,
+
+    /// @brief CONN has been received
+    SOAK_CLIENT_CONNECTED,
+
+    /// @brief The client has failed, it is waiting to be released
+    SOAK_CLIENT_DEAD
+} soak_client_state;
+
+
+/// @brief Options of soak tool
+typedef struct soak_options_s {
+    /// @brief Running mode
+    soak_mode mode;
+
+    /// @brief Listening port of server
+    unsigned port;
+
+    /// @brief URL of server in client mode
+    const char * url;
+
+    /// @brief Maximum number of concurrent sessions
+    size_t sessions;
+
+    /// @brief New sessions per second
+    double arrival_rate;
+
+    /// @brief Total number of sessions to start (0 = unlimited)
+    uint64_t total;
+
+    /// @brief Duration of test in seconds (0 = until interrupted)
+    unsigned duration_s;
+
+    /// @brief Minimum lifetime of a session after it has connected (s)
+    unsigned lifetime_min_s;
+
+    /// @brief Maximum lifetime of a session after it has connected (s)
+    unsigned lifetime_max_s;
+
+    /// @brief Fraction of sessions which disconnect abruptly (0 - 1)
+    double abrupt;
+
+    /// @brief Messages per second of every session
+    double message_rate;
+
+    /// @brief Minimum message size
+    size_t size_min;
+
+    /// @brief Maximum message size
+    size_t size_max;
+
+    /// @brief Number of channels
+    size_t nchannels;
+
+    /// @brief Modes of channels
+    pomelo_channel_mode modes[SOAK_MAX_CHANNELS];
+
+    /// @brief Weights of channels in the message mix
+    unsigned weights[SOAK_MAX_CHANNELS];
+
+    /// @brief Sum of weights
+    unsigned total_weight;
+
+    /// @brief Number of driver threads
+    unsigned threads;
+
+    /// @brief Interval of reports (s)
+    unsigned interval_s;
+
+    /// @brief Handshake timeout (ms)
+    unsigned handshake_timeout_ms;
+
+    /// @brief Echo received messages from server
+    bool echo;
+
+    /// @brief Simulated executor latency of host (us)
+    uint64_t executor_latency_us;
+} soak_options_t;
+
+
+/// @brief A client session slot
+typedef struct soak_client_s {
+    /// @brief Signaling client. Its lock also guards this slot.
+    pomelo_webrtc_bench_client_t base;
+
+    /// @brief State of slot
+    soak_client_state state;
+
+    /// @brief Whether this session disconnects abruptly
+    bool abrupt;
+
+    /// @brief Lifetime (ns)
+    uint64_t lifetime_ns;
+
+    /// @brief Start time (ns)
+    uint64_t start_ns;
+
+    /// @brief The time to close this session (ns, 0 = not set)
+    uint64_t deadline_ns;
+
+    /// @brief The time to send next message (ns)
+    uint64_t next_send_ns;
+} soak_client_t;
+
+
+/// @brief Counters of client side
+typedef struct soak_client_stats_s {
+    /// @brief Started sessions
+    pomelo_atomic_uint64_t started;
+
+    /// @brief Sessions which have received CONN
+    pomelo_atomic_uint64_t connected;
+
+    /// @brief Sessions which have been closed gracefully
+    pomelo_atomic_uint64_t closed_graceful;
+
+    /// @brief Sessions which have been dropped abruptly
+    pomelo_atomic_uint64_t closed_abrupt;
+
+    /// @brief Sessions which are connecting
+    pomelo_atomic_int64_t connecting_gauge;
+
+    /// @brief Sessions which are connected
+    pomelo_atomic_int64_t connected_gauge;
+
+    /// @brief Failed to create websocket or peer connection
+    pomelo_atomic_uint64_t create_failures;
+
+    /// @brief Websocket errors
+    pomelo_atomic_uint64_t ws_errors;
+
+    /// @brief Authentication failures
+    pomelo_atomic_uint64_t auth_failures;
+
+    /// @brief Peer connection or data channel failures
+    pomelo_atomic_uint64_t pc_failures;
+
+    /// @brief Handshakes which have not finished in time
+    pomelo_atomic_uint64_t handshake_timeouts;
+
+    /// @brief Sessions which have been closed by server
+    pomelo_atomic_uint64_t server_closes;
+
+    /// @brief Failed sends
+    pomelo_atomic_uint64_t send_failures;
+
+    /// @brief Sent messages
+    pomelo_atomic_uint64_t messages_sent;
+
+    /// @brief Received echoes
+    pomelo_atomic_uint64_t messages_received;
+
+    /// @brief Sent bytes
+    pomelo_atomic_uint64_t bytes_sent;
+
+    /// @brief Received bytes
+    pomelo_atomic_uint64_t bytes_received;
+
+    /// @brief Handshake durations (ns)
+    pomelo_histogram_t handshake;
+
+    /// @brief Round trip times of the whole run (ns)
+    pomelo_histogram_t rtt;
+
+    /// @brief Round trip times of current interval (ns)
+    pomelo_histogram_t rtt_window;
+} soak_client_stats_t;
+
+
+/// @brief Driver thread
+typedef struct soak_driver_s {
+    /// @brief Thread
+    uv_thread_t thread;
+
+    /// @brief First slot of this driver
+    size_t begin;
+
+    /// @brief Past-the-end slot of this driver
+    size_t end;
+
+    /// @brief Arrival rate of this driver
+    double arrival_rate;
+
+    /// @brief Random state
+    uint64_t random;
+
+    /// @brief Payload buffer
+    uint8_t payload[SOAK_PAYLOAD_MAX_SIZE];
+} soak_driver_t;
+
+
+/// @brief Global state of soak tool
+typedef struct soak_s {
+    /// @brief Options
+    soak_options_t options;
+
+    /// @brief URL of server
+    char url[256];
+
+    /// @brief Running flag of drivers
+    pomelo_atomic_uint64_t running;
+
+    /// @brief Next client ID
+    pomelo_atomic_uint64_t next_client_id;
+
+    /// @brief Client slots
+    soak_client_t * clients;
+
+    /// @brief Driver threads
+    soak_driver_t * drivers;
+
+    /// @brief RTC context of clients
+    rtc_context_t * rtc_context;
+
+    /// @brief Counters of clients
+    soak_client_stats_t stats;
+
+    /// @brief Mock plugin host
+    pomelo_webrtc_mock_t * mock;
+
+    /// @brief Messages received by server
+    pomelo_atomic_uint64_t server_received;
+} soak_t;
+
+
+/// @brief Global state
+static soak_t soak;
+
+/// @brief Set by signal handler
+static volatile sig_atomic_t soak_interrupted = 0;
+
+
+/* -------------------------------------------------------------------------- */
+/*                                  Helpers                                   */
+/* -------------------------------------------------------------------------- */
+
+/// @brief xorshift64* generator
+static uint64_t soak_random(uint64_t * state) {
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+
+/// @brief Uniform random number in [0, 1)
+static double soak_random_unit(uint64_t * state) {
+    return (double) (soak_random(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+
+/// @brief Uniform random integer in [min, max]
+static uint64_t soak_random_range(
+    uint64_t * state,
+    uint64_t min,
+    uint64_t max
+) {
+    if (max <= min) return min;
+    return min + soak_random(state) % (max - min + 1);
+}
+
+
+/// @brief Delay until the next message of a session. It is uniformly
+/// distributed around the mean interval.
+static uint64_t soak_message_delay(uint64_t * state) {
+    double mean = 1000000000.0 / soak.options.message_rate;
+    return (uint64_t) (mean * 2.0 * soak_random_unit(state));
+}
+
+
+/// @brief Pick a channel of the message mix
+static size_t soak_pick_channel(uint64_t * state) {
+    soak_options_t * options = &soak.options;
+    unsigned value = (unsigned) (soak_random(state) % options->total_weight);
+    for (size_t i = 0; i < options->nchannels; i++) {
+        if (value < options->weights[i]) return i;
+        value -= options->weights[i];
+    }
+    return options->nchannels - 1;
+}
+
+
+/// @brief Change state of client and update the gauges. The client must be
+/// locked.
+static void soak_client_set_state(
+    soak_client_t * client,
+    soak_client_state state
+) {
+    soak_client_stats_t * stats = &soak.stats;
+    if (client->state == SOAK_CLIENT_CONNECTING) {
+        pomelo_atomic_int64_fetch_sub(&stats->connecting_gauge, 1);
+    } else if (client->state == SOAK_CLIENT_CONNECTED) {
+        pomelo_atomic_int64_fetch_sub(&stats->connected_gauge, 1);
+    }
+
+    client->state = state;
+    if (state == SOAK_CLIENT_CONNECTING) {
+        pomelo_atomic_int64_fetch_add(&stats->connecting_gauge, 1);
+    } else if (state == SOAK_CLIENT_CONNECTED) {
+        pomelo_atomic_int64_fetch_add(&stats->connected_gauge, 1);
+    }
+}
+
+
+/// @brief Mark the client as failed and count the error. The client must be
+/// locked.
+static void soak_client_fail(
+    soak_client_t * client,
+    pomelo_atomic_uint64_t * counter
+) {
+    if (client->state != SOAK_CLIENT_CONNECTING &&
+        client->state != SOAK_CLIENT_CONNECTED
+    ) {
+        return; // Already failed or released
+    }
+
+    pomelo_atomic_uint64_fetch_add(counter, 1);
+    soak_client_set_state(client, SOAK_CLIENT_DEAD);
+}
+
+
+/* -------------------------------------------------------------------------- */
+/*                             Client callbacks                               */
+/* -------------------------------------------------------------------------- */
+
+/// @brief Process CONN. The client is locked.
+static void soak_client_on_connected(pomelo_webrtc_bench_client_t * base) {
+    soak_client_t * client = base->options.data;
+    if (client->state != SOAK_CLIENT_CONNECTING) return;
+
+    uint64_t now = pomelo_webrtc_bench_now_ns();
+    soak_client_set_state(client, SOAK_CLIENT_CONNECTED);
+    pomelo_atomic_uint64_fetch_add(&soak.stats.connected, 1);
+    pomelo_histogram_record(&soak.stats.handshake, now - client->start_ns);
+
+    if (!client->abrupt) {
+        client->deadline_ns = now + client->lifetime_ns;
+    }
+    client->next_send_ns = now;
+}
+
+
+/// @brief Count the failure of client. The client is locked.
+static void soak_client_on_failed(
+    pomelo_webrtc_bench_client_t * base,
+    pomelo_webrtc_bench_client_error error
+) {
+    soak_client_t * client = base->options.data;
+    soak_client_stats_t * stats = &soak.stats;
+    pomelo_atomic_uint64_t * counter = NULL;
+
+    switch (error) {
+        case POMELO_WEBRTC_BENCH_CLIENT_ERROR_CREATE:
+            counter = &stats->create_failures;
+            break;
+
+        case POMELO_WEBRTC_BENCH_CLIENT_ERROR_WS:
+            counter = &stats->ws_errors;
+            break;
+
+        case POMELO_WEBRTC_BENCH_CLIENT_ERROR_AUTH:
+            counter = &stats->auth_failures;
+            break;
+
+        case POMELO_WEBRTC_BENCH_CLIENT_ERROR_PC:
+            counter = &stats->pc_failures;
+            break;
+
+        default: // CLOSED
+            counter = &stats->server_closes;
+    }
+
+    soak_client_fail(client, counter);
+}
+
+
+/// @brief Measure an echo of server. The client is locked.
+static void soak_client_on_message(
+    pomelo_webrtc_bench_client_t * base,
+    size_t channel_index,
+    const uint8_t * data,
+    size_t size
+) {
+    (void) base;
+    (void) channel_index;
+    if (size < SOAK_PAYLOAD_HEADER_SIZE || data[0] != SOAK_PAYLOAD_MAGIC) {
+        return;
+    }
+
+    uint64_t rtt =
+        pomelo_webrtc_bench_now_ns() - pomelo_webrtc_bench_read_u64(data + 1);
+    soak_client_stats_t * stats = &soak.stats;
+    pomelo_histogram_record(&stats->rtt, rtt);
+    pomelo_histogram_record(&stats->rtt_window, rtt);
+    pomelo_atomic_uint64_fetch_add(&stats->messages_received, 1);
+    pomelo_atomic_uint64_fetch_add(&stats->bytes_received, size);
+}
+
+
+/* -------------------------------------------------------------------------- */
+/*                                  Drivers                                   */
+/* -------------------------------------------------------------------------- */
+
+/// @brief Start a new session on a free slot
+static void soak_client_start(soak_driver_t * driver, soak_client_t * client) {
+    soak_options_t * options = &soak.options;
+    uint64_t now = pomelo_webrtc_bench_now_ns();
+
+    pomelo_webrtc_bench_client_lock(&client->base);
+    client->abrupt = soak_random_unit(&driver->random) < options->abrupt;
+    client->lifetime_ns = soak_random_range(
+        &driver->random,
+        (uint64_t) options->lifetime_min_s * 1000000000ULL,
+        (uint64_t) options->lifetime_max_s * 1000000000ULL
+    );
+    client->start_ns = now;
+
+    // Abrupt sessions may be dropped at any moment, even while signaling
+    client->deadline_ns = client->abrupt
+        ? now + (uint64_t) (
+            soak_random_unit(&driver->random) * (double) client->lifetime_ns
+        )
+        : 0;
+    soak_client_set_state(client, SOAK_CLIENT_CONNECTING);
+    pomelo_atomic_uint64_fetch_add(&soak.stats.started, 1);
+    pomelo_webrtc_bench_client_unlock(&client->base);
+
+    pomelo_webrtc_bench_client_options_t client_options;
+    memset(&client_options, 0, sizeof(client_options));
+    client_options.rtc_context = soak.rtc_context;
+    client_options.url = soak.url;
+    client_options.client_id =
+        (int64_t) pomelo_atomic_uint64_fetch_add(&soak.next_client_id, 1);
+    client_options.token_timeout_s =
+        (int32_t) ((options->handshake_timeout_ms + 999) / 1000);
+    client_options.nchannels = options->nchannels;
+    client_options.modes = options->modes;
+    client_options.on_connected = soak_client_on_connected;
+    client_options.on_failed = soak_client_on_failed;
+    client_options.on_message = soak_client_on_message;
+    client_options.data = client;
+
+    // A failure is counted by the failed callback
+    pomelo_webrtc_bench_client_start(&client->base, &client_options);
+}
+
+
+/// @brief Release all objects of session and free its slot
+static void soak_client_stop(soak_client_t * client, bool graceful) {
+    pomelo_webrtc_bench_client_lock(&client->base);
+    soak_client_set_state(client, SOAK_CLIENT_FREE);
+    pomelo_webrtc_bench_client_unlock(&client->base);
+
+    // Late callbacks find the slot free and are ignored
+    pomelo_webrtc_bench_client_stop(&client->base, graceful);
+}
+
+
+/// @brief Send the due messages of a connected session. The client must be
+/// locked.
+static void soak_client_send(
+    soak_driver_t * driver,
+    soak_client_t * client,
+    uint64_t now
+) {
+    soak_options_t * options = &soak.options;
+    soak_client_stats_t * stats = &soak.stats;
+    if (options->message_rate <= 0) return;
+
+    for (int i = 0; i < SOAK_MAX_BURST && client->next_send_ns <= now; i++) {
+        size_t channel_index = soak_pick_channel(&driver->random);
+        size_t size = (size_t) soak_random_range(
+            &driver->random,
+            options->size_min,
+            options->size_max
+        );
+
+        uint8_t * payload = driver->payload;
+        payload[0] = SOAK_PAYLOAD_MAGIC;
+        uint64_t send_time = pomelo_webrtc_bench_now_ns();
+        pomelo_webrtc_bench_write_u64(payload + 1, send_time);
+
+        int ret = pomelo_webrtc_bench_client_send(
+            &client->base,
+            channel_index,
+            payload,
+            size
+        );
+        if (ret == 0) {
+            pomelo_atomic_uint64_fetch_add(&stats->messages_sent, 1);
+            pomelo_atomic_uint64_fetch_add(&stats->bytes_sent, size);
+        } else {
+            pomelo_atomic_uint64_fetch_add(&stats->send_failures, 1);
+        }
+
+        client->next_send_ns += soak_message_delay(&driver->random);
+    }
+
+    // Do not try to catch up after a stall
+    if (client->next_send_ns < now) {
+        client->next_send_ns = now;
+    }
+}
+
+
+/// @brief Update a slot
+static void soak_driver_update(
+    soak_driver_t * driver,
+    soak_client_t * client,
+    uint64_t now
+) {
+    soak_client_stats_t * stats = &soak.stats;
+    uint64_t timeout_ns =
+        (uint64_t) soak.options.handshake_timeout_ms * 1000000ULL;
+    bool stop = false;
+    bool graceful = false;
+
+    pomelo_webrtc_bench_client_lock(&client->base);
+    switch (client->state) {
+        case SOAK_CLIENT_CONNECTING:
+            if (client->abrupt && now >= client->deadline_ns) {
+                pomelo_atomic_uint64_fetch_add(&stats->closed_abrupt, 1);
+                stop = true;
+            } else if (now - client->start_ns >= timeout_ns) {
+                pomelo_atomic_uint64_fetch_add(&stats->handshake_timeouts, 1);
+                stop = true;
+            }
+            break;
+
+        case SOAK_CLIENT_CONNECTED:
+            if (now >= client->deadline_ns) {
+                if (client->abrupt) {
+                    pomelo_atomic_uint64_fetch_add(&stats->closed_abrupt, 1);
+                } else {
+                    pomelo_atomic_uint64_fetch_add(&stats->closed_graceful, 1);
+                    graceful = true;
+                }
+                stop = true;
+            } else {
+                soak_client_send(driver, client, now);
+            }
+            break;
+
+        case SOAK_CLIENT_DEAD:
+            stop = true; // The error has been counted
+            break;
+
+        default:
+            break;
+    }
+    pomelo_webrtc_bench_client_unlock(&client->base);
+
+    if (stop) {
+        soak_client_stop(client, graceful);
+    }
+}
+
+
+/// @brief Check if another session can be started
+static bool soak_can_start(void) {
+    uint64_t total = soak.options.total;
+    if (total == 0) return true;
+    return pomelo_atomic_uint64_load(&soak.stats.started) < total;
+}
+
+
+static void soak_driver_entry(soak_driver_t * driver) {
+    uint64_t last = pomelo_webrtc_bench_now_ns();
+    double credit = 0.0;
+    double max_credit = (double) (driver->end - driver->begin);
+
+    while (pomelo_atomic_uint64_load(&soak.running)) {
+        uint64_t now = pomelo_webrtc_bench_now_ns();
+        credit += driver->arrival_rate * (double) (now - last) / 1e9;
+        if (credit > max_credit) credit = max_credit;
+        last = now;
+
+        for (size_t i = driver->begin; i < driver->end; i++) {
+            soak_client_t * client = &soak.clients[i];
+
+            // Only this driver starts sessions on its slots
+            pomelo_webrtc_bench_client_lock(&client->base);
+            bool free_slot = (client->state == SOAK_CLIENT_FREE);
+            pomelo_webrtc_bench_client_unlock(&client->base);
+
+            if (!free_slot) {
+                soak_driver_update(driver, client, now);
+            } else if (credit >= 1.0 && soak_can_start()) {
+                credit -= 1.0;
+                soak_client_start(driver, client);
+            }
+        }
+
+        uv_sleep(SOAK_TICK_MS);
+    }
+
+    // Close all remaining sessions
+    for (size_t i = driver->begin; i < driver->end; i++) {
+        soak_client_stop(&soak.clients[i], true);
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+/*                                   Server                                   */
+/* -------------------------------------------------------------------------- */
+
+static void soak_server_on_receive(
+    pomelo_webrtc_mock_t * mock,
+    pomelo_session_t * session,
+    size_t channel_index,
+    const uint8_t * data,
+    size_t length
+) {
+    pomelo_atomic_uint64_fetch_add(&soak.server_received, 1);
+    if (soak.options.echo) {
+        pomelo_webrtc_mock_send(mock, session, channel_index, data, length);
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+/*                                  Reports                                   */
+/* -------------------------------------------------------------------------- */
+
+#define soak_load(field) ((unsigned long long) pomelo_atomic_uint64_load(field))
+
+
+static void soak_report_clients(unsigned elapsed_s) {
+    soak_client_stats_t * stats = &soak.stats;
+    printf(
+        "[%5us] clients: connecting=%lld connected=%lld started=%llu "
+        "ok=%llu closed=%llu abrupt=%llu\n",
+        elapsed_s,
+        (long long) pomelo_atomic_int64_load(&stats->connecting_gauge),
+        (long long) pomelo_atomic_int64_load(&stats->connected_gauge),
+        soak_load(&stats->started),
+        soak_load(&stats->connected),
+        soak_load(&stats->closed_graceful),
+        soak_load(&stats->closed_abrupt)
+    );
+    printf(
+        "         errors: create=%llu ws=%llu auth=%llu pc=%llu "
+        "timeout=%llu server_close=%llu send=%llu\n",
+        soak_load(&stats->create_failures),
+        soak_load(&stats->ws_errors),
+        soak_load(&stats->auth_failures),
+        soak_load(&stats->pc_failures),
+        soak_load(&stats->handshake_timeouts),
+        soak_load(&stats->server_closes),
+        soak_load(&stats->send_failures)
+    );
+    printf(
+        "         traffic: sent=%llu recv=%llu rtt_p50=%.2fms "
+        "rtt_p99=%.2fms rtt_max=%.2fms\n",
+        soak_load(&stats->messages_sent),
+        soak_load(&stats->messages_received),
+        pomelo_histogram_quantile(&stats->rtt_window, 0.5) / 1e6,
+        pomelo_histogram_quantile(&stats->rtt_window, 0.99) / 1e6,
+        pomelo_histogram_max(&stats->rtt_window) / 1e6
+    );
+    pomelo_histogram_reset(&stats->rtt_window);
+}
+
+
+static void soak_report_server(unsigned elapsed_s) {
+    pomelo_plugin_t * plugin = pomelo_webrtc_mock_plugin(soak.mock);
+    pomelo_webrtc_bench_usage_t usage;
+    pomelo_webrtc_bench_usage(&usage);
+
+    pomelo_webrtc_resource_stats_t resources;
+    memset(&resources, 0, sizeof(resources));
+    pomelo_webrtc_get_resource_stats(plugin, &resources);
+
+    uint64_t failed = 0;
+    uint64_t timeout = 0;
+    pomelo_webrtc_handshake_phase_stats_t phase_stats;
+    for (int i = 0; i < POMELO_WEBRTC_HANDSHAKE_PHASE_COUNT; i++) {
+        pomelo_webrtc_handshake_phase phase = (pomelo_webrtc_handshake_phase) i;
+        int ret =
+            pomelo_webrtc_get_handshake_stats(plugin, phase, &phase_stats);
+        if (ret < 0) continue;
+        failed += phase_stats.failed;
+        timeout += phase_stats.timeout;
+    }
+
+    printf(
+        "[%5us] server: rss=%.1fMB native_sessions=%zu recv=%llu "
+        "hs_failed=%llu hs_timeout=%llu\n",
+        elapsed_s,
+        usage.rss / (1024.0 * 1024.0),
+        pomelo_webrtc_mock_session_count(soak.mock),
+        soak_load(&soak.server_received),
+        (unsigned long long) failed,
+        (unsigned long long) timeout
+    );
+    printf(
+        "         in use: sockets=%llu preauths=%llu sessions=%llu "
+        "channels=%llu string_buffers=%llu recv_commands=%llu "
+        "pacer_entries=%llu\n",
+        (unsigned long long) resources.sockets,
+        (unsigned long long) resources.preauths,
+        (unsigned long long) resources.sessions,
+        (unsigned long long) resources.channels,
+        (unsigned long long) resources.string_buffers,
+        (unsigned long long) resources.recv_commands,
+        (unsigned long long) resources.pacer_entries
+    );
+
+    pomelo_webrtc_admission_stats_t admission;
+    memset(&admission, 0, sizeof(admission));
+    pomelo_webrtc_get_admission_stats(plugin, &admission);
+    printf(
+        "         admission: pending=%llu accepted=%llu rejected: rate=%llu "
+        "lag=%llu pending=%llu sessions=%llu source=%llu\n",
+        (unsigned long long) admission.pending,
+        (unsigned long long) admission.accepted,
+        (unsigned long long) admission.rejected_rate,
+        (unsigned long long) admission.rejected_loop_lag,
+        (unsigned long long) admission.rejected_pending,
+        (unsigned long long) admission.rejected_sessions,
+        (unsigned long long) admission.rejected_source
+    );
+
+    pomelo_webrtc_traffic_stats_t traffic;
+    memset(&traffic, 0, sizeof(traffic));
+    pomelo_webrtc_get_traffic_stats(plugin, &traffic);
+    printf(
+        "         traffic: in=%llu/%lluB out=%llu/%lluB recv_dropped=%llu "
+        "send_dropped=%llu send_failed=%llu\n",
+        (unsigned long long) traffic.messages_in,
+        (unsigned long long) traffic.bytes_in,
+        (unsigned long long) traffic.messages_out,
+        (unsigned long long) traffic.bytes_out,
+        (unsigned long long) traffic.recv_dropped,
+        (unsigned long long) traffic.send_dropped,
+        (unsigned long long) traffic.send_failed
+    );
+
+    pomelo_webrtc_loop_stats_t loop;
+    memset(&loop, 0, sizeof(loop));
+    pomelo_webrtc_get_loop_stats(plugin, &loop);
+    pomelo_webrtc_reset_loop_stats(plugin);
+    printf(
+        "         loop: lag=%lluus queue=%llu queue_max=%llu "
+        "busy_p99=%lluus busy_max=%lluus\n",
+        (unsigned long long) loop.lag_us,
+        (unsigned long long) loop.queue_depth,
+        (unsigned long long) loop.queue_depth_max,
+        (unsigned long long) loop.busy_us.p99,
+        (unsigned long long) loop.busy_us.max
+    );
+    printf(
+        "         tasks: latency p50=%lluus p99=%lluus max=%lluus "
+        "per_drain p50=%llu max=%llu\n",
+        (unsigned long long) loop.task_latency_us.p50,
+        (unsigned long long) loop.task_latency_us.p99,
+        (unsigned long long) loop.task_latency_us.max,
+        (unsigned long long) loop.tasks_per_drain.p50,
+        (unsigned long long) loop.tasks_per_drain.max
+    );
+}
+
+
+static void soak_report(unsigned elapsed_s) {
+    if (soak.rtc_context) soak_report_clients(elapsed_s);
+    if (soak.mock) soak_report_server(elapsed_s);
+    fflush(stdout);
+}
+
+
+static void soak_report_summary(void) {
+    if (!soak.rtc_context) return;
+    printf("summary:\n");
+    pomelo_webrtc_bench_print_histogram("handshake", &soak.stats.handshake);
+    pomelo_webrtc_bench_print_histogram("rtt", &soak.stats.rtt);
+    printf(
+        "  bytes: sent=%llu recv=%llu\n",
+        soak_load(&soak.stats.bytes_sent),
+        soak_load(&soak.stats.bytes_received)
+    );
+}
+
+
+/* -------------------------------------------------------------------------- */
+/*                                   Driver                                   */
+/* -------------------------------------------------------------------------- */
+
+static void print_usage(const char * program) {
+    printf(
+        "Usage: %s [options]\n"
+        "  --mode MODE            all, server or client (default all)\n"
+        "  --port N               Listening port of server (default 18889)\n"
+        "  --url URL              Server URL in client mode\n"
+        "                         (default ws://127.0.0.1:<port>)\n"
+        "  --sessions N           Maximum concurrent sessions (default 1000)\n"
+        "  --arrival N            New sessions per second (default 100)\n"
+        "  --total N              Total sessions to start (default unlimited)\n"
+        "  --duration S           Duration in seconds, 0 = until interrupted\n"
+        "                         (default 60)\n"
+        "  --lifetime MIN[:MAX]   Lifetime of sessions in seconds\n"
+        "                         (default 5:30)\n"
+        "  --abrupt F             Fraction of abrupt disconnects\n"
+        "                         (default 0.2)\n"
+        "  --msg-rate N           Messages/s of every session (default 10)\n"
+        "  --size MIN[:MAX]       Message size in bytes (default 32:256)\n"
+        "  --mix MODE:W,...       Channels and their weights in the message\n"
+        "                         mix, modes are u, s or r (default\n"
+        "                         u:60,s:20,r:20)\n"
+        "  --threads N            Client driver threads (default 4)\n"
+        "  --interval S           Report interval in seconds (default 5)\n"
+        "  --handshake-timeout MS Handshake timeout (default 15000)\n"
+        "  --echo 0|1             Echo messages from server (default 1)\n"
+        "  --executor-latency US  Simulated executor latency (default 0)\n",
+        program
+    );
+}
+
+
+static int parse_range(const char * value, uint64_t * min, uint64_t * max) {
+    char * end = NULL;
+    *min = strtoull(value, &end, 10);
+    if (end == value) return -1;
+
+    if (*end == ':') {
+        const char * next = end + 1;
+        *max = strtoull(next, &end, 10);
+        if (end == next) return -1;
+    } else {
+        *max = *min;
+    }
+
+    if (*end != '\0' || *max < *min) return -1;
+    return 0;
+}
+
+
+static int parse_mix(const char * value, soak_options_t * options) {
+    options->nchannels = 0;
+    options->total_weight = 0;
+
+    const char * cursor = value;
+    while (*cursor) {
+        if (options->nchannels >= SOAK_MAX_CHANNELS) return -1;
+        size_t index = options->nchannels;
+
+        switch (*cursor) {
+            case 'u':
+                options->modes[index] = POMELO_CHANNEL_MODE_UNRELIABLE;
+                break;
+
+            case 's':
+                options->modes[index] = POMELO_CHANNEL_MODE_SEQUENCED;
+                break;
+
+            case 'r':
+                options->modes[index] = POMELO_CHANNEL_MODE_RELIABLE;
+                break;
+
+            default:
+                return -1;
+        }
+        cursor++;
+
+        unsigned weight = 1;
+        if (*cursor == ':') {
+            char * end = NULL;
+            weight = (unsigned) strtoul(cursor + 1, &end, 10);
+            if (end == cursor + 1) return -1;
+            cursor = end;
+        }
+
+        options->weights[index] = weight;
+        options->total_weight += weight;
+        options->nchannels++;
+
+        if (*cursor == ',') {
+            cursor++;
+        } else if (*cursor != '\0') {
+            return -1;
+        }
+    }
+
+    return (options->nchannels > 0 && options->total_weight > 0) ? 0 : -1;
+}
+
+
+static int parse_options(int argc, char * argv[], soak_options_t * options) {
+    uint64_t min = 0;
+    uint64_t max = 0;
+
+    for (int i = 1; i < argc; i += 2) {
+        const char * arg = argv[i];
+        const char * value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (!value) return -1;
+
+        if (strcmp(arg, "--mode") == 0) {
+            if (strcmp(value, "all") == 0) {
+                options->mode = SOAK_MODE_ALL;
+            } else if (strcmp(value, "server") == 0) {
+                options->mode = SOAK_MODE_SERVER;
+            } else if (strcmp(value, "client") == 0) {
+                options->mode = SOAK_MODE_CLIENT;
+            } else {
+                return -1;
+            }
+        } else if (strcmp(arg, "--port") == 0) {
+            options->port = (unsigned) strtoul(value, NULL, 10);
+        } else if (strcmp(arg, "--url") == 0) {
+            options->url = value;
+        } else if (strcmp(arg, "--sessions") == 0) {
+            options->sessions = strtoul(value, NULL, 10);
+        } else if (strcmp(arg, "--arrival") == 0) {
+            options->arrival_rate = strtod(value, NULL);
+        } else if (strcmp(arg, "--total") == 0) {
+            options->total = strtoull(value, NULL, 10);
+        } else if (strcmp(arg, "--duration") == 0) {
+            options->duration_s = (unsigned) strtoul(value, NULL, 10);
+        } else if (strcmp(arg, "--lifetime") == 0) {
+            if (parse_range(value, &min, &max) < 0) return -1;
+            options->lifetime_min_s = (unsigned) min;
+            options->lifetime_max_s = (unsigned) max;
+        } else if (strcmp(arg, "--abrupt") == 0) {
+            options->abrupt = strtod(value, NULL);
+        } else if (strcmp(arg, "--msg-rate") == 0) {
+            options->message_rate = strtod(value, NULL);
+        } else if (strcmp(arg, "--size") == 0) {
+            if (parse_range(value, &min, &max) < 0) return -1;
+            options->size_min = (size_t) min;
+            options->size_max = (size_t) max;
+        } else if (strcmp(arg, "--mix") == 0) {
+            if (parse_mix(value, options) < 0) return -1;
+        } else if (strcmp(arg, "--threads") == 0) {
+            options->threads = (unsigned) strtoul(value, NULL, 10);
+        } else if (strcmp(arg, "--interval") == 0) {
+            options->interval_s = (unsigned) strtoul(value, NULL, 10);
+        } else if (strcmp(arg, "--handshake-timeout") == 0) {
+            options->handshake_timeout_ms = (unsigned) strtoul(value, NULL, 10);
+        } else if (strcmp(arg, "--echo") == 0) {
+            options->echo = strtoul(value, NULL, 10) != 0;
+        } else if (strcmp(arg, "--executor-latency") == 0) {
+            options->executor_latency_us = strtoull(value, NULL, 10);
+        } else {
+            return -1;
+        }
+    }
+
+    if (options->sessions == 0) return -1;
+    if (options->threads == 0 || options->threads > SOAK_MAX_THREADS) {
+        return -1;
+    }
+    if (options->abrupt < 0 || options->abrupt > 1) return -1;
+    if (options->size_min < SOAK_PAYLOAD_HEADER_SIZE) return -1;
+    if (options->size_max > SOAK_PAYLOAD_MAX_SIZE) return -1;
+    if (options->interval_s == 0) return -1;
+    if (options->handshake_timeout_ms == 0) return -1;
+    return 0;
+}
+
+
+static void soak_on_signal(int signum) {
+    (void) signum;
+    soak_interrupted = 1;
+}
+
+
+static int soak_start_server(void) {
+    soak_options_t * options = &soak.options;
+    char address[64];
+    snprintf(address, sizeof(address), "0.0.0.0:%u", options->port);
+
+    pomelo_webrtc_mock_options_t mock_options;
+    memset(&mock_options, 0, sizeof(mock_options));
+    mock_options.address = address;
+    mock_options.nchannels = options->nchannels;
+    for (size_t i = 0; i < options->nchannels; i++) {
+        mock_options.channel_modes[i] = options->modes[i];
+    }
+    mock_options.on_receive = soak_server_on_receive;
+    mock_options.executor_latency_us = options->executor_latency_us;
+
+    soak.mock = pomelo_webrtc_mock_create(&mock_options);
+    if (!soak.mock) {
+        fprintf(stderr, "Failed to create mock plugin host\n");
+        return -1;
+    }
+
+    if (pomelo_webrtc_mock_listen(soak.mock) < 0) {
+        fprintf(stderr, "Failed to listen on %s\n", address);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static int soak_start_clients(void) {
+    soak_options_t * options = &soak.options;
+    if (options->url) {
+        snprintf(soak.url, sizeof(soak.url), "%s", options->url);
+    } else {
+        snprintf(
+            soak.url,
+            sizeof(soak.url),
+            "ws://127.0.0.1:%u",
+            options->port
+        );
+    }
+
+    soak.rtc_context = pomelo_webrtc_bench_client_context_create();
+    if (!soak.rtc_context) {
+        fprintf(stderr, "Failed to create RTC context\n");
+        return -1;
+    }
+
+    soak.clients = calloc(options->sessions, sizeof(soak_client_t));
+    soak.drivers = calloc(options->threads, sizeof(soak_driver_t));
+    if (!soak.clients || !soak.drivers) {
+        fprintf(stderr, "Failed to allocate clients\n");
+        return -1;
+    }
+
+    for (size_t i = 0; i < options->sessions; i++) {
+        pomelo_webrtc_bench_client_init(&soak.clients[i].base);
+        soak.clients[i].state = SOAK_CLIENT_FREE;
+    }
+
+    pomelo_atomic_uint64_store(&soak.running, 1);
+    pomelo_atomic_uint64_store(&soak.next_client_id, 1);
+
+    // Split slots and arrival rate between drivers
+    size_t per_driver = (options->sessions + options->threads - 1)
+        / options->threads;
+    for (unsigned i = 0; i < options->threads; i++) {
+        soak_driver_t * driver = &soak.drivers[i];
+        size_t begin = i * per_driver;
+        size_t end = begin + per_driver;
+        driver->begin = (begin < options->sessions) ? begin : options->sessions;
+        driver->end = (end < options->sessions) ? end : options->sessions;
+        driver->arrival_rate = options->arrival_rate / options->threads;
+        driver->random = pomelo_webrtc_bench_now_ns() ^ ((uint64_t) i << 32);
+        if (driver->random == 0) driver->random = 1;
+
+        uv_thread_create(
+            &driver->thread,
+            (uv_thread_cb) soak_driver_entry,
+            driver
+        );
+    }
+
+    return 0;
+}
+
+
+static void soak_stop_clients(void) {
+    if (soak.drivers) {
+        pomelo_atomic_uint64_store(&soak.running, 0);
+        for (unsigned i = 0; i < soak.options.threads; i++) {
+            uv_thread_join(&soak.drivers[i].thread);
+        }
+        free(soak.drivers);
+        soak.drivers = NULL;
+    }
+
+    if (soak.clients) {
+        for (size_t i = 0; i < soak.options.sessions; i++) {
+            pomelo_webrtc_bench_client_cleanup(&soak.clients[i].base);
+        }
+        free(soak.clients);
+        soak.clients = NULL;
+    }
+}
+
+
+int main(int argc, char * argv[]) {
+    memset(&soak, 0, sizeof(soak));
+    soak_options_t * options = &soak.options;
+    options->mode = SOAK_MODE_ALL;
+    options->port = 18889;
+    options->sessions = 1000;
+    options->arrival_rate = 100;
+    options->duration_s = 60;
+    options->lifetime_min_s = 5;
+    options->lifetime_max_s = 30;
+    options->abrupt = 0.2;
+    options->message_rate = 10;
+    options->size_min = 32;
+    options->size_max = 256;
+    options->threads = 4;
+    options->interval_s = 5;
+    options->handshake_timeout_ms = 15000;
+    options->echo = true;
+    parse_mix("u:60,s:20,r:20", options);
+
+    if (parse_options(argc, argv, options) < 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    signal(SIGINT, soak_on_signal);
+    signal(SIGTERM, soak_on_signal);
+
+    printf(
+        "mode=%s sessions=%zu arrival=%.1f/s lifetime=%u:%us abrupt=%.2f "
+        "msg_rate=%.1f/s size=%zu:%zu channels=%zu\n",
+        options->mode == SOAK_MODE_ALL ? "all" :
+            (options->mode == SOAK_MODE_SERVER ? "server" : "client"),
+        options->sessions,
+        options->arrival_rate,
+        options->lifetime_min_s,
+        options->lifetime_max_s,
+        options->abrupt,
+        options->message_rate,
+        options->size_min,
+        options->size_max,
+        options->nchannels
+    );
+
+    int ret = 0;
+    if (options->mode != SOAK_MODE_CLIENT) {
+        ret = soak_start_server();
+    }
+    if (ret == 0 && options->mode != SOAK_MODE_SERVER) {
+        ret = soak_start_clients();
+    }
+
+    uint64_t start = pomelo_webrtc_bench_now_ns();
+    uint64_t interval_ns = (uint64_t) options->interval_s * 1000000000ULL;
+    uint64_t next_report = start + interval_ns;
+    uint64_t end = start + (uint64_t) options->duration_s * 1000000000ULL;
+
+    while (ret == 0 && !soak_interrupted) {
+        uv_sleep(SOAK_POLL_INTERVAL_MS);
+
+        uint64_t now = pomelo_webrtc_bench_now_ns();
+        if (now >= next_report) {
+            soak_report((unsigned) ((now - start) / 1000000000ULL));
+            next_report += interval_ns;
+        }
+
+        if (options->duration_s > 0 && now >= end) break;
+    }
+
+    // Clients must be gone before the server, and both RTC contexts clean up
+    // the shared libdatachannel state, so the client context goes last.
+    soak_stop_clients();
+    if (soak.mock) {
+        soak_report(
+            (unsigned) ((pomelo_webrtc_bench_now_ns() - start) / 1000000000ULL)
+        );
+        pomelo_webrtc_mock_destroy(soak.mock);
+        soak.mock = NULL;
+    }
+
+    soak_report_summary();
+    if (soak.rtc_context) {
+        rtc_context_destroy(soak.rtc_context);
+        soak.rtc_context = NULL;
+    }
+
+    return ret == 0 ? 0 : 1;
+}
@@ -0,0 +1,220 @@
+#include <assert.h>
+#include <string.h>
+#include "uv.h"
+#include "context.h"
+#include "admission.h"
+
+
+/// Maximum length of a remote address string
+#define POMELO_WEBRTC_ADMISSION_ADDRESS_LENGTH 64
+
+/// FNV-1a 64 bits offset basis
+#define POMELO_WEBRTC_ADMISSION_HASH_BASIS 0xcbf29ce484222325ULL
+
+/// FNV-1a 64 bits prime
+#define POMELO_WEBRTC_ADMISSION_HASH_PRIME 0x100000001b3ULL
+
+
+/// @brief Hash the source address of client, the port is excluded
+static uint64_t pomelo_webrtc_admission_source(
+    rtc_websocket_client_t * ws_client
+) {
+    char address[POMELO_WEBRTC_ADMISSION_ADDRESS_LENGTH];
+    rtc_websocket_client_remote_address(
+        ws_client,
+        address,
+        POMELO_WEBRTC_ADMISSION_ADDRESS_LENGTH
+    );
+
+    // Address is formatted as <host>:<port>
+    size_t length = strlen(address);
+    char * separator = strrchr(address, ':');
+    if (separator) {
+        length = (size_t) (separator - address);
+    }
+
+    uint64_t hash = POMELO_WEBRTC_ADMISSION_HASH_BASIS;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (uint8_t) address[i];
+        hash *= POMELO_WEBRTC_ADMISSION_HASH_PRIME;
+    }
+
+    // Zero is reserved for untracked handshakes
+    return (hash != 0) ? hash : 1;
+}
+
+
+/// @brief Take a token of accept rate limit
+static bool pomelo_webrtc_admission_take_token(
+    pomelo_webrtc_admission_t * admission,
+    pomelo_webrtc_config_t * config
+) {
+    if (config->admission_accept_rate <= 0) {
+        return true; // No limit
+    }
+
+    double rate = (double) config->admission_accept_rate;
+    double burst = (config->admission_accept_burst > 0)
+        ? (double) config->admission_accept_burst
+        : rate;
+
+    uint64_t now = uv_hrtime();
+    if (admission->refill_time == 0) {
+        admission->tokens = burst; // The first client
+    } else {
+        uint64_t elapsed = now - admission->refill_time;
+        admission->tokens += rate * ((double) elapsed / 1e9);
+        if (admission->tokens > burst) {
+            admission->tokens = burst;
+        }
+    }
+    admission->refill_time = now;
+
+    if (admission->tokens < 1.0) {
+        return false;
+    }
+    admission->tokens -= 1.0;
+    return true;
+}
+
+
+int pomelo_webrtc_admission_init(
+    pomelo_webrtc_admission_t * admission,
+    pomelo_webrtc_context_t * context
+) {
+    assert(admission != NULL);
+    assert(context != NULL);
+    memset(admission, 0, sizeof(pomelo_webrtc_admission_t));
+    admission->context = context;
+
+    pomelo_map_options_t map_options = {
+        .allocator = context->allocator,
+        .key_size = sizeof(uint64_t),
+        .value_size = sizeof(uint64_t)
+    };
+    admission->sources = pomelo_map_create(&map_options);
+    if (!admission->sources) return -1;
+
+    return 0;
+}
+
+
+void pomelo_webrtc_admission_cleanup(pomelo_webrtc_admission_t * admission) {
+    assert(admission != NULL);
+    if (admission->sources) {
+        pomelo_map_destroy(admission->sources);
+        admission->sources = NULL;
+    }
+}
+
+
+int pomelo_webrtc_admission_accept(
+    pomelo_webrtc_admission_t * admission,
+    rtc_websocket_client_t * ws_client,
+    uint64_t * source
+) {
+    assert(admission != NULL);
+    assert(ws_client != NULL);
+    assert(source != NULL);
+
+    pomelo_webrtc_context_t * context = admission->context;
+    pomelo_webrtc_config_t * config = &context->config;
+
+    if (config->admission_max_loop_lag_ms > 0) {
+        uint64_t lag_us =
+            pomelo_webrtc_loop_monitor_lag(&context->loop_monitor);
+        if (lag_us > 1000ULL * (uint64_t) config->admission_max_loop_lag_ms) {
+            pomelo_atomic_uint64_fetch_add(&admission->rejected_loop_lag, 1);
+            return -1; // Loop is lagging
+        }
+    }
+
+    uint64_t pending = pomelo_atomic_uint64_load(&admission->pending);
+    if (
+        config->admission_max_pending_handshakes > 0 &&
+        pending >= (uint64_t) config->admission_max_pending_handshakes
+    ) {
+        pomelo_atomic_uint64_fetch_add(&admission->rejected_pending, 1);
+        return -1; // Too many handshakes in progress
+    }
+
+    uint64_t sessions =
+        pomelo_atomic_uint64_load(&context->resources.sessions);
+    if (
+        config->admission_max_sessions > 0 &&
+        sessions >= (uint64_t) config->admission_max_sessions
+    ) {
+        pomelo_atomic_uint64_fetch_add(&admission->rejected_sessions, 1);
+        return -1; // Too many sessions
+    }
+
+    uint64_t hash = pomelo_webrtc_admission_source(ws_client);
+    uint64_t count = 0;
+    pomelo_map_get(admission->sources, hash, &count);
+    if (
+        config->admission_max_pending_per_source > 0 &&
+        count >= (uint64_t) config->admission_max_pending_per_source
+    ) {
+        pomelo_atomic_uint64_fetch_add(&admission->rejected_source, 1);
+        return -1; // Too many handshakes from this source
+    }
+
+    // Tokens are only taken by the clients which pass all other limits
+    if (!pomelo_webrtc_admission_take_token(admission, config)) {
+        pomelo_atomic_uint64_fetch_add(&admission->rejected_rate, 1);
+        return -1; // Accepting too fast
+    }
+
+    count++;
+    if (!pomelo_map_set(admission->sources, hash, count)) {
+        return -1; // Failed to track the source
+    }
+
+    pomelo_atomic_uint64_fetch_add(&admission->pending, 1);
+    pomelo_atomic_uint64_fetch_add(&admission->accepted, 1);
+    *source = hash;
+    return 0;
+}
+
+
+void pomelo_webrtc_admission_release(
+    pomelo_webrtc_admission_t * admission,
+    uint64_t source
+) {
+    assert(admission != NULL);
+    if (source == 0 || !admission->sources) {
+        return; // Not tracked
+    }
+
+    pomelo_atomic_uint64_fetch_sub(&admission->pending, 1);
+
+    uint64_t count = 0;
+    pomelo_map_get(admission->sources, source, &count);
+    if (count > 1) {
+        count--;
+        pomelo_map_set(admission->sources, source, count);
+    } else {
+        pomelo_map_del(admission->sources, source);
+    }
+}
+
+
+void pomelo_webrtc_admission_get(
+    pomelo_webrtc_admission_t * admission,
+    pomelo_webrtc_admission_stats_t * stats
+) {
+    assert(admission != NULL);
+    assert(stats != NULL);
+
+    stats->pending = pomelo_atomic_uint64_load(&admission->pending);
+    stats->accepted = pomelo_atomic_uint64_load(&admission->accepted);
+    stats->rejected_rate = pomelo_atomic_uint64_load(&admission->rejected_rate);
+    stats->rejected_loop_lag =
+        pomelo_atomic_uint64_load(&admission->rejected_loop_lag);
+    stats->rejected_pending =
+        pomelo_atomic_uint64_load(&admission->rejected_pending);
+    stats->rejected_sessions =
+        pomelo_atomic_uint64_load(&admission->rejected_sessions);
+    stats->rejected_source =
+        pomelo_atomic_uint64_load(&admission->rejected_source);
+}
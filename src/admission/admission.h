@@ -0,0 +1,110 @@
+#ifndef POMELO_WEBRTC_ADMISSION_H
+#define POMELO_WEBRTC_ADMISSION_H
+#include <stdbool.h>
+#include "rtc-api/rtc-api.h"
+#include "utils/map.h"
+#include "utils/atomic.h"
+#include "plugin.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Admission control of new websocket clients.
+    When a websocket client is accepted, it is checked against the limits of
+    configuration before anything else is created for it: the lag of plugin
+    loop, the number of handshakes in progress, the number of sessions, the
+    number of handshakes in progress from the same source address and the
+    accept rate (token bucket). Rejected clients are closed immediately.
+
+    Every admitted handshake holds a slot until its result is reported. The
+    slot is identified by the hash of source address (without port) and it
+    moves with the handshake tracker from the pre-auth record to the session.
+
+    Recording functions are called in plugin thread only, the counters can be
+    read from any thread.
+*/
+
+
+/// @brief Admission control
+typedef struct pomelo_webrtc_admission_s pomelo_webrtc_admission_t;
+
+
+struct pomelo_webrtc_admission_s {
+    /// @brief The context
+    pomelo_webrtc_context_t * context;
+
+    /// @brief Pending handshakes by source: hash of address => count
+    pomelo_map_t * sources;
+
+    /// @brief Available tokens of accept rate limit
+    double tokens;
+
+    /// @brief The last time tokens have been refilled (ns)
+    uint64_t refill_time;
+
+    /// @brief Admitted handshakes which have not finished yet
+    pomelo_atomic_uint64_t pending;
+
+    /// @brief Admitted clients
+    pomelo_atomic_uint64_t accepted;
+
+    /// @brief Rejected clients by accept rate limit
+    pomelo_atomic_uint64_t rejected_rate;
+
+    /// @brief Rejected clients by loop lag
+    pomelo_atomic_uint64_t rejected_loop_lag;
+
+    /// @brief Rejected clients by pending handshakes limit
+    pomelo_atomic_uint64_t rejected_pending;
+
+    /// @brief Rejected clients by sessions limit
+    pomelo_atomic_uint64_t rejected_sessions;
+
+    /// @brief Rejected clients by pending handshakes limit of source
+    pomelo_atomic_uint64_t rejected_source;
+};
+
+
+/// @brief Initialize the admission control
+/// @return 0 on success, or -1 on failure
+int pomelo_webrtc_admission_init(
+    pomelo_webrtc_admission_t * admission,
+    pomelo_webrtc_context_t * context
+);
+
+
+/// @brief Cleanup the admission control
+void pomelo_webrtc_admission_cleanup(pomelo_webrtc_admission_t * admission);
+
+
+/// @brief Check a new websocket client against the limits. On success, a
+/// pending handshake slot is taken for the client.
+/// @param source Output hash of source address, it is never zero
+/// @return 0 if the client is admitted, or -1 if it must be rejected
+int pomelo_webrtc_admission_accept(
+    pomelo_webrtc_admission_t * admission,
+    rtc_websocket_client_t * ws_client,
+    uint64_t * source
+);
+
+
+/// @brief Release the pending handshake slot of a source. Zero source is
+/// ignored.
+void pomelo_webrtc_admission_release(
+    pomelo_webrtc_admission_t * admission,
+    uint64_t source
+);
+
+
+/// @brief Get the counters
+void pomelo_webrtc_admission_get(
+    pomelo_webrtc_admission_t * admission,
+    pomelo_webrtc_admission_stats_t * stats
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // POMELO_WEBRTC_ADMISSION_H
@@ -0,0 +1,239 @@
+#include <assert.h>
+#include <string.h>
+#include "utils/common-macro.h"
+#include "context.h"
+#include "session/session.h"
+#include "channel-aggregate.h"
+
+
+/// @brief Get the maximum size of a packed message of channel
+static size_t pomelo_webrtc_channel_aggregate_max_size(
+    pomelo_webrtc_channel_t * channel
+) {
+    size_t size = channel->aggregate_max_size;
+    return (size < channel->max_message_size)
+        ? size
+        : channel->max_message_size;
+}
+
+
+/// @brief Timer callback of delayed packed messages
+static void pomelo_webrtc_channel_aggregate_on_timer(
+    size_t argc,
+    pomelo_webrtc_variant_t * args
+) {
+    assert(argc == 1);
+    assert(args != NULL);
+    pomelo_webrtc_channel_aggregate_flush_all(args[0].ptr);
+}
+
+
+/// @brief Add the channel to the flushing list of context
+static void pomelo_webrtc_channel_aggregate_list(
+    pomelo_webrtc_channel_t * channel
+) {
+    if (channel->aggregate_listed) {
+        return; // Already listed
+    }
+
+    // Keep the channel until it is flushed
+    pomelo_webrtc_channel_ref(channel);
+    pomelo_webrtc_context_t * context = channel->context;
+    channel->aggregate_next = context->aggregate_channels;
+    channel->aggregate_listed = true;
+    context->aggregate_channels = channel;
+
+    int delay_ms = channel->aggregate_delay_ms;
+    if (delay_ms > 0 && !context->aggregate_task) {
+        // Without the timer, it is flushed by the loop check and prepare hooks
+        pomelo_webrtc_variant_t args[] = {{ .ptr = context }};
+        context->aggregate_task = pomelo_webrtc_context_schedule_task(
+            context,
+            pomelo_webrtc_channel_aggregate_on_timer,
+            POMELO_ARRAY_LENGTH(args),
+            args,
+            (uint64_t) delay_ms
+        );
+    }
+}
+
+
+/// @brief Send the packed message of channel
+static void pomelo_webrtc_channel_aggregate_flush(
+    pomelo_webrtc_channel_t * channel
+) {
+    rtc_buffer_t * buffer = channel->aggregate;
+    if (!buffer) {
+        return; // Nothing is packed
+    }
+
+    if (pomelo_webrtc_channel_is_sequenced(channel)) {
+        uint16_t sequence = pomelo_webrtc_channel_next_sequence(channel);
+        channel->aggregate_data[0] = (uint8_t) (sequence >> 8);
+        channel->aggregate_data[1] = (uint8_t) sequence;
+    }
+    rtc_buffer_truncate(buffer, channel->aggregate_size);
+
+    channel->aggregate = NULL;
+    channel->aggregate_data = NULL;
+    channel->aggregate_size = 0;
+    channel->aggregate_capacity = 0;
+
+    pomelo_webrtc_pacer_send(&channel->session->pacer, channel, buffer);
+    rtc_buffer_unref(buffer);
+}
+
+
+void pomelo_webrtc_channel_aggregate_init(pomelo_webrtc_channel_t * channel) {
+    assert(channel != NULL);
+    pomelo_webrtc_config_t * config = &channel->context->config;
+    channel->aggregate_max_size = (config->aggregation_max_size > 0)
+        ? (size_t) config->aggregation_max_size
+        : POMELO_WEBRTC_CHANNEL_AGGREGATE_DEFAULT_MAX_SIZE;
+    channel->aggregate_delay_ms = config->aggregation_max_delay_ms;
+}
+
+
+void pomelo_webrtc_channel_aggregate_send(
+    pomelo_webrtc_channel_t * channel,
+    rtc_buffer_t * buffer
+) {
+    assert(channel != NULL);
+    assert(buffer != NULL);
+
+    size_t length = rtc_buffer_size(buffer);
+    if (length > POMELO_WEBRTC_CHANNEL_AGGREGATE_MAX_LENGTH) {
+        pomelo_webrtc_channel_count_send_dropped(channel);
+        return; // Too large to describe
+    }
+
+    size_t frame_size =
+        pomelo_webrtc_channel_aggregate_write_length(NULL, length) + length;
+    if (
+        channel->aggregate &&
+        channel->aggregate_size + frame_size > channel->aggregate_capacity
+    ) {
+        pomelo_webrtc_channel_aggregate_flush(channel); // Full
+    }
+
+    if (!channel->aggregate) {
+        size_t header_size = pomelo_webrtc_channel_is_sequenced(channel)
+            ? POMELO_WEBRTC_CHANNEL_SEQUENCE_BYTES
+            : 0;
+
+        // A large message is packed alone
+        size_t capacity = pomelo_webrtc_channel_aggregate_max_size(channel);
+        if (capacity < header_size + frame_size) {
+            capacity = header_size + frame_size;
+        }
+
+        channel->aggregate = rtc_buffer_prepare(
+            channel->context->rtc_context,
+            capacity,
+            &channel->aggregate_data
+        );
+        if (!channel->aggregate) {
+            pomelo_webrtc_channel_count_send_dropped(channel);
+            return; // Failed to allocate buffer
+        }
+        channel->aggregate_size = header_size;
+        channel->aggregate_capacity = capacity;
+        pomelo_webrtc_channel_aggregate_list(channel);
+    }
+
+    uint8_t * data = channel->aggregate_data + channel->aggregate_size;
+    data += pomelo_webrtc_channel_aggregate_write_length(data, length);
+    memcpy(data, rtc_buffer_data(buffer), length);
+    channel->aggregate_size += frame_size;
+}
+
+
+void pomelo_webrtc_channel_aggregate_reset(pomelo_webrtc_channel_t * channel) {
+    assert(channel != NULL);
+    if (!channel->aggregate) {
+        return;
+    }
+
+    rtc_buffer_unref(channel->aggregate);
+    channel->aggregate = NULL;
+    channel->aggregate_data = NULL;
+    channel->aggregate_size = 0;
+    channel->aggregate_capacity = 0;
+}
+
+
+void pomelo_webrtc_channel_aggregate_flush_all(
+    pomelo_webrtc_context_t * context
+) {
+    assert(context != NULL);
+    if (context->aggregate_task) {
+        pomelo_webrtc_context_unschedule_task(context, context->aggregate_task);
+        context->aggregate_task = NULL;
+    }
+
+    pomelo_webrtc_channel_t * channel = context->aggregate_channels;
+    context->aggregate_channels = NULL;
+    while (channel) {
+        pomelo_webrtc_channel_t * next = channel->aggregate_next;
+        channel->aggregate_next = NULL;
+        channel->aggregate_listed = false;
+
+        // Closed channels have dropped their packed messages
+        pomelo_webrtc_channel_aggregate_flush(channel);
+        pomelo_webrtc_channel_unref(channel);
+        channel = next;
+    }
+}
+
+
+size_t pomelo_webrtc_channel_aggregate_write_length(
+    uint8_t * data,
+    size_t length
+) {
+    size_t bytes = 1;
+    while (length >= 0x80) {
+        if (data) *data++ = (uint8_t) (length | 0x80);
+        length >>= 7;
+        bytes++;
+    }
+    if (data) *data = (uint8_t) length;
+    return bytes;
+}
+
+
+int pomelo_webrtc_channel_aggregate_read_length(
+    const uint8_t ** data,
+    size_t * size,
+    size_t * length
+) {
+    assert(data != NULL);
+    assert(size != NULL);
+    assert(length != NULL);
+
+    const uint8_t * bytes = *data;
+    size_t remain = *size;
+    size_t value = 0;
+    for (size_t i = 0; i < POMELO_WEBRTC_CHANNEL_AGGREGATE_LENGTH_BYTES; i++) {
+        if (remain == 0) {
+            return -1; // Truncated length
+        }
+
+        uint8_t byte = *bytes++;
+        remain--;
+        value |= (size_t) (byte & 0x7F) << (7 * i);
+        if (byte & 0x80) {
+            continue;
+        }
+
+        if (value == 0 || value > remain) {
+            return -1; // Empty or truncated message
+        }
+
+        *data = bytes;
+        *size = remain;
+        *length = value;
+        return 0;
+    }
+
+    return -1; // Too long length
+}
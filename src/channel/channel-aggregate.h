@@ -0,0 +1,87 @@
+#ifndef POMELO_PLUGIN_WEBRTC_CHANNEL_AGGREGATE_H
+#define POMELO_PLUGIN_WEBRTC_CHANNEL_AGGREGATE_H
+#include "channel-int.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Aggregation of small messages on unreliable channels.
+    With the "agg" feature, the messages of configured unreliable channels
+    are packed into one data channel message, after the other channel
+    headers:
+        [length][message][length][message]...
+    The length is a varint of 7 bits per byte, little endian, the high bit
+    is set on all bytes but the last one.
+
+    Messages are packed in plugin thread until the packed message is full,
+    then it is flushed right after the I/O callbacks of the current loop
+    iteration (check phase), or after `aggregation_max_delay_ms` when it is
+    set. Messages packed by timers are flushed before the loop polls again.
+    Losing a packed message loses all of its messages, so it is kept around
+    one network packet by default.
+
+    Unpacking is done by the receiver of native messages, which is not the
+    plugin thread.
+*/
+
+
+/// Default maximum size of a packed message
+#define POMELO_WEBRTC_CHANNEL_AGGREGATE_DEFAULT_MAX_SIZE 1200
+
+/// Maximum size of the length of a message
+#define POMELO_WEBRTC_CHANNEL_AGGREGATE_LENGTH_BYTES 3
+
+/// Maximum length of a message in a packed message
+#define POMELO_WEBRTC_CHANNEL_AGGREGATE_MAX_LENGTH ((1 << 21) - 1)
+
+
+/// @brief Snapshot the aggregation options of channel from the config
+void pomelo_webrtc_channel_aggregate_init(pomelo_webrtc_channel_t * channel);
+
+
+/// @brief Pack a message. The message will be sent with the next packed
+/// message of channel.
+void pomelo_webrtc_channel_aggregate_send(
+    pomelo_webrtc_channel_t * channel,
+    rtc_buffer_t * buffer
+);
+
+
+/// @brief Drop the packed message of channel
+void pomelo_webrtc_channel_aggregate_reset(pomelo_webrtc_channel_t * channel);
+
+
+/// @brief Send the packed messages of all channels
+void pomelo_webrtc_channel_aggregate_flush_all(
+    pomelo_webrtc_context_t * context
+);
+
+
+/// @brief Write the length of a message. This is threadsafe.
+/// @param data The output or NULL to only count the bytes
+/// @return The number of bytes of the length
+size_t pomelo_webrtc_channel_aggregate_write_length(
+    uint8_t * data,
+    size_t length
+);
+
+
+/// @brief Read the length of the next message in a packed message. This is
+/// threadsafe.
+/// @param data The packed data, advanced past the length
+/// @param size Size of the packed data, reduced by the length bytes
+/// @param length Output length of the message
+/// @return 0 on success or -1 if the packed message is invalid
+int pomelo_webrtc_channel_aggregate_read_length(
+    const uint8_t ** data,
+    size_t * size,
+    size_t * length
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // POMELO_PLUGIN_WEBRTC_CHANNEL_AGGREGATE_H
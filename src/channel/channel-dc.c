@@ -4,8 +4,10 @@
 #include "context.h"
 #include "session/session.h"
 #include "channel-dc.h"
+#include "channel-fragment.h"
 #include "socket/socket.h"
 #include "utils/common-macro.h"
+#include "log/log.h"
 
 
 #define RTC_CHANNEL_NAME_CAPACITY (sizeof(POMELO_SERVER_CHANNEL_PREFIX) + 11)
@@ -45,6 +47,11 @@ static void pomelo_webrtc_dc_on_open_callback(
     }
 
     if (dc == channel->outgoing_dc) {
+        // Fragments are sized by the limit which the client has announced
+        size_t max_size = rtc_data_channel_max_message_size(dc);
+        if (max_size > POMELO_WEBRTC_CHANNEL_FRAGMENT_FIRST_HEADER_BYTES) {
+            channel->max_message_size = max_size;
+        }
         pomelo_webrtc_session_on_channel_opened(channel->session, channel);
     }
 }
@@ -135,7 +142,7 @@ void pomelo_webrtc_dc_on_error(
         return;
     }
 
-    pomelo_webrtc_log_debug(error);
+    pomelo_webrtc_log_at(POMELO_WEBRTC_LOG_LEVEL_DEBUG, "%s", error);
 
     pomelo_webrtc_variant_t args[] = {{ .ptr = dc }};
     pomelo_webrtc_context_submit_task(
@@ -163,7 +170,12 @@ static void pomelo_webrtc_dc_on_message_callback(
         return;
     }
     
-    if (dc != channel->incoming_dc) {
+    // Client has no data channel of its own for the system channel, it
+    // replies the pings through the outgoing one.
+    if (
+        dc != channel->incoming_dc &&
+        channel->index != POMELO_WEBRTC_CHANNEL_SYSTEM_INDEX
+    ) {
         return;
     }
 
@@ -331,6 +343,7 @@ void pomelo_webrtc_channel_dc_process_message(
     if (!pomelo_webrtc_channel_dc_is_receiving_enabled(channel)) {
         return; // Channel is not enabled
     }
+    pomelo_webrtc_channel_count_recv(channel, rtc_buffer_size(message));
 
     pomelo_webrtc_session_t * session = channel->session;
     if (channel == session->system_channel) {
@@ -341,5 +354,24 @@ void pomelo_webrtc_channel_dc_process_message(
         return;
     }
 
-    pomelo_webrtc_channel_receive(channel, message);
+    if (pomelo_webrtc_channel_is_fragmented(channel)) {
+        pomelo_webrtc_channel_fragment_receive(channel, message);
+        return;
+    }
+
+    size_t offset = 0;
+    if (pomelo_webrtc_channel_is_sequenced(channel)) {
+        size_t length = rtc_buffer_size(message);
+        if (length <= POMELO_WEBRTC_CHANNEL_SEQUENCE_BYTES) {
+            pomelo_webrtc_channel_count_recv_dropped(channel);
+            return; // No payload
+        }
+
+        const uint8_t * data = rtc_buffer_data(message);
+        uint16_t sequence = (uint16_t) ((data[0] << 8) | data[1]);
+        pomelo_webrtc_loss_record(&channel->loss, sequence);
+        offset = POMELO_WEBRTC_CHANNEL_SEQUENCE_BYTES;
+    }
+
+    pomelo_webrtc_channel_receive(channel, message, offset);
 }
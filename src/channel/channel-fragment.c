@@ -0,0 +1,228 @@
+#include <assert.h>
+#include <string.h>
+#include "context.h"
+#include "session/session.h"
+#include "channel-fragment.h"
+
+
+void pomelo_webrtc_channel_fragment_init(pomelo_webrtc_channel_t * channel) {
+    assert(channel != NULL);
+    int limit = channel->context->config.reassembly_buffer_limit;
+    channel->reassembly_limit = (limit > 0)
+        ? (size_t) limit
+        : POMELO_WEBRTC_CHANNEL_DEFAULT_REASSEMBLY_LIMIT;
+}
+
+
+/// @brief Start reassembling a message
+static void pomelo_webrtc_channel_fragment_first(
+    pomelo_webrtc_channel_t * channel,
+    const uint8_t * data,
+    size_t length
+) {
+    if (length <= POMELO_WEBRTC_CHANNEL_FRAGMENT_FIRST_HEADER_BYTES) {
+        pomelo_webrtc_channel_count_recv_dropped(channel);
+        return; // No payload
+    }
+
+    size_t total = ((size_t) data[1] << 24) | ((size_t) data[2] << 16) |
+        ((size_t) data[3] << 8) | (size_t) data[4];
+    data += POMELO_WEBRTC_CHANNEL_FRAGMENT_FIRST_HEADER_BYTES;
+    length -= POMELO_WEBRTC_CHANNEL_FRAGMENT_FIRST_HEADER_BYTES;
+    if (total <= length) {
+        pomelo_webrtc_channel_count_recv_dropped(channel);
+        return; // Not a fragmented message
+    }
+
+    pomelo_webrtc_session_t * session = channel->session;
+    size_t limit = channel->reassembly_limit;
+    if (
+        session->reassembly_bytes > limit ||
+        total > limit - session->reassembly_bytes
+    ) {
+        // The following fragments are discarded as no message is in progress
+        pomelo_webrtc_channel_count_recv_dropped(channel);
+        return; // Too large
+    }
+
+    uint8_t * buffer_data = NULL;
+    rtc_buffer_t * buffer = rtc_buffer_prepare(
+        channel->context->rtc_context,
+        total,
+        &buffer_data
+    );
+    if (!buffer) {
+        pomelo_webrtc_channel_count_recv_dropped(channel);
+        return; // Failed to allocate buffer
+    }
+
+    memcpy(buffer_data, data, length);
+    channel->reassembly = buffer;
+    channel->reassembly_data = buffer_data;
+    channel->reassembly_size = total;
+    channel->reassembly_offset = length;
+    session->reassembly_bytes += total;
+}
+
+
+/// @brief Append a fragment to the message which is being reassembled
+static void pomelo_webrtc_channel_fragment_next(
+    pomelo_webrtc_channel_t * channel,
+    const uint8_t * data,
+    size_t length
+) {
+    if (!channel->reassembly) {
+        return; // The message has been dropped at its first fragment
+    }
+
+    data += POMELO_WEBRTC_CHANNEL_FRAGMENT_HEADER_BYTES;
+    length -= POMELO_WEBRTC_CHANNEL_FRAGMENT_HEADER_BYTES;
+    size_t remain = channel->reassembly_size - channel->reassembly_offset;
+    if (length == 0 || length > remain) {
+        pomelo_webrtc_channel_fragment_reset(channel);
+        pomelo_webrtc_channel_count_recv_dropped(channel);
+        return; // Invalid fragment
+    }
+
+    memcpy(channel->reassembly_data + channel->reassembly_offset, data, length);
+    channel->reassembly_offset += length;
+    if (length < remain) {
+        return; // Wait for more fragments
+    }
+
+    // Complete, hand the message over
+    rtc_buffer_t * message = channel->reassembly;
+    channel->session->reassembly_bytes -= channel->reassembly_size;
+    channel->reassembly = NULL;
+    channel->reassembly_data = NULL;
+    channel->reassembly_size = 0;
+    channel->reassembly_offset = 0;
+
+    pomelo_webrtc_channel_receive(channel, message, 0);
+    rtc_buffer_unref(message);
+}
+
+
+void pomelo_webrtc_channel_fragment_send(
+    pomelo_webrtc_channel_t * channel,
+    pomelo_webrtc_pacer_t * pacer,
+    rtc_buffer_t * buffer,
+    uint8_t * header
+) {
+    assert(channel != NULL);
+    assert(pacer != NULL);
+    assert(buffer != NULL);
+    assert(header != NULL);
+
+    size_t size = rtc_buffer_size(buffer);
+    size_t max_size = channel->max_message_size;
+    if (size <= max_size) {
+        header[0] = POMELO_WEBRTC_CHANNEL_FRAGMENT_WHOLE;
+        pomelo_webrtc_pacer_send(pacer, channel, buffer);
+        return;
+    }
+
+    const uint8_t * payload =
+        rtc_buffer_data(buffer) + POMELO_WEBRTC_CHANNEL_FRAGMENT_HEADER_BYTES;
+    size_t total = size - POMELO_WEBRTC_CHANNEL_FRAGMENT_HEADER_BYTES;
+    if (total > UINT32_MAX) {
+        pomelo_webrtc_channel_count_send_dropped(channel);
+        return; // Too large to describe
+    }
+
+    rtc_context_t * rtc_context = channel->context->rtc_context;
+    size_t offset = 0;
+    while (offset < total) {
+        size_t header_size = (offset == 0)
+            ? POMELO_WEBRTC_CHANNEL_FRAGMENT_FIRST_HEADER_BYTES
+            : POMELO_WEBRTC_CHANNEL_FRAGMENT_HEADER_BYTES;
+        size_t length = max_size - header_size;
+        if (length > total - offset) {
+            length = total - offset;
+        }
+
+        uint8_t * data = NULL;
+        rtc_buffer_t * fragment =
+            rtc_buffer_prepare(rtc_context, header_size + length, &data);
+        if (!fragment) {
+            // The receiver drops the incomplete message at the next one
+            pomelo_webrtc_channel_count_send_dropped(channel);
+            return; // Failed to allocate fragment
+        }
+
+        if (offset == 0) {
+            data[0] = POMELO_WEBRTC_CHANNEL_FRAGMENT_FIRST;
+            data[1] = (uint8_t) (total >> 24);
+            data[2] = (uint8_t) (total >> 16);
+            data[3] = (uint8_t) (total >> 8);
+            data[4] = (uint8_t) total;
+        } else {
+            data[0] = POMELO_WEBRTC_CHANNEL_FRAGMENT_NEXT;
+        }
+        memcpy(data + header_size, payload + offset, length);
+        offset += length;
+
+        pomelo_webrtc_pacer_send(pacer, channel, fragment);
+        rtc_buffer_unref(fragment);
+    }
+}
+
+
+void pomelo_webrtc_channel_fragment_receive(
+    pomelo_webrtc_channel_t * channel,
+    rtc_buffer_t * message
+) {
+    assert(channel != NULL);
+    assert(message != NULL);
+
+    size_t length = rtc_buffer_size(message);
+    if (length <= POMELO_WEBRTC_CHANNEL_FRAGMENT_HEADER_BYTES) {
+        pomelo_webrtc_channel_count_recv_dropped(channel);
+        return; // No payload
+    }
+
+    const uint8_t * data = rtc_buffer_data(message);
+    switch (data[0]) {
+        case POMELO_WEBRTC_CHANNEL_FRAGMENT_WHOLE:
+            if (pomelo_webrtc_channel_fragment_reset(channel)) {
+                pomelo_webrtc_channel_count_recv_dropped(channel);
+            }
+            pomelo_webrtc_channel_receive(
+                channel,
+                message,
+                POMELO_WEBRTC_CHANNEL_FRAGMENT_HEADER_BYTES
+            );
+            return;
+
+        case POMELO_WEBRTC_CHANNEL_FRAGMENT_FIRST:
+            if (pomelo_webrtc_channel_fragment_reset(channel)) {
+                pomelo_webrtc_channel_count_recv_dropped(channel);
+            }
+            pomelo_webrtc_channel_fragment_first(channel, data, length);
+            return;
+
+        case POMELO_WEBRTC_CHANNEL_FRAGMENT_NEXT:
+            pomelo_webrtc_channel_fragment_next(channel, data, length);
+            return;
+
+        default:
+            pomelo_webrtc_channel_count_recv_dropped(channel);
+            return; // Unknown header
+    }
+}
+
+
+bool pomelo_webrtc_channel_fragment_reset(pomelo_webrtc_channel_t * channel) {
+    assert(channel != NULL);
+    if (!channel->reassembly) {
+        return false;
+    }
+
+    channel->session->reassembly_bytes -= channel->reassembly_size;
+    rtc_buffer_unref(channel->reassembly);
+    channel->reassembly = NULL;
+    channel->reassembly_data = NULL;
+    channel->reassembly_size = 0;
+    channel->reassembly_offset = 0;
+    return true;
+}
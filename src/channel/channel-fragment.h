@@ -0,0 +1,81 @@
+#ifndef POMELO_PLUGIN_WEBRTC_CHANNEL_FRAGMENT_H
+#define POMELO_PLUGIN_WEBRTC_CHANNEL_FRAGMENT_H
+#include "channel-int.h"
+#include "pacing/pacer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Fragmentation of reliable channels.
+    With the "frag" feature, every message of reliable channels starts with a
+    1-byte header. A message which fits in the maximum message size of data
+    channel is sent whole, a larger one is split into fragments:
+        [WHOLE][payload]
+        [FIRST][4 bytes: total payload size, big endian][payload]
+        [NEXT][payload] ... until the total size has been received
+
+    Reliable channels are ordered, so the fragments of a message arrive in
+    order and are never interleaved with other messages of the same channel.
+    The receiver allocates the whole message at the first fragment, the bytes
+    being reassembled by all channels of a session are capped. A message
+    which does not fit in the cap is dropped.
+
+    All functions are called in plugin thread only.
+*/
+
+
+/// Size of the fragment header
+#define POMELO_WEBRTC_CHANNEL_FRAGMENT_HEADER_BYTES 1
+
+/// Size of the header of the first fragment
+#define POMELO_WEBRTC_CHANNEL_FRAGMENT_FIRST_HEADER_BYTES 5
+
+/// A whole message
+#define POMELO_WEBRTC_CHANNEL_FRAGMENT_WHOLE 0
+
+/// The first fragment of a message
+#define POMELO_WEBRTC_CHANNEL_FRAGMENT_FIRST 1
+
+/// A following fragment of a message
+#define POMELO_WEBRTC_CHANNEL_FRAGMENT_NEXT 2
+
+/// Maximum message size when the data channel does not report it
+#define POMELO_WEBRTC_CHANNEL_DEFAULT_MAX_MESSAGE_SIZE 65536
+
+/// Default cap of reassembled bytes per session
+#define POMELO_WEBRTC_CHANNEL_DEFAULT_REASSEMBLY_LIMIT (1024 * 1024)
+
+
+/// @brief Snapshot the reassembly limit of channel from the config
+void pomelo_webrtc_channel_fragment_init(pomelo_webrtc_channel_t * channel);
+
+
+/// @brief Send a message through the pacer, split into fragments when it is
+/// larger than the maximum message size. The message starts with the space
+/// reserved for the fragment header.
+void pomelo_webrtc_channel_fragment_send(
+    pomelo_webrtc_channel_t * channel,
+    pomelo_webrtc_pacer_t * pacer,
+    rtc_buffer_t * buffer,
+    uint8_t * header
+);
+
+
+/// @brief Process a received message which starts with the fragment header
+void pomelo_webrtc_channel_fragment_receive(
+    pomelo_webrtc_channel_t * channel,
+    rtc_buffer_t * message
+);
+
+
+/// @brief Drop the message which is being reassembled
+/// @return Whether a message has been dropped
+bool pomelo_webrtc_channel_fragment_reset(pomelo_webrtc_channel_t * channel);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // POMELO_PLUGIN_WEBRTC_CHANNEL_FRAGMENT_H
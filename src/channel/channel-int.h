@@ -26,9 +26,59 @@ void pomelo_webrtc_channel_send_buffer(
 
 
 /// @brief Handle received message
+/// @param offset Offset of the payload in message
 void pomelo_webrtc_channel_receive(
     pomelo_webrtc_channel_t * channel,
-    rtc_buffer_t * message
+    rtc_buffer_t * message,
+    size_t offset
+);
+
+
+/// @brief Handle a message which has been received over websocket before
+/// the data channels are ready. It is never held.
+void pomelo_webrtc_channel_receive_early(
+    pomelo_webrtc_channel_t * channel,
+    rtc_buffer_t * message,
+    size_t offset
+);
+
+
+/// @brief Submit the command of a received message to the native session
+void pomelo_webrtc_channel_submit_receive(
+    pomelo_webrtc_recv_command_t * command
+);
+
+
+/// @brief Release the command of a received message without processing it
+void pomelo_webrtc_channel_discard_receive(
+    pomelo_webrtc_recv_command_t * command
+);
+
+
+/// @brief Get the sequence of the next outgoing message. Plugin thread only.
+uint16_t pomelo_webrtc_channel_next_sequence(
+    pomelo_webrtc_channel_t * channel
+);
+
+
+/// @brief Count a message which has been received from the data channel.
+/// Plugin thread only.
+void pomelo_webrtc_channel_count_recv(
+    pomelo_webrtc_channel_t * channel,
+    size_t bytes
+);
+
+
+/// @brief Count a received message which has not reached the native session
+void pomelo_webrtc_channel_count_recv_dropped(
+    pomelo_webrtc_channel_t * channel
+);
+
+
+/// @brief Count an outgoing message which has been dropped before reaching
+/// the data channel. Plugin thread only.
+void pomelo_webrtc_channel_count_send_dropped(
+    pomelo_webrtc_channel_t * channel
 );
 
 
@@ -43,6 +93,14 @@ void pomelo_webrtc_channel_receive_complete(
 );
 
 
+/// @brief Count the result of sending a message through the data channel
+void pomelo_webrtc_channel_count_send(
+    pomelo_webrtc_channel_t * channel,
+    int result,
+    size_t bytes
+);
+
+
 /// @brief On finalize the channel
 void pomelo_webrtc_channel_on_finalize(pomelo_webrtc_channel_t * channel);
 
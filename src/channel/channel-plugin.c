@@ -1,6 +1,9 @@
 #include <assert.h>
 #include "session/session.h"
+#include "session/session-ws.h"
 #include "channel-plugin.h"
+#include "channel-fragment.h"
+#include "channel-aggregate.h"
 #include "context.h"
 #include "utils/macro.h"
 #include "utils/common-macro.h"
@@ -46,13 +49,14 @@ static void pomelo_webrtc_plugin_session_send_callback(
     size_t argc,
     pomelo_webrtc_variant_t * args
 ) {
-    assert(argc == 4);
+    assert(argc == 5);
     assert(args != NULL);
 
     pomelo_plugin_t * plugin = args[0].ptr;
     pomelo_session_t * native_session = args[1].ptr;
     size_t channel_index = args[2].size;
     rtc_buffer_t * buffer = args[3].ptr;
+    uint8_t * header = args[4].ptr; // Reserved header or NULL
 
     pomelo_webrtc_session_t * session =
         plugin->session_get_private(plugin, native_session);
@@ -62,7 +66,40 @@ static void pomelo_webrtc_plugin_session_send_callback(
     pomelo_array_get(session->channels, channel_index, &channel);
 
     if (channel != NULL && channel != session->system_channel) {
-        pomelo_webrtc_channel_send_buffer(channel, buffer);
+        if (session->flags & POMELO_WEBRTC_SESSION_FLAG_EARLY_SEND) {
+            // Data channels are not ready, skip their headers
+            size_t header_size = 0;
+            if (header) {
+                header_size = pomelo_webrtc_channel_is_sequenced(channel)
+                    ? POMELO_WEBRTC_CHANNEL_SEQUENCE_BYTES
+                    : POMELO_WEBRTC_CHANNEL_FRAGMENT_HEADER_BYTES;
+            }
+            pomelo_webrtc_session_ws_send_data(
+                session,
+                channel,
+                rtc_buffer_data(buffer) + header_size,
+                rtc_buffer_size(buffer) - header_size
+            );
+        } else if (pomelo_webrtc_channel_is_aggregated(channel)) {
+            pomelo_webrtc_channel_aggregate_send(channel, buffer);
+        } else if (header && pomelo_webrtc_channel_is_fragmented(channel)) {
+            pomelo_webrtc_channel_fragment_send(
+                channel,
+                &session->pacer,
+                buffer,
+                header
+            );
+        } else {
+            if (header) {
+                uint16_t sequence =
+                    pomelo_webrtc_channel_next_sequence(channel);
+                header[0] = (uint8_t) (sequence >> 8);
+                header[1] = (uint8_t) sequence;
+            }
+            pomelo_webrtc_pacer_send(&session->pacer, channel, buffer);
+        }
+    } else {
+        pomelo_webrtc_plugin_count_send_dropped(plugin, native_session);
     }
 
     rtc_buffer_unref(buffer);
@@ -84,23 +121,81 @@ void POMELO_PLUGIN_CALL pomelo_webrtc_plugin_session_send(
         return; // Empty message
     }
 
+    // The headers are written in plugin thread, only reserve their space here
+    size_t header_size = 0;
+    bool compressed = false;
+    pomelo_webrtc_session_t * session =
+        plugin->session_get_private(plugin, native_session);
+    if (session) {
+        if (
+            pomelo_webrtc_session_is_channel_aggregated(session, channel_index)
+        ) {
+            // The headers are written once per packed message
+        } else if (
+            pomelo_webrtc_session_is_channel_sequenced(session, channel_index)
+        ) {
+            header_size = POMELO_WEBRTC_CHANNEL_SEQUENCE_BYTES;
+        } else if (
+            pomelo_webrtc_session_is_channel_fragmented(session, channel_index)
+        ) {
+            header_size = POMELO_WEBRTC_CHANNEL_FRAGMENT_HEADER_BYTES;
+        }
+        compressed =
+            pomelo_webrtc_session_is_channel_compressed(session, channel_index);
+    }
+
+    // The compression header follows the channel headers
+    size_t prefix = header_size;
+    if (compressed) {
+        prefix += POMELO_WEBRTC_COMPRESS_HEADER_BYTES;
+    }
+
     uint8_t * data = NULL;
     pomelo_webrtc_context_t * context = plugin->get_data(plugin);
-    rtc_buffer_t * buffer =
-        rtc_buffer_prepare(context->rtc_context, length, &data);
+    rtc_buffer_t * buffer = rtc_buffer_prepare(
+        context->rtc_context,
+        prefix + length,
+        &data
+    );
     if (!buffer) {
+        pomelo_webrtc_plugin_count_send_dropped(plugin, native_session);
         return; // Failed to acquire new buffer
     }
 
-    if (plugin->message_read(plugin, message, data, length) < 0) {
+    int ret = plugin->message_read(plugin, message, data + prefix, length);
+    if (ret < 0) {
+        pomelo_webrtc_plugin_count_send_dropped(plugin, native_session);
+        rtc_buffer_unref(buffer);
         return; // Failed to read
     }
 
+    if (compressed) {
+        // Compress here, so that the plugin thread is not blocked by codec
+        data[header_size] = POMELO_WEBRTC_COMPRESS_NONE;
+        if (length >= session->compression_min_size) {
+            uint8_t * compressed_data = NULL;
+            rtc_buffer_t * compressed_buffer = pomelo_webrtc_compress(
+                context->rtc_context,
+                pomelo_webrtc_session_get_dictionary(session, channel_index),
+                data + prefix,
+                length,
+                header_size,
+                &compressed_data
+            );
+            if (compressed_buffer) {
+                rtc_buffer_unref(buffer);
+                buffer = compressed_buffer;
+                data = compressed_data;
+            }
+        }
+    }
+
     pomelo_webrtc_variant_t args[] = {
         { .ptr = plugin },
         { .ptr = native_session },
         { .size = channel_index },
-        { .ptr = buffer }
+        { .ptr = buffer },
+        { .ptr = (header_size > 0) ? data : NULL }
     };
 
     pomelo_webrtc_task_t * task = pomelo_webrtc_context_submit_task(
@@ -111,6 +206,7 @@ void POMELO_PLUGIN_CALL pomelo_webrtc_plugin_session_send(
     );
     if (!task) {
         // Failed to submit new task
+        pomelo_webrtc_plugin_count_send_dropped(plugin, native_session);
         rtc_buffer_unref(buffer);
     }
 }
@@ -120,22 +216,55 @@ void POMELO_PLUGIN_CALL pomelo_webrtc_plugin_session_send(
 /*                            Private APIs                                    */
 /* -------------------------------------------------------------------------- */
 
-void pomelo_webrtc_plugin_channel_receive(
+/// @brief Deliver a received message to the native session
+static void pomelo_webrtc_plugin_channel_deliver(
     pomelo_plugin_t * plugin,
-    pomelo_webrtc_recv_command_t * command
+    pomelo_webrtc_recv_command_t * command,
+    const uint8_t * payload,
+    size_t size
 ) {
-    pomelo_message_t * native_message = plugin->message_acquire(plugin);
-    if (!native_message) return; // Failed to acquire message
+    // Decompress here, so that the plugin thread is not blocked by codec
+    rtc_buffer_t * decompressed = NULL;
+    if (pomelo_webrtc_channel_is_compressed(command->channel)) {
+        pomelo_webrtc_context_t * context = plugin->get_data(plugin);
+        pomelo_webrtc_session_t * session = command->channel->session;
+        int ret = pomelo_webrtc_decompress(
+            context->rtc_context,
+            pomelo_webrtc_session_get_dictionary(
+                session,
+                command->channel->index
+            ),
+            payload,
+            size,
+            &decompressed
+        );
+        if (ret < 0) {
+            pomelo_webrtc_channel_count_recv_dropped(command->channel);
+            return; // Invalid compressed message
+        }
 
-    rtc_buffer_t * message = command->message;
+        if (decompressed) {
+            payload = rtc_buffer_data(decompressed);
+            size = rtc_buffer_size(decompressed);
+        } else {
+            payload += POMELO_WEBRTC_COMPRESS_HEADER_BYTES;
+            size -= POMELO_WEBRTC_COMPRESS_HEADER_BYTES;
+        }
+    }
 
-    int ret = plugin->message_write(
-        plugin,
-        native_message,
-        rtc_buffer_data(message),
-        rtc_buffer_size(message)
-    );
-    if (ret < 0) return; // Failed to write message
+    pomelo_message_t * native_message = plugin->message_acquire(plugin);
+    if (!native_message) {
+        if (decompressed) rtc_buffer_unref(decompressed);
+        pomelo_webrtc_channel_count_recv_dropped(command->channel);
+        return; // Failed to acquire message
+    }
+
+    int ret = plugin->message_write(plugin, native_message, payload, size);
+    if (decompressed) rtc_buffer_unref(decompressed);
+    if (ret < 0) {
+        pomelo_webrtc_channel_count_recv_dropped(command->channel);
+        return; // Failed to write message
+    }
 
     plugin->session_receive(
         plugin,
@@ -144,3 +273,52 @@ void pomelo_webrtc_plugin_channel_receive(
         native_message
     );
 }
+
+
+void pomelo_webrtc_plugin_channel_receive(
+    pomelo_plugin_t * plugin,
+    pomelo_webrtc_recv_command_t * command
+) {
+    rtc_buffer_t * message = command->message;
+    const uint8_t * payload = rtc_buffer_data(message) + command->offset;
+    size_t size = rtc_buffer_size(message) - command->offset;
+
+    if (!pomelo_webrtc_channel_is_aggregated(command->channel)) {
+        pomelo_webrtc_plugin_channel_deliver(plugin, command, payload, size);
+        return;
+    }
+
+    // Unpack the messages
+    size_t length = 0;
+    while (size > 0) {
+        int ret = pomelo_webrtc_channel_aggregate_read_length(
+            &payload,
+            &size,
+            &length
+        );
+        if (ret < 0) {
+            pomelo_webrtc_channel_count_recv_dropped(command->channel);
+            return; // The rest of packed message is invalid
+        }
+
+        pomelo_webrtc_plugin_channel_deliver(plugin, command, payload, length);
+        payload += length;
+        size -= length;
+    }
+}
+
+
+void pomelo_webrtc_plugin_count_send_dropped(
+    pomelo_plugin_t * plugin,
+    pomelo_session_t * native_session
+) {
+    pomelo_webrtc_context_t * context = plugin->get_data(plugin);
+    pomelo_webrtc_traffic_on_send_dropped(&context->traffic);
+
+    pomelo_webrtc_session_t * session =
+        plugin->session_get_private(plugin, native_session);
+    if (session) {
+        // The channel is not resolved in this thread
+        pomelo_webrtc_traffic_on_send_dropped(&session->traffic);
+    }
+}
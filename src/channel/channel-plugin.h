@@ -35,6 +35,14 @@ void pomelo_webrtc_plugin_channel_receive(
 );
 
 
+/// @brief Count an outgoing message which has been dropped before its channel
+/// is resolved. This can be called from any thread.
+void pomelo_webrtc_plugin_count_send_dropped(
+    pomelo_plugin_t * plugin,
+    pomelo_session_t * native_session
+);
+
+
 #ifdef __cplusplus
 }
 #endif
@@ -10,6 +10,8 @@
 #include "session/session.h"
 #include "channel-dc.h"
 #include "channel-plugin.h"
+#include "channel-fragment.h"
+#include "channel-aggregate.h"
 
 
 #define pomelo_webrtc_channel_is_active(channel)                               \
@@ -63,6 +65,28 @@ int pomelo_webrtc_channel_init(
 
     channel->index = info->channel_index;
     channel->mode = info->channel_mode;
+    channel->priority = info->priority;
+    channel->traffic = info->traffic;
+    channel->send_sequence = 0;
+    pomelo_webrtc_loss_reset(&channel->loss);
+    if (info->sequenced) {
+        POMELO_SET_FLAG(channel->flags, POMELO_WEBRTC_CHANNEL_FLAG_SEQUENCED);
+    }
+    if (info->fragmented) {
+        POMELO_SET_FLAG(channel->flags, POMELO_WEBRTC_CHANNEL_FLAG_FRAGMENTED);
+    }
+    if (info->compressed) {
+        POMELO_SET_FLAG(channel->flags, POMELO_WEBRTC_CHANNEL_FLAG_COMPRESSED);
+    }
+    if (info->aggregated) {
+        POMELO_SET_FLAG(channel->flags, POMELO_WEBRTC_CHANNEL_FLAG_AGGREGATED);
+    }
+    channel->max_message_size = POMELO_WEBRTC_CHANNEL_DEFAULT_MAX_MESSAGE_SIZE;
+    pomelo_webrtc_channel_fragment_init(channel);
+    channel->aggregate = NULL;
+    channel->aggregate_next = NULL;
+    channel->aggregate_listed = false;
+    pomelo_webrtc_channel_aggregate_init(channel);
     pomelo_webrtc_channel_set_active(channel);
 
     // Initialize DC part of channel
@@ -77,6 +101,10 @@ void pomelo_webrtc_channel_cleanup(pomelo_webrtc_channel_t * channel) {
     // Cleanup dc part
     pomelo_webrtc_channel_dc_cleanup(channel);
 
+    // Give the reassembly bytes back to the session
+    pomelo_webrtc_channel_fragment_reset(channel);
+    pomelo_webrtc_channel_aggregate_reset(channel);
+
     // Unref the session
     pomelo_webrtc_session_unref(channel->session);
     channel->session = NULL;
@@ -84,6 +112,8 @@ void pomelo_webrtc_channel_cleanup(pomelo_webrtc_channel_t * channel) {
     channel->flags = 0;
     channel->index = 0;
     channel->mode = POMELO_CHANNEL_MODE_UNRELIABLE;
+    channel->priority = 0;
+    channel->traffic = NULL;
 }
 
 
@@ -94,7 +124,8 @@ void pomelo_webrtc_channel_close(pomelo_webrtc_channel_t * channel) {
     }
     pomelo_webrtc_channel_unset_active(channel);
 
-    // Close the channel
+    // Close the channel, the packed messages are no longer sent
+    pomelo_webrtc_channel_aggregate_reset(channel);
     pomelo_webrtc_channel_dc_close(channel);
 
     // Finally, unref itself
@@ -117,8 +148,8 @@ void pomelo_webrtc_channel_send(
     assert(data != NULL);
     if (length == 0) return;
 
-    // Send message and unref the buffer
-    rtc_data_channel_send(channel->outgoing_dc, data, length);
+    int ret = rtc_data_channel_send(channel->outgoing_dc, data, length);
+    pomelo_webrtc_channel_count_send(channel, ret, length);
 }
 
 
@@ -161,6 +192,14 @@ void pomelo_webrtc_channel_unref(pomelo_webrtc_channel_t * channel) {
 }
 
 
+uint16_t pomelo_webrtc_channel_next_sequence(
+    pomelo_webrtc_channel_t * channel
+) {
+    assert(channel != NULL);
+    return channel->send_sequence++;
+}
+
+
 void pomelo_webrtc_channel_send_buffer(
     pomelo_webrtc_channel_t * channel,
     rtc_buffer_t * buffer
@@ -168,18 +207,45 @@ void pomelo_webrtc_channel_send_buffer(
     assert(channel != NULL);
     assert(buffer != NULL);
 
-    // Send message and unref the buffer
-    rtc_data_channel_send_buffer(channel->outgoing_dc, buffer);
+    int ret = rtc_data_channel_send_buffer(channel->outgoing_dc, buffer);
+    pomelo_webrtc_channel_count_send(channel, ret, rtc_buffer_size(buffer));
 }
 
 
-void pomelo_webrtc_channel_receive(
+void pomelo_webrtc_channel_count_recv(
     pomelo_webrtc_channel_t * channel,
-    rtc_buffer_t * message
+    size_t bytes
 ) {
     assert(channel != NULL);
-    assert(message != NULL);
+    pomelo_webrtc_traffic_on_recv(channel->traffic, bytes);
+    pomelo_webrtc_traffic_on_recv(&channel->context->traffic, bytes);
+}
+
+
+void pomelo_webrtc_channel_count_recv_dropped(
+    pomelo_webrtc_channel_t * channel
+) {
+    assert(channel != NULL);
+    pomelo_webrtc_traffic_on_recv_dropped(channel->traffic);
+    pomelo_webrtc_traffic_on_recv_dropped(&channel->context->traffic);
+}
+
+
+void pomelo_webrtc_channel_count_send_dropped(
+    pomelo_webrtc_channel_t * channel
+) {
+    assert(channel != NULL);
+    pomelo_webrtc_traffic_on_send_dropped(channel->traffic);
+    pomelo_webrtc_traffic_on_send_dropped(&channel->context->traffic);
+}
 
+
+/// @brief Acquire the command of a received message
+static pomelo_webrtc_recv_command_t * pomelo_webrtc_channel_prepare_receive(
+    pomelo_webrtc_channel_t * channel,
+    rtc_buffer_t * message,
+    size_t offset
+) {
     // Ref this channel until the messasge is processed completely
     pomelo_webrtc_channel_ref(channel);
 
@@ -189,17 +255,66 @@ void pomelo_webrtc_channel_receive(
     pomelo_webrtc_context_t * context = channel->context;
 
     pomelo_webrtc_recv_command_t * command =
-        pomelo_pool_acquire(context->recv_command_pool, NULL);
+        pomelo_webrtc_context_acquire_recv_command(context);
     if (!command) {
         // Failed to allocate command
+        pomelo_webrtc_channel_count_recv_dropped(channel);
         rtc_buffer_unref(message);
         pomelo_webrtc_channel_unref(channel);
-        return;
+        return NULL;
     }
 
     command->message = message;
+    command->offset = offset;
     command->native_session = channel->session->native_session;
     command->channel = channel;
+    command->next = NULL;
+    return command;
+}
+
+
+void pomelo_webrtc_channel_receive(
+    pomelo_webrtc_channel_t * channel,
+    rtc_buffer_t * message,
+    size_t offset
+) {
+    assert(channel != NULL);
+    assert(message != NULL);
+
+    pomelo_webrtc_recv_command_t * command =
+        pomelo_webrtc_channel_prepare_receive(channel, message, offset);
+    if (!command) return;
+
+    if (pomelo_webrtc_session_hold_received(channel->session, command)) {
+        return; // Client is still sending over websocket
+    }
+
+    pomelo_webrtc_channel_submit_receive(command);
+}
+
+
+void pomelo_webrtc_channel_receive_early(
+    pomelo_webrtc_channel_t * channel,
+    rtc_buffer_t * message,
+    size_t offset
+) {
+    assert(channel != NULL);
+    assert(message != NULL);
+
+    pomelo_webrtc_recv_command_t * command =
+        pomelo_webrtc_channel_prepare_receive(channel, message, offset);
+    if (!command) return;
+
+    pomelo_webrtc_channel_submit_receive(command);
+}
+
+
+void pomelo_webrtc_channel_submit_receive(
+    pomelo_webrtc_recv_command_t * command
+) {
+    assert(command != NULL);
+    pomelo_webrtc_channel_t * channel = command->channel;
+    pomelo_webrtc_context_t * context = channel->context;
 
     int ret = context->plugin->executor_submit(
         context->plugin,
@@ -208,9 +323,8 @@ void pomelo_webrtc_channel_receive(
     );
     if (ret < 0) {
         // Failed to submit command
-        rtc_buffer_unref(message);
-        pomelo_webrtc_channel_unref(channel);
-        pomelo_pool_release(context->recv_command_pool, command);
+        pomelo_webrtc_channel_count_recv_dropped(channel);
+        pomelo_webrtc_channel_discard_receive(command);
         return;
     }
 
@@ -218,6 +332,19 @@ void pomelo_webrtc_channel_receive(
 }
 
 
+void pomelo_webrtc_channel_discard_receive(
+    pomelo_webrtc_recv_command_t * command
+) {
+    assert(command != NULL);
+    pomelo_webrtc_channel_t * channel = command->channel;
+    pomelo_webrtc_context_t * context = channel->context;
+
+    rtc_buffer_unref(command->message);
+    pomelo_webrtc_context_release_recv_command(context, command);
+    pomelo_webrtc_channel_unref(channel);
+}
+
+
 /* -------------------------------------------------------------------------- */
 /*                               Private APIs                                 */
 /* -------------------------------------------------------------------------- */
@@ -234,7 +361,25 @@ void pomelo_webrtc_channel_receive_complete(
 
     rtc_buffer_unref(command->message);
     pomelo_webrtc_channel_unref(channel);
-    pomelo_pool_release(context->recv_command_pool, command);
+    pomelo_webrtc_context_release_recv_command(context, command);
+}
+
+
+void pomelo_webrtc_channel_count_send(
+    pomelo_webrtc_channel_t * channel,
+    int result,
+    size_t bytes
+) {
+    assert(channel != NULL);
+    pomelo_webrtc_context_t * context = channel->context;
+    if (result < 0) {
+        pomelo_webrtc_traffic_on_send_failed(channel->traffic);
+        pomelo_webrtc_traffic_on_send_failed(&context->traffic);
+        return;
+    }
+
+    pomelo_webrtc_traffic_on_send(channel->traffic, bytes);
+    pomelo_webrtc_traffic_on_send(&context->traffic, bytes);
 }
 
 
@@ -3,6 +3,8 @@
 #include "plugin.h"
 #include "rtc-api/rtc-api.h"
 #include "base/ref.h"
+#include "stats/traffic-stats.h"
+#include "stats/loss-stats.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -12,6 +14,29 @@ extern "C" {
 #define POMELO_WEBRTC_CHANNEL_FLAG_ACTIVE     (1 << 0)
 #define POMELO_WEBRTC_CHANNEL_FLAG_DC_ACTIVE  (1 << 1)
 #define POMELO_WEBRTC_CHANNEL_FLAG_DC_RECEIVE (1 << 2)
+#define POMELO_WEBRTC_CHANNEL_FLAG_SEQUENCED  (1 << 3)
+#define POMELO_WEBRTC_CHANNEL_FLAG_FRAGMENTED (1 << 4)
+#define POMELO_WEBRTC_CHANNEL_FLAG_COMPRESSED (1 << 5)
+#define POMELO_WEBRTC_CHANNEL_FLAG_AGGREGATED (1 << 6)
+
+/// Size of the sequence header of messages (big endian)
+#define POMELO_WEBRTC_CHANNEL_SEQUENCE_BYTES 2
+
+/// Check whether messages of channel carry the sequence header
+#define pomelo_webrtc_channel_is_sequenced(channel)                            \
+POMELO_CHECK_FLAG((channel)->flags, POMELO_WEBRTC_CHANNEL_FLAG_SEQUENCED)
+
+/// Check whether messages of channel carry the fragment header
+#define pomelo_webrtc_channel_is_fragmented(channel)                           \
+POMELO_CHECK_FLAG((channel)->flags, POMELO_WEBRTC_CHANNEL_FLAG_FRAGMENTED)
+
+/// Check whether messages of channel carry the compression header
+#define pomelo_webrtc_channel_is_compressed(channel)                           \
+POMELO_CHECK_FLAG((channel)->flags, POMELO_WEBRTC_CHANNEL_FLAG_COMPRESSED)
+
+/// Check whether small messages of channel are packed together
+#define pomelo_webrtc_channel_is_aggregated(channel)                           \
+POMELO_CHECK_FLAG((channel)->flags, POMELO_WEBRTC_CHANNEL_FLAG_AGGREGATED)
 
 #define POMELO_SERVER_CHANNEL_PREFIX "server-channel-"
 #define POMELO_CLIENT_CHANNEL_PREFIX "client-channel-"
@@ -27,6 +52,24 @@ struct pomelo_webrtc_channel_info_s {
 
     /// @brief Channel mode
     pomelo_channel_mode channel_mode;
+
+    /// @brief Traffic counters of channel, owned by the session
+    pomelo_webrtc_traffic_t * traffic;
+
+    /// @brief Whether messages carry the sequence header
+    bool sequenced;
+
+    /// @brief Whether messages carry the fragment header
+    bool fragmented;
+
+    /// @brief Whether messages carry the compression header
+    bool compressed;
+
+    /// @brief Whether small messages are packed together
+    bool aggregated;
+
+    /// @brief Send priority, 0 is the lowest
+    uint8_t priority;
 };
 
 
@@ -49,11 +92,66 @@ struct pomelo_webrtc_channel_s {
     /// @brief Channel mode
     pomelo_channel_mode mode;
 
+    /// @brief Send priority, 0 is the lowest
+    uint8_t priority;
+
     /// @brief Incoming RTC data channel
     rtc_data_channel_t * incoming_dc;
 
     /// @brief Outgoing RTC data channel
     rtc_data_channel_t * outgoing_dc;
+
+    /// @brief Traffic counters of channel, owned by the session
+    pomelo_webrtc_traffic_t * traffic;
+
+    /// @brief Sequence of the next outgoing message
+    uint16_t send_sequence;
+
+    /// @brief Loss estimator of incoming messages
+    pomelo_webrtc_loss_t loss;
+
+    /// @brief Maximum size of an outgoing message
+    size_t max_message_size;
+
+    /// @brief The message which is being reassembled
+    rtc_buffer_t * reassembly;
+
+    /// @brief Data of the message which is being reassembled
+    uint8_t * reassembly_data;
+
+    /// @brief Total size of the message which is being reassembled
+    size_t reassembly_size;
+
+    /// @brief Received bytes of the message which is being reassembled
+    size_t reassembly_offset;
+
+    /// @brief Cap of reassembled bytes of session, snapshotted from the config
+    size_t reassembly_limit;
+
+    /// @brief The packed message which is being filled
+    rtc_buffer_t * aggregate;
+
+    /// @brief Data of the packed message
+    uint8_t * aggregate_data;
+
+    /// @brief Used bytes of the packed message
+    size_t aggregate_size;
+
+    /// @brief Capacity of the packed message
+    size_t aggregate_capacity;
+
+    /// @brief Next channel in the flushing list of context
+    pomelo_webrtc_channel_t * aggregate_next;
+
+    /// @brief Whether this channel is in the flushing list of context
+    bool aggregate_listed;
+
+    /// @brief Maximum size of a packed message, snapshotted from the config
+    size_t aggregate_max_size;
+
+    /// @brief Maximum delay of a packed message in milliseconds, snapshotted
+    /// from the config. <= 0 means it is flushed in the current iteration.
+    int aggregate_delay_ms;
 };
 
 
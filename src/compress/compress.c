@@ -0,0 +1,174 @@
+#include <assert.h>
+#include <string.h>
+#include "utils/lz.h"
+#include "compress.h"
+
+
+/// @brief Finalize the dictionary
+static void pomelo_webrtc_dictionary_on_finalize(
+    pomelo_webrtc_dictionary_t * dictionary
+) {
+    pomelo_allocator_free(dictionary->allocator, dictionary);
+}
+
+
+pomelo_webrtc_dictionary_t * pomelo_webrtc_dictionary_create(
+    pomelo_allocator_t * allocator,
+    const uint8_t * data,
+    size_t size
+) {
+    assert(allocator != NULL);
+    assert(data != NULL);
+    assert(size > 0);
+
+    pomelo_webrtc_dictionary_t * dictionary = pomelo_allocator_malloc(
+        allocator,
+        sizeof(pomelo_webrtc_dictionary_t) + size
+    );
+    if (!dictionary) return NULL;
+
+    pomelo_reference_init(
+        &dictionary->ref,
+        (pomelo_ref_finalize_cb) pomelo_webrtc_dictionary_on_finalize
+    );
+    dictionary->allocator = allocator;
+    dictionary->size = size;
+    dictionary->data = (uint8_t *) (dictionary + 1);
+    memcpy(dictionary->data, data, size);
+    return dictionary;
+}
+
+
+void pomelo_webrtc_dictionary_ref(pomelo_webrtc_dictionary_t * dictionary) {
+    assert(dictionary != NULL);
+    pomelo_reference_ref(&dictionary->ref);
+}
+
+
+void pomelo_webrtc_dictionary_unref(pomelo_webrtc_dictionary_t * dictionary) {
+    assert(dictionary != NULL);
+    pomelo_reference_unref(&dictionary->ref);
+}
+
+
+rtc_buffer_t * pomelo_webrtc_compress(
+    rtc_context_t * rtc_context,
+    pomelo_webrtc_dictionary_t * dictionary,
+    const uint8_t * payload,
+    size_t size,
+    size_t header_size,
+    uint8_t ** data
+) {
+    assert(rtc_context != NULL);
+    assert(payload != NULL);
+    assert(data != NULL);
+    if (size > POMELO_WEBRTC_COMPRESS_MAX_SIZE) {
+        return NULL; // The receiver would refuse it
+    }
+
+    size_t prefix = header_size + POMELO_WEBRTC_COMPRESS_HEADER_BYTES +
+        POMELO_WEBRTC_COMPRESS_SIZE_BYTES;
+    uint8_t * output = NULL;
+    rtc_buffer_t * buffer = rtc_buffer_prepare(
+        rtc_context,
+        prefix + pomelo_lz_bound(size),
+        &output
+    );
+    if (!buffer) return NULL;
+
+    size_t compressed_size = pomelo_lz_compress(
+        payload,
+        size,
+        dictionary ? dictionary->data : NULL,
+        dictionary ? dictionary->size : 0,
+        output + prefix,
+        pomelo_lz_bound(size)
+    );
+    if (
+        compressed_size == 0 ||
+        compressed_size + POMELO_WEBRTC_COMPRESS_SIZE_BYTES >= size
+    ) {
+        rtc_buffer_unref(buffer);
+        return NULL; // Not worth it
+    }
+
+    uint8_t * header = output + header_size;
+    header[0] = POMELO_WEBRTC_COMPRESS_LZ;
+    header[1] = (uint8_t) (size >> 24);
+    header[2] = (uint8_t) (size >> 16);
+    header[3] = (uint8_t) (size >> 8);
+    header[4] = (uint8_t) size;
+    rtc_buffer_truncate(buffer, prefix + compressed_size);
+
+    *data = output;
+    return buffer;
+}
+
+
+int pomelo_webrtc_decompress(
+    rtc_context_t * rtc_context,
+    pomelo_webrtc_dictionary_t * dictionary,
+    const uint8_t * message,
+    size_t size,
+    rtc_buffer_t ** output
+) {
+    assert(rtc_context != NULL);
+    assert(message != NULL);
+    assert(output != NULL);
+    *output = NULL;
+
+    if (size <= POMELO_WEBRTC_COMPRESS_HEADER_BYTES) {
+        return -1; // No payload
+    }
+
+    switch (message[0]) {
+        case POMELO_WEBRTC_COMPRESS_NONE:
+            return 0;
+
+        case POMELO_WEBRTC_COMPRESS_LZ:
+            break;
+
+        default:
+            return -1; // Unknown codec
+    }
+
+    size_t prefix = POMELO_WEBRTC_COMPRESS_HEADER_BYTES +
+        POMELO_WEBRTC_COMPRESS_SIZE_BYTES;
+    if (size <= prefix) {
+        return -1; // No block
+    }
+
+    size_t original_size = ((size_t) message[1] << 24) |
+        ((size_t) message[2] << 16) | ((size_t) message[3] << 8) |
+        (size_t) message[4];
+    if (original_size == 0 || original_size > POMELO_WEBRTC_COMPRESS_MAX_SIZE) {
+        return -1; // Invalid size
+    }
+
+    // Check the size before allocating, so that a small message cannot
+    // reserve a large buffer
+    if (original_size > pomelo_lz_max_output(size - prefix)) {
+        return -1; // Block cannot expand to this size
+    }
+
+    uint8_t * data = NULL;
+    rtc_buffer_t * buffer =
+        rtc_buffer_prepare(rtc_context, original_size, &data);
+    if (!buffer) return -1;
+
+    int64_t result = pomelo_lz_decompress(
+        message + prefix,
+        size - prefix,
+        dictionary ? dictionary->data : NULL,
+        dictionary ? dictionary->size : 0,
+        data,
+        original_size
+    );
+    if (result != (int64_t) original_size) {
+        rtc_buffer_unref(buffer);
+        return -1; // Corrupted block
+    }
+
+    *output = buffer;
+    return 0;
+}
@@ -0,0 +1,110 @@
+#ifndef POMELO_WEBRTC_COMPRESS_H
+#define POMELO_WEBRTC_COMPRESS_H
+#include "rtc-api/rtc-api.h"
+#include "base/ref.h"
+#include "plugin.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Compression of channel messages.
+    With the "zip" feature, every message of the channels which are marked in
+    channel_compression starts with a 1-byte header:
+        [0][payload]                                          as is
+        [1][4 bytes: payload size, big endian][LZ block]      compressed
+    Messages shorter than the minimum size and messages which do not shrink
+    are sent as is. A channel may have a preshared dictionary, which must be
+    the same on both sides.
+
+    Messages are compressed in the thread which sends them and decompressed
+    in the executor of native sessions, so the plugin loop never runs the
+    codec. Dictionaries are immutable, they can be read from any thread.
+*/
+
+
+/// Size of the compression header
+#define POMELO_WEBRTC_COMPRESS_HEADER_BYTES 1
+
+/// Size of the original size of compressed messages
+#define POMELO_WEBRTC_COMPRESS_SIZE_BYTES 4
+
+/// The message has not been compressed
+#define POMELO_WEBRTC_COMPRESS_NONE 0
+
+/// The message has been compressed
+#define POMELO_WEBRTC_COMPRESS_LZ 1
+
+/// Default minimum size of messages to compress
+#define POMELO_WEBRTC_COMPRESS_DEFAULT_MIN_SIZE 128
+
+/// Maximum size of a decompressed message
+#define POMELO_WEBRTC_COMPRESS_MAX_SIZE (16 * 1024 * 1024)
+
+
+/// @brief Preshared dictionary of a channel
+typedef struct pomelo_webrtc_dictionary_s pomelo_webrtc_dictionary_t;
+
+
+struct pomelo_webrtc_dictionary_s {
+    /// @brief Reference of dictionary
+    pomelo_reference_t ref;
+
+    /// @brief The allocator which has allocated this dictionary
+    pomelo_allocator_t * allocator;
+
+    /// @brief Size of data
+    size_t size;
+
+    /// @brief Data, follows this structure
+    uint8_t * data;
+};
+
+
+/// @brief Create a dictionary, the data is copied
+pomelo_webrtc_dictionary_t * pomelo_webrtc_dictionary_create(
+    pomelo_allocator_t * allocator,
+    const uint8_t * data,
+    size_t size
+);
+
+
+/// @brief Increase reference counter of dictionary
+void pomelo_webrtc_dictionary_ref(pomelo_webrtc_dictionary_t * dictionary);
+
+
+/// @brief Decrease reference counter of dictionary
+void pomelo_webrtc_dictionary_unref(pomelo_webrtc_dictionary_t * dictionary);
+
+
+/// @brief Compress a message into a new buffer which starts with reserved
+/// space of header_size bytes, followed by the compression header.
+/// @return The buffer, or NULL if the message does not shrink or on failure
+rtc_buffer_t * pomelo_webrtc_compress(
+    rtc_context_t * rtc_context,
+    pomelo_webrtc_dictionary_t * dictionary,
+    const uint8_t * payload,
+    size_t size,
+    size_t header_size,
+    uint8_t ** data
+);
+
+
+/// @brief Decompress a received message which starts with the compression
+/// header
+/// @param output Set to the decompressed message, or NULL if the message has
+/// not been compressed. The caller owns the output.
+/// @return 0 on success or -1 if the message is invalid
+int pomelo_webrtc_decompress(
+    rtc_context_t * rtc_context,
+    pomelo_webrtc_dictionary_t * dictionary,
+    const uint8_t * message,
+    size_t size,
+    rtc_buffer_t ** output
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // POMELO_WEBRTC_COMPRESS_H
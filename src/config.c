@@ -0,0 +1,426 @@
+#include <assert.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <limits.h>
+#include "utils/common-macro.h"
+#include "plugin.h"
+#include "config.h"
+#include "log/log.h"
+
+
+/// Maximum length of a line in configuration file
+#define CONFIG_LINE_LENGTH 1024
+
+/// Maximum length of a key
+#define CONFIG_KEY_LENGTH 64
+
+/// Separator of list values
+#define CONFIG_LIST_SEPARATOR ','
+
+
+/// @brief Type of option
+typedef enum config_option_type_e {
+    CONFIG_OPTION_BOOL,
+    CONFIG_OPTION_INT,
+    CONFIG_OPTION_UINT16,
+    CONFIG_OPTION_STRING,
+    CONFIG_OPTION_ICE_SERVERS,
+    CONFIG_OPTION_CHANNEL_PRIORITIES,
+    CONFIG_OPTION_CHANNEL_COMPRESSION,
+    CONFIG_OPTION_CHANNEL_AGGREGATION
+} config_option_type;
+
+
+/// @brief Description of an option
+typedef struct config_option_s {
+    /// @brief Key of option
+    const char * key;
+
+    /// @brief Type of option
+    config_option_type type;
+
+    /// @brief Offset of the option in configuration
+    size_t offset;
+
+    /// @brief Size of the option in configuration
+    size_t size;
+} config_option_t;
+
+
+#define CONFIG_OPTION(name, type) {                                            \
+    #name, type,                                                               \
+    offsetof(pomelo_webrtc_config_t, name),                                    \
+    sizeof(((pomelo_webrtc_config_t *) 0)->name)                               \
+}
+
+
+/// @brief All known options
+static const config_option_t config_options[] = {
+    CONFIG_OPTION(bind_address, CONFIG_OPTION_STRING),
+    CONFIG_OPTION(port_range_begin, CONFIG_OPTION_UINT16),
+    CONFIG_OPTION(port_range_end, CONFIG_OPTION_UINT16),
+    CONFIG_OPTION(enable_ice_udp_mux, CONFIG_OPTION_BOOL),
+    CONFIG_OPTION(mtu, CONFIG_OPTION_INT),
+    CONFIG_OPTION(max_message_size, CONFIG_OPTION_INT),
+    CONFIG_OPTION(ice_servers, CONFIG_OPTION_ICE_SERVERS),
+    CONFIG_OPTION(log_level, CONFIG_OPTION_INT),
+    CONFIG_OPTION(thread_pool_size, CONFIG_OPTION_INT),
+    CONFIG_OPTION(sctp_recv_buffer_size, CONFIG_OPTION_INT),
+    CONFIG_OPTION(sctp_send_buffer_size, CONFIG_OPTION_INT),
+    CONFIG_OPTION(sctp_max_chunks_on_queue, CONFIG_OPTION_INT),
+    CONFIG_OPTION(sctp_initial_congestion_window, CONFIG_OPTION_INT),
+    CONFIG_OPTION(sctp_max_burst, CONFIG_OPTION_INT),
+    CONFIG_OPTION(sctp_congestion_control_module, CONFIG_OPTION_INT),
+    CONFIG_OPTION(sctp_delayed_sack_time_ms, CONFIG_OPTION_INT),
+    CONFIG_OPTION(sctp_min_retransmit_timeout_ms, CONFIG_OPTION_INT),
+    CONFIG_OPTION(sctp_max_retransmit_timeout_ms, CONFIG_OPTION_INT),
+    CONFIG_OPTION(sctp_initial_retransmit_timeout_ms, CONFIG_OPTION_INT),
+    CONFIG_OPTION(sctp_max_retransmit_attempts, CONFIG_OPTION_INT),
+    CONFIG_OPTION(sctp_heartbeat_interval_ms, CONFIG_OPTION_INT),
+    CONFIG_OPTION(admission_max_loop_lag_ms, CONFIG_OPTION_INT),
+    CONFIG_OPTION(admission_max_pending_handshakes, CONFIG_OPTION_INT),
+    CONFIG_OPTION(admission_max_sessions, CONFIG_OPTION_INT),
+    CONFIG_OPTION(admission_max_pending_per_source, CONFIG_OPTION_INT),
+    CONFIG_OPTION(admission_accept_rate, CONFIG_OPTION_INT),
+    CONFIG_OPTION(admission_accept_burst, CONFIG_OPTION_INT),
+    CONFIG_OPTION(liveness_timeout_ms, CONFIG_OPTION_INT),
+    CONFIG_OPTION(early_data, CONFIG_OPTION_BOOL),
+    CONFIG_OPTION(early_data_max_held_bytes, CONFIG_OPTION_INT),
+    CONFIG_OPTION(early_data_switch_timeout_ms, CONFIG_OPTION_INT),
+    CONFIG_OPTION(ws_release, CONFIG_OPTION_BOOL),
+    CONFIG_OPTION(send_rate_limit, CONFIG_OPTION_INT),
+    CONFIG_OPTION(send_burst, CONFIG_OPTION_INT),
+    CONFIG_OPTION(send_max_delay_ms, CONFIG_OPTION_INT),
+    CONFIG_OPTION(send_rate_adaptive, CONFIG_OPTION_BOOL),
+    CONFIG_OPTION(channel_priorities, CONFIG_OPTION_CHANNEL_PRIORITIES),
+    CONFIG_OPTION(reassembly_buffer_limit, CONFIG_OPTION_INT),
+    CONFIG_OPTION(channel_compression, CONFIG_OPTION_CHANNEL_COMPRESSION),
+    CONFIG_OPTION(compression_min_size, CONFIG_OPTION_INT),
+    CONFIG_OPTION(channel_aggregation, CONFIG_OPTION_CHANNEL_AGGREGATION),
+    CONFIG_OPTION(aggregation_max_delay_ms, CONFIG_OPTION_INT),
+    CONFIG_OPTION(aggregation_max_size, CONFIG_OPTION_INT)
+};
+
+
+/// @brief Parse a boolean value
+static int config_parse_bool(const char * value, bool * output) {
+    if (
+        strcmp(value, "1") == 0 ||
+        strcmp(value, "true") == 0 ||
+        strcmp(value, "yes") == 0 ||
+        strcmp(value, "on") == 0
+    ) {
+        *output = true;
+        return 0;
+    }
+
+    if (
+        strcmp(value, "0") == 0 ||
+        strcmp(value, "false") == 0 ||
+        strcmp(value, "no") == 0 ||
+        strcmp(value, "off") == 0
+    ) {
+        *output = false;
+        return 0;
+    }
+
+    return -1;
+}
+
+
+/// @brief Parse an integer value in range
+static int config_parse_int(
+    const char * value,
+    long min,
+    long max,
+    long * output
+) {
+    char * end = NULL;
+    long result = strtol(value, &end, 10);
+    if (end == value || *end != '\0') {
+        return -1; // Not a number
+    }
+
+    if (result < min || result > max) {
+        return -1; // Out of range
+    }
+
+    *output = result;
+    return 0;
+}
+
+
+/// @brief Parse comma-separated ICE servers
+static int config_parse_ice_servers(
+    pomelo_webrtc_config_t * config,
+    const char * value
+) {
+    config->ice_servers_count = 0;
+    const char * position = value;
+    while (*position) {
+        const char * end = strchr(position, CONFIG_LIST_SEPARATOR);
+        size_t length = end ? (size_t) (end - position) : strlen(position);
+        if (length > 0) {
+            if (
+                config->ice_servers_count >=
+                    POMELO_WEBRTC_CONFIG_MAX_ICE_SERVERS ||
+                length >= POMELO_WEBRTC_CONFIG_ICE_SERVER_LENGTH
+            ) {
+                return -1; // Too many servers or too long URL
+            }
+
+            char * server = config->ice_servers[config->ice_servers_count++];
+            memcpy(server, position, length);
+            server[length] = '\0';
+        }
+
+        if (!end) break;
+        position = end + 1;
+    }
+
+    return 0;
+}
+
+
+/// @brief Parse comma-separated values of channels, every value is in
+/// [0, limit)
+static int config_parse_channel_list(
+    const char * value,
+    long limit,
+    uint8_t * output,
+    int * output_count
+) {
+    int count = 0;
+    const char * position = value;
+    while (*position) {
+        char * end = NULL;
+        long number = strtol(position, &end, 10);
+        if (
+            end == position ||
+            number < 0 ||
+            number >= limit ||
+            count >= POMELO_WEBRTC_CONFIG_MAX_CHANNELS
+        ) {
+            return -1; // Out of range or too many channels
+        }
+        output[count++] = (uint8_t) number;
+
+        while (isspace((unsigned char) *end)) {
+            end++;
+        }
+        if (*end == '\0') break;
+        if (*end != CONFIG_LIST_SEPARATOR) return -1;
+        position = end + 1;
+    }
+
+    *output_count = count;
+    return 0;
+}
+
+
+/// @brief Trim the leading and trailing spaces of string in place
+static char * config_trim(char * str) {
+    while (isspace((unsigned char) *str)) {
+        str++;
+    }
+
+    char * end = str + strlen(str);
+    while (end > str && isspace((unsigned char) end[-1])) {
+        end--;
+    }
+    *end = '\0';
+    return str;
+}
+
+
+void pomelo_webrtc_config_init(pomelo_webrtc_config_t * config) {
+    assert(config != NULL);
+    memset(config, 0, sizeof(pomelo_webrtc_config_t));
+#ifdef NDEBUG
+    config->log_level = POMELO_WEBRTC_LOG_LEVEL_INFO;
+#else
+    config->log_level = POMELO_WEBRTC_LOG_LEVEL_DEBUG;
+#endif // NDEBUG
+}
+
+
+int pomelo_webrtc_config_set(
+    pomelo_webrtc_config_t * config,
+    const char * key,
+    const char * value
+) {
+    assert(config != NULL);
+    assert(key != NULL);
+    assert(value != NULL);
+
+    const config_option_t * option = NULL;
+    for (size_t i = 0; i < POMELO_ARRAY_LENGTH(config_options); i++) {
+        if (strcmp(config_options[i].key, key) == 0) {
+            option = &config_options[i];
+            break;
+        }
+    }
+    if (!option) return -1; // Unknown option
+
+    void * field = ((uint8_t *) config) + option->offset;
+    long number = 0;
+    switch (option->type) {
+        case CONFIG_OPTION_BOOL:
+            return config_parse_bool(value, field);
+
+        case CONFIG_OPTION_INT:
+            if (config_parse_int(value, INT_MIN, INT_MAX, &number) < 0) {
+                return -1;
+            }
+            *((int *) field) = (int) number;
+            return 0;
+
+        case CONFIG_OPTION_UINT16:
+            if (config_parse_int(value, 0, UINT16_MAX, &number) < 0) {
+                return -1;
+            }
+            *((uint16_t *) field) = (uint16_t) number;
+            return 0;
+
+        case CONFIG_OPTION_STRING: {
+            size_t length = strlen(value);
+            if (length >= option->size) return -1; // Too long
+            memcpy(field, value, length + 1);
+            return 0;
+        }
+
+        case CONFIG_OPTION_ICE_SERVERS:
+            return config_parse_ice_servers(config, value);
+
+        case CONFIG_OPTION_CHANNEL_PRIORITIES:
+            return config_parse_channel_list(
+                value,
+                POMELO_WEBRTC_CONFIG_CHANNEL_PRIORITY_LEVELS,
+                config->channel_priorities,
+                &config->channel_priorities_count
+            );
+
+        case CONFIG_OPTION_CHANNEL_COMPRESSION:
+            return config_parse_channel_list(
+                value,
+                2, // Disabled or enabled
+                config->channel_compression,
+                &config->channel_compression_count
+            );
+
+        case CONFIG_OPTION_CHANNEL_AGGREGATION:
+            return config_parse_channel_list(
+                value,
+                2, // Disabled or enabled
+                config->channel_aggregation,
+                &config->channel_aggregation_count
+            );
+    }
+
+    return -1;
+}
+
+
+int pomelo_webrtc_config_load_env(pomelo_webrtc_config_t * config) {
+    assert(config != NULL);
+
+    char name[sizeof(POMELO_WEBRTC_CONFIG_ENV_PREFIX) + CONFIG_KEY_LENGTH];
+    size_t prefix_length = sizeof(POMELO_WEBRTC_CONFIG_ENV_PREFIX) - 1;
+    memcpy(name, POMELO_WEBRTC_CONFIG_ENV_PREFIX, prefix_length);
+
+    int loaded = 0;
+    for (size_t i = 0; i < POMELO_ARRAY_LENGTH(config_options); i++) {
+        const char * key = config_options[i].key;
+        size_t key_length = strlen(key);
+        assert(key_length < CONFIG_KEY_LENGTH);
+
+        // Build the environment variable name
+        for (size_t j = 0; j < key_length; j++) {
+            name[prefix_length + j] = (char) toupper((unsigned char) key[j]);
+        }
+        name[prefix_length + key_length] = '\0';
+
+        const char * value = getenv(name);
+        if (!value) continue;
+
+        if (pomelo_webrtc_config_set(config, key, value) < 0) {
+            return -1; // Invalid value
+        }
+        loaded++;
+    }
+
+    return loaded;
+}
+
+
+int pomelo_webrtc_config_load_file(
+    pomelo_webrtc_config_t * config,
+    const char * path
+) {
+    assert(config != NULL);
+    assert(path != NULL);
+
+    FILE * file = fopen(path, "r");
+    if (!file) return -1; // Failed to open file
+
+    char line[CONFIG_LINE_LENGTH];
+    int loaded = 0;
+    size_t line_number = 0;
+    while (fgets(line, sizeof(line), file)) {
+        line_number++;
+        if (!strchr(line, '\n') && !feof(file)) {
+            // The rest of line would be parsed as another entry
+            pomelo_webrtc_log_error(
+                "%s:%zu: Line is longer than %d characters",
+                path,
+                line_number,
+                CONFIG_LINE_LENGTH - 2
+            );
+            loaded = -1;
+            break;
+        }
+
+        // Strip comments
+        char * comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+
+        char * separator = strchr(line, '=');
+        if (!separator) {
+            if (*config_trim(line) == '\0') continue; // Empty line
+            loaded = -1;
+            break; // Invalid line
+        }
+        *separator = '\0';
+
+        char * key = config_trim(line);
+        char * value = config_trim(separator + 1);
+        if (pomelo_webrtc_config_set(config, key, value) < 0) {
+            loaded = -1;
+            break; // Invalid option
+        }
+        loaded++;
+    }
+
+    fclose(file);
+    return loaded;
+}
+
+
+int pomelo_webrtc_config_load_default(pomelo_webrtc_config_t * config) {
+    assert(config != NULL);
+    pomelo_webrtc_config_init(config);
+
+    const char * path = getenv(POMELO_WEBRTC_CONFIG_FILE_ENV);
+    if (path && *path && pomelo_webrtc_config_load_file(config, path) < 0) {
+        return -1; // Invalid configuration file
+    }
+
+    // Environment variables override the file
+    if (pomelo_webrtc_config_load_env(config) < 0) {
+        return -1; // Invalid environment variables
+    }
+
+    return 0;
+}
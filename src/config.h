@@ -0,0 +1,276 @@
+#ifndef POMELO_PLUGIN_WEBRTC_CONFIG_H
+#define POMELO_PLUGIN_WEBRTC_CONFIG_H
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Configuration of the plugin.
+    The configuration is loaded from the defaults, then the file which is
+    pointed by POMELO_WEBRTC_CONFIG_FILE and then the environment variables,
+    which override the file, when the plugin is loaded. It can be replaced
+    at runtime by pomelo_webrtc_set_config; new values only affect new
+    sessions.
+
+    Every option has a key which is used in configuration file
+    (`key = value`, one per line, `#` for comments) and in environment
+    (POMELO_WEBRTC_<KEY in upper case>), e.g.:
+        enable_ice_udp_mux = true
+        port_range_begin = 50000
+        port_range_end = 50100
+        ice_servers = stun:stun.l.google.com:19302,turn:user:pass@host:3478
+        channel_priorities = 3,0,1
+        channel_compression = 0,1,1
+        channel_aggregation = 0,1,0
+*/
+
+/// Maximum length of an address string
+#define POMELO_WEBRTC_CONFIG_ADDRESS_LENGTH 64
+
+/// Maximum number of ICE servers
+#define POMELO_WEBRTC_CONFIG_MAX_ICE_SERVERS 8
+
+/// Maximum length of an ICE server URL
+#define POMELO_WEBRTC_CONFIG_ICE_SERVER_LENGTH 256
+
+/// Maximum number of channels which can be given a priority
+#define POMELO_WEBRTC_CONFIG_MAX_CHANNELS 64
+
+/// Number of channel priority levels, 0 is the lowest
+#define POMELO_WEBRTC_CONFIG_CHANNEL_PRIORITY_LEVELS 4
+
+/// Environment variable of the configuration file path
+#define POMELO_WEBRTC_CONFIG_FILE_ENV "POMELO_WEBRTC_CONFIG_FILE"
+
+/// Prefix of environment variables
+#define POMELO_WEBRTC_CONFIG_ENV_PREFIX "POMELO_WEBRTC_"
+
+
+/// @brief Configuration of the plugin
+typedef struct pomelo_webrtc_config_s pomelo_webrtc_config_t;
+
+
+struct pomelo_webrtc_config_s {
+    /* Peer connection */
+
+    /// @brief Local address to bind the ICE sockets. Empty means any.
+    char bind_address[POMELO_WEBRTC_CONFIG_ADDRESS_LENGTH];
+
+    /// @brief First port of ICE port range. 0 means automatic.
+    uint16_t port_range_begin;
+
+    /// @brief Last port of ICE port range. 0 means automatic.
+    uint16_t port_range_end;
+
+    /// @brief Serve all peer connections on a single UDP port
+    bool enable_ice_udp_mux;
+
+    /// @brief MTU of peer connections. <= 0 means automatic.
+    int mtu;
+
+    /// @brief Maximum message size of peer connections. <= 0 means default.
+    int max_message_size;
+
+    /// @brief ICE server URLs (STUN/TURN)
+    char ice_servers
+        [POMELO_WEBRTC_CONFIG_MAX_ICE_SERVERS]
+        [POMELO_WEBRTC_CONFIG_ICE_SERVER_LENGTH];
+
+    /// @brief Number of ICE servers
+    int ice_servers_count;
+
+    /* Global settings, only applied when the plugin is loaded */
+
+    /// @brief Logging level, see pomelo_webrtc_log_level.
+    /// It can be changed at runtime by pomelo_webrtc_set_log_level.
+    int log_level;
+
+    /// @brief Size of libdatachannel thread pool. <= 0 means default.
+    int thread_pool_size;
+
+    /// @brief SCTP: Receive buffer size in bytes. <= 0 means default.
+    int sctp_recv_buffer_size;
+
+    /// @brief SCTP: Send buffer size in bytes. <= 0 means default.
+    int sctp_send_buffer_size;
+
+    /// @brief SCTP: Maximum number of chunks on queue. <= 0 means default.
+    int sctp_max_chunks_on_queue;
+
+    /// @brief SCTP: Initial congestion window in MTUs. <= 0 means default.
+    int sctp_initial_congestion_window;
+
+    /// @brief SCTP: Maximum burst in MTUs. 0 means default, < 0 means disabled.
+    int sctp_max_burst;
+
+    /// @brief SCTP: Congestion control module: 1 HSTCP, 2 H-TCP, 3 RTCC.
+    /// <= 0 means default (RFC2581).
+    int sctp_congestion_control_module;
+
+    /// @brief SCTP: Delayed SACK time. 0 means default, < 0 means disabled.
+    int sctp_delayed_sack_time_ms;
+
+    /// @brief SCTP: Minimum RTO. <= 0 means default.
+    int sctp_min_retransmit_timeout_ms;
+
+    /// @brief SCTP: Maximum RTO. <= 0 means default.
+    int sctp_max_retransmit_timeout_ms;
+
+    /// @brief SCTP: Initial RTO. <= 0 means default.
+    int sctp_initial_retransmit_timeout_ms;
+
+    /// @brief SCTP: Maximum retransmissions. <= 0 means default.
+    int sctp_max_retransmit_attempts;
+
+    /// @brief SCTP: Heartbeat interval. <= 0 means default.
+    int sctp_heartbeat_interval_ms;
+
+    /* Admission control of new websocket clients, 0 means no limit */
+
+    /// @brief Reject new clients while the lag of plugin loop is higher
+    int admission_max_loop_lag_ms;
+
+    /// @brief Maximum number of handshakes in progress
+    int admission_max_pending_handshakes;
+
+    /// @brief Maximum number of sessions
+    int admission_max_sessions;
+
+    /// @brief Maximum number of handshakes in progress from a source address
+    int admission_max_pending_per_source;
+
+    /// @brief Accepted clients per second
+    int admission_accept_rate;
+
+    /// @brief Burst of accepted clients. <= 0 means the accept rate.
+    int admission_accept_burst;
+
+    /// @brief Close a connected session when no pong has been received from
+    /// its client for this long. <= 0 means disabled, the session is then only
+    /// closed when the peer connection fails.
+    int liveness_timeout_ms;
+
+    /// @brief Create the native session right after authentication for the
+    /// clients which support it. Messages are then exchanged over websocket
+    /// until the data channels are ready.
+    bool early_data;
+
+    /// @brief Maximum bytes of data channel messages which are held until the
+    /// client has switched from websocket. <= 0 means 256 KiB.
+    int early_data_max_held_bytes;
+
+    /// @brief Time for the client to switch from websocket, counted from the
+    /// first held message. <= 0 means 5000 ms.
+    int early_data_switch_timeout_ms;
+
+    /// @brief Close the signaling websocket once the session is connected,
+    /// for the clients which support it. Later signaling is carried by the
+    /// system channel, where it is resent until acknowledged. Closing is
+    /// only detected by the peer connection, so it is best paired with
+    /// `liveness_timeout_ms`.
+    bool ws_release;
+
+    /* Send pacing of sessions */
+
+    /// @brief Send rate of a session in bytes per second. <= 0 means no
+    /// pacing, messages are sent as soon as they are ready.
+    int send_rate_limit;
+
+    /// @brief Burst of a session in bytes. <= 0 means 20ms of the send rate.
+    int send_burst;
+
+    /// @brief Unreliable messages waiting longer than this are dropped.
+    /// <= 0 means 100ms.
+    int send_max_delay_ms;
+
+    /// @brief Adapt the send rate to the loss reported by clients. The send
+    /// rate limit is then the highest rate.
+    bool send_rate_adaptive;
+
+    /// @brief Priorities of channels by index, from 0 (lowest, default) to
+    /// POMELO_WEBRTC_CONFIG_CHANNEL_PRIORITY_LEVELS - 1. When the send rate
+    /// is exhausted, a level gets twice the share of the level below it.
+    /// Priorities need `send_rate_limit`: without pacing, messages are sent
+    /// as soon as they are ready and are not queued by priority.
+    uint8_t channel_priorities[POMELO_WEBRTC_CONFIG_MAX_CHANNELS];
+
+    /// @brief Number of channel priorities
+    int channel_priorities_count;
+
+    /* Fragmentation of reliable messages */
+
+    /// @brief Bytes which the reliable channels of a session may hold for
+    /// reassembling fragmented messages. <= 0 means 1MB.
+    int reassembly_buffer_limit;
+
+    /* Compression of channel messages */
+
+    /// @brief Whether messages of channels are compressed by index, 0 or 1.
+    /// Only applies to the clients which support it.
+    uint8_t channel_compression[POMELO_WEBRTC_CONFIG_MAX_CHANNELS];
+
+    /// @brief Number of channel compression flags
+    int channel_compression_count;
+
+    /// @brief Shorter messages are not compressed. <= 0 means 128 bytes.
+    int compression_min_size;
+
+    /* Aggregation of small unreliable messages */
+
+    /// @brief Whether small messages of unreliable channels are packed
+    /// together by index, 0 or 1. Only applies to the clients which support
+    /// it.
+    uint8_t channel_aggregation[POMELO_WEBRTC_CONFIG_MAX_CHANNELS];
+
+    /// @brief Number of channel aggregation flags
+    int channel_aggregation_count;
+
+    /// @brief Packed messages are sent after this delay. <= 0 means right
+    /// after the I/O callbacks of the current loop iteration.
+    int aggregation_max_delay_ms;
+
+    /// @brief Maximum size of a packed message. <= 0 means 1200 bytes.
+    int aggregation_max_size;
+};
+
+
+/// @brief Initialize the configuration with default values
+void pomelo_webrtc_config_init(pomelo_webrtc_config_t * config);
+
+
+/// @brief Set an option by its key and textual value.
+/// @return 0 on success, or -1 if the key is unknown or value is invalid
+int pomelo_webrtc_config_set(
+    pomelo_webrtc_config_t * config,
+    const char * key,
+    const char * value
+);
+
+
+/// @brief Load the options from environment variables
+/// @return Number of loaded options, or -1 if any value is invalid
+int pomelo_webrtc_config_load_env(pomelo_webrtc_config_t * config);
+
+
+/// @brief Load the options from a configuration file
+/// @return Number of loaded options, or -1 on failure
+int pomelo_webrtc_config_load_file(
+    pomelo_webrtc_config_t * config,
+    const char * path
+);
+
+
+/// @brief Load the configuration from the file which is pointed by
+/// POMELO_WEBRTC_CONFIG_FILE (if any) and then from environment, on top of
+/// default values. Environment variables override the file.
+/// @return 0 on success, or -1 if any option is invalid
+int pomelo_webrtc_config_load_default(pomelo_webrtc_config_t * config);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // POMELO_PLUGIN_WEBRTC_CONFIG_H
@@ -1,13 +1,14 @@
 #include <assert.h>
 #include <string.h>
 #include <stdlib.h>
-#include <time.h>
 #include "pomelo/constants.h"
 #include "utils/string-buffer.h"
 #include "context.h"
 #include "session/session.h"
 #include "socket/socket.h"
 #include "channel/channel.h"
+#include "preauth/preauth.h"
+#include "preauth/preauth-batch.h"
 #include "socket/socket-plugin.h"
 #include "socket/socket-wss.h"
 #include "session/session-plugin.h"
@@ -15,24 +16,12 @@
 #include "session/session-pc.h"
 #include "channel/channel-plugin.h"
 #include "channel/channel-dc.h"
-
-
-#define POMELO_PLUGIN_WEBRTC_LOG_LEVEL RTC_LOG_LEVEL_DEBUG
-#define DATE_TIME_BUFFER_LENGTH 30
+#include "channel/channel-aggregate.h"
+#include "log/log.h"
 
 
 static void rtc_log_handler(rtc_log_level level, const char * message) {
-    if (level >= POMELO_PLUGIN_WEBRTC_LOG_LEVEL) {
-        time_t tm = time(NULL);
-        char datetime_buffer[DATE_TIME_BUFFER_LENGTH];
-        strftime(
-            datetime_buffer,
-            DATE_TIME_BUFFER_LENGTH,
-            "%c GMT",
-            gmtime(&tm)
-        );
-        pomelo_webrtc_log("%10s [L%d] - %s\n", datetime_buffer, (int) level, message);
-    }
+    pomelo_webrtc_log_at((pomelo_webrtc_log_level) level, "%s", message);
 }
 
 
@@ -48,14 +37,51 @@ pomelo_webrtc_context_t * pomelo_webrtc_context_create(
         return NULL;
     }
     memset(context, 0, sizeof(pomelo_webrtc_context_t));
+    context->allocator = allocator;
     context->plugin = plugin;
 
+    // Start the logger first, so that configuration errors go through it
+    pomelo_webrtc_logger_startup();
+
+    // Load configuration
+    bool config_valid =
+        (pomelo_webrtc_config_load_default(&context->config) == 0);
+    if (!config_valid) {
+        pomelo_webrtc_config_init(&context->config);
+    }
+
+    pomelo_webrtc_logger_set_level(context->config.log_level);
+    if (!config_valid) {
+        pomelo_webrtc_log_warning("Invalid configuration, use defaults");
+    }
+
     // Initialize rtc
     rtc_options_t options;
     memset(&options, 0, sizeof(rtc_options_t));
-    options.log_level = POMELO_PLUGIN_WEBRTC_LOG_LEVEL;
+    options.log_level = (rtc_log_level) context->config.log_level;
     options.log_callback = rtc_log_handler;
 
+    // Set global settings
+    pomelo_webrtc_config_t * config = &context->config;
+    options.thread_pool_size = (config->thread_pool_size > 0)
+        ? (unsigned int) config->thread_pool_size
+        : 0;
+
+    rtc_sctp_settings_t * sctp = &options.sctp_settings;
+    sctp->recv_buffer_size = config->sctp_recv_buffer_size;
+    sctp->send_buffer_size = config->sctp_send_buffer_size;
+    sctp->max_chunks_on_queue = config->sctp_max_chunks_on_queue;
+    sctp->initial_congestion_window = config->sctp_initial_congestion_window;
+    sctp->max_burst = config->sctp_max_burst;
+    sctp->congestion_control_module = config->sctp_congestion_control_module;
+    sctp->delayed_sack_time_ms = config->sctp_delayed_sack_time_ms;
+    sctp->min_retransmit_timeout_ms = config->sctp_min_retransmit_timeout_ms;
+    sctp->max_retransmit_timeout_ms = config->sctp_max_retransmit_timeout_ms;
+    sctp->initial_retransmit_timeout_ms =
+        config->sctp_initial_retransmit_timeout_ms;
+    sctp->max_retransmit_attempts = config->sctp_max_retransmit_attempts;
+    sctp->heartbeat_interval_ms = config->sctp_heartbeat_interval_ms;
+
     // Set Websocket callbacks
     options.wss_client_callback = pomelo_webrtc_socket_wss_on_client;
     options.ws_open_callback = pomelo_webrtc_ws_on_open;
@@ -67,6 +93,8 @@ pomelo_webrtc_context_t * pomelo_webrtc_context_create(
     options.pc_local_candidate_callback = pomelo_webrtc_pc_on_local_candidate;
     options.pc_state_change_callback = pomelo_webrtc_pc_on_state_changed;
     options.pc_data_channel_callback = pomelo_webrtc_pc_on_data_channel;
+    options.pc_gathering_state_change_callback =
+        pomelo_webrtc_pc_on_gathering_state_changed;
 
     // Set Data channel callbacks
     options.dc_open_callback = pomelo_webrtc_dc_on_open;
@@ -117,6 +145,18 @@ pomelo_webrtc_context_t * pomelo_webrtc_context_create(
     // Set running sockets to 0
     pomelo_atomic_uint64_store(&context->running_sockets, 0);
 
+    // Reset statistics
+    pomelo_webrtc_handshake_stats_reset(&context->handshake_stats);
+    memset(&context->resources, 0, sizeof(pomelo_webrtc_context_resources_t));
+    pomelo_webrtc_loop_monitor_reset(&context->loop_monitor);
+    pomelo_webrtc_traffic_reset(&context->traffic);
+
+    // Initialize admission control
+    if (pomelo_webrtc_admission_init(&context->admission, context) < 0) {
+        pomelo_webrtc_context_destroy(context);
+        return NULL;
+    }
+
     // Create string buffers pool
     pomelo_pool_root_options_t pool_options;
     memset(&pool_options, 0, sizeof(pomelo_pool_root_options_t));
@@ -166,6 +206,36 @@ pomelo_webrtc_context_t * pomelo_webrtc_context_create(
         return NULL;
     }
 
+    // Create pre-auth records pool
+    memset(&pool_options, 0, sizeof(pomelo_pool_root_options_t));
+    pool_options.allocator = allocator;
+    pool_options.element_size = sizeof(pomelo_webrtc_preauth_t);
+    pool_options.alloc_data = context;
+    pool_options.on_alloc = (pomelo_pool_alloc_cb)
+        pomelo_webrtc_preauth_on_alloc;
+    pool_options.on_free = (pomelo_pool_free_cb)
+        pomelo_webrtc_preauth_on_free;
+    pool_options.on_init = (pomelo_pool_init_cb)
+        pomelo_webrtc_preauth_init;
+    pool_options.on_cleanup = (pomelo_pool_cleanup_cb)
+        pomelo_webrtc_preauth_cleanup;
+    context->preauth_pool = pomelo_pool_root_create(&pool_options);
+    if (!context->preauth_pool) {
+        pomelo_webrtc_context_destroy(context);
+        return NULL;
+    }
+
+    // Create pool of verifying batches
+    memset(&pool_options, 0, sizeof(pomelo_pool_root_options_t));
+    pool_options.allocator = allocator;
+    pool_options.element_size = sizeof(pomelo_webrtc_auth_batch_t);
+    pool_options.zero_init = true;
+    context->auth_batch_pool = pomelo_pool_root_create(&pool_options);
+    if (!context->auth_batch_pool) {
+        pomelo_webrtc_context_destroy(context);
+        return NULL;
+    }
+
     // Create sessions pool
     memset(&pool_options, 0, sizeof(pomelo_pool_root_options_t));
     pool_options.allocator = allocator;
@@ -261,6 +331,17 @@ pomelo_webrtc_context_t * pomelo_webrtc_context_create(
         return NULL;
     }
 
+    // Create pool of pacer entries
+    memset(&pool_options, 0, sizeof(pomelo_pool_root_options_t));
+    pool_options.allocator = allocator;
+    pool_options.element_size = sizeof(pomelo_webrtc_pacer_entry_t);
+    pool_options.zero_init = true;
+    context->pacer_entry_pool = pomelo_pool_root_create(&pool_options);
+    if (!context->pacer_entry_pool) {
+        pomelo_webrtc_context_destroy(context);
+        return NULL;
+    }
+
     // Initialize thread
     uv_loop_t * loop = &context->event_loop;
     uv_async_t * async_task = &context->async_task;
@@ -273,6 +354,17 @@ pomelo_webrtc_context_t * pomelo_webrtc_context_create(
     async_task->data = context;
     async_shutdown->data = context;
 
+    // Monitor the loop health
+    uv_prepare_init(loop, &context->loop_prepare);
+    uv_check_init(loop, &context->loop_check);
+    context->loop_prepare.data = context;
+    context->loop_check.data = context;
+    uv_prepare_start(
+        &context->loop_prepare,
+        pomelo_webrtc_loop_prepare_callback
+    );
+    uv_check_start(&context->loop_check, pomelo_webrtc_loop_check_callback);
+
     // Start the plugin thread
     pomelo_atomic_int64_store(&context->thread_running, true);
     int ret = uv_thread_create(
@@ -321,6 +413,17 @@ void pomelo_webrtc_context_destroy(pomelo_webrtc_context_t * context) {
         context->socket_pool = NULL;
     }
 
+    if (context->preauth_pool) {
+        pomelo_pool_destroy(context->preauth_pool);
+        context->preauth_pool = NULL;
+    }
+
+    if (context->auth_batch_pool) {
+        pomelo_pool_destroy(context->auth_batch_pool);
+        context->auth_batch_pool = NULL;
+    }
+    context->auth_batch = NULL;
+
     if (context->session_pool) {
         pomelo_pool_destroy(context->session_pool);
         context->session_pool = NULL;
@@ -356,6 +459,25 @@ void pomelo_webrtc_context_destroy(pomelo_webrtc_context_t * context) {
         context->recv_command_pool = NULL;
     }
 
+    if (context->pacer_entry_pool) {
+        pomelo_pool_destroy(context->pacer_entry_pool);
+        context->pacer_entry_pool = NULL;
+    }
+
+    // Sessions have released their references
+    for (size_t i = 0; i < POMELO_WEBRTC_CONFIG_MAX_CHANNELS; i++) {
+        if (context->dictionaries[i]) {
+            pomelo_webrtc_dictionary_unref(context->dictionaries[i]);
+            context->dictionaries[i] = NULL;
+        }
+    }
+
+    // Records and sessions have released their admission slots
+    pomelo_webrtc_admission_cleanup(&context->admission);
+
+    // All threads have stopped, flush the remaining logs
+    pomelo_webrtc_logger_shutdown();
+
     // Free itself
     pomelo_allocator_free(context->allocator, context);
 }
@@ -391,7 +513,9 @@ pomelo_webrtc_task_t * pomelo_webrtc_context_submit_task(
         memcpy(task->args, args, argc * sizeof(pomelo_webrtc_variant_t));
     }
 
-    // Add task to list and send running signal
+    // Stamp the task, then add it to list and send running signal
+    task->submit_time = uv_hrtime();
+    pomelo_webrtc_loop_monitor_on_submit(&context->loop_monitor);
     pomelo_list_push_back(context->tasks, task);
     uv_async_send(&context->async_task);
 
@@ -494,6 +618,7 @@ pomelo_webrtc_task_t * pomelo_webrtc_context_spawn_task(
         memcpy(base->args, args, argc * sizeof(pomelo_webrtc_variant_t));
     }
 
+    task->context = context;
     task->work_fn = work;
     task->work.data = task;
 
@@ -513,7 +638,12 @@ pomelo_string_buffer_t * pomelo_webrtc_context_acquire_string_buffer(
     pomelo_webrtc_context_t * context
 ) {
     assert(context != NULL);
-    return pomelo_pool_acquire(context->string_buffer_pool, NULL);
+    pomelo_string_buffer_t * buffer =
+        pomelo_pool_acquire(context->string_buffer_pool, NULL);
+    if (buffer) {
+        pomelo_atomic_uint64_fetch_add(&context->resources.string_buffers, 1);
+    }
+    return buffer;
 }
 
 
@@ -522,6 +652,7 @@ void pomelo_webrtc_context_release_string_buffer(
     pomelo_string_buffer_t * buffer
 ) {
     assert(context != NULL);
+    pomelo_atomic_uint64_fetch_sub(&context->resources.string_buffers, 1);
     pomelo_pool_release(context->string_buffer_pool, buffer);
 }
 
@@ -531,7 +662,12 @@ pomelo_webrtc_socket_t * pomelo_webrtc_context_acquire_socket(
     pomelo_webrtc_socket_info_t * info
 ) {
     assert(context != NULL);
-    return pomelo_pool_acquire(context->socket_pool, info);
+    pomelo_webrtc_socket_t * socket =
+        pomelo_pool_acquire(context->socket_pool, info);
+    if (socket) {
+        pomelo_atomic_uint64_fetch_add(&context->resources.sockets, 1);
+    }
+    return socket;
 }
 
 
@@ -540,16 +676,46 @@ void pomelo_webrtc_context_release_socket(
     pomelo_webrtc_socket_t * socket
 ) {
     assert(context != NULL);
+    pomelo_atomic_uint64_fetch_sub(&context->resources.sockets, 1);
     pomelo_pool_release(context->socket_pool, socket);
 }
 
 
+pomelo_webrtc_preauth_t * pomelo_webrtc_context_acquire_preauth(
+    pomelo_webrtc_context_t * context,
+    pomelo_webrtc_preauth_info_t * info
+) {
+    assert(context != NULL);
+    pomelo_webrtc_preauth_t * preauth =
+        pomelo_pool_acquire(context->preauth_pool, info);
+    if (preauth) {
+        pomelo_atomic_uint64_fetch_add(&context->resources.preauths, 1);
+    }
+    return preauth;
+}
+
+
+void pomelo_webrtc_context_release_preauth(
+    pomelo_webrtc_context_t * context,
+    pomelo_webrtc_preauth_t * preauth
+) {
+    assert(context != NULL);
+    pomelo_atomic_uint64_fetch_sub(&context->resources.preauths, 1);
+    pomelo_pool_release(context->preauth_pool, preauth);
+}
+
+
 pomelo_webrtc_session_t * pomelo_webrtc_context_acquire_session(
     pomelo_webrtc_context_t * context,
     pomelo_webrtc_session_info_t * info
 ) {
     assert(context != NULL);
-    return pomelo_pool_acquire(context->session_pool, info);
+    pomelo_webrtc_session_t * session =
+        pomelo_pool_acquire(context->session_pool, info);
+    if (session) {
+        pomelo_atomic_uint64_fetch_add(&context->resources.sessions, 1);
+    }
+    return session;
 }
 
 
@@ -558,6 +724,7 @@ void pomelo_webrtc_context_release_session(
     pomelo_webrtc_session_t * session
 ) {
     assert(context != NULL);
+    pomelo_atomic_uint64_fetch_sub(&context->resources.sessions, 1);
     pomelo_pool_release(context->session_pool, session);
 }
 
@@ -567,7 +734,12 @@ pomelo_webrtc_channel_t * pomelo_webrtc_context_acquire_channel(
     pomelo_webrtc_channel_info_t * info
 ) {
     assert(context != NULL);
-    return pomelo_pool_acquire(context->channel_pool, info);
+    pomelo_webrtc_channel_t * channel =
+        pomelo_pool_acquire(context->channel_pool, info);
+    if (channel) {
+        pomelo_atomic_uint64_fetch_add(&context->resources.channels, 1);
+    }
+    return channel;
 }
 
 
@@ -576,9 +748,81 @@ void pomelo_webrtc_context_release_channel(
     pomelo_webrtc_channel_t * channel
 ) {
     assert(context != NULL);
+    pomelo_atomic_uint64_fetch_sub(&context->resources.channels, 1);
     pomelo_pool_release(context->channel_pool, channel);
 }
 
+
+pomelo_webrtc_recv_command_t * pomelo_webrtc_context_acquire_recv_command(
+    pomelo_webrtc_context_t * context
+) {
+    assert(context != NULL);
+    pomelo_webrtc_recv_command_t * command =
+        pomelo_pool_acquire(context->recv_command_pool, NULL);
+    if (command) {
+        pomelo_atomic_uint64_fetch_add(&context->resources.recv_commands, 1);
+    }
+    return command;
+}
+
+
+void pomelo_webrtc_context_release_recv_command(
+    pomelo_webrtc_context_t * context,
+    pomelo_webrtc_recv_command_t * command
+) {
+    assert(context != NULL);
+    pomelo_atomic_uint64_fetch_sub(&context->resources.recv_commands, 1);
+    pomelo_pool_release(context->recv_command_pool, command);
+}
+
+
+pomelo_webrtc_pacer_entry_t * pomelo_webrtc_context_acquire_pacer_entry(
+    pomelo_webrtc_context_t * context
+) {
+    assert(context != NULL);
+    pomelo_webrtc_pacer_entry_t * entry =
+        pomelo_pool_acquire(context->pacer_entry_pool, NULL);
+    if (entry) {
+        pomelo_atomic_uint64_fetch_add(&context->resources.pacer_entries, 1);
+    }
+    return entry;
+}
+
+
+void pomelo_webrtc_context_release_pacer_entry(
+    pomelo_webrtc_context_t * context,
+    pomelo_webrtc_pacer_entry_t * entry
+) {
+    assert(context != NULL);
+    pomelo_atomic_uint64_fetch_sub(&context->resources.pacer_entries, 1);
+    pomelo_pool_release(context->pacer_entry_pool, entry);
+}
+
+
+void pomelo_webrtc_context_finish_handshake(
+    pomelo_webrtc_context_t * context,
+    pomelo_webrtc_handshake_t * handshake,
+    pomelo_webrtc_handshake_result result
+) {
+    assert(context != NULL);
+    assert(handshake != NULL);
+    if (handshake->finished) {
+        return; // Already reported
+    }
+
+    pomelo_webrtc_handshake_stats_finish(
+        &context->handshake_stats,
+        handshake,
+        result
+    );
+
+    if (result != POMELO_WEBRTC_HANDSHAKE_RESULT_TRANSFERRED) {
+        pomelo_webrtc_admission_release(&context->admission, handshake->source);
+        handshake->source = 0;
+    }
+}
+
+
 /* -------------------------------------------------------------------------- */
 /*                              Private APIs                                  */
 /* -------------------------------------------------------------------------- */
@@ -617,14 +861,33 @@ void pomelo_webrtc_async_task_callback(uv_async_t * async) {
     pomelo_list_t * tasks = context->tasks;
     pomelo_pool_t * tasks_pool = context->async_tasks_pool;
 
+    pomelo_webrtc_loop_monitor_t * monitor = &context->loop_monitor;
+    uint64_t start = pomelo_webrtc_loop_monitor_begin_callbacks(monitor);
+    uint64_t ntasks = 0;
+
     pomelo_webrtc_task_t * task = NULL;
+    pomelo_webrtc_variant_t args[POMELO_WEBRTC_TASK_MAX_ARGS];
     while (pomelo_list_pop_front(tasks, &task) == 0) {
-        pomelo_webrtc_variant_t * args = task->args;
+        pomelo_webrtc_loop_monitor_on_task(
+            monitor,
+            task->submit_time,
+            uv_hrtime()
+        );
+
+        // Copy the arguments, the released task can be reused by other
+        // threads while the callback is running
         size_t argc = task->argc;
         pomelo_webrtc_task_cb callback = task->callback;
+        if (argc > 0) {
+            memcpy(args, task->args, argc * sizeof(pomelo_webrtc_variant_t));
+        }
         pomelo_pool_release(tasks_pool, task);
         callback(argc, args);
+        ntasks++;
     }
+
+    pomelo_webrtc_loop_monitor_on_drain(monitor, ntasks);
+    pomelo_webrtc_loop_monitor_end_callbacks(monitor, start);
 }
 
 
@@ -635,6 +898,37 @@ void pomelo_webrtc_async_shutdown_callback(uv_async_t * async) {
 }
 
 
+/// @brief Flush the packed messages unless they are delayed by the timer
+static void pomelo_webrtc_context_flush_aggregate(
+    pomelo_webrtc_context_t * context
+) {
+    if (context->aggregate_channels && !context->aggregate_task) {
+        pomelo_webrtc_channel_aggregate_flush_all(context);
+    }
+}
+
+
+void pomelo_webrtc_loop_prepare_callback(uv_prepare_t * prepare) {
+    assert(prepare != NULL);
+    pomelo_webrtc_context_t * context = prepare->data;
+
+    // Messages packed by timers must not wait for the loop to wake up again
+    pomelo_webrtc_context_flush_aggregate(context);
+    pomelo_webrtc_loop_monitor_on_prepare(&context->loop_monitor);
+}
+
+
+void pomelo_webrtc_loop_check_callback(uv_check_t * check) {
+    assert(check != NULL);
+    pomelo_webrtc_context_t * context = check->data;
+    pomelo_webrtc_loop_monitor_on_check(&context->loop_monitor);
+
+    // I/O callbacks have run, flush the messages which have been packed in
+    // them
+    pomelo_webrtc_context_flush_aggregate(context);
+}
+
+
 void pomelo_webrtc_timer_callback(uv_timer_t * timer) {
     assert(timer != NULL);
     // Call the timer callback
@@ -651,13 +945,20 @@ void pomelo_webrtc_worker_task_process(uv_work_t * work) {
 
 
 void pomelo_webrtc_worker_task_callback(uv_work_t * work, int status) {
-    if (status == UV_ECANCELED) {
-        return; // Canceled
-    }
-
     pomelo_webrtc_worker_task_t * task = work->data;
+    pomelo_webrtc_context_t * context = task->context;
     pomelo_webrtc_task_t * base = &task->base;
+
+    // The callback also runs for a cancelled task, whose work has not run,
+    // so that it can release what the task owns
+    (void) status;
     if (base->callback) {
+        pomelo_webrtc_loop_monitor_t * monitor = &context->loop_monitor;
+        uint64_t start = pomelo_webrtc_loop_monitor_begin_callbacks(monitor);
         base->callback(base->argc, base->args);
+        pomelo_webrtc_loop_monitor_end_callbacks(monitor, start);
     }
+
+    // Worker tasks are acquired and released in plugin thread
+    pomelo_pool_release(context->worker_tasks_pool, task);
 }
@@ -8,6 +8,12 @@
 #include "utils/atomic.h"
 #include "utils/string-buffer.h"
 #include "rtc-api/rtc-api.h"
+#include "stats/handshake-stats.h"
+#include "stats/loop-stats.h"
+#include "stats/traffic-stats.h"
+#include "admission/admission.h"
+#include "pacing/pacer.h"
+#include "compress/compress.h"
 
 
 /// Maximum number of arguments of one task
@@ -18,6 +24,31 @@ extern "C" {
 #endif
 
 
+/// @brief Counters of the objects which are acquired from context pools
+typedef struct pomelo_webrtc_context_resources_s {
+    /// @brief Acquired sockets
+    pomelo_atomic_uint64_t sockets;
+
+    /// @brief Acquired pre-auth records
+    pomelo_atomic_uint64_t preauths;
+
+    /// @brief Acquired sessions
+    pomelo_atomic_uint64_t sessions;
+
+    /// @brief Acquired channels
+    pomelo_atomic_uint64_t channels;
+
+    /// @brief Acquired string buffers
+    pomelo_atomic_uint64_t string_buffers;
+
+    /// @brief Acquired received commands
+    pomelo_atomic_uint64_t recv_commands;
+
+    /// @brief Acquired pacer entries
+    pomelo_atomic_uint64_t pacer_entries;
+} pomelo_webrtc_context_resources_t;
+
+
 struct pomelo_webrtc_context_s {
     /// @brief The allocator
     pomelo_allocator_t * allocator;
@@ -43,6 +74,16 @@ struct pomelo_webrtc_context_s {
     /// @brief Pool of sockets
     pomelo_pool_t * socket_pool;
 
+    /// @brief Pool of pre-auth records
+    pomelo_pool_t * preauth_pool;
+
+    /// @brief Pool of connect token verifying batches
+    pomelo_pool_t * auth_batch_pool;
+
+    /// @brief The batch which is collecting AUTH messages of current loop
+    /// iteration
+    pomelo_webrtc_auth_batch_t * auth_batch;
+
     /// @brief Pool of sessions
     pomelo_pool_t * session_pool;
 
@@ -64,6 +105,12 @@ struct pomelo_webrtc_context_s {
     /// @brief Shutdown async
     uv_async_t async_shutdown;
 
+    /// @brief Marks the start of waiting for I/O of loop
+    uv_prepare_t loop_prepare;
+
+    /// @brief Marks the end of waiting for I/O of loop
+    uv_check_t loop_check;
+
     /// @brief Tasks to execute
     pomelo_list_t * tasks;
 
@@ -78,6 +125,40 @@ struct pomelo_webrtc_context_s {
 
     /// @brief Pool of received commands
     pomelo_pool_t * recv_command_pool;
+
+    /// @brief Pool of messages which are waiting for pacers
+    pomelo_pool_t * pacer_entry_pool;
+
+    /// @brief Handshake statistics
+    pomelo_webrtc_handshake_stats_t handshake_stats;
+
+    /// @brief Number of objects which are in use
+    pomelo_webrtc_context_resources_t resources;
+
+    /// @brief Health of loop
+    pomelo_webrtc_loop_monitor_t loop_monitor;
+
+    /// @brief Admission control of new clients
+    pomelo_webrtc_admission_t admission;
+
+    /// @brief Traffic of all sessions
+    pomelo_webrtc_traffic_t traffic;
+
+    /// @brief Preshared dictionaries of channels by index. Plugin thread only,
+    /// sessions keep references to the ones they use.
+    pomelo_webrtc_dictionary_t *
+        dictionaries[POMELO_WEBRTC_CONFIG_MAX_CHANNELS];
+
+    /// @brief Channels which have packed messages to flush. Plugin thread
+    /// only.
+    pomelo_webrtc_channel_t * aggregate_channels;
+
+    /// @brief Timer of flushing packed messages, when they are delayed
+    pomelo_webrtc_task_t * aggregate_task;
+
+    /// @brief Configuration of plugin. It is only accessed in plugin thread
+    /// after the context has been created.
+    pomelo_webrtc_config_t config;
 };
 
 
@@ -90,6 +171,9 @@ struct pomelo_webrtc_task_s {
 
     /// @brief Array of arguments
     pomelo_webrtc_variant_t args[POMELO_WEBRTC_TASK_MAX_ARGS];
+
+    /// @brief Monotonic time (ns) when the task has been submitted
+    uint64_t submit_time;
 };
 
 
@@ -106,6 +190,9 @@ struct pomelo_webrtc_worker_task_s {
     /// @brief Base task
     pomelo_webrtc_task_t base;
 
+    /// @brief Context
+    pomelo_webrtc_context_t * context;
+
     /// @brief Task to work
     pomelo_webrtc_task_cb work_fn;
 
@@ -118,11 +205,17 @@ struct pomelo_webrtc_recv_command_s {
     /// @brief RTC message
     rtc_buffer_t * message;
 
+    /// @brief Offset of the payload in message
+    size_t offset;
+
     /// @brief Session
     pomelo_session_t * native_session;
 
     /// @brief Channel
     pomelo_webrtc_channel_t * channel;
+
+    /// @brief Next held command of session
+    pomelo_webrtc_recv_command_t * next;
 };
 
 /* -------------------------------------------------------------------------- */
@@ -167,7 +260,8 @@ void pomelo_webrtc_context_unschedule_task(
 
 
 /// @brief Spawn a task to run in worker thread. After complete, call the
-/// provided callback in main thread
+/// provided callback in main thread. The callback is also called if the task
+/// is cancelled before its work runs.
 pomelo_webrtc_task_t * pomelo_webrtc_context_spawn_task(
     pomelo_webrtc_context_t * context,
     pomelo_webrtc_task_cb work,
@@ -204,6 +298,20 @@ void pomelo_webrtc_context_release_socket(
 );
 
 
+/// @brief Acquire a pre-auth record from pool
+pomelo_webrtc_preauth_t * pomelo_webrtc_context_acquire_preauth(
+    pomelo_webrtc_context_t * context,
+    pomelo_webrtc_preauth_info_t * info
+);
+
+
+/// @brief Release a pre-auth record to pool
+void pomelo_webrtc_context_release_preauth(
+    pomelo_webrtc_context_t * context,
+    pomelo_webrtc_preauth_t * preauth
+);
+
+
 /// @brief Acquire a session from pool
 pomelo_webrtc_session_t * pomelo_webrtc_context_acquire_session(
     pomelo_webrtc_context_t * context,
@@ -232,6 +340,41 @@ void pomelo_webrtc_context_release_channel(
 );
 
 
+/// @brief Acquire a received command from pool
+pomelo_webrtc_recv_command_t * pomelo_webrtc_context_acquire_recv_command(
+    pomelo_webrtc_context_t * context
+);
+
+
+/// @brief Release a received command to pool
+void pomelo_webrtc_context_release_recv_command(
+    pomelo_webrtc_context_t * context,
+    pomelo_webrtc_recv_command_t * command
+);
+
+
+/// @brief Acquire a pacer entry from pool
+pomelo_webrtc_pacer_entry_t * pomelo_webrtc_context_acquire_pacer_entry(
+    pomelo_webrtc_context_t * context
+);
+
+
+/// @brief Release a pacer entry to pool
+void pomelo_webrtc_context_release_pacer_entry(
+    pomelo_webrtc_context_t * context,
+    pomelo_webrtc_pacer_entry_t * entry
+);
+
+
+/// @brief Report the result of a handshake. Unless the handshake has been
+/// transferred to another owner, its admission slot is released.
+void pomelo_webrtc_context_finish_handshake(
+    pomelo_webrtc_context_t * context,
+    pomelo_webrtc_handshake_t * handshake,
+    pomelo_webrtc_handshake_result result
+);
+
+
 /* -------------------------------------------------------------------------- */
 /*                              Private APIs                                  */
 /* -------------------------------------------------------------------------- */
@@ -252,6 +395,14 @@ void pomelo_webrtc_async_task_callback(uv_async_t * async);
 void pomelo_webrtc_async_shutdown_callback(uv_async_t * async);
 
 
+/// @brief Loop prepare handler
+void pomelo_webrtc_loop_prepare_callback(uv_prepare_t * prepare);
+
+
+/// @brief Loop check handler
+void pomelo_webrtc_loop_check_callback(uv_check_t * check);
+
+
 /// @brief Timer callback
 void pomelo_webrtc_timer_callback(uv_timer_t * timer);
 
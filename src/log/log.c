@@ -0,0 +1,416 @@
+#include <assert.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "uv.h"
+#include "pomelo/allocator.h"
+#include "utils/atomic.h"
+#include "log.h"
+
+
+#ifdef _MSC_VER
+#define LOG_THREAD_LOCAL __declspec(thread)
+#else
+#define LOG_THREAD_LOCAL _Thread_local
+#endif
+
+#define LOG_RING_MASK (POMELO_WEBRTC_LOG_RING_CAPACITY - 1)
+#define LOG_CACHE_LINE_SIZE 64
+#define LOG_DATE_TIME_LENGTH 32
+#define LOG_NS_PER_MS 1000000ULL
+
+
+/// @brief A pre-encoded log record
+typedef struct pomelo_webrtc_log_record_s {
+    /// @brief Wall clock seconds
+    uint64_t seconds;
+
+    /// @brief Wall clock nanoseconds
+    uint32_t nanoseconds;
+
+    /// @brief Level of record
+    uint8_t level;
+
+    /// @brief Length of message
+    uint8_t length;
+
+    /// @brief Formatted message, without trailing new line
+    char message[POMELO_WEBRTC_LOG_MESSAGE_CAPACITY];
+} pomelo_webrtc_log_record_t;
+
+
+/// @brief Single-producer single-consumer ring of a thread
+typedef struct pomelo_webrtc_log_ring_s pomelo_webrtc_log_ring_t;
+
+struct pomelo_webrtc_log_ring_s {
+    /// @brief Write position, only written by the owner thread
+    pomelo_atomic_uint64_t head;
+    uint8_t padding_head[LOG_CACHE_LINE_SIZE - sizeof(pomelo_atomic_uint64_t)];
+
+    /// @brief Read position, only written by the drainer
+    pomelo_atomic_uint64_t tail;
+    uint8_t padding_tail[LOG_CACHE_LINE_SIZE - sizeof(pomelo_atomic_uint64_t)];
+
+    /// @brief Number of dropped records
+    pomelo_atomic_uint64_t dropped;
+
+    /// @brief Number of dropped records which have been reported by drainer
+    uint64_t dropped_reported;
+
+    /// @brief Next registered ring
+    pomelo_webrtc_log_ring_t * next;
+
+    /// @brief Records
+    pomelo_webrtc_log_record_t records[POMELO_WEBRTC_LOG_RING_CAPACITY];
+};
+
+
+/// @brief The logger
+typedef struct pomelo_webrtc_logger_s {
+    /// @brief Allocator of rings
+    pomelo_allocator_t * allocator;
+
+    /// @brief Running flag
+    pomelo_atomic_int64_t running;
+
+    /// @brief Registered rings (pointer to the most recent one)
+    pomelo_atomic_uint64_t rings;
+
+    /// @brief Number of startups which have not been shut down yet. It is
+    /// guarded by the lifecycle mutex.
+    size_t users;
+
+    /// @brief Mutex of startup and shutdown
+    uv_mutex_t lifecycle_mutex;
+
+    /// @brief Drainer thread
+    uv_thread_t thread;
+
+    /// @brief Mutex of drainer waking up, never taken by producers
+    uv_mutex_t mutex;
+
+    /// @brief Condition to wake up the drainer on shutdown
+    uv_cond_t cond;
+} pomelo_webrtc_logger_t;
+
+
+pomelo_atomic_int64_t pomelo_webrtc_log_level_current =
+    POMELO_WEBRTC_LOG_LEVEL_INFO;
+
+static pomelo_webrtc_logger_t logger;
+
+static uv_once_t logger_once = UV_ONCE_INIT;
+
+static LOG_THREAD_LOCAL pomelo_webrtc_log_ring_t * local_ring;
+
+static const char log_level_names[] = "NFEWIDV";
+
+
+/* -------------------------------------------------------------------------- */
+/*                               Private APIs                                 */
+/* -------------------------------------------------------------------------- */
+
+/// @brief Initialize the lifecycle mutex of logger
+static void pomelo_webrtc_logger_init_once(void) {
+    logger.allocator = pomelo_allocator_default();
+    if (uv_mutex_init(&logger.lifecycle_mutex) < 0) {
+        abort(); // Cannot guard the startup and shutdown
+    }
+}
+
+
+/// @brief Get the ring of current thread, register new one if needed
+static pomelo_webrtc_log_ring_t * pomelo_webrtc_logger_get_ring(void) {
+    if (local_ring) {
+        return local_ring;
+    }
+
+    pomelo_webrtc_log_ring_t * ring = pomelo_allocator_malloc_t(
+        logger.allocator,
+        pomelo_webrtc_log_ring_t
+    );
+    if (!ring) return NULL; // Failed to allocate new ring
+
+    pomelo_atomic_uint64_store(&ring->head, 0);
+    pomelo_atomic_uint64_store(&ring->tail, 0);
+    pomelo_atomic_uint64_store(&ring->dropped, 0);
+    ring->dropped_reported = 0;
+
+    // Lock-free push to the registered rings
+    uint64_t head;
+    do {
+        head = pomelo_atomic_uint64_load(&logger.rings);
+        ring->next = (pomelo_webrtc_log_ring_t *) (uintptr_t) head;
+    } while (!pomelo_atomic_uint64_compare_exchange(
+        &logger.rings,
+        head,
+        (uint64_t) (uintptr_t) ring
+    ));
+
+    local_ring = ring;
+    return ring;
+}
+
+
+/// @brief Stamp and format a record
+static void pomelo_webrtc_logger_format(
+    pomelo_webrtc_log_record_t * record,
+    pomelo_webrtc_log_level level,
+    const char * format,
+    va_list args
+) {
+    struct timespec ts;
+    if (timespec_get(&ts, TIME_UTC) == 0) {
+        memset(&ts, 0, sizeof(ts));
+    }
+    record->seconds = (uint64_t) ts.tv_sec;
+    record->nanoseconds = (uint32_t) ts.tv_nsec;
+    record->level = (uint8_t) level;
+
+    int length = vsnprintf(
+        record->message,
+        POMELO_WEBRTC_LOG_MESSAGE_CAPACITY,
+        format,
+        args
+    );
+    if (length < 0) {
+        length = 0;
+    } else if (length >= POMELO_WEBRTC_LOG_MESSAGE_CAPACITY) {
+        length = POMELO_WEBRTC_LOG_MESSAGE_CAPACITY - 1; // Truncated
+    }
+
+    // The output terminates every record with a new line
+    while (length > 0 && record->message[length - 1] == '\n') {
+        length--;
+    }
+    record->length = (uint8_t) length;
+}
+
+
+/// @brief Write a record to output
+static void pomelo_webrtc_logger_output(pomelo_webrtc_log_record_t * record) {
+    char datetime[LOG_DATE_TIME_LENGTH];
+    time_t seconds = (time_t) record->seconds;
+
+    // The synchronous path may run in any thread, use reentrant gmtime
+    struct tm tm;
+#ifdef _MSC_VER
+    bool tm_valid = (gmtime_s(&tm, &seconds) == 0);
+#else
+    bool tm_valid = (gmtime_r(&seconds, &tm) != NULL);
+#endif
+    if (
+        !tm_valid ||
+        !strftime(datetime, sizeof(datetime), "%Y-%m-%d %H:%M:%S", &tm)
+    ) {
+        datetime[0] = '\0';
+    }
+
+    char level = (record->level < sizeof(log_level_names) - 1)
+        ? log_level_names[record->level]
+        : '?';
+    fprintf(
+        stdout,
+        "%s.%06u GMT [%c] %.*s\n",
+        datetime,
+        (unsigned) (record->nanoseconds / 1000),
+        level,
+        (int) record->length,
+        record->message
+    );
+}
+
+
+/// @brief Drain all registered rings
+/// @return Number of drained records
+static size_t pomelo_webrtc_logger_drain(void) {
+    size_t drained = 0;
+    pomelo_webrtc_log_ring_t * ring = (pomelo_webrtc_log_ring_t *)
+        (uintptr_t) pomelo_atomic_uint64_load(&logger.rings);
+
+    for (; ring; ring = ring->next) {
+        uint64_t tail = pomelo_atomic_uint64_load(&ring->tail);
+        uint64_t head = pomelo_atomic_uint64_load(&ring->head);
+        for (; tail != head; tail++) {
+            pomelo_webrtc_logger_output(&ring->records[tail & LOG_RING_MASK]);
+            drained++;
+        }
+        pomelo_atomic_uint64_store(&ring->tail, tail);
+
+        uint64_t dropped = pomelo_atomic_uint64_load(&ring->dropped);
+        if (dropped != ring->dropped_reported) {
+            fprintf(
+                stdout,
+                "[WebRTC] Log ring is full, %llu records dropped\n",
+                (unsigned long long) (dropped - ring->dropped_reported)
+            );
+            ring->dropped_reported = dropped;
+            drained++;
+        }
+    }
+
+    if (drained > 0) {
+        fflush(stdout);
+    }
+    return drained;
+}
+
+
+/// @brief Entry of drainer thread
+static void pomelo_webrtc_logger_drainer_entry(void * data) {
+    (void) data;
+    while (pomelo_atomic_int64_load(&logger.running)) {
+        pomelo_webrtc_logger_drain();
+
+        uv_mutex_lock(&logger.mutex);
+        if (pomelo_atomic_int64_load(&logger.running)) {
+            uv_cond_timedwait(
+                &logger.cond,
+                &logger.mutex,
+                POMELO_WEBRTC_LOG_DRAIN_INTERVAL_MS * LOG_NS_PER_MS
+            );
+        }
+        uv_mutex_unlock(&logger.mutex);
+    }
+
+    // Final drain
+    pomelo_webrtc_logger_drain();
+}
+
+
+/// @brief Start the drainer thread. The lifecycle mutex must be held.
+/// @return 0 on success, or -1 on failure
+static int pomelo_webrtc_logger_start_drainer(void) {
+    if (uv_mutex_init(&logger.mutex) < 0) {
+        return -1;
+    }
+    if (uv_cond_init(&logger.cond) < 0) {
+        uv_mutex_destroy(&logger.mutex);
+        return -1;
+    }
+
+    pomelo_atomic_int64_store(&logger.running, true);
+    int ret = uv_thread_create(
+        &logger.thread,
+        pomelo_webrtc_logger_drainer_entry,
+        NULL
+    );
+    if (ret < 0) {
+        pomelo_atomic_int64_store(&logger.running, false);
+        uv_cond_destroy(&logger.cond);
+        uv_mutex_destroy(&logger.mutex);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/// @brief Stop the drainer thread after it has drained the remaining records.
+/// The lifecycle mutex must be held.
+static void pomelo_webrtc_logger_stop_drainer(void) {
+    bool running = pomelo_atomic_int64_compare_exchange(
+        &logger.running, true, false
+    );
+    if (!running) return;
+
+    // Wake up and join the drainer, it drains the remaining records
+    uv_mutex_lock(&logger.mutex);
+    uv_cond_signal(&logger.cond);
+    uv_mutex_unlock(&logger.mutex);
+    uv_thread_join(&logger.thread);
+
+    uv_cond_destroy(&logger.cond);
+    uv_mutex_destroy(&logger.mutex);
+
+    // Rings are not freed. A thread may still hold its ring and write to it,
+    // those records are drained when the logger is started again.
+}
+
+
+/* -------------------------------------------------------------------------- */
+/*                               Module APIs                                  */
+/* -------------------------------------------------------------------------- */
+
+int pomelo_webrtc_logger_startup(void) {
+    uv_once(&logger_once, pomelo_webrtc_logger_init_once);
+
+    uv_mutex_lock(&logger.lifecycle_mutex);
+    logger.users++;
+    int ret = 0;
+    if (!pomelo_atomic_int64_load(&logger.running)) {
+        // The first startup, or the previous ones failed to start the drainer
+        ret = pomelo_webrtc_logger_start_drainer();
+    }
+    uv_mutex_unlock(&logger.lifecycle_mutex);
+    return ret;
+}
+
+
+void pomelo_webrtc_logger_shutdown(void) {
+    uv_once(&logger_once, pomelo_webrtc_logger_init_once);
+
+    uv_mutex_lock(&logger.lifecycle_mutex);
+    assert(logger.users > 0);
+    if (logger.users > 0) {
+        logger.users--;
+    }
+    if (logger.users == 0) {
+        pomelo_webrtc_logger_stop_drainer();
+    }
+    uv_mutex_unlock(&logger.lifecycle_mutex);
+}
+
+
+void pomelo_webrtc_logger_set_level(pomelo_webrtc_log_level level) {
+    pomelo_atomic_int64_store(&pomelo_webrtc_log_level_current, level);
+}
+
+
+void pomelo_webrtc_logger_write(
+    pomelo_webrtc_log_level level,
+    const char * format,
+    ...
+) {
+    va_list args;
+    va_start(args, format);
+    pomelo_webrtc_logger_write_va(level, format, args);
+    va_end(args);
+}
+
+
+void pomelo_webrtc_logger_write_va(
+    pomelo_webrtc_log_level level,
+    const char * format,
+    va_list args
+) {
+    assert(format != NULL);
+    pomelo_webrtc_log_ring_t * ring = NULL;
+    if (pomelo_atomic_int64_load(&logger.running)) {
+        ring = pomelo_webrtc_logger_get_ring();
+    }
+
+    if (!ring) {
+        // Logger is not running, write synchronously in the same format
+        pomelo_webrtc_log_record_t record;
+        pomelo_webrtc_logger_format(&record, level, format, args);
+        pomelo_webrtc_logger_output(&record);
+        fflush(stdout);
+        return;
+    }
+
+    uint64_t head = pomelo_atomic_uint64_load(&ring->head);
+    uint64_t tail = pomelo_atomic_uint64_load(&ring->tail);
+    if (head - tail >= POMELO_WEBRTC_LOG_RING_CAPACITY) {
+        // Ring is full, drop the record
+        pomelo_atomic_uint64_fetch_add(&ring->dropped, 1);
+        return;
+    }
+
+    pomelo_webrtc_log_record_t * record = &ring->records[head & LOG_RING_MASK];
+    pomelo_webrtc_logger_format(record, level, format, args);
+
+    // Publish the record
+    pomelo_atomic_uint64_store(&ring->head, head + 1);
+}
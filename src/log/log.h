@@ -0,0 +1,111 @@
+#ifndef POMELO_PLUGIN_WEBRTC_LOG_H
+#define POMELO_PLUGIN_WEBRTC_LOG_H
+#include <stdint.h>
+#include <stdarg.h>
+#include "utils/atomic.h"
+#include "plugin.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Asynchronous logger.
+    Every logging thread owns a single-producer ring of fixed-size records.
+    Producers only format the message into their own ring and never take any
+    lock, a single background drainer formats the timestamps and writes the
+    records to stdout. When a ring is full, the record is dropped and counted,
+    logging never blocks the caller.
+
+    Rings are registered lazily with a lock-free push and are never freed, a
+    thread may still write to its ring after the logger has been shut down.
+    Those records are written when the logger is started again.
+
+    Startup and shutdown are counted. Every context starts the logger and
+    shuts it down after all of its threads (event loop, libdatachannel and
+    worker threads) have stopped; the last shutdown stops the drainer.
+*/
+
+/// Capacity of a record message, longer messages are truncated
+#define POMELO_WEBRTC_LOG_MESSAGE_CAPACITY 240
+
+/// Number of records of a ring (Must be power of 2)
+#define POMELO_WEBRTC_LOG_RING_CAPACITY 256
+
+/// Interval of draining records
+#define POMELO_WEBRTC_LOG_DRAIN_INTERVAL_MS 10
+
+
+/// @brief Current logging level. It is read by all logging threads and only
+/// written by pomelo_webrtc_logger_set_level.
+extern pomelo_atomic_int64_t pomelo_webrtc_log_level_current;
+
+
+/// @brief Check if a level is enabled
+#define pomelo_webrtc_log_is_enabled(level)                                    \
+    ((int64_t) (level) <=                                                      \
+        pomelo_atomic_int64_load(&pomelo_webrtc_log_level_current))
+
+
+/// @brief Log a message at a level. Arguments are not evaluated when the level
+/// is disabled.
+#define pomelo_webrtc_log_at(level, ...)                                       \
+do {                                                                           \
+    if (pomelo_webrtc_log_is_enabled(level)) {                                 \
+        pomelo_webrtc_logger_write((level), __VA_ARGS__);                      \
+    }                                                                          \
+} while (0)
+
+
+#define pomelo_webrtc_log_error(...)                                           \
+    pomelo_webrtc_log_at(POMELO_WEBRTC_LOG_LEVEL_ERROR, __VA_ARGS__)
+
+#define pomelo_webrtc_log_warning(...)                                         \
+    pomelo_webrtc_log_at(POMELO_WEBRTC_LOG_LEVEL_WARNING, __VA_ARGS__)
+
+#define pomelo_webrtc_log_info(...)                                            \
+    pomelo_webrtc_log_at(POMELO_WEBRTC_LOG_LEVEL_INFO, __VA_ARGS__)
+
+#define pomelo_webrtc_log_verbose(...)                                         \
+    pomelo_webrtc_log_at(POMELO_WEBRTC_LOG_LEVEL_VERBOSE, __VA_ARGS__)
+
+
+/* -------------------------------------------------------------------------- */
+/*                               Module APIs                                  */
+/* -------------------------------------------------------------------------- */
+
+/// @brief Start the logger. The level is not changed. If the logger has not
+/// been started, messages are written synchronously in the same format.
+/// @return 0 on success, or -1 on failure
+int pomelo_webrtc_logger_startup(void);
+
+
+/// @brief Release one startup. The last one drains all pending records and
+/// stops the logger.
+void pomelo_webrtc_logger_shutdown(void);
+
+
+/// @brief Set current logging level
+void pomelo_webrtc_logger_set_level(pomelo_webrtc_log_level level);
+
+
+/// @brief Format a message and push it to the ring of current thread.
+/// Prefer the pomelo_webrtc_log_* macros, they check the level first.
+void pomelo_webrtc_logger_write(
+    pomelo_webrtc_log_level level,
+    const char * format,
+    ...
+);
+
+
+/// @brief Format a message and push it to the ring of current thread
+void pomelo_webrtc_logger_write_va(
+    pomelo_webrtc_log_level level,
+    const char * format,
+    va_list args
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // POMELO_PLUGIN_WEBRTC_LOG_H
@@ -0,0 +1,293 @@
+#include <assert.h>
+#include <string.h>
+#include "uv.h"
+#include "utils/common-macro.h"
+#include "context.h"
+#include "session/session.h"
+#include "channel/channel-int.h"
+#include "pacer.h"
+
+
+/// @brief Refill the bucket
+static void pomelo_webrtc_pacer_refill(
+    pomelo_webrtc_pacer_t * pacer,
+    uint64_t now
+) {
+    uint64_t elapsed = now - pacer->refill_time;
+    pacer->refill_time = now;
+
+    pacer->tokens += (double) pacer->rate * ((double) elapsed / 1e9);
+    if (pacer->tokens > pacer->burst) {
+        pacer->tokens = pacer->burst;
+    }
+}
+
+
+/// @brief Send a message and take its tokens
+static void pomelo_webrtc_pacer_send_now(
+    pomelo_webrtc_pacer_t * pacer,
+    pomelo_webrtc_channel_t * channel,
+    rtc_buffer_t * buffer
+) {
+    pacer->tokens -= (double) rtc_buffer_size(buffer);
+    pomelo_webrtc_channel_send_buffer(channel, buffer);
+}
+
+
+/// @brief Remove the front entry of a queue and release its references
+static void pomelo_webrtc_pacer_pop(
+    pomelo_webrtc_pacer_t * pacer,
+    pomelo_webrtc_pacer_queue_t * queue
+) {
+    pomelo_webrtc_pacer_entry_t * entry = queue->front;
+    assert(entry != NULL);
+
+    queue->front = entry->next;
+    if (!queue->front) {
+        queue->back = NULL;
+    }
+    pacer->queued--;
+
+    rtc_buffer_unref(entry->buffer);
+    pomelo_webrtc_channel_unref(entry->channel);
+    pomelo_webrtc_context_release_pacer_entry(pacer->session->context, entry);
+}
+
+
+/// @brief Stop the timer
+static void pomelo_webrtc_pacer_stop(pomelo_webrtc_pacer_t * pacer) {
+    if (pacer->task) {
+        pomelo_webrtc_context_unschedule_task(
+            pacer->session->context,
+            pacer->task
+        );
+        pacer->task = NULL;
+    }
+}
+
+
+/// @brief Drop the unreliable messages which have waited too long. Messages
+/// of a queue are in order of time, so the stale ones are at its front.
+static void pomelo_webrtc_pacer_drop_stale(
+    pomelo_webrtc_pacer_t * pacer,
+    pomelo_webrtc_pacer_queue_t * queue,
+    uint64_t now
+) {
+    while (queue->front) {
+        pomelo_webrtc_pacer_entry_t * entry = queue->front;
+        pomelo_webrtc_channel_t * channel = entry->channel;
+        if (
+            channel->mode == POMELO_CHANNEL_MODE_RELIABLE ||
+            now - entry->queue_time <= pacer->max_delay
+        ) {
+            return;
+        }
+
+        pomelo_webrtc_channel_count_send_dropped(channel);
+        pomelo_webrtc_pacer_pop(pacer, queue);
+    }
+}
+
+
+/// @brief Drain the queues as far as the tokens allow
+static void pomelo_webrtc_pacer_flush(
+    size_t argc,
+    pomelo_webrtc_variant_t * args
+) {
+    assert(argc == 1);
+    assert(args != NULL);
+
+    pomelo_webrtc_pacer_t * pacer = args[0].ptr;
+    uint64_t now = uv_hrtime();
+    pomelo_webrtc_pacer_refill(pacer, now);
+
+    size_t nlevels = POMELO_ARRAY_LENGTH(pacer->queues);
+    for (size_t level = 0; level < nlevels; level++) {
+        pomelo_webrtc_pacer_drop_stale(pacer, &pacer->queues[level], now);
+    }
+
+    // Deficit round robin, from the highest level
+    while (pacer->queued > 0 && pacer->tokens >= 0) {
+        for (size_t i = nlevels; i > 0 && pacer->tokens >= 0; i--) {
+            size_t level = i - 1;
+            pomelo_webrtc_pacer_queue_t * queue = &pacer->queues[level];
+            if (!queue->front) {
+                queue->deficit = 0; // Idle levels do not save up
+                continue;
+            }
+
+            queue->deficit += (size_t) POMELO_WEBRTC_PACER_QUANTUM << level;
+            while (queue->front && pacer->tokens >= 0) {
+                rtc_buffer_t * buffer = queue->front->buffer;
+                size_t size = rtc_buffer_size(buffer);
+                if (size > queue->deficit) {
+                    break; // Wait for the next round
+                }
+
+                queue->deficit -= size;
+                pomelo_webrtc_pacer_send_now(
+                    pacer,
+                    queue->front->channel,
+                    buffer
+                );
+                pomelo_webrtc_pacer_pop(pacer, queue);
+            }
+
+            if (!queue->front) {
+                queue->deficit = 0;
+            }
+        }
+    }
+
+    if (pacer->queued == 0) {
+        pomelo_webrtc_pacer_stop(pacer);
+    }
+}
+
+
+void pomelo_webrtc_pacer_init(
+    pomelo_webrtc_pacer_t * pacer,
+    pomelo_webrtc_session_t * session
+) {
+    assert(pacer != NULL);
+    assert(session != NULL);
+
+    memset(pacer, 0, sizeof(pomelo_webrtc_pacer_t));
+    pacer->session = session;
+
+    pomelo_webrtc_config_t * config = &session->context->config;
+    if (config->send_rate_limit <= 0) {
+        return; // No pacing
+    }
+
+    pacer->enabled = true;
+    pacer->adaptive = config->send_rate_adaptive;
+    pacer->max_rate = (uint64_t) config->send_rate_limit;
+    pacer->rate = pacer->max_rate;
+    pacer->burst = (config->send_burst > 0)
+        ? (double) config->send_burst
+        : (double) (pacer->max_rate * POMELO_WEBRTC_PACER_DEFAULT_BURST_MS)
+            / 1000.0;
+
+    int max_delay_ms = (config->send_max_delay_ms > 0)
+        ? config->send_max_delay_ms
+        : POMELO_WEBRTC_PACER_DEFAULT_MAX_DELAY_MS;
+    pacer->max_delay = 1000000ULL * (uint64_t) max_delay_ms;
+
+    pacer->tokens = pacer->burst;
+    pacer->refill_time = uv_hrtime();
+}
+
+
+void pomelo_webrtc_pacer_cleanup(pomelo_webrtc_pacer_t * pacer) {
+    assert(pacer != NULL);
+    if (!pacer->session) {
+        return; // Not initialized
+    }
+
+    pomelo_webrtc_pacer_stop(pacer);
+    for (size_t i = 0; i < POMELO_ARRAY_LENGTH(pacer->queues); i++) {
+        pomelo_webrtc_pacer_queue_t * queue = &pacer->queues[i];
+        while (queue->front) {
+            pomelo_webrtc_channel_count_send_dropped(queue->front->channel);
+            pomelo_webrtc_pacer_pop(pacer, queue);
+        }
+        queue->deficit = 0;
+    }
+    pacer->enabled = false;
+}
+
+
+void pomelo_webrtc_pacer_send(
+    pomelo_webrtc_pacer_t * pacer,
+    pomelo_webrtc_channel_t * channel,
+    rtc_buffer_t * buffer
+) {
+    assert(pacer != NULL);
+    assert(channel != NULL);
+    assert(buffer != NULL);
+
+    if (!pacer->enabled) {
+        pomelo_webrtc_channel_send_buffer(channel, buffer);
+        return;
+    }
+
+    uint64_t now = uv_hrtime();
+    pomelo_webrtc_pacer_refill(pacer, now);
+
+    // Messages never overtake the queued ones. The tokens may go negative
+    // here, so a message larger than the burst still goes out.
+    if (pacer->queued == 0 && pacer->tokens >= 0) {
+        pomelo_webrtc_pacer_send_now(pacer, channel, buffer);
+        return;
+    }
+
+    if (!pacer->task) {
+        pomelo_webrtc_variant_t args[] = {{ .ptr = pacer }};
+        pacer->task = pomelo_webrtc_context_schedule_task(
+            pacer->session->context,
+            pomelo_webrtc_pacer_flush,
+            POMELO_ARRAY_LENGTH(args),
+            args,
+            POMELO_WEBRTC_PACER_INTERVAL_MS
+        );
+        if (!pacer->task) {
+            // Cannot pace without the timer
+            pomelo_webrtc_pacer_send_now(pacer, channel, buffer);
+            return;
+        }
+    }
+
+    pomelo_webrtc_pacer_entry_t * entry =
+        pomelo_webrtc_context_acquire_pacer_entry(pacer->session->context);
+    if (!entry) {
+        pomelo_webrtc_channel_count_send_dropped(channel);
+        return; // Failed to allocate entry
+    }
+
+    // Keep the message and its channel until it is sent
+    rtc_buffer_ref(buffer);
+    pomelo_webrtc_channel_ref(channel);
+
+    entry->next = NULL;
+    entry->channel = channel;
+    entry->buffer = buffer;
+    entry->queue_time = now;
+
+    size_t level = channel->priority;
+    if (level >= POMELO_ARRAY_LENGTH(pacer->queues)) {
+        level = POMELO_ARRAY_LENGTH(pacer->queues) - 1;
+    }
+
+    pomelo_webrtc_pacer_queue_t * queue = &pacer->queues[level];
+    if (queue->back) {
+        queue->back->next = entry;
+    } else {
+        queue->front = entry;
+    }
+    queue->back = entry;
+    pacer->queued++;
+}
+
+
+void pomelo_webrtc_pacer_on_loss(
+    pomelo_webrtc_pacer_t * pacer,
+    uint64_t loss_ppm
+) {
+    assert(pacer != NULL);
+    if (!pacer->enabled || !pacer->adaptive) {
+        return; // Fixed rate
+    }
+
+    uint64_t rate = pacer->rate;
+    if (loss_ppm > POMELO_WEBRTC_PACER_HIGH_LOSS_PPM) {
+        rate -= rate >> 3; // x 7/8
+    } else if (loss_ppm < POMELO_WEBRTC_PACER_LOW_LOSS_PPM) {
+        rate += pacer->max_rate >> 4;
+    }
+
+    uint64_t min_rate = pacer->max_rate >> POMELO_WEBRTC_PACER_MIN_RATE_SHIFT;
+    if (rate < min_rate) rate = min_rate;
+    if (rate > pacer->max_rate) rate = pacer->max_rate;
+    pacer->rate = rate;
+}
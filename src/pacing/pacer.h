@@ -0,0 +1,165 @@
+#ifndef POMELO_WEBRTC_PACER_H
+#define POMELO_WEBRTC_PACER_H
+#include <stdbool.h>
+#include "rtc-api/rtc-api.h"
+#include "plugin.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Send pacing of a session.
+    Outgoing messages pass a token bucket which is refilled at the send rate
+    of session. When the bucket is empty, messages wait in FIFO queues which
+    are drained by a timer of plugin loop, so a burst of messages leaves the
+    server spread over time instead of overflowing the path at once.
+
+    Each priority level of channels has its own queue. The queues are
+    drained by deficit round robin, a level gets twice the bytes of the level
+    below it in every round, so bulk transfers cannot starve urgent messages
+    and still make progress. The system channel never passes the pacer, pings
+    and pongs always leave first.
+
+    Reliable messages are only deferred. Unreliable and sequenced messages
+    are dropped when they have waited longer than the maximum delay, a stale
+    message is worse than a lost one for them.
+
+    With adaptive rate, the send rate follows the downlink loss reported by
+    client: it is decreased multiplicatively when the loss is high and it is
+    increased additively up to the configured rate when the loss is low.
+
+    All functions are called in plugin thread only.
+*/
+
+
+/// @brief Interval of draining the queue (ms)
+#define POMELO_WEBRTC_PACER_INTERVAL_MS 5
+
+/// @brief Bytes which the lowest priority level may send in a round
+#define POMELO_WEBRTC_PACER_QUANTUM 1200
+
+/// @brief Default maximum delay of unreliable messages (ms)
+#define POMELO_WEBRTC_PACER_DEFAULT_MAX_DELAY_MS 100
+
+/// @brief Default burst, in milliseconds of the send rate
+#define POMELO_WEBRTC_PACER_DEFAULT_BURST_MS 20
+
+/// @brief Adaptive rate: loss above this is high (ppm)
+#define POMELO_WEBRTC_PACER_HIGH_LOSS_PPM 20000 // 2%
+
+/// @brief Adaptive rate: loss below this is low (ppm)
+#define POMELO_WEBRTC_PACER_LOW_LOSS_PPM 5000 // 0.5%
+
+/// @brief Adaptive rate: the rate never goes below the configured one
+/// divided by 2^N
+#define POMELO_WEBRTC_PACER_MIN_RATE_SHIFT 3
+
+
+/// @brief Send pacer
+typedef struct pomelo_webrtc_pacer_s pomelo_webrtc_pacer_t;
+
+/// @brief A queued message
+typedef struct pomelo_webrtc_pacer_entry_s pomelo_webrtc_pacer_entry_t;
+
+/// @brief Queue of a priority level
+typedef struct pomelo_webrtc_pacer_queue_s pomelo_webrtc_pacer_queue_t;
+
+
+struct pomelo_webrtc_pacer_entry_s {
+    /// @brief Next entry in queue
+    pomelo_webrtc_pacer_entry_t * next;
+
+    /// @brief Channel to send through
+    pomelo_webrtc_channel_t * channel;
+
+    /// @brief Message
+    rtc_buffer_t * buffer;
+
+    /// @brief Time of queuing (ns)
+    uint64_t queue_time;
+};
+
+
+struct pomelo_webrtc_pacer_queue_s {
+    /// @brief Front of queue
+    pomelo_webrtc_pacer_entry_t * front;
+
+    /// @brief Back of queue
+    pomelo_webrtc_pacer_entry_t * back;
+
+    /// @brief Bytes which this level may still send in the current round
+    size_t deficit;
+};
+
+
+struct pomelo_webrtc_pacer_s {
+    /// @brief The session
+    pomelo_webrtc_session_t * session;
+
+    /// @brief Whether the pacing is enabled
+    bool enabled;
+
+    /// @brief Whether the send rate follows the reported loss
+    bool adaptive;
+
+    /// @brief Configured send rate (bytes per second)
+    uint64_t max_rate;
+
+    /// @brief Current send rate (bytes per second)
+    uint64_t rate;
+
+    /// @brief Capacity of bucket (bytes)
+    double burst;
+
+    /// @brief Available tokens (bytes). It goes negative when a message is
+    /// larger than the tokens, the next messages wait for the debt.
+    double tokens;
+
+    /// @brief The last time tokens have been refilled (ns)
+    uint64_t refill_time;
+
+    /// @brief Maximum delay of unreliable messages (ns)
+    uint64_t max_delay;
+
+    /// @brief Queues by priority level
+    pomelo_webrtc_pacer_queue_t
+        queues[POMELO_WEBRTC_CONFIG_CHANNEL_PRIORITY_LEVELS];
+
+    /// @brief Number of queued messages
+    size_t queued;
+
+    /// @brief Timer draining the queue
+    pomelo_webrtc_task_t * task;
+};
+
+
+/// @brief Initialize the pacer from the configuration
+void pomelo_webrtc_pacer_init(
+    pomelo_webrtc_pacer_t * pacer,
+    pomelo_webrtc_session_t * session
+);
+
+
+/// @brief Drop all queued messages and disable the pacer
+void pomelo_webrtc_pacer_cleanup(pomelo_webrtc_pacer_t * pacer);
+
+
+/// @brief Send a message now or queue it
+void pomelo_webrtc_pacer_send(
+    pomelo_webrtc_pacer_t * pacer,
+    pomelo_webrtc_channel_t * channel,
+    rtc_buffer_t * buffer
+);
+
+
+/// @brief Adapt the rate to the downlink loss reported by client
+void pomelo_webrtc_pacer_on_loss(
+    pomelo_webrtc_pacer_t * pacer,
+    uint64_t loss_ppm
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // POMELO_WEBRTC_PACER_H
@@ -3,7 +3,10 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdarg.h>
+#include "utils/common-macro.h"
 #include "context.h"
+#include "session/session.h"
+#include "log/log.h"
 
 
 /* -------------------------------------------------------------------------- */
@@ -38,20 +41,361 @@ void POMELO_PLUGIN_CALL pomelo_webrtc_on_unload(pomelo_plugin_t * plugin) {
 /* -------------------------------------------------------------------------- */
 
 void pomelo_webrtc_log(const char * format, ...) {
+    if (!pomelo_webrtc_log_is_enabled(POMELO_WEBRTC_LOG_LEVEL_INFO)) return;
+
     va_list args;
     va_start(args, format);
-    vprintf(format, args);
+    pomelo_webrtc_logger_write_va(POMELO_WEBRTC_LOG_LEVEL_INFO, format, args);
     va_end(args);
 }
 
 
 void pomelo_webrtc_log_debug(const char * format, ...) {
-#ifndef NDEBUG
+    if (!pomelo_webrtc_log_is_enabled(POMELO_WEBRTC_LOG_LEVEL_DEBUG)) return;
+
     va_list args;
     va_start(args, format);
-    vprintf(format, args);
+    pomelo_webrtc_logger_write_va(POMELO_WEBRTC_LOG_LEVEL_DEBUG, format, args);
     va_end(args);
-#else
-    (void) format;
-#endif // NDEBUG
+}
+
+
+int pomelo_webrtc_set_log_level(
+    pomelo_plugin_t * plugin,
+    pomelo_webrtc_log_level level
+) {
+    assert(plugin != NULL);
+    pomelo_webrtc_context_t * context = plugin->get_data(plugin);
+    if (!context) return -1; // Plugin is not loaded
+
+    pomelo_webrtc_logger_set_level(level);
+    rtc_context_set_log_level(context->rtc_context, (rtc_log_level) level);
+    return 0;
+}
+
+
+int pomelo_webrtc_get_handshake_stats(
+    pomelo_plugin_t * plugin,
+    pomelo_webrtc_handshake_phase phase,
+    pomelo_webrtc_handshake_phase_stats_t * stats
+) {
+    assert(plugin != NULL);
+    assert(stats != NULL);
+
+    if ((int) phase < 0 || phase >= POMELO_WEBRTC_HANDSHAKE_PHASE_COUNT) {
+        return -1; // Invalid phase
+    }
+
+    pomelo_webrtc_context_t * context = plugin->get_data(plugin);
+    if (!context) return -1; // Plugin is not loaded
+
+    pomelo_webrtc_handshake_stats_get(&context->handshake_stats, phase, stats);
+    return 0;
+}
+
+
+int pomelo_webrtc_get_resource_stats(
+    pomelo_plugin_t * plugin,
+    pomelo_webrtc_resource_stats_t * stats
+) {
+    assert(plugin != NULL);
+    assert(stats != NULL);
+
+    pomelo_webrtc_context_t * context = plugin->get_data(plugin);
+    if (!context) return -1; // Plugin is not loaded
+
+    pomelo_webrtc_context_resources_t * resources = &context->resources;
+    stats->sockets = pomelo_atomic_uint64_load(&resources->sockets);
+    stats->preauths = pomelo_atomic_uint64_load(&resources->preauths);
+    stats->sessions = pomelo_atomic_uint64_load(&resources->sessions);
+    stats->channels = pomelo_atomic_uint64_load(&resources->channels);
+    stats->string_buffers =
+        pomelo_atomic_uint64_load(&resources->string_buffers);
+    stats->recv_commands =
+        pomelo_atomic_uint64_load(&resources->recv_commands);
+    stats->pacer_entries =
+        pomelo_atomic_uint64_load(&resources->pacer_entries);
+    return 0;
+}
+
+
+int pomelo_webrtc_get_loop_stats(
+    pomelo_plugin_t * plugin,
+    pomelo_webrtc_loop_stats_t * stats
+) {
+    assert(plugin != NULL);
+    assert(stats != NULL);
+
+    pomelo_webrtc_context_t * context = plugin->get_data(plugin);
+    if (!context) return -1; // Plugin is not loaded
+
+    pomelo_webrtc_loop_monitor_get(&context->loop_monitor, stats);
+    return 0;
+}
+
+
+int pomelo_webrtc_reset_loop_stats(pomelo_plugin_t * plugin) {
+    assert(plugin != NULL);
+
+    pomelo_webrtc_context_t * context = plugin->get_data(plugin);
+    if (!context) return -1; // Plugin is not loaded
+
+    pomelo_webrtc_loop_monitor_reset_distributions(&context->loop_monitor);
+    return 0;
+}
+
+
+int pomelo_webrtc_get_admission_stats(
+    pomelo_plugin_t * plugin,
+    pomelo_webrtc_admission_stats_t * stats
+) {
+    assert(plugin != NULL);
+    assert(stats != NULL);
+
+    pomelo_webrtc_context_t * context = plugin->get_data(plugin);
+    if (!context) return -1; // Plugin is not loaded
+
+    pomelo_webrtc_admission_get(&context->admission, stats);
+    return 0;
+}
+
+
+int pomelo_webrtc_get_traffic_stats(
+    pomelo_plugin_t * plugin,
+    pomelo_webrtc_traffic_stats_t * stats
+) {
+    assert(plugin != NULL);
+    assert(stats != NULL);
+
+    pomelo_webrtc_context_t * context = plugin->get_data(plugin);
+    if (!context) return -1; // Plugin is not loaded
+
+    memset(stats, 0, sizeof(pomelo_webrtc_traffic_stats_t));
+    pomelo_webrtc_traffic_fold(&context->traffic, stats);
+    return 0;
+}
+
+
+int pomelo_webrtc_session_get_stats(
+    pomelo_plugin_t * plugin,
+    pomelo_session_t * native_session,
+    pomelo_webrtc_traffic_stats_t * stats
+) {
+    assert(plugin != NULL);
+    assert(native_session != NULL);
+    assert(stats != NULL);
+
+    pomelo_webrtc_session_t * session =
+        plugin->session_get_private(plugin, native_session);
+    if (!session) return -1; // Not a session of this plugin
+
+    pomelo_webrtc_session_get_traffic(session, stats);
+    return 0;
+}
+
+
+int pomelo_webrtc_channel_get_stats(
+    pomelo_plugin_t * plugin,
+    pomelo_session_t * native_session,
+    size_t channel_index,
+    pomelo_webrtc_traffic_stats_t * stats
+) {
+    assert(plugin != NULL);
+    assert(native_session != NULL);
+    assert(stats != NULL);
+
+    pomelo_webrtc_session_t * session =
+        plugin->session_get_private(plugin, native_session);
+    if (!session) return -1; // Not a session of this plugin
+
+    return pomelo_webrtc_session_get_channel_traffic(
+        session,
+        channel_index,
+        stats
+    );
+}
+
+
+int pomelo_webrtc_session_get_transport_stats(
+    pomelo_plugin_t * plugin,
+    pomelo_session_t * native_session,
+    pomelo_webrtc_transport_stats_t * stats
+) {
+    assert(plugin != NULL);
+    assert(native_session != NULL);
+    assert(stats != NULL);
+
+    pomelo_webrtc_session_t * session =
+        plugin->session_get_private(plugin, native_session);
+    if (!session) return -1; // Not a session of this plugin
+
+    pomelo_webrtc_transport_get(&session->transport, stats);
+    return 0;
+}
+
+
+int pomelo_webrtc_session_get_rtt_stats(
+    pomelo_plugin_t * plugin,
+    pomelo_session_t * native_session,
+    pomelo_webrtc_rtt_stats_t * stats
+) {
+    assert(plugin != NULL);
+    assert(native_session != NULL);
+    assert(stats != NULL);
+
+    pomelo_webrtc_session_t * session =
+        plugin->session_get_private(plugin, native_session);
+    if (!session) return -1; // Not a session of this plugin
+
+    pomelo_webrtc_rtt_get(&session->rtt_stats, stats);
+    stats->mean_us = pomelo_atomic_uint64_load(&session->rtt.mean) / 1000ULL;
+    return 0;
+}
+
+
+int pomelo_webrtc_session_get_loss_stats(
+    pomelo_plugin_t * plugin,
+    pomelo_session_t * native_session,
+    pomelo_webrtc_loss_stats_t * stats
+) {
+    assert(plugin != NULL);
+    assert(native_session != NULL);
+    assert(stats != NULL);
+
+    pomelo_webrtc_session_t * session =
+        plugin->session_get_private(plugin, native_session);
+    if (!session) return -1; // Not a session of this plugin
+
+    pomelo_webrtc_session_get_loss(session, stats);
+    return 0;
+}
+
+
+int pomelo_webrtc_session_get_clock_stats(
+    pomelo_plugin_t * plugin,
+    pomelo_session_t * native_session,
+    pomelo_webrtc_clock_stats_t * stats
+) {
+    assert(plugin != NULL);
+    assert(native_session != NULL);
+    assert(stats != NULL);
+
+    pomelo_webrtc_session_t * session =
+        plugin->session_get_private(plugin, native_session);
+    if (!session) return -1; // Not a session of this plugin
+
+    pomelo_webrtc_clock_get(&session->clock, stats);
+    return 0;
+}
+
+
+/// @brief Apply the configuration in plugin thread
+static void pomelo_webrtc_set_config_callback(
+    size_t argc,
+    pomelo_webrtc_variant_t * args
+) {
+    assert(argc == 2);
+    assert(args != NULL);
+
+    pomelo_webrtc_context_t * context = args[0].ptr;
+    pomelo_webrtc_config_t * config = args[1].ptr;
+
+    memcpy(&context->config, config, sizeof(pomelo_webrtc_config_t));
+    pomelo_allocator_free(context->allocator, config);
+}
+
+
+int pomelo_webrtc_set_config(
+    pomelo_plugin_t * plugin,
+    const pomelo_webrtc_config_t * config
+) {
+    assert(plugin != NULL);
+    assert(config != NULL);
+
+    pomelo_webrtc_context_t * context = plugin->get_data(plugin);
+    if (!context) return -1; // Plugin is not loaded
+
+    // Copy the configuration, the plugin thread will take it
+    pomelo_webrtc_config_t * copied =
+        pomelo_allocator_malloc_t(context->allocator, pomelo_webrtc_config_t);
+    if (!copied) return -1; // Failed to allocate
+    memcpy(copied, config, sizeof(pomelo_webrtc_config_t));
+
+    pomelo_webrtc_variant_t args[] = {
+        { .ptr = context },
+        { .ptr = copied }
+    };
+    pomelo_webrtc_task_t * task = pomelo_webrtc_context_submit_task(
+        context,
+        pomelo_webrtc_set_config_callback,
+        POMELO_ARRAY_LENGTH(args),
+        args
+    );
+    if (!task) {
+        // Failed to submit task
+        pomelo_allocator_free(context->allocator, copied);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static void pomelo_webrtc_set_channel_dictionary_callback(
+    size_t argc,
+    pomelo_webrtc_variant_t * args
+) {
+    assert(argc == 3);
+    assert(args != NULL);
+
+    pomelo_webrtc_context_t * context = args[0].ptr;
+    size_t channel_index = args[1].size;
+    pomelo_webrtc_dictionary_t * dictionary = args[2].ptr;
+
+    if (context->dictionaries[channel_index]) {
+        pomelo_webrtc_dictionary_unref(context->dictionaries[channel_index]);
+    }
+    context->dictionaries[channel_index] = dictionary;
+}
+
+
+int pomelo_webrtc_set_channel_dictionary(
+    pomelo_plugin_t * plugin,
+    size_t channel_index,
+    const uint8_t * data,
+    size_t size
+) {
+    assert(plugin != NULL);
+    if (channel_index >= POMELO_WEBRTC_CONFIG_MAX_CHANNELS) {
+        return -1; // Invalid channel
+    }
+
+    pomelo_webrtc_context_t * context = plugin->get_data(plugin);
+    if (!context) return -1; // Plugin is not loaded
+
+    pomelo_webrtc_dictionary_t * dictionary = NULL;
+    if (data && size > 0) {
+        dictionary =
+            pomelo_webrtc_dictionary_create(context->allocator, data, size);
+        if (!dictionary) return -1; // Failed to allocate
+    }
+
+    pomelo_webrtc_variant_t args[] = {
+        { .ptr = context },
+        { .size = channel_index },
+        { .ptr = dictionary }
+    };
+    pomelo_webrtc_task_t * task = pomelo_webrtc_context_submit_task(
+        context,
+        pomelo_webrtc_set_channel_dictionary_callback,
+        POMELO_ARRAY_LENGTH(args),
+        args
+    );
+    if (!task) {
+        // Failed to submit task
+        if (dictionary) pomelo_webrtc_dictionary_unref(dictionary);
+        return -1;
+    }
+
+    return 0;
 }
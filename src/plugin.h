@@ -3,6 +3,7 @@
 #include <stddef.h>
 
 #include "pomelo/plugin.h"
+#include "config.h"
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -63,6 +64,348 @@ typedef struct pomelo_webrtc_session_info_s pomelo_webrtc_session_info_t;
 /// @brief Information about the socket
 typedef struct pomelo_webrtc_socket_info_s pomelo_webrtc_socket_info_t;
 
+/// @brief Record of a websocket client which has not been authenticated yet
+typedef struct pomelo_webrtc_preauth_s pomelo_webrtc_preauth_t;
+
+/// @brief Information about the pre-auth record
+typedef struct pomelo_webrtc_preauth_info_s pomelo_webrtc_preauth_info_t;
+
+/// @brief Batch of connect tokens to verify in worker thread
+typedef struct pomelo_webrtc_auth_batch_s pomelo_webrtc_auth_batch_t;
+
+
+/// @brief Kind of the object which is associated with a websocket client
+typedef enum pomelo_webrtc_ws_owner_kind_e {
+    POMELO_WEBRTC_WS_OWNER_PREAUTH,
+    POMELO_WEBRTC_WS_OWNER_SESSION
+} pomelo_webrtc_ws_owner_kind;
+
+
+/// @brief Logging levels, from the most to the least severe
+typedef enum pomelo_webrtc_log_level_e {
+    POMELO_WEBRTC_LOG_LEVEL_NONE,
+    POMELO_WEBRTC_LOG_LEVEL_FATAL,
+    POMELO_WEBRTC_LOG_LEVEL_ERROR,
+    POMELO_WEBRTC_LOG_LEVEL_WARNING,
+    POMELO_WEBRTC_LOG_LEVEL_INFO,
+    POMELO_WEBRTC_LOG_LEVEL_DEBUG,
+    POMELO_WEBRTC_LOG_LEVEL_VERBOSE
+} pomelo_webrtc_log_level;
+
+
+/// @brief Types of ICE candidates
+typedef enum pomelo_webrtc_candidate_type_e {
+    /// @brief Unknown or no candidate pair has been selected
+    POMELO_WEBRTC_CANDIDATE_TYPE_UNKNOWN,
+
+    /// @brief Address of the host
+    POMELO_WEBRTC_CANDIDATE_TYPE_HOST,
+
+    /// @brief Address discovered by a STUN server
+    POMELO_WEBRTC_CANDIDATE_TYPE_SERVER_REFLEXIVE,
+
+    /// @brief Address discovered from the connectivity checks of peer
+    POMELO_WEBRTC_CANDIDATE_TYPE_PEER_REFLEXIVE,
+
+    /// @brief Address of a TURN relay
+    POMELO_WEBRTC_CANDIDATE_TYPE_RELAYED
+} pomelo_webrtc_candidate_type;
+
+
+/// @brief Phases of connection handshake, in their usual order
+typedef enum pomelo_webrtc_handshake_phase_e {
+    /// @brief Websocket client has been accepted
+    POMELO_WEBRTC_HANDSHAKE_PHASE_WS_ACCEPTED,
+
+    /// @brief AUTH message has been received
+    POMELO_WEBRTC_HANDSHAKE_PHASE_AUTH_RECEIVED,
+
+    /// @brief Connect token has been decoded
+    POMELO_WEBRTC_HANDSHAKE_PHASE_TOKEN_DECODED,
+
+    /// @brief Local offer has been sent
+    POMELO_WEBRTC_HANDSHAKE_PHASE_OFFER_SENT,
+
+    /// @brief Remote description has been applied
+    POMELO_WEBRTC_HANDSHAKE_PHASE_REMOTE_DESCRIPTION,
+
+    /// @brief The first remote candidate has been received
+    POMELO_WEBRTC_HANDSHAKE_PHASE_FIRST_REMOTE_CANDIDATE,
+
+    /// @brief Peer connection has connected
+    POMELO_WEBRTC_HANDSHAKE_PHASE_PC_CONNECTED,
+
+    /// @brief All data channels have opened
+    POMELO_WEBRTC_HANDSHAKE_PHASE_CHANNELS_OPENED,
+
+    /// @brief READY signal has been received from client
+    POMELO_WEBRTC_HANDSHAKE_PHASE_READY_RECEIVED,
+
+    /// @brief Native session has been created
+    POMELO_WEBRTC_HANDSHAKE_PHASE_SESSION_CREATED,
+
+    /// @brief Number of phases
+    POMELO_WEBRTC_HANDSHAKE_PHASE_COUNT
+} pomelo_webrtc_handshake_phase;
+
+
+/// @brief Statistic of a single handshake phase. All durations are in
+/// microseconds and are measured from the moment websocket client is accepted.
+typedef struct pomelo_webrtc_handshake_phase_stats_s {
+    /// @brief Number of handshakes which have reached this phase
+    uint64_t count;
+
+    /// @brief Approximate minimum duration
+    uint64_t min_us;
+
+    /// @brief Mean duration
+    uint64_t mean_us;
+
+    /// @brief Median duration
+    uint64_t p50_us;
+
+    /// @brief 90th percentile of duration
+    uint64_t p90_us;
+
+    /// @brief 99th percentile of duration
+    uint64_t p99_us;
+
+    /// @brief 99.9th percentile of duration
+    uint64_t p999_us;
+
+    /// @brief Maximum duration
+    uint64_t max_us;
+
+    /// @brief Number of handshakes which failed after reaching this phase
+    uint64_t failed;
+
+    /// @brief Number of handshakes which timed out after reaching this phase
+    uint64_t timeout;
+} pomelo_webrtc_handshake_phase_stats_t;
+
+
+/// @brief Number of plugin objects which are currently in use. These are
+/// sampled from atomic counters, so they can be read from any thread.
+typedef struct pomelo_webrtc_resource_stats_s {
+    /// @brief Running sockets
+    uint64_t sockets;
+
+    /// @brief Websocket clients which have not been authenticated yet
+    uint64_t preauths;
+
+    /// @brief Sessions, including the ones which are still connecting
+    uint64_t sessions;
+
+    /// @brief Channels of all sessions
+    uint64_t channels;
+
+    /// @brief String buffers which are being used for signaling messages
+    uint64_t string_buffers;
+
+    /// @brief Received messages which are waiting for the executor
+    uint64_t recv_commands;
+
+    /// @brief Outgoing messages which are waiting for send pacing
+    uint64_t pacer_entries;
+} pomelo_webrtc_resource_stats_t;
+
+
+/// @brief Distribution of a measured value
+typedef struct pomelo_webrtc_distribution_s {
+    /// @brief Number of samples
+    uint64_t count;
+
+    /// @brief Mean value
+    uint64_t mean;
+
+    /// @brief Median value
+    uint64_t p50;
+
+    /// @brief 90th percentile
+    uint64_t p90;
+
+    /// @brief 99th percentile
+    uint64_t p99;
+
+    /// @brief 99.9th percentile
+    uint64_t p999;
+
+    /// @brief Maximum value
+    uint64_t max;
+} pomelo_webrtc_distribution_t;
+
+
+/// @brief Health of the plugin loop. Distributions are collected since the
+/// last reset, gauges are sampled at the moment of query.
+typedef struct pomelo_webrtc_loop_stats_s {
+    /// @brief Current lag of loop (us). It is the smoothed busy time of loop
+    /// iterations, or the duration of the running iteration if it is longer.
+    uint64_t lag_us;
+
+    /// @brief Tasks which have been submitted but have not run yet
+    uint64_t queue_depth;
+
+    /// @brief The highest queue depth
+    uint64_t queue_depth_max;
+
+    /// @brief Time which loop iterations spend outside of waiting (us)
+    pomelo_webrtc_distribution_t busy_us;
+
+    /// @brief Duration of loop iterations, including waiting (us)
+    pomelo_webrtc_distribution_t iteration_us;
+
+    /// @brief Time from submitting a task to running it (us)
+    pomelo_webrtc_distribution_t task_latency_us;
+
+    /// @brief Number of tasks which are run per drain of the task queue
+    pomelo_webrtc_distribution_t tasks_per_drain;
+} pomelo_webrtc_loop_stats_t;
+
+
+/// @brief Counters of admission control at websocket accept. Rejected clients
+/// are closed before any pre-auth record, session or peer connection is
+/// created for them.
+typedef struct pomelo_webrtc_admission_stats_s {
+    /// @brief Handshakes which have been admitted and have not finished yet
+    uint64_t pending;
+
+    /// @brief Admitted websocket clients
+    uint64_t accepted;
+
+    /// @brief Clients rejected by the accept rate limit
+    uint64_t rejected_rate;
+
+    /// @brief Clients rejected because the plugin loop was lagging
+    uint64_t rejected_loop_lag;
+
+    /// @brief Clients rejected by the pending handshakes limit
+    uint64_t rejected_pending;
+
+    /// @brief Clients rejected by the sessions limit
+    uint64_t rejected_sessions;
+
+    /// @brief Clients rejected by the pending handshakes limit of their source
+    /// address
+    uint64_t rejected_source;
+} pomelo_webrtc_admission_stats_t;
+
+
+/// @brief Traffic counters of a channel, a session or the whole plugin
+typedef struct pomelo_webrtc_traffic_stats_s {
+    /// @brief Received messages
+    uint64_t messages_in;
+
+    /// @brief Received bytes
+    uint64_t bytes_in;
+
+    /// @brief Sent messages
+    uint64_t messages_out;
+
+    /// @brief Sent bytes
+    uint64_t bytes_out;
+
+    /// @brief Received messages which have been dropped before reaching the
+    /// native session
+    uint64_t recv_dropped;
+
+    /// @brief Outgoing messages which have been dropped before reaching the
+    /// data channel
+    uint64_t send_dropped;
+
+    /// @brief Outgoing messages which have been rejected by the data channel
+    uint64_t send_failed;
+} pomelo_webrtc_traffic_stats_t;
+
+
+/// @brief Transport statistics of the peer connection of a session. They are
+/// sampled periodically, so they may lag behind by a second.
+typedef struct pomelo_webrtc_transport_stats_s {
+    /// @brief Round trip time measured by SCTP (us), zero if not available
+    uint64_t rtt_us;
+
+    /// @brief Bytes sent through the transport, including all overheads
+    uint64_t bytes_sent;
+
+    /// @brief Bytes received through the transport, including all overheads
+    uint64_t bytes_received;
+
+    /// @brief Type of local candidate of the selected pair
+    pomelo_webrtc_candidate_type local_candidate;
+
+    /// @brief Type of remote candidate of the selected pair. It is relayed
+    /// when the client is reached through a TURN server.
+    pomelo_webrtc_candidate_type remote_candidate;
+} pomelo_webrtc_transport_stats_t;
+
+
+/// @brief Round trip time of a session, measured by the pings of system
+/// channel. The minimum and percentiles cover the recent few seconds.
+typedef struct pomelo_webrtc_rtt_stats_s {
+    /// @brief Smoothed mean (us), the same value as the native session has
+    uint64_t mean_us;
+
+    /// @brief The latest sample (us)
+    uint64_t last_us;
+
+    /// @brief Minimum of the recent samples (us)
+    uint64_t min_us;
+
+    /// @brief Median of the recent samples (us)
+    uint64_t p50_us;
+
+    /// @brief 95th percentile of the recent samples (us)
+    uint64_t p95_us;
+
+    /// @brief Interarrival jitter as in RFC 3550 (us)
+    uint64_t jitter_us;
+
+    /// @brief Number of recent samples, zero if no pong has been received
+    uint64_t samples;
+} pomelo_webrtc_rtt_stats_t;
+
+
+/// @brief Message loss of a session. Uplink loss is measured on the pings of
+/// client and, with the "seq" feature, on the non-reliable channels. Downlink
+/// loss is reported by clients which have negotiated the "seq" feature.
+typedef struct pomelo_webrtc_loss_stats_s {
+    /// @brief Loss of messages from client in the last second (ppm)
+    uint64_t uplink_loss_ppm;
+
+    /// @brief Loss of messages to client in the last report (ppm)
+    uint64_t downlink_loss_ppm;
+
+    /// @brief Total number of expected messages from client
+    uint64_t uplink_expected;
+
+    /// @brief Total number of lost messages from client
+    uint64_t uplink_lost;
+} pomelo_webrtc_loss_stats_t;
+
+
+/// @brief Clock of the client of a session, estimated from the client time
+/// carried by pongs. The client clock equals the socket time plus the offset.
+typedef struct pomelo_webrtc_clock_stats_s {
+    /// @brief Offset of client clock from the socket time (us)
+    int64_t offset_us;
+
+    /// @brief Drift of client clock relative to the socket time (ns/s)
+    int64_t skew_ppb;
+
+    /// @brief The offset is accurate within plus or minus this value (us).
+    /// It is half of the lowest RTT in the recent samples.
+    uint64_t offset_error_us;
+
+    /// @brief Estimated delay from server to client (us)
+    uint64_t forward_delay_us;
+
+    /// @brief Estimated delay from client to server (us)
+    uint64_t backward_delay_us;
+
+    /// @brief Number of samples which the estimate is based on, zero if
+    /// there is no estimate yet
+    uint64_t samples;
+} pomelo_webrtc_clock_stats_t;
+
 
 /* -------------------------------------------------------------------------- */
 /*                               PLugin APIs                                  */
@@ -80,12 +423,148 @@ void POMELO_PLUGIN_CALL pomelo_webrtc_on_unload(pomelo_plugin_t * plugin);
 /*                               Public APIs                                  */
 /* -------------------------------------------------------------------------- */
 
-/// @brief Log a message
+/// @brief Log a message at info level
 void pomelo_webrtc_log(const char * format, ...);
 
-/// @brief Log a message in debugging mode
+/// @brief Log a message at debug level
 void pomelo_webrtc_log_debug(const char * format, ...);
 
+
+/// @brief Change the logging level of plugin and libdatachannel at runtime
+/// @return 0 on success, or -1 if the plugin is not loaded
+int pomelo_webrtc_set_log_level(
+    pomelo_plugin_t * plugin,
+    pomelo_webrtc_log_level level
+);
+
+
+/// @brief Get the handshake statistic of a phase.
+/// @return 0 on success, or -1 if the plugin is not loaded or phase is invalid
+int pomelo_webrtc_get_handshake_stats(
+    pomelo_plugin_t * plugin,
+    pomelo_webrtc_handshake_phase phase,
+    pomelo_webrtc_handshake_phase_stats_t * stats
+);
+
+
+/// @brief Get the number of plugin objects which are currently in use
+/// @return 0 on success, or -1 if the plugin is not loaded
+int pomelo_webrtc_get_resource_stats(
+    pomelo_plugin_t * plugin,
+    pomelo_webrtc_resource_stats_t * stats
+);
+
+
+/// @brief Get the health of plugin loop
+/// @return 0 on success, or -1 if the plugin is not loaded
+int pomelo_webrtc_get_loop_stats(
+    pomelo_plugin_t * plugin,
+    pomelo_webrtc_loop_stats_t * stats
+);
+
+
+/// @brief Reset the distributions and the highest queue depth of plugin loop.
+/// Samples which are recorded at the same time may be lost.
+/// @return 0 on success, or -1 if the plugin is not loaded
+int pomelo_webrtc_reset_loop_stats(pomelo_plugin_t * plugin);
+
+
+/// @brief Get the counters of admission control
+/// @return 0 on success, or -1 if the plugin is not loaded
+int pomelo_webrtc_get_admission_stats(
+    pomelo_plugin_t * plugin,
+    pomelo_webrtc_admission_stats_t * stats
+);
+
+
+/// @brief Get the traffic of all sessions since the plugin has been loaded,
+/// including the closed ones
+/// @return 0 on success, or -1 if the plugin is not loaded
+int pomelo_webrtc_get_traffic_stats(
+    pomelo_plugin_t * plugin,
+    pomelo_webrtc_traffic_stats_t * stats
+);
+
+
+/// @brief Get the traffic of a session. It is the sum of all its channels,
+/// including the system channel.
+/// @return 0 on success, or -1 if the session does not belong to the plugin
+int pomelo_webrtc_session_get_stats(
+    pomelo_plugin_t * plugin,
+    pomelo_session_t * native_session,
+    pomelo_webrtc_traffic_stats_t * stats
+);
+
+
+/// @brief Get the traffic of a channel of session
+/// @return 0 on success, or -1 if the session does not belong to the plugin
+/// or the channel index is invalid
+int pomelo_webrtc_channel_get_stats(
+    pomelo_plugin_t * plugin,
+    pomelo_session_t * native_session,
+    size_t channel_index,
+    pomelo_webrtc_traffic_stats_t * stats
+);
+
+
+/// @brief Get the transport statistics of a session
+/// @return 0 on success, or -1 if the session does not belong to the plugin
+int pomelo_webrtc_session_get_transport_stats(
+    pomelo_plugin_t * plugin,
+    pomelo_session_t * native_session,
+    pomelo_webrtc_transport_stats_t * stats
+);
+
+
+/// @brief Get the RTT statistics of a session
+/// @return 0 on success, or -1 if the session does not belong to the plugin
+int pomelo_webrtc_session_get_rtt_stats(
+    pomelo_plugin_t * plugin,
+    pomelo_session_t * native_session,
+    pomelo_webrtc_rtt_stats_t * stats
+);
+
+
+/// @brief Get the message loss of a session
+/// @return 0 on success, or -1 if the session does not belong to the plugin
+int pomelo_webrtc_session_get_loss_stats(
+    pomelo_plugin_t * plugin,
+    pomelo_session_t * native_session,
+    pomelo_webrtc_loss_stats_t * stats
+);
+
+
+/// @brief Get the estimated clock offset and one-way delays of a session
+/// @return 0 on success, or -1 if the session does not belong to the plugin
+int pomelo_webrtc_session_get_clock_stats(
+    pomelo_plugin_t * plugin,
+    pomelo_session_t * native_session,
+    pomelo_webrtc_clock_stats_t * stats
+);
+
+
+/// @brief Set the preshared compression dictionary of a channel. The data is
+/// copied and applied in the plugin thread, it only affects the sessions
+/// which are created after that. Clients must use the same dictionary.
+/// @param data The dictionary, or NULL to remove it
+/// @return 0 on success, or -1 if the plugin is not loaded or on failure
+int pomelo_webrtc_set_channel_dictionary(
+    pomelo_plugin_t * plugin,
+    size_t channel_index,
+    const uint8_t * data,
+    size_t size
+);
+
+
+/// @brief Replace the configuration of plugin. The configuration is copied and
+/// applied in the plugin thread, it only affects the sessions which are
+/// created after that.
+/// @return 0 on success, or -1 if the plugin is not loaded or on failure
+int pomelo_webrtc_set_config(
+    pomelo_plugin_t * plugin,
+    const pomelo_webrtc_config_t * config
+);
+
 #ifdef __cplusplus
 }
 #endif
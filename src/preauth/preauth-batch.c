@@ -0,0 +1,130 @@
+#include <assert.h>
+#include <string.h>
+#include "utils/common-macro.h"
+#include "context.h"
+#include "preauth-batch.h"
+
+
+static void pomelo_webrtc_preauth_batch_flush_task(
+    size_t argc,
+    pomelo_webrtc_variant_t * args
+) {
+    assert(argc == 1);
+    assert(args != NULL);
+    pomelo_webrtc_preauth_batch_flush(args[0].ptr);
+}
+
+
+/* -------------------------------------------------------------------------- */
+/*                               Module APIs                                  */
+/* -------------------------------------------------------------------------- */
+
+int pomelo_webrtc_preauth_batch_submit(
+    pomelo_webrtc_context_t * context,
+    pomelo_webrtc_preauth_t * preauth
+) {
+    assert(context != NULL);
+    assert(preauth != NULL);
+
+    pomelo_webrtc_auth_batch_t * batch = context->auth_batch;
+    if (!batch) {
+        batch = pomelo_pool_acquire(context->auth_batch_pool, NULL);
+        if (!batch) return -1; // Failed to acquire new batch
+
+        batch->context = context;
+        batch->size = 0;
+
+        // The flush task is queued behind all the pending tasks, so that all
+        // AUTH messages of this loop iteration will join this batch.
+        pomelo_webrtc_variant_t args[] = {{ .ptr = context }};
+        pomelo_webrtc_task_t * task = pomelo_webrtc_context_submit_task(
+            context,
+            pomelo_webrtc_preauth_batch_flush_task,
+            POMELO_ARRAY_LENGTH(args),
+            args
+        );
+        if (!task) {
+            pomelo_pool_release(context->auth_batch_pool, batch);
+            return -1;
+        }
+
+        context->auth_batch = batch;
+    }
+
+    batch->preauths[batch->size++] = preauth;
+    if (batch->size == POMELO_WEBRTC_AUTH_BATCH_CAPACITY) {
+        // Batch is full, flush it now
+        pomelo_webrtc_preauth_batch_flush(context);
+    }
+
+    return 0;
+}
+
+
+void pomelo_webrtc_preauth_batch_flush(pomelo_webrtc_context_t * context) {
+    assert(context != NULL);
+
+    pomelo_webrtc_auth_batch_t * batch = context->auth_batch;
+    if (!batch) {
+        return; // Nothing to flush
+    }
+    context->auth_batch = NULL;
+
+    // All records are rejected unless the worker verifies them. If the task
+    // is cancelled or cannot be spawned, the batch is done as failed.
+    for (size_t i = 0; i < batch->size; i++) {
+        batch->preauths[i]->auth_result = -1;
+    }
+
+    pomelo_webrtc_variant_t args[] = {{ .ptr = batch }};
+    pomelo_webrtc_task_t * task = pomelo_webrtc_context_spawn_task(
+        context,
+        pomelo_webrtc_preauth_batch_process,
+        pomelo_webrtc_preauth_batch_done,
+        POMELO_ARRAY_LENGTH(args),
+        args
+    );
+    if (!task) {
+        // Failed to spawn worker task
+        pomelo_webrtc_preauth_batch_done(POMELO_ARRAY_LENGTH(args), args);
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+/*                                Private APIs                                */
+/* -------------------------------------------------------------------------- */
+
+void pomelo_webrtc_preauth_batch_process(
+    size_t argc,
+    pomelo_webrtc_variant_t * args
+) {
+    assert(argc == 1);
+    assert(args != NULL);
+
+    pomelo_webrtc_auth_batch_t * batch = args[0].ptr;
+    for (size_t i = 0; i < batch->size; i++) {
+        pomelo_webrtc_preauth_verify(batch->preauths[i]);
+    }
+}
+
+
+void pomelo_webrtc_preauth_batch_done(
+    size_t argc,
+    pomelo_webrtc_variant_t * args
+) {
+    assert(argc == 1);
+    assert(args != NULL);
+
+    pomelo_webrtc_auth_batch_t * batch = args[0].ptr;
+    pomelo_webrtc_context_t * context = batch->context;
+
+    for (size_t i = 0; i < batch->size; i++) {
+        pomelo_webrtc_preauth_t * preauth = batch->preauths[i];
+        pomelo_webrtc_preauth_on_auth_verified(preauth);
+        pomelo_webrtc_preauth_unref(preauth); // Batch no longer references it
+    }
+
+    batch->size = 0;
+    pomelo_pool_release(context->auth_batch_pool, batch);
+}
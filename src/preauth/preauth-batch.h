@@ -0,0 +1,68 @@
+#ifndef POMELO_PLUGIN_WEBRTC_PREAUTH_BATCH_H
+#define POMELO_PLUGIN_WEBRTC_PREAUTH_BATCH_H
+#include "preauth.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Connect tokens are verified in worker threads, so that the decoding (base64
+    and AEAD decryption) will not block the event loop. All the AUTH messages
+    which arrive in the same loop iteration are collected into one batch and
+    verified by a single worker task.
+*/
+
+/// Maximum number of records in one batch
+#define POMELO_WEBRTC_AUTH_BATCH_CAPACITY 64
+
+
+struct pomelo_webrtc_auth_batch_s {
+    /// @brief Context
+    pomelo_webrtc_context_t * context;
+
+    /// @brief Number of records in this batch
+    size_t size;
+
+    /// @brief Records to verify
+    pomelo_webrtc_preauth_t * preauths[POMELO_WEBRTC_AUTH_BATCH_CAPACITY];
+};
+
+
+/* -------------------------------------------------------------------------- */
+/*                               Module APIs                                  */
+/* -------------------------------------------------------------------------- */
+
+/// @brief Add a record to the current batch. The batch will be flushed at the
+/// end of current loop iteration or when it is full.
+int pomelo_webrtc_preauth_batch_submit(
+    pomelo_webrtc_context_t * context,
+    pomelo_webrtc_preauth_t * preauth
+);
+
+
+/// @brief Send the current batch to worker thread
+void pomelo_webrtc_preauth_batch_flush(pomelo_webrtc_context_t * context);
+
+
+/* -------------------------------------------------------------------------- */
+/*                                Private APIs                                */
+/* -------------------------------------------------------------------------- */
+
+/// @brief Verify all records of batch. This is called in worker thread.
+void pomelo_webrtc_preauth_batch_process(
+    size_t argc,
+    pomelo_webrtc_variant_t * args
+);
+
+
+/// @brief Dispatch the results of batch. This is called in main thread.
+void pomelo_webrtc_preauth_batch_done(
+    size_t argc,
+    pomelo_webrtc_variant_t * args
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // POMELO_PLUGIN_WEBRTC_PREAUTH_BATCH_H
@@ -0,0 +1,484 @@
+#include <assert.h>
+#include <string.h>
+#include "pomelo/constants.h"
+#include "pomelo/base64.h"
+#include "utils/common-macro.h"
+#include "context.h"
+#include "session/session-ws.h"
+#include "socket/socket-int.h"
+#include "preauth-batch.h"
+#include "preauth.h"
+
+
+#define POMELO_CONNECT_TOKEN_BASE64_LENGTH                                     \
+(pomelo_base64_calc_encoded_length(POMELO_CONNECT_TOKEN_BYTES) - 1)
+
+#define POMELO_CONNECT_TOKEN_BASE64_NO_PADDING_LENGTH                          \
+(pomelo_base64_calc_encoded_no_padding_length(POMELO_CONNECT_TOKEN_BYTES) - 1)
+
+/// Compare head of message with opcode
+#define opcode_cmp(message, opcode)                                            \
+    (memcmp((message), (opcode), sizeof(opcode) - 1) == 0)
+
+
+/// Mark a handshake phase of record as reached
+#define pomelo_webrtc_preauth_mark_phase(preauth, phase)                       \
+pomelo_webrtc_handshake_stats_mark(                                            \
+    &(preauth)->context->handshake_stats, &(preauth)->handshake, (phase)       \
+)
+
+/// Report the handshake result of record
+#define pomelo_webrtc_preauth_finish_handshake(preauth, result)                \
+pomelo_webrtc_context_finish_handshake(                                        \
+    (preauth)->context, &(preauth)->handshake, (result)                        \
+)
+
+
+#define pomelo_webrtc_preauth_is_active(preauth)                               \
+POMELO_CHECK_FLAG((preauth)->flags, POMELO_WEBRTC_PREAUTH_FLAG_ACTIVE)
+
+#define pomelo_webrtc_preauth_set_active(preauth)                              \
+POMELO_SET_FLAG((preauth)->flags, POMELO_WEBRTC_PREAUTH_FLAG_ACTIVE)
+
+#define pomelo_webrtc_preauth_unset_active(preauth)                            \
+POMELO_UNSET_FLAG((preauth)->flags, POMELO_WEBRTC_PREAUTH_FLAG_ACTIVE)
+
+
+/* -------------------------------------------------------------------------- */
+/*                               Public APIs                                  */
+/* -------------------------------------------------------------------------- */
+
+int pomelo_webrtc_preauth_on_alloc(
+    pomelo_webrtc_preauth_t * preauth,
+    pomelo_webrtc_context_t * context
+) {
+    assert(preauth != NULL);
+    assert(context != NULL);
+    preauth->ws_owner = POMELO_WEBRTC_WS_OWNER_PREAUTH;
+    preauth->context = context;
+    return 0;
+}
+
+
+void pomelo_webrtc_preauth_on_free(pomelo_webrtc_preauth_t * preauth) {
+    assert(preauth != NULL);
+    preauth->context = NULL;
+}
+
+
+int pomelo_webrtc_preauth_init(
+    pomelo_webrtc_preauth_t * preauth,
+    pomelo_webrtc_preauth_info_t * info
+) {
+    assert(preauth != NULL);
+    assert(info != NULL);
+
+    // Initialize reference
+    pomelo_reference_init(
+        &preauth->ref,
+        (pomelo_ref_finalize_cb) pomelo_webrtc_preauth_on_finalize
+    );
+
+    preauth->socket = info->socket;
+    pomelo_webrtc_preauth_set_active(preauth);
+
+    // Start tracking the handshake
+    pomelo_webrtc_handshake_stats_begin(
+        &preauth->context->handshake_stats,
+        &preauth->handshake
+    );
+
+    // New record references the socket
+    pomelo_webrtc_socket_ref(info->socket);
+
+    // Schedule for authenticating
+    pomelo_webrtc_variant_t args[] = {{ .ptr = preauth }};
+    preauth->task_timeout = pomelo_webrtc_context_schedule_task(
+        preauth->context,
+        pomelo_webrtc_preauth_on_timeout,
+        POMELO_ARRAY_LENGTH(args),
+        args,
+        POMELO_AUTH_TIMEOUT_MS
+    );
+    if (!preauth->task_timeout) return -1;
+
+    // Take the websocket client
+    preauth->ws_client = info->ws_client;
+    rtc_websocket_client_set_data(info->ws_client, preauth);
+
+    // WSC references the record until WSC is closed
+    pomelo_webrtc_preauth_ref(preauth);
+    return 0;
+}
+
+
+void pomelo_webrtc_preauth_cleanup(pomelo_webrtc_preauth_t * preauth) {
+    assert(preauth != NULL);
+
+    if (preauth->task_timeout) {
+        pomelo_webrtc_context_unschedule_task(
+            preauth->context,
+            preauth->task_timeout
+        );
+        preauth->task_timeout = NULL;
+    }
+
+    if (preauth->ws_client) {
+        rtc_websocket_client_destroy(preauth->ws_client);
+        preauth->ws_client = NULL;
+    }
+
+    // This record no longer references the socket
+    if (preauth->socket) {
+        pomelo_webrtc_socket_unref(preauth->socket);
+        preauth->socket = NULL;
+    }
+
+    pomelo_webrtc_preauth_release_auth(preauth);
+
+    // No-op if the result has been reported
+    pomelo_webrtc_preauth_finish_handshake(
+        preauth,
+        POMELO_WEBRTC_HANDSHAKE_RESULT_FAILED
+    );
+
+    preauth->flags = 0;
+    preauth->list_entry = NULL;
+    preauth->auth_result = 0;
+    preauth->client_id = 0;
+    preauth->connect_timeout = 0;
+    preauth->features = 0;
+}
+
+
+void pomelo_webrtc_preauth_close(pomelo_webrtc_preauth_t * preauth) {
+    assert(preauth != NULL);
+    if (!pomelo_webrtc_preauth_is_active(preauth)) {
+        return; // Record is deactivated
+    }
+    pomelo_webrtc_preauth_unset_active(preauth);
+
+    // No-op if the result has been reported
+    pomelo_webrtc_preauth_finish_handshake(
+        preauth,
+        POMELO_WEBRTC_HANDSHAKE_RESULT_FAILED
+    );
+
+    if (preauth->task_timeout) {
+        pomelo_webrtc_context_unschedule_task(
+            preauth->context,
+            preauth->task_timeout
+        );
+        preauth->task_timeout = NULL;
+    }
+
+    // Remove this record from socket
+    pomelo_webrtc_socket_remove_preauth(preauth->socket, preauth);
+
+    if (preauth->ws_client) {
+        rtc_websocket_client_close(preauth->ws_client);
+        // => pomelo_webrtc_preauth_ws_on_closed
+    }
+
+    // Finally, unref itself
+    pomelo_webrtc_preauth_unref(preauth);
+}
+
+
+void pomelo_webrtc_preauth_ref(pomelo_webrtc_preauth_t * preauth) {
+    assert(preauth != NULL);
+    pomelo_reference_ref(&preauth->ref);
+}
+
+
+void pomelo_webrtc_preauth_unref(pomelo_webrtc_preauth_t * preauth) {
+    assert(preauth != NULL);
+    pomelo_reference_unref(&preauth->ref);
+}
+
+
+void pomelo_webrtc_preauth_ws_process_message(
+    pomelo_webrtc_preauth_t * preauth,
+    rtc_buffer_t * message
+) {
+    assert(preauth != NULL);
+    assert(message != NULL);
+
+    if (!pomelo_webrtc_preauth_is_active(preauth)) {
+        return; // Record is deactivated
+    }
+
+    if (POMELO_CHECK_FLAG(
+        preauth->flags,
+        POMELO_WEBRTC_PREAUTH_FLAG_AUTHENTICATING
+    )) {
+        return; // Only one AUTH message is accepted
+    }
+
+    size_t size = rtc_buffer_size(message);
+    const char * data = (const char *) rtc_buffer_data(message);
+    if (size == 0) {
+        return;
+    }
+
+    // Ignore the terminated character
+    size_t message_length = size - 1;
+    if (message_length <= sizeof(OPCODE_AUTH)) {
+        return;
+    }
+
+    if (!opcode_cmp(data, OPCODE_AUTH)) {
+        return;
+    }
+
+    // Format: AUTH|<token>[|<features>]
+    const char * auth = data + sizeof(OPCODE_AUTH); // Ingore separator
+    size_t auth_length = message_length - sizeof(OPCODE_AUTH);
+    const char * separator = memchr(auth, MESSAGE_SEPARATOR, auth_length);
+    if (separator) {
+        const char * features = separator + 1;
+        preauth->features = pomelo_webrtc_ws_parse_features(
+            features,
+            auth_length - (features - auth)
+        );
+        auth_length = separator - auth;
+    }
+
+    pomelo_webrtc_preauth_recv_auth(preauth, message, auth, auth_length);
+}
+
+
+void pomelo_webrtc_preauth_ws_on_closed(pomelo_webrtc_preauth_t * preauth) {
+    assert(preauth != NULL);
+
+    pomelo_webrtc_preauth_close(preauth);
+    pomelo_webrtc_preauth_unref(preauth); // WS no longer references record
+}
+
+
+/* -------------------------------------------------------------------------- */
+/*                               Module APIs                                  */
+/* -------------------------------------------------------------------------- */
+
+void pomelo_webrtc_preauth_verify(pomelo_webrtc_preauth_t * preauth) {
+    assert(preauth != NULL);
+
+    // Convert message from base64
+    int ret = pomelo_base64_decode(
+        preauth->connect_token,
+        POMELO_CONNECT_TOKEN_BYTES,
+        preauth->auth,
+        preauth->auth_length
+    );
+    if (ret < 0) {
+        // Failed to decode connect token
+        preauth->auth_result = -1;
+        return;
+    }
+
+    // Decode the connect token. This runs in a worker thread, so the native
+    // decoder must only read the immutable state of socket (its private key
+    // and protocol ID) and must not touch anything owned by the native loop.
+    pomelo_plugin_t * plugin = preauth->context->plugin;
+    pomelo_plugin_token_info_t info = { 0 };
+    info.client_id = &preauth->client_id;
+    info.timeout = &preauth->connect_timeout;
+
+    preauth->auth_result = plugin->connect_token_decode(
+        plugin,
+        preauth->socket->native_socket,
+        preauth->connect_token,
+        &info
+    );
+}
+
+
+void pomelo_webrtc_preauth_on_auth_verified(pomelo_webrtc_preauth_t * preauth) {
+    assert(preauth != NULL);
+    pomelo_webrtc_preauth_release_auth(preauth);
+
+    if (!pomelo_webrtc_preauth_is_active(preauth)) {
+        return; // Record has been closed while verifying
+    }
+
+    if (preauth->auth_result < 0) {
+        pomelo_webrtc_preauth_on_auth_result(preauth, NULL);
+        return;
+    }
+
+    pomelo_webrtc_preauth_mark_phase(
+        preauth,
+        POMELO_WEBRTC_HANDSHAKE_PHASE_TOKEN_DECODED
+    );
+
+    pomelo_plugin_token_info_t info = { 0 };
+    info.client_id = &preauth->client_id;
+    info.timeout = &preauth->connect_timeout;
+    pomelo_webrtc_preauth_on_auth_result(preauth, &info);
+}
+
+
+/* -------------------------------------------------------------------------- */
+/*                                Private APIs                                */
+/* -------------------------------------------------------------------------- */
+
+void pomelo_webrtc_preauth_recv_auth(
+    pomelo_webrtc_preauth_t * preauth,
+    rtc_buffer_t * message,
+    const char * auth,
+    size_t auth_length
+) {
+    assert(preauth != NULL);
+    assert(message != NULL);
+    assert(auth != NULL);
+
+    pomelo_webrtc_preauth_mark_phase(
+        preauth,
+        POMELO_WEBRTC_HANDSHAKE_PHASE_AUTH_RECEIVED
+    );
+
+    if (
+        auth_length != POMELO_CONNECT_TOKEN_BASE64_LENGTH &&
+        auth_length != POMELO_CONNECT_TOKEN_BASE64_NO_PADDING_LENGTH
+    ) {
+        // Invalid auth token
+        pomelo_webrtc_preauth_on_auth_result(preauth, NULL);
+        return;
+    }
+
+    pomelo_webrtc_context_t * context = preauth->context;
+    assert(context != NULL);
+
+    preauth->connect_token =
+        pomelo_pool_acquire(context->connect_token_pool, NULL);
+    if (!preauth->connect_token) {
+        // Failed to acquire connect token buffer
+        pomelo_webrtc_preauth_on_auth_result(preauth, NULL);
+        return;
+    }
+
+    // Keep the message until the token has been verified
+    rtc_buffer_ref(message);
+    preauth->auth_message = message;
+    preauth->auth = auth;
+    preauth->auth_length = auth_length;
+    POMELO_SET_FLAG(preauth->flags, POMELO_WEBRTC_PREAUTH_FLAG_AUTHENTICATING);
+
+    // The batch references this record until verifying is done
+    pomelo_webrtc_preauth_ref(preauth);
+    int ret = pomelo_webrtc_preauth_batch_submit(context, preauth);
+    if (ret < 0) {
+        pomelo_webrtc_preauth_unref(preauth);
+        pomelo_webrtc_preauth_release_auth(preauth);
+        pomelo_webrtc_preauth_on_auth_result(preauth, NULL);
+        return;
+    }
+    // => pomelo_webrtc_preauth_on_auth_verified
+}
+
+
+void pomelo_webrtc_preauth_release_auth(pomelo_webrtc_preauth_t * preauth) {
+    assert(preauth != NULL);
+
+    if (preauth->connect_token) {
+        pomelo_pool_release(
+            preauth->context->connect_token_pool,
+            preauth->connect_token
+        );
+        preauth->connect_token = NULL;
+    }
+
+    if (preauth->auth_message) {
+        rtc_buffer_unref(preauth->auth_message);
+        preauth->auth_message = NULL;
+    }
+
+    preauth->auth = NULL;
+    preauth->auth_length = 0;
+}
+
+
+void pomelo_webrtc_preauth_on_auth_result(
+    pomelo_webrtc_preauth_t * preauth,
+    pomelo_plugin_token_info_t * info
+) {
+    assert(preauth != NULL);
+
+    if (!info) {
+        // Authenticating failed
+        rtc_websocket_client_send_binary(
+            preauth->ws_client,
+            (const uint8_t *) RESULT_AUTH_FAILED,
+            sizeof(RESULT_AUTH_FAILED) - 1
+        );
+        pomelo_webrtc_preauth_close(preauth);
+        return;
+    }
+
+    // Now the client is trusted, create the full session
+    pomelo_webrtc_session_info_t session_info = {
+        .socket = preauth->socket,
+        .ws_client = preauth->ws_client,
+        .client_id = *info->client_id,
+        .connect_timeout = *info->timeout,
+        .handshake = &preauth->handshake,
+        .features = preauth->features
+    };
+    pomelo_webrtc_session_t * session =
+        pomelo_webrtc_socket_create_session(preauth->socket, &session_info);
+
+    if (rtc_websocket_client_get_data(preauth->ws_client) != preauth) {
+        // The ownership of WS has been transferred to the session. The WS
+        // reference of this record is released here because this record will
+        // not receive the closed event of WS anymore.
+        preauth->ws_client = NULL;
+        pomelo_webrtc_preauth_unref(preauth);
+    } else if (!session) {
+        // Failed to create the session, the client is still waiting for the
+        // result
+        rtc_websocket_client_send_binary(
+            preauth->ws_client,
+            (const uint8_t *) RESULT_AUTH_FAILED,
+            sizeof(RESULT_AUTH_FAILED) - 1
+        );
+    }
+
+    // The record has completed its job
+    pomelo_webrtc_preauth_close(preauth);
+
+    if (session) {
+        // => Negotiating
+        pomelo_webrtc_session_start(session);
+    }
+}
+
+
+void pomelo_webrtc_preauth_on_timeout(
+    size_t argc,
+    pomelo_webrtc_variant_t * args
+) {
+    assert(argc == 1);
+    assert(args != NULL);
+
+    pomelo_webrtc_preauth_t * preauth = args[0].ptr;
+    assert(preauth != NULL);
+
+    pomelo_webrtc_context_unschedule_task(
+        preauth->context,
+        preauth->task_timeout
+    );
+    preauth->task_timeout = NULL;
+
+    pomelo_webrtc_preauth_finish_handshake(
+        preauth,
+        POMELO_WEBRTC_HANDSHAKE_RESULT_TIMEOUT
+    );
+    pomelo_webrtc_preauth_close(preauth);
+}
+
+
+void pomelo_webrtc_preauth_on_finalize(pomelo_webrtc_preauth_t * preauth) {
+    assert(preauth != NULL);
+    // Release the record
+    pomelo_webrtc_context_release_preauth(preauth->context, preauth);
+}
@@ -0,0 +1,193 @@
+#ifndef POMELO_PLUGIN_WEBRTC_PREAUTH_H
+#define POMELO_PLUGIN_WEBRTC_PREAUTH_H
+#include "rtc-api/rtc-api.h"
+#include "plugin.h"
+#include "base/ref.h"
+#include "utils/list.h"
+#include "stats/handshake-stats.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Pre-authentication record.
+    It only holds the websocket client and the auth timer of a client which has
+    not been authenticated yet. The session (with its peer connection) is only
+    created after the connect token of client has been verified.
+*/
+
+#define POMELO_WEBRTC_PREAUTH_FLAG_ACTIVE         (1 << 0)
+#define POMELO_WEBRTC_PREAUTH_FLAG_AUTHENTICATING (1 << 1)
+
+// Wait for 5 seconds for sending authenticating
+#define POMELO_AUTH_TIMEOUT_MS 5000
+
+
+struct pomelo_webrtc_preauth_info_s {
+    /// @brief Socket
+    pomelo_webrtc_socket_t * socket;
+
+    /// @brief WebSocket client
+    rtc_websocket_client_t * ws_client;
+};
+
+
+struct pomelo_webrtc_preauth_s {
+    /// @brief Kind of websocket owner. This must be the first member.
+    pomelo_webrtc_ws_owner_kind ws_owner;
+
+    /// @brief Reference
+    pomelo_reference_t ref;
+
+    /// @brief Context
+    pomelo_webrtc_context_t * context;
+
+    /// @brief Flags of record
+    uint8_t flags;
+
+    /// @brief Associated socket
+    pomelo_webrtc_socket_t * socket;
+
+    /// @brief Position of this record in pre-auth list of socket
+    pomelo_list_entry_t * list_entry;
+
+    /// @brief WebSocket client. It will be NULL after the ownership of WS has
+    /// been transferred to the session.
+    rtc_websocket_client_t * ws_client;
+
+    /// @brief Auth timeout
+    pomelo_webrtc_task_t * task_timeout;
+
+    /// @brief The AUTH message which is being verified
+    rtc_buffer_t * auth_message;
+
+    /// @brief Base64 connect token inside the AUTH message
+    const char * auth;
+
+    /// @brief Length of base64 connect token
+    size_t auth_length;
+
+    /// @brief Decoded connect token buffer (from connect token pool)
+    uint8_t * connect_token;
+
+    /// @brief Result of verifying, written by worker thread
+    int auth_result;
+
+    /// @brief Client ID from connect token, written by worker thread
+    int64_t client_id;
+
+    /// @brief Connect timeout from connect token, written by worker thread
+    int32_t connect_timeout;
+
+    /// @brief Handshake tracker
+    pomelo_webrtc_handshake_t handshake;
+
+    /// @brief Features requested by client in AUTH message
+    uint32_t features;
+};
+
+
+/* -------------------------------------------------------------------------- */
+/*                               Public APIs                                  */
+/* -------------------------------------------------------------------------- */
+
+/// @brief On alloc the pre-auth record
+int pomelo_webrtc_preauth_on_alloc(
+    pomelo_webrtc_preauth_t * preauth,
+    pomelo_webrtc_context_t * context
+);
+
+
+/// @brief On free the pre-auth record
+void pomelo_webrtc_preauth_on_free(pomelo_webrtc_preauth_t * preauth);
+
+
+/// @brief Initialize the pre-auth record
+int pomelo_webrtc_preauth_init(
+    pomelo_webrtc_preauth_t * preauth,
+    pomelo_webrtc_preauth_info_t * info
+);
+
+
+/// @brief Cleanup the pre-auth record
+void pomelo_webrtc_preauth_cleanup(pomelo_webrtc_preauth_t * preauth);
+
+
+/// @brief Close the pre-auth record and its websocket
+void pomelo_webrtc_preauth_close(pomelo_webrtc_preauth_t * preauth);
+
+
+/// @brief Increase reference counter of pre-auth record
+void pomelo_webrtc_preauth_ref(pomelo_webrtc_preauth_t * preauth);
+
+
+/// @brief Decrease reference counter of pre-auth record
+void pomelo_webrtc_preauth_unref(pomelo_webrtc_preauth_t * preauth);
+
+
+/// @brief Process the websocket message
+void pomelo_webrtc_preauth_ws_process_message(
+    pomelo_webrtc_preauth_t * preauth,
+    rtc_buffer_t * message
+);
+
+
+/// @brief Process when WS is closed
+void pomelo_webrtc_preauth_ws_on_closed(pomelo_webrtc_preauth_t * preauth);
+
+
+/* -------------------------------------------------------------------------- */
+/*                               Module APIs                                  */
+/* -------------------------------------------------------------------------- */
+
+/// @brief Verify the received connect token. This function is called in worker
+/// thread, it only touches the verifying fields of record.
+/// It requires `connect_token_decode` of plugin to be threadsafe: it may run
+/// in several workers at once and alongside the plugin thread.
+void pomelo_webrtc_preauth_verify(pomelo_webrtc_preauth_t * preauth);
+
+
+/// @brief Process when the connect token has been verified in worker thread
+void pomelo_webrtc_preauth_on_auth_verified(pomelo_webrtc_preauth_t * preauth);
+
+
+/* -------------------------------------------------------------------------- */
+/*                                Private APIs                                */
+/* -------------------------------------------------------------------------- */
+
+/// @brief Receive authentication information. The connect token will be
+/// verified in worker thread.
+void pomelo_webrtc_preauth_recv_auth(
+    pomelo_webrtc_preauth_t * preauth,
+    rtc_buffer_t * message,
+    const char * auth,
+    size_t auth_length
+);
+
+
+/// @brief Release the resources which are held while verifying
+void pomelo_webrtc_preauth_release_auth(pomelo_webrtc_preauth_t * preauth);
+
+
+/// @brief Process auth result
+void pomelo_webrtc_preauth_on_auth_result(
+    pomelo_webrtc_preauth_t * preauth,
+    pomelo_plugin_token_info_t * info
+);
+
+
+/// @brief Process auth timeout
+void pomelo_webrtc_preauth_on_timeout(
+    size_t argc,
+    pomelo_webrtc_variant_t * args
+);
+
+
+/// @brief On finalize the pre-auth record
+void pomelo_webrtc_preauth_on_finalize(pomelo_webrtc_preauth_t * preauth);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // POMELO_PLUGIN_WEBRTC_PREAUTH_H
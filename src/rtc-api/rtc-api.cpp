@@ -50,6 +50,12 @@ void * rtc_context_get_data(rtc_context_t * context) {
 }
 
 
+void rtc_context_set_log_level(rtc_context_t * context, rtc_log_level level) {
+    assert(context != nullptr);
+    reinterpret_cast<RTCContext *>(context)->set_log_level(level);
+}
+
+
 /* -------------------------------------------------------------------------- */
 /*                          Websocket Server APIs                             */
 /* -------------------------------------------------------------------------- */
@@ -129,6 +135,39 @@ rtc_context_t * rtc_websocket_server_get_context(rtc_websocket_server_t * wss) {
 /*                          Websocket Client APIs                             */
 /* -------------------------------------------------------------------------- */
 
+void rtc_websocket_client_options_init(
+    rtc_websocket_client_options_t * options
+) {
+    assert(options != nullptr);
+    memset(options, 0, sizeof(rtc_websocket_client_options_t));
+}
+
+
+rtc_websocket_client_t * rtc_websocket_client_create(
+    rtc_websocket_client_options_t * options
+) {
+    assert(options != nullptr);
+    if (!options->context || !options->url) {
+        return nullptr;
+    }
+
+    auto context = reinterpret_cast<RTCContext *>(options->context);
+    auto wsc = context->pool_wsclient->acquire();
+    if (!wsc) {
+        return nullptr;
+    }
+
+    try {
+        wsc->init(options);
+    } catch (std::exception ex) {
+        context->handle_exception(ex);
+        context->pool_wsclient->release(wsc);
+        return nullptr;
+    }
+
+    return reinterpret_cast<rtc_websocket_client_t *>(wsc);
+}
+
 
 void rtc_websocket_client_set_data(rtc_websocket_client_t * wsc, void * data) {
     assert(wsc != nullptr);
@@ -339,6 +378,16 @@ void rtc_peer_connection_add_remote_candidate(
 }
 
 
+int rtc_peer_connection_get_stats(
+    rtc_peer_connection_t * pc,
+    rtc_peer_connection_stats_t * stats
+) {
+    assert(pc != nullptr);
+    assert(stats != nullptr);
+    return reinterpret_cast<RTCPeerConnection *>(pc)->get_stats(stats);
+}
+
+
 rtc_context_t * rtc_peer_connection_get_context(rtc_peer_connection_t * pc) {
     assert(pc != nullptr);
     return reinterpret_cast<rtc_context_t *>(
@@ -429,6 +478,12 @@ const char * rtc_data_channel_get_label(rtc_data_channel_t * dc) {
 }
 
 
+size_t rtc_data_channel_max_message_size(rtc_data_channel_t * dc) {
+    assert(dc != nullptr);
+    return reinterpret_cast<RTCDataChannel *>(dc)->max_message_size();
+}
+
+
 /* -------------------------------------------------------------------------- */
 /*                          Readonly Buffer APIs                              */
 /* -------------------------------------------------------------------------- */
@@ -479,6 +534,12 @@ rtc_buffer_t * rtc_buffer_prepare(
 }
 
 
+void rtc_buffer_truncate(rtc_buffer_t * buffer, size_t size) {
+    assert(buffer != nullptr);
+    reinterpret_cast<RTCBuffer *>(buffer)->truncate(size);
+}
+
+
 rtc_context_t * rtc_buffer_get_context(rtc_context_t * buffer) {
     assert(buffer != nullptr);
     return reinterpret_cast<rtc_context_t *>(
@@ -19,6 +19,13 @@ typedef enum {
 } rtc_peer_connection_state;
 
 
+typedef enum {
+	RTC_GATHERING_STATE_NEW = 0,
+	RTC_GATHERING_STATE_IN_PROGRESS = 1,
+	RTC_GATHERING_STATE_COMPLETE = 2
+} rtc_gathering_state;
+
+
 typedef enum {
 	RTC_CERTIFICATE_TYPE_DEFAULT, // ECDSA
 	RTC_CERTIFICATE_TYPE_ECDSA,
@@ -41,6 +48,26 @@ typedef enum {
     RTC_LOG_LEVEL_VERBOSE
 } rtc_log_level;
 
+
+typedef enum {
+    RTC_CANDIDATE_TYPE_UNKNOWN,
+    RTC_CANDIDATE_TYPE_HOST,
+    RTC_CANDIDATE_TYPE_SERVER_REFLEXIVE,
+    RTC_CANDIDATE_TYPE_PEER_REFLEXIVE,
+    RTC_CANDIDATE_TYPE_RELAYED
+} rtc_candidate_type;
+
+
+typedef enum {
+    RTC_CANDIDATE_TRANSPORT_UNKNOWN,
+    RTC_CANDIDATE_TRANSPORT_UDP,
+    RTC_CANDIDATE_TRANSPORT_TCP
+} rtc_candidate_transport;
+
+
+/// Maximum length of candidate address
+#define RTC_CANDIDATE_ADDRESS_LENGTH 64
+
 typedef struct rtc_websocket_server_s rtc_websocket_server_t;
 typedef struct rtc_websocket_client_s rtc_websocket_client_t;
 typedef struct rtc_peer_connection_s rtc_peer_connection_t;
@@ -49,10 +76,14 @@ typedef struct rtc_buffer_s rtc_buffer_t;
 typedef struct rtc_context_s rtc_context_t;
 
 typedef struct rtc_options_s rtc_options_t;
+typedef struct rtc_sctp_settings_s rtc_sctp_settings_t;
 typedef struct rtc_websocket_server_options_s rtc_websocket_server_options_t;
+typedef struct rtc_websocket_client_options_s rtc_websocket_client_options_t;
 typedef struct rtc_peer_connection_options_s rtc_peer_connection_options_t;
 typedef struct rtc_data_channel_options_s rtc_data_channel_options_t;
 typedef struct rtc_data_channel_reliability_s rtc_data_channel_reliability_t;
+typedef struct rtc_candidate_info_s rtc_candidate_info_t;
+typedef struct rtc_peer_connection_stats_s rtc_peer_connection_stats_t;
 
 typedef void (*rtc_log_callback)(rtc_log_level level, const char * message);
 
@@ -78,6 +109,11 @@ typedef void (*rtc_peer_connection_state_change_callback)(
     rtc_peer_connection_state state
 );
 
+typedef void (*rtc_peer_connection_gathering_state_change_callback)(
+    rtc_peer_connection_t * pc,
+    rtc_gathering_state state
+);
+
 typedef void (*rtc_peer_connection_data_channel_callback)(
     rtc_peer_connection_t * pc,
     rtc_data_channel_t * dc
@@ -116,11 +152,31 @@ typedef void (*rtc_data_channel_message_callback)(
 );
 
 
+struct rtc_sctp_settings_s {
+    int recv_buffer_size;             // in bytes, <= 0 means optimized default
+    int send_buffer_size;             // in bytes, <= 0 means optimized default
+    int max_chunks_on_queue;          // in chunks, <= 0 means optimized default
+    int initial_congestion_window;    // in MTUs, <= 0 means optimized default
+    int max_burst;                    // in MTUs, 0 means optimized default, < 0 means disabled
+    int congestion_control_module;    // 1: HSTCP, 2: H-TCP, 3: RTCC, <= 0 means default (RFC2581)
+    int delayed_sack_time_ms;         // in milliseconds, 0 means optimized default, < 0 means disabled
+    int min_retransmit_timeout_ms;    // in milliseconds, <= 0 means optimized default
+    int max_retransmit_timeout_ms;    // in milliseconds, <= 0 means optimized default
+    int initial_retransmit_timeout_ms;// in milliseconds, <= 0 means optimized default
+    int max_retransmit_attempts;      // number of retransmissions, <= 0 means optimized default
+    int heartbeat_interval_ms;        // in milliseconds, <= 0 means optimized default
+};
+
+
 struct rtc_options_s {
     /* Log settings */
     rtc_log_level log_level;
     rtc_log_callback log_callback;
 
+    /* Global settings, applied before preloading */
+    unsigned int thread_pool_size;    // 0 means default (hardware concurrency)
+    rtc_sctp_settings_t sctp_settings;
+
     /* Callback for websocket server */
     rtc_websocket_server_callback wss_client_callback;
 
@@ -134,6 +190,8 @@ struct rtc_options_s {
     rtc_peer_connection_local_candidate_callback pc_local_candidate_callback;
     rtc_peer_connection_state_change_callback pc_state_change_callback;
     rtc_peer_connection_data_channel_callback pc_data_channel_callback;
+    rtc_peer_connection_gathering_state_change_callback
+        pc_gathering_state_change_callback;
 
     /* Callbacks for data channels */
     rtc_data_channel_open_callback dc_open_callback;
@@ -163,6 +221,19 @@ struct rtc_websocket_server_options_s {
 };
 
 
+struct rtc_websocket_client_options_s {
+    /// @brief Context
+    rtc_context_t * context;
+
+    /// @brief Initial private data
+    void * data;
+
+    /* Configuration */
+
+    const char * url;                  // ws:// or wss:// URL to connect to
+};
+
+
 struct rtc_peer_connection_options_s {
     /// @brief Context
     rtc_context_t * context;
@@ -213,6 +284,35 @@ struct rtc_data_channel_options_s {
 };
 
 
+struct rtc_candidate_info_s {
+    rtc_candidate_type type;
+    rtc_candidate_transport transport;
+    char address[RTC_CANDIDATE_ADDRESS_LENGTH]; // empty if unresolved
+    uint16_t port;
+};
+
+
+struct rtc_peer_connection_stats_s {
+    /// @brief Round trip time measured by SCTP (ms), -1 if not available
+    int64_t rtt_ms;
+
+    /// @brief Bytes sent through the transport
+    uint64_t bytes_sent;
+
+    /// @brief Bytes received through the transport
+    uint64_t bytes_received;
+
+    /// @brief Whether a candidate pair has been selected
+    bool has_selected_pair;
+
+    /// @brief Local candidate of selected pair
+    rtc_candidate_info_t local;
+
+    /// @brief Remote candidate of selected pair
+    rtc_candidate_info_t remote;
+};
+
+
 /* -------------------------------------------------------------------------- */
 /*                               Common APIs                                  */
 /* -------------------------------------------------------------------------- */
@@ -229,6 +329,9 @@ void rtc_context_set_data(rtc_context_t * context, void * data);
 /// @brief Get RTC context data
 void * rtc_context_get_data(rtc_context_t * context);
 
+/// @brief Change the logging level of RTC context
+void rtc_context_set_log_level(rtc_context_t * context, rtc_log_level level);
+
 
 /* -------------------------------------------------------------------------- */
 /*                          Websocket Server APIs                             */
@@ -265,6 +368,18 @@ rtc_context_t * rtc_websocket_server_get_context(rtc_websocket_server_t * wss);
 /*                          Websocket Client APIs                             */
 /* -------------------------------------------------------------------------- */
 
+/// @brief Initialize websocket client options
+void rtc_websocket_client_options_init(
+    rtc_websocket_client_options_t * options
+);
+
+/// @brief Create new websocket client and start connecting to the URL. The
+/// open callback will be called when the connection has been established.
+/// @return Websocket client or NULL on failed
+rtc_websocket_client_t * rtc_websocket_client_create(
+    rtc_websocket_client_options_t * options
+);
+
 /// @brief Set private data for websocket client
 void rtc_websocket_client_set_data(rtc_websocket_client_t * wsc, void * data);
 
@@ -370,6 +485,13 @@ void rtc_peer_connection_add_remote_candidate(
     const char * mid
 );
 
+/// @brief Get transport statistics of peer connection
+/// @return 0 on success or -1 on failure
+int rtc_peer_connection_get_stats(
+    rtc_peer_connection_t * pc,
+    rtc_peer_connection_stats_t * stats
+);
+
 /// @brief Get context
 rtc_context_t * rtc_peer_connection_get_context(rtc_peer_connection_t * pc);
 
@@ -415,6 +537,11 @@ bool rtc_data_channel_is_open(rtc_data_channel_t * dc);
 /// @brief Get label of data channel
 const char * rtc_data_channel_get_label(rtc_data_channel_t * dc);
 
+/// @brief Get the maximum size of a message which can be sent through data
+/// channel, as negotiated with the remote peer
+/// @return The size or 0 if it is not available
+size_t rtc_data_channel_max_message_size(rtc_data_channel_t * dc);
+
 /* -------------------------------------------------------------------------- */
 /*                          Readonly Buffer APIs                              */
 /* -------------------------------------------------------------------------- */
@@ -438,6 +565,9 @@ rtc_buffer_t * rtc_buffer_prepare(
     uint8_t ** data
 );
 
+/// @brief Shrink a prepared buffer, the data is kept
+void rtc_buffer_truncate(rtc_buffer_t * buffer, size_t size);
+
 /// @brief Get context
 rtc_context_t * rtc_buffer_get_context(rtc_context_t * buffer);
 
@@ -44,6 +44,13 @@ void RTCBuffer::prepare(size_t capacity, uint8_t ** data) {
 }
 
 
+void RTCBuffer::truncate(size_t size) {
+    if (is_binary && size < binary_data.size()) {
+        binary_data.resize(size);
+    }
+}
+
+
 void RTCBuffer::reset_ref() {
     ref_counter.store(1, std::memory_order_relaxed);
 }
@@ -65,7 +72,7 @@ void RTCBuffer::ref() {
 
 
 void RTCBuffer::unref() {
-    int prev = ref_counter.fetch_add(1, std::memory_order_relaxed);
+    int prev = ref_counter.fetch_sub(1, std::memory_order_acq_rel);
     if (prev == 1) { // Need to release
         source->release(this);
     }
@@ -19,6 +19,7 @@ public:
     void set(std::string && string_data);
     void set(rtc::binary & binary_data);
     void prepare(size_t capacity, uint8_t ** data);
+    void truncate(size_t size);
 
     void reset_ref();
     void ref();
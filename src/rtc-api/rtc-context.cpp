@@ -22,21 +22,14 @@ RTCContext::RTCContext(rtc_options_t * options) {
     memcpy(&this->options, options, sizeof(rtc_options_t));
 
     // Initialize logger
-    log_callback = nullptr;
-    rtc_log_level level = options->log_level;
-    rtc_log_callback callback = options->log_callback;
-    
-    if (callback) {
-        if (level >= RTC_LOG_LEVEL_DEBUG) {
-            log_callback = callback;
-        }
-        rtc::InitLogger(static_cast<rtc::LogLevel>(level), [callback](
-            rtc::LogLevel level,
-            std::string message
-        ) {
-            callback(static_cast<rtc_log_level>(level), message.c_str());
-        });
+    log_callback.store(nullptr, std::memory_order_relaxed);
+    set_log_level(options->log_level);
+
+    // Global settings must be applied before preloading
+    if (options->thread_pool_size > 0) {
+        rtc::SetThreadPoolSize(options->thread_pool_size);
     }
+    rtc::SetSctpSettings(make_sctp_settings(&options->sctp_settings));
 
     // Finally, preload RTC
     rtc::Preload();
@@ -62,14 +55,91 @@ RTCContext::~RTCContext() {
     pool_buffer = nullptr;
 
     rtc::Cleanup().wait_for(10s);
-    log_callback = nullptr;
+    log_callback.store(nullptr, std::memory_order_relaxed);
 }
 
 
 
+rtc::SctpSettings RTCContext::make_sctp_settings(
+    rtc_sctp_settings_t * settings
+) {
+    rtc::SctpSettings sctp;
+    if (settings->recv_buffer_size > 0) {
+        sctp.recvBufferSize = size_t(settings->recv_buffer_size);
+    }
+    if (settings->send_buffer_size > 0) {
+        sctp.sendBufferSize = size_t(settings->send_buffer_size);
+    }
+    if (settings->max_chunks_on_queue > 0) {
+        sctp.maxChunksOnQueue = size_t(settings->max_chunks_on_queue);
+    }
+    if (settings->initial_congestion_window > 0) {
+        sctp.initialCongestionWindow =
+            size_t(settings->initial_congestion_window);
+    }
+    if (settings->max_burst > 0) {
+        sctp.maxBurst = size_t(settings->max_burst);
+    } else if (settings->max_burst < 0) {
+        sctp.maxBurst = size_t(0); // Disabled
+    }
+    if (settings->congestion_control_module > 0) {
+        sctp.congestionControlModule =
+            unsigned(settings->congestion_control_module);
+    }
+    if (settings->delayed_sack_time_ms > 0) {
+        sctp.delayedSackTime =
+            std::chrono::milliseconds(settings->delayed_sack_time_ms);
+    } else if (settings->delayed_sack_time_ms < 0) {
+        sctp.delayedSackTime = std::chrono::milliseconds(0); // Disabled
+    }
+    if (settings->min_retransmit_timeout_ms > 0) {
+        sctp.minRetransmitTimeout =
+            std::chrono::milliseconds(settings->min_retransmit_timeout_ms);
+    }
+    if (settings->max_retransmit_timeout_ms > 0) {
+        sctp.maxRetransmitTimeout =
+            std::chrono::milliseconds(settings->max_retransmit_timeout_ms);
+    }
+    if (settings->initial_retransmit_timeout_ms > 0) {
+        sctp.initialRetransmitTimeout =
+            std::chrono::milliseconds(settings->initial_retransmit_timeout_ms);
+    }
+    if (settings->max_retransmit_attempts > 0) {
+        sctp.maxRetransmitAttempts =
+            unsigned(settings->max_retransmit_attempts);
+    }
+    if (settings->heartbeat_interval_ms > 0) {
+        sctp.heartbeatInterval =
+            std::chrono::milliseconds(settings->heartbeat_interval_ms);
+    }
+    return sctp;
+}
+
+
+void RTCContext::set_log_level(rtc_log_level level) {
+    rtc_log_callback callback = options.log_callback;
+    if (!callback) return;
+
+    // Exceptions are only logged in debug level
+    log_callback.store(
+        (level >= RTC_LOG_LEVEL_DEBUG) ? callback : nullptr,
+        std::memory_order_relaxed
+    );
+
+    // Calling InitLogger again only changes the level of installed logger
+    rtc::InitLogger(static_cast<rtc::LogLevel>(level), [callback](
+        rtc::LogLevel level,
+        std::string message
+    ) {
+        callback(static_cast<rtc_log_level>(level), message.c_str());
+    });
+}
+
+
 void RTCContext::handle_exception(std::exception & ex) {
-    if (log_callback) {
-        log_callback(RTC_LOG_LEVEL_DEBUG, ex.what());
+    rtc_log_callback callback = log_callback.load(std::memory_order_relaxed);
+    if (callback) {
+        callback(RTC_LOG_LEVEL_DEBUG, ex.what());
     }
 }
 
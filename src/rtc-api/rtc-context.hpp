@@ -12,6 +12,14 @@ public:
     RTCContext(rtc_options_t * rtc_options);
     ~RTCContext();
 
+    /// @brief Convert SCTP settings to libdatachannel settings
+    static rtc::SctpSettings make_sctp_settings(
+        rtc_sctp_settings_t * settings
+    );
+
+    /// @brief Set logging level
+    void set_log_level(rtc_log_level level);
+
     /// @brief Handle exception
     void handle_exception(std::exception & ex);
     
@@ -32,7 +40,7 @@ public:
     RTCBufferPool * pool_buffer;
 
 private:
-    rtc_log_callback log_callback;
+    std::atomic<rtc_log_callback> log_callback;
     std::atomic<void *> data;
 };
 
@@ -54,6 +54,8 @@ void RTCDataChannel::finalize() {
     }
 
     try {
+        // Late events must not reach this object after it has been released
+        dc->resetCallbacks();
         dc->close();
     } catch (std::exception ex) {
         context->handle_exception(ex);
@@ -109,6 +111,16 @@ const char * RTCDataChannel::get_label() {
 }
 
 
+size_t RTCDataChannel::max_message_size() {
+    try {
+        return dc->maxMessageSize();
+    } catch (std::exception ex) {
+        context->handle_exception(ex);
+        return 0;
+    }
+}
+
+
 void RTCDataChannel::on_open() {
     open_callback(reinterpret_cast<rtc_data_channel_t *>(this));
 }
@@ -30,6 +30,9 @@ public:
     /// @brief Get label of data channel
     const char * get_label();
 
+    /// @brief Get the negotiated maximum message size, 0 on failure
+    size_t max_message_size();
+
 private:
     void on_open();
     void on_closed();
@@ -1,4 +1,5 @@
 #include <cassert>
+#include <cstring>
 #include "rtc-api.hpp"
 #include "rtc-peer-connection.hpp"
 #include "rtc-data-channel.hpp"
@@ -23,6 +24,8 @@ void RTCPeerConnection::init(rtc_peer_connection_options_t * options) {
     local_candidate_callback = context->options.pc_local_candidate_callback;
     state_change_callback = context->options.pc_state_change_callback;
     data_channel_callback = context->options.pc_data_channel_callback;
+    gathering_state_change_callback =
+        context->options.pc_gathering_state_change_callback;
 
     rtc::Configuration conf;
     for (int i = 0; i < options->ice_servers_count; ++i) {
@@ -78,6 +81,14 @@ void RTCPeerConnection::init(rtc_peer_connection_options_t * options) {
             &RTCPeerConnection::on_data_channel, this, std::placeholders::_1
         ));
     }
+
+    if (gathering_state_change_callback) {
+        pc->onGatheringStateChange(std::bind(
+            &RTCPeerConnection::on_gathering_state_change,
+            this,
+            std::placeholders::_1
+        ));
+    }
 }
 
 
@@ -88,6 +99,8 @@ void RTCPeerConnection::finalize() {
     }
 
     try {
+        // Late events must not reach this object after it has been released
+        pc->resetCallbacks();
         pc->close();
     } catch (std::exception ex) {
         context->handle_exception(ex);
@@ -97,6 +110,7 @@ void RTCPeerConnection::finalize() {
     local_candidate_callback = nullptr;
     state_change_callback = nullptr;
     data_channel_callback = nullptr;
+    gathering_state_change_callback = nullptr;
 
     clear_local_description();
 }
@@ -247,6 +261,77 @@ void RTCPeerConnection::add_remote_candidate(
 }
 
 
+/// @brief Copy the information of candidate
+static void copy_candidate(
+    rtc::Candidate & candidate,
+    rtc_candidate_info_t * info
+) {
+    switch (candidate.type()) {
+        case rtc::Candidate::Type::Host:
+            info->type = RTC_CANDIDATE_TYPE_HOST;
+            break;
+        case rtc::Candidate::Type::ServerReflexive:
+            info->type = RTC_CANDIDATE_TYPE_SERVER_REFLEXIVE;
+            break;
+        case rtc::Candidate::Type::PeerReflexive:
+            info->type = RTC_CANDIDATE_TYPE_PEER_REFLEXIVE;
+            break;
+        case rtc::Candidate::Type::Relayed:
+            info->type = RTC_CANDIDATE_TYPE_RELAYED;
+            break;
+        default:
+            info->type = RTC_CANDIDATE_TYPE_UNKNOWN;
+    }
+
+    switch (candidate.transportType()) {
+        case rtc::Candidate::TransportType::Udp:
+            info->transport = RTC_CANDIDATE_TRANSPORT_UDP;
+            break;
+        case rtc::Candidate::TransportType::Unknown:
+            info->transport = RTC_CANDIDATE_TRANSPORT_UNKNOWN;
+            break;
+        default:
+            info->transport = RTC_CANDIDATE_TRANSPORT_TCP;
+    }
+
+    copy_address(
+        candidate.address(),
+        info->address,
+        RTC_CANDIDATE_ADDRESS_LENGTH
+    );
+    info->port = candidate.port().value_or(0);
+}
+
+
+int RTCPeerConnection::get_stats(rtc_peer_connection_stats_t * stats) {
+    assert(stats != nullptr);
+    std::memset(stats, 0, sizeof(rtc_peer_connection_stats_t));
+    stats->rtt_ms = -1;
+
+    try {
+        auto rtt = pc->rtt();
+        if (rtt.has_value()) {
+            stats->rtt_ms = rtt->count();
+        }
+        stats->bytes_sent = pc->bytesSent();
+        stats->bytes_received = pc->bytesReceived();
+
+        rtc::Candidate local;
+        rtc::Candidate remote;
+        if (pc->getSelectedCandidatePair(&local, &remote)) {
+            stats->has_selected_pair = true;
+            copy_candidate(local, &stats->local);
+            copy_candidate(remote, &stats->remote);
+        }
+    } catch (std::exception ex) {
+        context->handle_exception(ex);
+        return -1;
+    }
+
+    return 0;
+}
+
+
 void RTCPeerConnection::on_local_candidate(rtc::Candidate candidate) {
     RTCBuffer * cand_buff = context->pool_buffer->acquire();
     if (!cand_buff) {
@@ -280,6 +365,16 @@ void RTCPeerConnection::on_state_change(rtc::PeerConnection::State state) {
 }
 
 
+void RTCPeerConnection::on_gathering_state_change(
+    rtc::PeerConnection::GatheringState state
+) {
+    gathering_state_change_callback(
+        reinterpret_cast<rtc_peer_connection_t *>(this),
+        static_cast<rtc_gathering_state>(state)
+    );
+}
+
+
 void RTCPeerConnection::on_data_channel(
     std::shared_ptr<rtc::DataChannel> data_channel
 ) {
@@ -38,6 +38,9 @@ public:
     /// @brief Add remote candidate
     void add_remote_candidate(const char * cand, const char * mid);
 
+    /// @brief Get transport statistics
+    int get_stats(rtc_peer_connection_stats_t * stats);
+
 private:
     /// @brief Handle local candidate
     void on_local_candidate(rtc::Candidate candidate);
@@ -45,6 +48,11 @@ private:
     /// @brief Handle state changed
     void on_state_change(rtc::PeerConnection::State state);
 
+    /// @brief Handle gathering state changed
+    void on_gathering_state_change(
+        rtc::PeerConnection::GatheringState state
+    );
+
     /// @brief Handle new data channel
     void on_data_channel(std::shared_ptr<rtc::DataChannel> data_channel);
 
@@ -63,6 +71,8 @@ private:
         = nullptr;
     rtc_peer_connection_state_change_callback state_change_callback = nullptr;
     rtc_peer_connection_data_channel_callback data_channel_callback = nullptr;
+    rtc_peer_connection_gathering_state_change_callback
+        gathering_state_change_callback = nullptr;
 
     /// @brief Local description
     std::optional<rtc::Description> local_description;
@@ -47,6 +47,15 @@ void RTCWSClient::init(std::shared_ptr<rtc::WebSocket> ws_client) {
 }
 
 
+void RTCWSClient::init(rtc_websocket_client_options_t * options) {
+    set_data(options->data);
+
+    // Bind the callbacks before opening, so that no event will be missed
+    init(std::make_shared<rtc::WebSocket>());
+    ws_client->open(options->url);
+}
+
+
 void RTCWSClient::finalize() {
     RTCObject::finalize();
     if (!ws_client) {
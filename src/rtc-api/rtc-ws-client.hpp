@@ -11,6 +11,9 @@ public:
     ~RTCWSClient();
 
     void init(std::shared_ptr<rtc::WebSocket> ws_client);
+
+    /// @brief Create a new websocket and connect it to the URL of options
+    void init(rtc_websocket_client_options_t * options);
     virtual void finalize() override;
 
     /// @brief Close websocket client
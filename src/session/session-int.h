@@ -12,8 +12,30 @@ extern "C" {
 #define OPCODE_AUTH        "AUTH"
 #define OPCODE_DESCRIPTION "DESC"
 #define OPCODE_CANDIDATE   "CAND"
+#define OPCODE_CANDIDATES  "CANDS"
 #define OPCODE_READY       "READY"
 #define OPCODE_CONNECTED   "CONN"
+#define OPCODE_EARLY       "EARLY"
+#define OPCODE_DONE        "DONE"
+#define OPCODE_RELEASE     "RELEASE"
+
+// Early data frames start with a zero byte, which never starts a text
+// message: [0][2 bytes: channel index, big endian][message]
+#define EARLY_DATA_TAG          0
+#define EARLY_DATA_HEADER_BYTES 3
+#define EARLY_DATA_DEFAULT_MAX_HELD_BYTES (256 * 1024)
+#define EARLY_DATA_DEFAULT_SWITCH_TIMEOUT_MS 5000
+
+// Optional features which are negotiated in AUTH message:
+// AUTH|<token>|<feature>,<feature>,...
+#define FEATURE_SEPARATOR  ','
+#define FEATURE_CANDIDATES "cands"
+#define FEATURE_SEQUENCE   "seq"
+#define FEATURE_FRAGMENT   "frag"
+#define FEATURE_COMPRESSION "zip"
+#define FEATURE_AGGREGATION "agg"
+#define FEATURE_EARLY_DATA  "early"
+#define FEATURE_WS_RELEASE  "wsrel"
 
 #define RESULT_AUTH_OK          "AUTH|OK"
 #define RESULT_AUTH_FAILED      "AUTH|FAILED"
@@ -26,24 +48,44 @@ extern "C" {
 // Current protocol is only supporting maximum 4 opcodes
 #define SYS_OPCODE_PING 0
 #define SYS_OPCODE_PONG 1
+#define SYS_OPCODE_LOSS_REPORT 2
+#define SYS_OPCODE_SIGNAL 3
 
-// Wait for 5 seconds for sending authenticating
-#define POMELO_AUTH_TIMEOUT_MS 5000
+// Signaling over system channel, once websocket has been released:
+//   [SYS_OPCODE_SIGNAL << 6 | flags][2 bytes: sequence, big endian][message]
+// Every message is acknowledged by a frame with the ACK flag and the same
+// sequence, and is resent until then. Only one message of each direction is
+// in flight, so they are processed in order.
+#define SYS_SIGNAL_FLAG_ACK 1
+#define SYS_SIGNAL_HEADER_BYTES 3
+#define SYS_SIGNAL_RESEND_INTERVAL_MS 200
 
 
 /* -------------------------------------------------------------------------- */
 /*                               Module APIs                                  */
 /* -------------------------------------------------------------------------- */
 
+/// Mark a handshake phase of session as reached
+#define pomelo_webrtc_session_mark_phase(session, phase)                       \
+pomelo_webrtc_handshake_stats_mark(                                            \
+    &(session)->context->handshake_stats, &(session)->handshake, (phase)       \
+)
+
+/// Report the handshake result of session
+#define pomelo_webrtc_session_finish_handshake(session, result)                \
+pomelo_webrtc_context_finish_handshake(                                        \
+    (session)->context, &(session)->handshake, (result)                        \
+)
+
+
 /// Check if session is active
 #define pomelo_webrtc_session_is_active(session)                               \
 POMELO_CHECK_FLAG((session)->flags, POMELO_WEBRTC_SESSION_FLAG_ACTIVE)
 
 
-/// @brief Process auth result
-void pomelo_webrtc_session_on_auth_result(
-    pomelo_webrtc_session_t * session,
-    pomelo_plugin_token_info_t * info
+/// @brief Process when all local candidates have been gathered
+void pomelo_webrtc_session_on_local_candidates_gathered(
+    pomelo_webrtc_session_t * session
 );
 
 
@@ -121,7 +163,9 @@ void pomelo_webrtc_session_send_pong(
 void pomelo_webrtc_session_recv_pong(
     pomelo_webrtc_session_t * session,
     uint64_t ping_sequence,
-    uint64_t recv_time
+    uint64_t recv_time,
+    uint64_t client_time,
+    bool has_client_time
 );
 
 
@@ -143,6 +187,45 @@ void pomelo_webrtc_session_process_pong(
 );
 
 
+/// @brief Sample the loss of the last interval and report it to client
+void pomelo_webrtc_session_update_loss(pomelo_webrtc_session_t * session);
+
+
+/// @brief Process loss report of client
+void pomelo_webrtc_session_process_loss_report(
+    pomelo_webrtc_session_t * session,
+    const uint8_t * message,
+    size_t length
+);
+
+
+/// @brief Process the signal of client that it has stopped sending over
+/// websocket
+void pomelo_webrtc_session_recv_done(pomelo_webrtc_session_t * session);
+
+
+/// @brief Drop the held messages of data channels
+void pomelo_webrtc_session_discard_held(pomelo_webrtc_session_t * session);
+
+
+/// @brief Close the websocket if the session no longer needs it
+void pomelo_webrtc_session_release_ws(pomelo_webrtc_session_t * session);
+
+
+/// @brief Snapshot the compressed channels and their dictionaries
+void pomelo_webrtc_session_init_compression(pomelo_webrtc_session_t * session);
+
+
+/// @brief Release the dictionaries of compressed channels
+void pomelo_webrtc_session_cleanup_compression(
+    pomelo_webrtc_session_t * session
+);
+
+
+/// @brief Snapshot the unreliable channels whose messages are packed together
+void pomelo_webrtc_session_init_aggregation(pomelo_webrtc_session_t * session);
+
+
 /// @brief Create channels
 int pomelo_webrtc_session_create_channels(pomelo_webrtc_session_t * session);
 
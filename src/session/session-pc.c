@@ -246,6 +246,51 @@ void pomelo_webrtc_pc_on_data_channel(
 }
 
 
+static void pomelo_webrtc_pc_on_gathering_state_changed_callback(
+    size_t argc,
+    pomelo_webrtc_variant_t * args
+) {
+    assert(argc == 2);
+    assert(args != NULL);
+
+    rtc_peer_connection_t * pc = args[0].ptr;
+    rtc_gathering_state state = args[1].i32;
+    pomelo_webrtc_session_t * session = rtc_peer_connection_get_data(pc);
+
+    if (
+        state == RTC_GATHERING_STATE_COMPLETE &&
+        pomelo_webrtc_session_pc_is_active(session)
+    ) {
+        pomelo_webrtc_session_on_local_candidates_gathered(session);
+    }
+}
+
+
+void pomelo_webrtc_pc_on_gathering_state_changed(
+    rtc_peer_connection_t * pc,
+    rtc_gathering_state state
+) {
+    assert(pc != NULL);
+    rtc_context_t * rtc_context = rtc_peer_connection_get_context(pc);
+    pomelo_webrtc_context_t * context = rtc_context_get_data(rtc_context);
+    if (!context) {
+        return;
+    }
+
+    pomelo_webrtc_variant_t args[] = {
+        { .ptr = pc },
+        { .i32 = state }
+    };
+
+    pomelo_webrtc_context_submit_task(
+        context,
+        pomelo_webrtc_pc_on_gathering_state_changed_callback,
+        POMELO_ARRAY_LENGTH(args),
+        args
+    );
+}
+
+
 /* -------------------------------------------------------------------------- */
 /*                                 Public APIs                                */
 /* -------------------------------------------------------------------------- */
@@ -253,8 +298,14 @@ void pomelo_webrtc_pc_on_data_channel(
 int pomelo_webrtc_session_pc_init(pomelo_webrtc_session_t * session) {
     assert(session != NULL);
 
+    // ICE server URLs are copied while creating the peer connection
+    const char * ice_servers[POMELO_WEBRTC_CONFIG_MAX_ICE_SERVERS];
     rtc_peer_connection_options_t options;
-    pomelo_webrtc_session_pc_init_rtc_pc_options(&options);
+    pomelo_webrtc_session_pc_init_rtc_pc_options(
+        &options,
+        &session->context->config,
+        ice_servers
+    );
 
     // Set associated data
     options.context = session->context->rtc_context;
@@ -353,18 +404,40 @@ void pomelo_webrtc_session_pc_add_remote_candidate(
 /* -------------------------------------------------------------------------- */
 
 void pomelo_webrtc_session_pc_init_rtc_pc_options(
-    rtc_peer_connection_options_t * options
+    rtc_peer_connection_options_t * options,
+    pomelo_webrtc_config_t * config,
+    const char ** ice_servers
 ) {
     assert(options != NULL);
+    assert(config != NULL);
+    assert(ice_servers != NULL);
     memset(options, 0, sizeof(rtc_peer_connection_options_t));
 
-    // TODO: Load RTC configuration from file or somewhere
+    for (int i = 0; i < config->ice_servers_count; i++) {
+        ice_servers[i] = config->ice_servers[i];
+    }
+    options->ice_servers = ice_servers;
+    options->ice_servers_count = config->ice_servers_count;
+
+    options->bind_address =
+        config->bind_address[0] ? config->bind_address : NULL;
+    options->enable_ice_udp_mux = config->enable_ice_udp_mux;
+    options->port_range_begin = config->port_range_begin;
+    options->port_range_end = config->port_range_end;
+    options->mtu = config->mtu;
+    options->max_message_size = config->max_message_size;
 }
 
 
 void pomelo_webrtc_session_pc_on_connected(pomelo_webrtc_session_t * session) {
-    (void) session;
-    // Nothing to do
+    assert(session != NULL);
+    pomelo_webrtc_session_mark_phase(
+        session,
+        POMELO_WEBRTC_HANDSHAKE_PHASE_PC_CONNECTED
+    );
+
+    // The candidate pair has just been selected
+    pomelo_webrtc_transport_update(&session->transport, session->pc);
 }
 
 
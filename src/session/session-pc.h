@@ -32,6 +32,13 @@ void pomelo_webrtc_pc_on_data_channel(
 );
 
 
+/// @brief Handle PC gathering state changed
+void pomelo_webrtc_pc_on_gathering_state_changed(
+    rtc_peer_connection_t * pc,
+    rtc_gathering_state state
+);
+
+
 /* -------------------------------------------------------------------------- */
 /*                                 Public APIs                                */
 /* -------------------------------------------------------------------------- */
@@ -79,9 +86,13 @@ void pomelo_webrtc_session_pc_add_remote_candidate(
 /*                                Private APIs                                */
 /* -------------------------------------------------------------------------- */
 
-/// @brief Initialize RTC configuration
+/// @brief Initialize RTC configuration from plugin configuration.
+/// The ICE servers array must have POMELO_WEBRTC_CONFIG_MAX_ICE_SERVERS slots
+/// and outlive the creation of peer connection.
 void pomelo_webrtc_session_pc_init_rtc_pc_options(
-    rtc_peer_connection_options_t * options
+    rtc_peer_connection_options_t * options,
+    pomelo_webrtc_config_t * config,
+    const char ** ice_servers
 );
 
 
@@ -116,12 +116,20 @@ void POMELO_PLUGIN_CALL pomelo_webrtc_plugin_session_get_rtt(
     pomelo_webrtc_session_t * session =
         plugin->session_get_private(plugin, native_session);
 
+    uint64_t rtt_mean = pomelo_atomic_uint64_load(&session->rtt.mean);
+    uint64_t rtt_variance = pomelo_atomic_uint64_load(&session->rtt.variance);
+    if (rtt_mean == 0) {
+        // No pong has been received, fall back to the RTT measured by SCTP
+        rtt_mean = pomelo_atomic_uint64_load(&session->transport.rtt);
+        rtt_variance = 0;
+    }
+
     if (mean) {
-        *mean = pomelo_atomic_uint64_load(&session->rtt.mean);
+        *mean = rtt_mean;
     }
 
     if (variance) {
-        *variance = pomelo_atomic_uint64_load(&session->rtt.variance);
+        *variance = rtt_variance;
     }
 }
 
@@ -210,8 +218,10 @@ void pomelo_webrtc_session_plugin_open(pomelo_webrtc_session_t * session) {
         session
     );
     if (ret != 0) {
-        // Failed to submit task, unref this session
+        // Failed to submit task, the native session will never be created
+        pomelo_webrtc_session_close(session);
         pomelo_webrtc_session_unref(session);
+        return;
     }
 
     // => pomelo_webrtc_session_plugin_on_created
@@ -1,19 +1,23 @@
 #include <assert.h>
 #include <string.h>
-#include "pomelo/constants.h"
-#include "pomelo/base64.h"
 #include "utils/common-macro.h"
 #include "utils/string-buffer.h"
 #include "context.h"
 #include "socket/socket.h"
+#include "preauth/preauth.h"
+#include "log/log.h"
+#include "channel/channel-int.h"
+#include "channel/channel-aggregate.h"
 #include "session-ws.h"
 
+/// Window to collect local candidates into one frame
+#define CANDIDATES_BATCH_WINDOW_MS 10
 
-#define POMELO_CONNECT_TOKEN_BASE64_LENGTH                                     \
-(pomelo_base64_calc_encoded_length(POMELO_CONNECT_TOKEN_BYTES) - 1)
+/// Maximum number of candidates in one frame
+#define CANDIDATES_BATCH_MAX_COUNT 32
 
-#define POMELO_CONNECT_TOKEN_BASE64_NO_PADDING_LENGTH                          \
-(pomelo_base64_calc_encoded_no_padding_length(POMELO_CONNECT_TOKEN_BYTES) - 1)
+/// Length of a remote address string
+#define ADDRESS_BUFFER_LENGTH 64
 
 /// Compare head of message with opcode
 #define opcode_cmp(message, opcode)                                            \
@@ -24,10 +28,6 @@
 POMELO_CHECK_FLAG((session)->flags, POMELO_WEBRTC_SESSION_FLAG_WS_ACTIVE)
 
 
-#define pomelo_webrtc_session_ws_is_authenticated(session)                     \
-POMELO_CHECK_FLAG((session)->flags, POMELO_WEBRTC_SESSION_FLAG_WS_AUTHENTICATED)
-
-
 #define pomelo_webrtc_session_ws_set_active(session)                           \
 POMELO_SET_FLAG((session)->flags, POMELO_WEBRTC_SESSION_FLAG_WS_ACTIVE)
 
@@ -36,8 +36,14 @@ POMELO_SET_FLAG((session)->flags, POMELO_WEBRTC_SESSION_FLAG_WS_ACTIVE)
 POMELO_UNSET_FLAG((session)->flags, POMELO_WEBRTC_SESSION_FLAG_WS_ACTIVE)
 
 
-#define pomelo_webrtc_session_ws_set_authenticated(session)                    \
-POMELO_SET_FLAG((session)->flags, POMELO_WEBRTC_SESSION_FLAG_WS_AUTHENTICATED)
+#define pomelo_webrtc_session_ws_is_released(session)                          \
+POMELO_CHECK_FLAG((session)->flags, POMELO_WEBRTC_SESSION_FLAG_WS_RELEASED)
+
+
+/// Signaling is carried by websocket or, once released, by system channel
+#define pomelo_webrtc_session_ws_can_signal(session)                           \
+(pomelo_webrtc_session_ws_is_active(session) ||                                \
+    pomelo_webrtc_session_ws_is_released(session))
 
 
 /* -------------------------------------------------------------------------- */
@@ -59,11 +65,18 @@ static void pomelo_webrtc_ws_on_closed_callback(
     assert(args != NULL);
 
     rtc_websocket_client_t * ws_client = args[0].ptr;
-    pomelo_webrtc_session_t * session =
-        rtc_websocket_client_get_data(ws_client);
-    if (!session) return; // Not a mapped session
+    void * owner = rtc_websocket_client_get_data(ws_client);
+    if (!owner) return; // Not a mapped client
+
+    switch (*((pomelo_webrtc_ws_owner_kind *) owner)) {
+        case POMELO_WEBRTC_WS_OWNER_PREAUTH:
+            pomelo_webrtc_preauth_ws_on_closed(owner);
+            break;
 
-    pomelo_webrtc_session_ws_on_closed(session);
+        case POMELO_WEBRTC_WS_OWNER_SESSION:
+            pomelo_webrtc_session_ws_on_closed(owner);
+            break;
+    }
 }
 
 
@@ -90,7 +103,7 @@ void pomelo_webrtc_ws_on_error(
     const char * error
 ) {
     (void) ws_client;
-    pomelo_webrtc_log_debug(error);
+    pomelo_webrtc_log_at(POMELO_WEBRTC_LOG_LEVEL_DEBUG, "%s", error);
     // We will receive close event after this event
 }
 
@@ -104,15 +117,32 @@ static void pomelo_webrtc_ws_on_message_callback(
 
     rtc_websocket_client_t * ws_client = args[0].ptr;
     rtc_buffer_t * message = args[1].ptr;
-    pomelo_webrtc_session_t * session =
-        rtc_websocket_client_get_data(ws_client);
-
-    if (session && pomelo_webrtc_session_ws_is_active(session)) {
-        // Only accept message when WS is active
-
-        size_t size = rtc_buffer_size(message);
-        const char * data = (const char *) rtc_buffer_data(message);
-        pomelo_webrtc_session_ws_process_message(session, data, size);
+    void * owner = rtc_websocket_client_get_data(ws_client);
+
+    if (owner) {
+        switch (*((pomelo_webrtc_ws_owner_kind *) owner)) {
+            case POMELO_WEBRTC_WS_OWNER_PREAUTH:
+                pomelo_webrtc_preauth_ws_process_message(owner, message);
+                break;
+
+            case POMELO_WEBRTC_WS_OWNER_SESSION: {
+                pomelo_webrtc_session_t * session = owner;
+                if (!pomelo_webrtc_session_ws_is_active(session)) {
+                    break; // Only accept message when WS is active
+                }
+
+                size_t size = rtc_buffer_size(message);
+                const char * data = (const char *) rtc_buffer_data(message);
+                if (size > 0 && data[0] == EARLY_DATA_TAG) {
+                    pomelo_webrtc_session_ws_process_data(session, message);
+                } else {
+                    pomelo_webrtc_session_ws_process_message(
+                        session, data, size
+                    );
+                }
+                break;
+            }
+        }
     }
 
     rtc_buffer_unref(message); // Unref buffer after calling callback
@@ -149,6 +179,199 @@ void pomelo_webrtc_ws_on_message(
     }
 }
 
+static void pomelo_webrtc_session_ws_flush_candidates_callback(
+    size_t argc,
+    pomelo_webrtc_variant_t * args
+) {
+    assert(argc == 1);
+    assert(args != NULL);
+    pomelo_webrtc_session_ws_flush_candidates(args[0].ptr);
+}
+
+
+/// @brief Send the first unacknowledged signaling message over system
+/// channel
+static void pomelo_webrtc_session_ws_send_signal_head(
+    pomelo_webrtc_session_t * session
+) {
+    rtc_buffer_t * buffer = NULL;
+    pomelo_array_get(session->signals, session->signal_head, &buffer);
+    if (buffer) {
+        pomelo_webrtc_channel_send_buffer(session->system_channel, buffer);
+    }
+}
+
+
+static void pomelo_webrtc_session_ws_resend_signal_callback(
+    size_t argc,
+    pomelo_webrtc_variant_t * args
+) {
+    assert(argc == 1);
+    assert(args != NULL);
+    pomelo_webrtc_session_ws_send_signal_head(args[0].ptr);
+}
+
+
+/// @brief Send the acknowledgement of a signaling message of client
+static void pomelo_webrtc_session_ws_ack_signal(
+    pomelo_webrtc_session_t * session,
+    uint16_t sequence
+) {
+    uint8_t data[SYS_SIGNAL_HEADER_BYTES];
+    data[0] = (uint8_t) ((SYS_OPCODE_SIGNAL << 6) | SYS_SIGNAL_FLAG_ACK);
+    data[1] = (uint8_t) (sequence >> 8);
+    data[2] = (uint8_t) sequence;
+    pomelo_webrtc_channel_send(session->system_channel, data, sizeof(data));
+}
+
+
+/// @brief Process the acknowledgement of the first unacknowledged signaling
+/// message
+static void pomelo_webrtc_session_ws_recv_signal_ack(
+    pomelo_webrtc_session_t * session,
+    uint16_t sequence
+) {
+    rtc_buffer_t * buffer = NULL;
+    pomelo_array_get(session->signals, session->signal_head, &buffer);
+    if (!buffer) {
+        return; // Nothing is in flight
+    }
+
+    const uint8_t * data = rtc_buffer_data(buffer);
+    if ((((uint16_t) data[1] << 8) | data[2]) != sequence) {
+        return; // Acknowledgement of a resent message
+    }
+
+    rtc_buffer_unref(buffer);
+    session->signal_head++;
+    if (session->signal_head < session->signals->size) {
+        pomelo_webrtc_session_ws_send_signal_head(session);
+        return;
+    }
+
+    // All messages have been acknowledged
+    pomelo_array_clear(session->signals);
+    session->signal_head = 0;
+    pomelo_webrtc_context_unschedule_task(
+        session->context,
+        session->signal_task
+    );
+    session->signal_task = NULL;
+}
+
+
+/// @brief Send a signaling message over system channel until it is
+/// acknowledged
+static void pomelo_webrtc_session_ws_queue_signal(
+    pomelo_webrtc_session_t * session,
+    const char * message,
+    size_t length
+) {
+    uint8_t * data = NULL;
+    rtc_buffer_t * buffer = rtc_buffer_prepare(
+        session->context->rtc_context,
+        length + SYS_SIGNAL_HEADER_BYTES,
+        &data
+    );
+    if (!buffer) {
+        // Negotiation cannot go on without this message
+        pomelo_webrtc_session_close(session);
+        return; // Failed to allocate buffer
+    }
+
+    uint16_t sequence = session->signal_send_sequence++;
+    data[0] = (uint8_t) (SYS_OPCODE_SIGNAL << 6);
+    data[1] = (uint8_t) (sequence >> 8);
+    data[2] = (uint8_t) sequence;
+    memcpy(data + SYS_SIGNAL_HEADER_BYTES, message, length);
+    if (!pomelo_array_append(session->signals, buffer)) {
+        rtc_buffer_unref(buffer);
+        pomelo_webrtc_session_close(session);
+        return; // Failed to queue the message
+    }
+
+    if (session->signal_task) {
+        return; // Sent after the previous messages are acknowledged
+    }
+
+    pomelo_webrtc_session_ws_send_signal_head(session);
+    pomelo_webrtc_variant_t args[] = {{ .ptr = session }};
+    session->signal_task = pomelo_webrtc_context_schedule_task(
+        session->context,
+        pomelo_webrtc_session_ws_resend_signal_callback,
+        POMELO_ARRAY_LENGTH(args),
+        args,
+        SYS_SIGNAL_RESEND_INTERVAL_MS
+    );
+    if (!session->signal_task) {
+        pomelo_webrtc_session_close(session);
+    }
+}
+
+
+/// @brief Check if a message starts with an opcode and its separator
+static bool pomelo_webrtc_session_ws_has_opcode(
+    const uint8_t * message,
+    size_t length,
+    const char * opcode,
+    size_t opcode_length
+) {
+    return length > opcode_length &&
+        memcmp(message, opcode, opcode_length) == 0 &&
+        message[opcode_length] == MESSAGE_SEPARATOR;
+}
+
+
+/// @brief Check if a message of system channel is a signaling message. Other
+/// opcodes of websocket, such as READY or DONE, are not accepted there.
+static bool pomelo_webrtc_session_ws_is_signal(
+    const uint8_t * message,
+    size_t length
+) {
+    return (
+        pomelo_webrtc_session_ws_has_opcode(
+            message, length,
+            OPCODE_DESCRIPTION, sizeof(OPCODE_DESCRIPTION) - 1
+        ) ||
+        pomelo_webrtc_session_ws_has_opcode(
+            message, length,
+            OPCODE_CANDIDATE, sizeof(OPCODE_CANDIDATE) - 1
+        ) ||
+        pomelo_webrtc_session_ws_has_opcode(
+            message, length,
+            OPCODE_CANDIDATES, sizeof(OPCODE_CANDIDATES) - 1
+        )
+    );
+}
+
+
+/// @brief Send a signaling message over websocket, or over system channel
+/// when websocket has been released
+static void pomelo_webrtc_session_ws_send_signal(
+    pomelo_webrtc_session_t * session,
+    const char * message,
+    size_t length
+) {
+    if (pomelo_webrtc_session_ws_is_active(session)) {
+        rtc_websocket_client_send_binary(
+            session->ws_client,
+            (const uint8_t *) message,
+            length
+        );
+        return;
+    }
+
+    if (
+        !pomelo_webrtc_session_ws_is_released(session) ||
+        !pomelo_webrtc_session_is_active(session)
+    ) {
+        return; // Signaling is closed
+    }
+
+    pomelo_webrtc_session_ws_queue_signal(session, message, length);
+}
+
+
 /* -------------------------------------------------------------------------- */
 /*                                 Public APIs                                */
 /* -------------------------------------------------------------------------- */
@@ -174,6 +397,8 @@ int pomelo_webrtc_session_ws_init(
 
 void pomelo_webrtc_session_ws_cleanup(pomelo_webrtc_session_t * session) {
     assert(session != NULL);
+    pomelo_webrtc_session_ws_clear_candidates(session);
+    pomelo_webrtc_session_ws_discard_signals(session);
 
     // Delete the websocket & peer connection
     if (session->ws_client) {
@@ -189,20 +414,64 @@ void pomelo_webrtc_session_ws_close(pomelo_webrtc_session_t * session) {
         return;
     }
     pomelo_webrtc_session_ws_unset_active(session);
+    pomelo_webrtc_session_ws_clear_candidates(session);
 
     rtc_websocket_client_close(session->ws_client);
     // => pomelo_webrtc_session_ws_on_closed
 }
 
 
+void pomelo_webrtc_session_ws_release(pomelo_webrtc_session_t * session) {
+    assert(session != NULL);
+    if (!pomelo_webrtc_session_ws_is_active(session)) {
+        return;
+    }
+
+    // The pending candidates are the last ones sent over websocket
+    pomelo_webrtc_session_ws_flush_candidates(session);
+    rtc_websocket_client_send_binary(
+        session->ws_client,
+        (const uint8_t *) OPCODE_RELEASE,
+        sizeof(OPCODE_RELEASE) - 1
+    );
+
+    // Closing of the released websocket does not close the session
+    session->flags |= POMELO_WEBRTC_SESSION_FLAG_WS_RELEASED;
+    pomelo_webrtc_session_ws_close(session);
+}
+
+
+void pomelo_webrtc_session_ws_discard_signals(
+    pomelo_webrtc_session_t * session
+) {
+    assert(session != NULL);
+    if (session->signal_task) {
+        pomelo_webrtc_context_unschedule_task(
+            session->context,
+            session->signal_task
+        );
+        session->signal_task = NULL;
+    }
+
+    size_t size = session->signals->size;
+    for (size_t i = session->signal_head; i < size; i++) {
+        rtc_buffer_t * buffer = NULL;
+        pomelo_array_get(session->signals, i, &buffer);
+        if (buffer) rtc_buffer_unref(buffer);
+    }
+    pomelo_array_clear(session->signals);
+    session->signal_head = 0;
+}
+
+
 void pomelo_webrtc_session_ws_send_description(
     pomelo_webrtc_session_t * session,
     const char * sdp,
     const char * type
 ) {
     assert(session != NULL);
-    if (!pomelo_webrtc_session_ws_is_active(session)) {
-        return; // WS is deactivated
+    if (!pomelo_webrtc_session_ws_can_signal(session)) {
+        return; // Signaling is closed
     }
 
     pomelo_webrtc_context_t * context = session->context;
@@ -220,11 +489,7 @@ void pomelo_webrtc_session_ws_send_description(
     const char * response = NULL;
     size_t response_length = 0;
     pomelo_string_buffer_to_binary(buffer, &response, &response_length);
-    rtc_websocket_client_send_binary(
-        session->ws_client,
-        (const uint8_t *) response,
-        response_length
-    );
+    pomelo_webrtc_session_ws_send_signal(session, response, response_length);
 
     // Finally release the buffer
     pomelo_webrtc_context_release_string_buffer(context, buffer);
@@ -237,11 +502,48 @@ void pomelo_webrtc_session_ws_send_candidate(
     const char * mid
 ) {
     assert(session != NULL);
-    if (!pomelo_webrtc_session_ws_is_active(session)) {
-        return; // WS is deactivated
+    if (!pomelo_webrtc_session_ws_can_signal(session)) {
+        return; // Signaling is closed
     }
 
     pomelo_webrtc_context_t * context = session->context;
+    if (session->features & POMELO_WEBRTC_FEATURE_CANDIDATES) {
+        // Collect the candidate into the pending frame
+        pomelo_string_buffer_t * pending = session->pending_candidates;
+        if (!pending) {
+            pending = pomelo_webrtc_context_acquire_string_buffer(context);
+            if (!pending) return; // Cannot acquire new string buffer
+
+            pomelo_webrtc_variant_t args[] = {{ .ptr = session }};
+            session->task_candidates = pomelo_webrtc_context_schedule_task(
+                context,
+                pomelo_webrtc_session_ws_flush_candidates_callback,
+                POMELO_ARRAY_LENGTH(args),
+                args,
+                CANDIDATES_BATCH_WINDOW_MS
+            );
+            if (!session->task_candidates) {
+                pomelo_webrtc_context_release_string_buffer(context, pending);
+                return; // Cannot schedule flushing
+            }
+
+            session->pending_candidates = pending;
+            pomelo_string_buffer_append_str(pending, OPCODE_CANDIDATES);
+        }
+
+        // Format: <opcode>|<mid>|<cand>|<mid>|<cand>...
+        pomelo_string_buffer_append_chr(pending, MESSAGE_SEPARATOR);
+        pomelo_string_buffer_append_str(pending, mid);
+        pomelo_string_buffer_append_chr(pending, MESSAGE_SEPARATOR);
+        pomelo_string_buffer_append_str(pending, cand);
+
+        session->pending_candidates_count++;
+        if (session->pending_candidates_count >= CANDIDATES_BATCH_MAX_COUNT) {
+            pomelo_webrtc_session_ws_flush_candidates(session);
+        }
+        return;
+    }
+
     pomelo_string_buffer_t * buffer =
         pomelo_webrtc_context_acquire_string_buffer(context);
     if (!buffer) return; // Cannot acquire new string buffer
@@ -256,17 +558,34 @@ void pomelo_webrtc_session_ws_send_candidate(
     const char * response = NULL;
     size_t response_length = 0;
     pomelo_string_buffer_to_binary(buffer, &response, &response_length);
-    rtc_websocket_client_send_binary(
-        session->ws_client,
-        (const uint8_t *) response,
-        response_length
-    );
+    pomelo_webrtc_session_ws_send_signal(session, response, response_length);
 
     // Finally release the buffer
     pomelo_webrtc_context_release_string_buffer(context, buffer);
 }
 
 
+void pomelo_webrtc_session_ws_flush_candidates(
+    pomelo_webrtc_session_t * session
+) {
+    assert(session != NULL);
+
+    pomelo_string_buffer_t * pending = session->pending_candidates;
+    if (!pending) {
+        return; // Nothing to flush
+    }
+
+    if (pomelo_webrtc_session_ws_can_signal(session)) {
+        const char * message = NULL;
+        size_t length = 0;
+        pomelo_string_buffer_to_binary(pending, &message, &length);
+        pomelo_webrtc_session_ws_send_signal(session, message, length);
+    }
+
+    pomelo_webrtc_session_ws_clear_candidates(session);
+}
+
+
 void pomelo_webrtc_session_ws_send_ready(pomelo_webrtc_session_t * session) {
     assert(session != NULL);
     if (!pomelo_webrtc_session_ws_is_active(session)) {
@@ -296,91 +615,174 @@ void pomelo_webrtc_session_ws_send_connected(
     );
 }
 
-/* -------------------------------------------------------------------------- */
-/*                                Private APIs                                */
-/* -------------------------------------------------------------------------- */
 
-void pomelo_webrtc_session_ws_recv_auth(
-    pomelo_webrtc_session_t * session,
-    const char * auth,
-    size_t auth_length
-) {
-    assert(session != NULL);
-    assert(auth != NULL);
 
-    if (
-        auth_length != POMELO_CONNECT_TOKEN_BASE64_LENGTH &&
-        auth_length != POMELO_CONNECT_TOKEN_BASE64_NO_PADDING_LENGTH
-    ) {
-        // Invalid auth token
-        pomelo_webrtc_session_ws_auth_result(session, NULL);
-        return;
+void pomelo_webrtc_session_ws_send_early(pomelo_webrtc_session_t * session) {
+    assert(session != NULL);
+    if (!pomelo_webrtc_session_ws_is_active(session)) {
+        return; // WS is deactivated
     }
 
-    pomelo_webrtc_context_t * context = session->context;
-    assert(context != NULL);
+    rtc_websocket_client_send_binary(
+        session->ws_client,
+        (const uint8_t *) OPCODE_EARLY,
+        sizeof(OPCODE_EARLY) - 1
+    );
+}
 
-    uint8_t connect_token[POMELO_CONNECT_TOKEN_BYTES] = { 0 };
 
-    // Convert message to base64
-    int ret = pomelo_base64_decode(
-        connect_token,
-        POMELO_CONNECT_TOKEN_BYTES,
-        auth,
-        auth_length
-    );
-    if (ret < 0) {
-        // Failed to decode connect token
-        pomelo_webrtc_session_ws_auth_result(session, NULL);
-        return;
+void pomelo_webrtc_session_ws_send_data(
+    pomelo_webrtc_session_t * session,
+    pomelo_webrtc_channel_t * channel,
+    const uint8_t * message,
+    size_t length
+) {
+    assert(session != NULL);
+    assert(channel != NULL);
+    assert(message != NULL);
+    if (!pomelo_webrtc_session_ws_is_active(session)) {
+        pomelo_webrtc_channel_count_send_dropped(channel);
+        return; // WS is deactivated
     }
 
-    // Decode the connect token
-    pomelo_plugin_t * plugin = context->plugin;
-    int64_t client_id = 0;
-    int32_t timeout = 0;
-    pomelo_plugin_token_info_t info = { 0 };
-    info.client_id = &client_id;
-    info.timeout = &timeout;
-
-    ret = plugin->connect_token_decode(
-        plugin,
-        session->socket->native_socket,
-        connect_token,
-        &info
+    // Packed channels expect a packed message of one message
+    size_t header_size = EARLY_DATA_HEADER_BYTES;
+    if (pomelo_webrtc_channel_is_aggregated(channel)) {
+        header_size +=
+            pomelo_webrtc_channel_aggregate_write_length(NULL, length);
+    }
+
+    uint8_t * data = NULL;
+    rtc_buffer_t * buffer = rtc_buffer_prepare(
+        session->context->rtc_context,
+        header_size + length,
+        &data
     );
+    if (!buffer) {
+        pomelo_webrtc_channel_count_send_dropped(channel);
+        return; // Failed to allocate buffer
+    }
 
-    if (ret < 0) {
-        pomelo_webrtc_session_ws_auth_result(session, NULL);
-        return;
+    // Format: [0][2 bytes: channel index][message]
+    data[0] = EARLY_DATA_TAG;
+    data[1] = (uint8_t) (channel->index >> 8);
+    data[2] = (uint8_t) channel->index;
+    if (pomelo_webrtc_channel_is_aggregated(channel)) {
+        pomelo_webrtc_channel_aggregate_write_length(
+            data + EARLY_DATA_HEADER_BYTES,
+            length
+        );
     }
+    memcpy(data + header_size, message, length);
 
-    session->client_id = client_id;
-    pomelo_webrtc_session_ws_auth_result(session, &info);
+    int ret = rtc_websocket_client_send_binary(
+        session->ws_client,
+        data,
+        header_size + length
+    );
+    pomelo_webrtc_channel_count_send(channel, ret, header_size + length);
+    rtc_buffer_unref(buffer);
 }
 
 
-void pomelo_webrtc_session_ws_auth_result(
+int pomelo_webrtc_session_ws_address(
     pomelo_webrtc_session_t * session,
-    pomelo_plugin_token_info_t * info
+    pomelo_address_t * address
 ) {
     assert(session != NULL);
+    assert(address != NULL);
 
-    if (info) {
-        // Set as authenticated
-        pomelo_webrtc_session_ws_set_authenticated(session);
-        pomelo_webrtc_session_ws_send_auth_success(session);
-    } else {
-        rtc_websocket_client_send_binary(
-            session->ws_client,
-            (const uint8_t *) RESULT_AUTH_FAILED,
-            sizeof(RESULT_AUTH_FAILED) - 1
-        );
+    char address_str[ADDRESS_BUFFER_LENGTH];
+    rtc_websocket_client_remote_address(
+        session->ws_client,
+        address_str,
+        ADDRESS_BUFFER_LENGTH
+    );
+
+    return pomelo_address_from_string(address, address_str);
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                Module APIs                                 */
+/* -------------------------------------------------------------------------- */
+
+/// @brief Known features
+static const struct {
+    const char * name;
+    uint32_t flag;
+} pomelo_webrtc_ws_features[] = {
+    { FEATURE_CANDIDATES, POMELO_WEBRTC_FEATURE_CANDIDATES },
+    { FEATURE_SEQUENCE, POMELO_WEBRTC_FEATURE_SEQUENCE },
+    { FEATURE_FRAGMENT, POMELO_WEBRTC_FEATURE_FRAGMENT },
+    { FEATURE_COMPRESSION, POMELO_WEBRTC_FEATURE_COMPRESSION },
+    { FEATURE_AGGREGATION, POMELO_WEBRTC_FEATURE_AGGREGATION },
+    { FEATURE_EARLY_DATA, POMELO_WEBRTC_FEATURE_EARLY_DATA },
+    { FEATURE_WS_RELEASE, POMELO_WEBRTC_FEATURE_WS_RELEASE }
+};
+
+#define KNOWN_FEATURES_COUNT POMELO_ARRAY_LENGTH(pomelo_webrtc_ws_features)
+
+
+uint32_t pomelo_webrtc_ws_parse_features(
+    const char * features,
+    size_t length
+) {
+    assert(features != NULL);
+
+    // The list is present, even if it is empty
+    uint32_t result = POMELO_WEBRTC_FEATURE_NEGOTIATED;
+    const char * end = features + length;
+    const char * position = features;
+    while (position < end) {
+        const char * name_end =
+            memchr(position, FEATURE_SEPARATOR, end - position);
+        if (!name_end) name_end = end;
+        size_t name_length = name_end - position;
+
+        for (size_t i = 0; i < KNOWN_FEATURES_COUNT; i++) {
+            const char * name = pomelo_webrtc_ws_features[i].name;
+            if (
+                strlen(name) == name_length &&
+                memcmp(name, position, name_length) == 0
+            ) {
+                result |= pomelo_webrtc_ws_features[i].flag;
+                break;
+            }
+        }
+
+        position = name_end + 1;
     }
 
-    pomelo_webrtc_session_on_auth_result(session, info);
+    return result;
+}
+
+
+void pomelo_webrtc_ws_append_features(
+    pomelo_string_buffer_t * buffer,
+    uint32_t features
+) {
+    assert(buffer != NULL);
+
+    bool first = true;
+    for (size_t i = 0; i < KNOWN_FEATURES_COUNT; i++) {
+        if (!(features & pomelo_webrtc_ws_features[i].flag)) {
+            continue;
+        }
+
+        if (!first) {
+            pomelo_string_buffer_append_chr(buffer, FEATURE_SEPARATOR);
+        }
+        pomelo_string_buffer_append_str(
+            buffer,
+            pomelo_webrtc_ws_features[i].name
+        );
+        first = false;
+    }
 }
 
+/* -------------------------------------------------------------------------- */
+/*                                Private APIs                                */
+/* -------------------------------------------------------------------------- */
 
 void pomelo_webrtc_session_ws_send_auth_success(
     pomelo_webrtc_session_t * session
@@ -403,6 +805,12 @@ void pomelo_webrtc_session_ws_send_auth_success(
     pomelo_string_buffer_append_chr(buffer, MESSAGE_SEPARATOR);
     pomelo_string_buffer_append_u64(buffer, time);
 
+    if (session->features & POMELO_WEBRTC_FEATURE_NEGOTIATED) {
+        // Only reply the accepted features to the clients which sent theirs
+        pomelo_string_buffer_append_chr(buffer, MESSAGE_SEPARATOR);
+        pomelo_webrtc_ws_append_features(buffer, session->features);
+    }
+
     const char * message = NULL;
     size_t length = 0;
     pomelo_string_buffer_to_binary(buffer, &message, &length);
@@ -418,58 +826,33 @@ void pomelo_webrtc_session_ws_send_auth_success(
 }
 
 
-void pomelo_webrtc_session_ws_process_message(
-    pomelo_webrtc_session_t * session,
-    const char * message,
-    size_t size
-) {
-    assert(session != NULL);
-    assert(message != NULL);
-
-    if (pomelo_webrtc_session_ws_is_authenticated(session)) {
-        pomelo_webrtc_session_ws_on_message_authenticated(
-            session, message, size - 1
-        );
-    } else {
-        pomelo_webrtc_session_ws_on_message_unauthenticated(
-            session, message, size - 1
-        );
-    }
-}
-
-
-void pomelo_webrtc_session_ws_on_message_unauthenticated(
-    pomelo_webrtc_session_t * session,
-    const char * message,
-    size_t message_length
+void pomelo_webrtc_session_ws_send_auth_failed(
+    pomelo_webrtc_session_t * session
 ) {
     assert(session != NULL);
-    assert(message != NULL);
-
-    if (message_length <= sizeof(OPCODE_AUTH)) {
-        return;
-    }
-
-    if (!opcode_cmp(message, OPCODE_AUTH)) {
-        return;
+    if (!pomelo_webrtc_session_ws_is_active(session)) {
+        return; // WS is deactivated
     }
 
-    pomelo_webrtc_session_ws_recv_auth(
-        session,
-        message + sizeof(OPCODE_AUTH), // Ingore separator
-        message_length - sizeof(OPCODE_AUTH) // Ingore separator
+    rtc_websocket_client_send_binary(
+        session->ws_client,
+        (const uint8_t *) RESULT_AUTH_FAILED,
+        sizeof(RESULT_AUTH_FAILED) - 1
     );
 }
 
 
-void pomelo_webrtc_session_ws_on_message_authenticated(
+void pomelo_webrtc_session_ws_process_message(
     pomelo_webrtc_session_t * session,
     const char * message,
-    size_t message_length
+    size_t size
 ) {
     assert(session != NULL);
     assert(message != NULL);
 
+    // Ignore the terminated character
+    size_t message_length = size - 1;
+
     // Check description opcode
     if (opcode_cmp(message, OPCODE_DESCRIPTION)) {
         pomelo_webrtc_session_ws_process_description_message(
@@ -480,6 +863,17 @@ void pomelo_webrtc_session_ws_on_message_authenticated(
         return;
     }
 
+    // Check multi-candidate opcode (before candidate opcode, they have the
+    // same prefix)
+    if (opcode_cmp(message, OPCODE_CANDIDATES)) {
+        pomelo_webrtc_session_ws_process_candidates_message(
+            session,
+            message + sizeof(OPCODE_CANDIDATES),
+            message_length - sizeof(OPCODE_CANDIDATES)
+        );
+        return;
+    }
+
     // Check candidate opcode
     if (opcode_cmp(message, OPCODE_CANDIDATE)) {
         pomelo_webrtc_session_ws_process_candidate_message(
@@ -495,6 +889,102 @@ void pomelo_webrtc_session_ws_on_message_authenticated(
         pomelo_webrtc_session_recv_ready(session);
         return;
     }
+
+    // Check opcode done
+    if (opcode_cmp(message, OPCODE_DONE)) {
+        pomelo_webrtc_session_recv_done(session);
+        return;
+    }
+}
+
+
+void pomelo_webrtc_session_ws_process_data(
+    pomelo_webrtc_session_t * session,
+    rtc_buffer_t * message
+) {
+    assert(session != NULL);
+    assert(message != NULL);
+    if (!(session->flags & POMELO_WEBRTC_SESSION_FLAG_EARLY_RECV)) {
+        return; // Client has switched to data channels
+    }
+
+    size_t size = rtc_buffer_size(message);
+    if (size <= EARLY_DATA_HEADER_BYTES) {
+        return; // No payload
+    }
+
+    const uint8_t * data = rtc_buffer_data(message);
+    size_t index = ((size_t) data[1] << 8) | (size_t) data[2];
+
+    pomelo_webrtc_channel_t * channel = NULL;
+    pomelo_array_get(session->channels, index, &channel);
+    if (!channel) {
+        return; // Unknown channel
+    }
+
+    pomelo_webrtc_channel_count_recv(channel, size);
+    pomelo_webrtc_channel_receive_early(
+        channel,
+        message,
+        EARLY_DATA_HEADER_BYTES
+    );
+}
+
+
+void pomelo_webrtc_session_ws_process_signal(
+    pomelo_webrtc_session_t * session,
+    const uint8_t * message,
+    size_t length
+) {
+    assert(session != NULL);
+    assert(message != NULL);
+    if (!pomelo_webrtc_session_ws_is_released(session)) {
+        return; // Signaling is carried by websocket
+    }
+    if (length < SYS_SIGNAL_HEADER_BYTES) {
+        return; // Invalid frame
+    }
+
+    uint16_t sequence = ((uint16_t) message[1] << 8) | message[2];
+    if (message[0] & SYS_SIGNAL_FLAG_ACK) {
+        pomelo_webrtc_session_ws_recv_signal_ack(session, sequence);
+        return;
+    }
+
+    if (sequence != session->signal_recv_sequence) {
+        if ((uint16_t) (sequence + 1) == session->signal_recv_sequence) {
+            // The acknowledgement has been lost, the client resent it
+            pomelo_webrtc_session_ws_ack_signal(session, sequence);
+        }
+        return; // Not in order, the client resends it
+    }
+    session->signal_recv_sequence++;
+    pomelo_webrtc_session_ws_ack_signal(session, sequence);
+
+    message += SYS_SIGNAL_HEADER_BYTES;
+    length -= SYS_SIGNAL_HEADER_BYTES;
+    if (!pomelo_webrtc_session_ws_is_signal(message, length)) {
+        return; // Only descriptions and candidates are accepted
+    }
+
+    pomelo_webrtc_context_t * context = session->context;
+    pomelo_string_buffer_t * buffer =
+        pomelo_webrtc_context_acquire_string_buffer(context);
+    if (!buffer) return; // Cannot acquire new string buffer
+
+    // Messages are processed as the terminated strings of websocket
+    pomelo_string_buffer_append_bin(buffer, (const char *) message, length);
+
+    const char * signal = NULL;
+    size_t signal_length = 0;
+    pomelo_string_buffer_to_string(buffer, &signal, &signal_length);
+    pomelo_webrtc_session_ws_process_message(
+        session,
+        signal,
+        signal_length + 1
+    );
+
+    pomelo_webrtc_context_release_string_buffer(context, buffer);
 }
 
 
@@ -573,9 +1063,100 @@ void pomelo_webrtc_session_ws_process_candidate_message(
 }
 
 
+void pomelo_webrtc_session_ws_process_candidates_message(
+    pomelo_webrtc_session_t * session,
+    const char * message,
+    size_t size
+) {
+    assert(session != NULL);
+    assert(message != NULL);
+
+    pomelo_webrtc_context_t * context = session->context;
+    pomelo_string_buffer_t * mid_buffer =
+        pomelo_webrtc_context_acquire_string_buffer(context);
+    if (!mid_buffer) return; // Cannot acquire new string buffer
+
+    pomelo_string_buffer_t * cand_buffer =
+        pomelo_webrtc_context_acquire_string_buffer(context);
+    if (!cand_buffer) {
+        pomelo_webrtc_context_release_string_buffer(context, mid_buffer);
+        return; // Cannot acquire new string buffer
+    }
+
+    // Format: <mid>|<cand>|<mid>|<cand>...
+    const char * end = message + size;
+    const char * position = message;
+    while (position < end) {
+        const char * mid_end =
+            memchr(position, MESSAGE_SEPARATOR, end - position);
+        if (!mid_end) break; // Missing candidate
+
+        const char * cand_begin = mid_end + 1;
+        const char * cand_end =
+            memchr(cand_begin, MESSAGE_SEPARATOR, end - cand_begin);
+        if (!cand_end) cand_end = end;
+
+        // Reset the buffers
+        pomelo_string_buffer_init(mid_buffer, NULL);
+        pomelo_string_buffer_init(cand_buffer, NULL);
+
+        pomelo_string_buffer_append_bin(
+            mid_buffer, position, mid_end - position
+        );
+        pomelo_string_buffer_append_bin(
+            cand_buffer, cand_begin, cand_end - cand_begin
+        );
+
+        const char * mid = NULL;
+        const char * cand = NULL;
+        pomelo_string_buffer_to_string(mid_buffer, &mid, NULL);
+        pomelo_string_buffer_to_string(cand_buffer, &cand, NULL);
+        pomelo_webrtc_session_recv_remote_candidate(session, cand, mid);
+
+        position = cand_end + 1;
+    }
+
+    // Finally, release string buffers
+    pomelo_webrtc_context_release_string_buffer(context, mid_buffer);
+    pomelo_webrtc_context_release_string_buffer(context, cand_buffer);
+}
+
+
+void pomelo_webrtc_session_ws_clear_candidates(
+    pomelo_webrtc_session_t * session
+) {
+    assert(session != NULL);
+    pomelo_webrtc_context_t * context = session->context;
+
+    if (session->task_candidates) {
+        pomelo_webrtc_context_unschedule_task(
+            context,
+            session->task_candidates
+        );
+        session->task_candidates = NULL;
+    }
+
+    if (session->pending_candidates) {
+        pomelo_webrtc_context_release_string_buffer(
+            context,
+            session->pending_candidates
+        );
+        session->pending_candidates = NULL;
+    }
+
+    session->pending_candidates_count = 0;
+}
+
+
 void pomelo_webrtc_session_ws_on_closed(pomelo_webrtc_session_t * session) {
     assert(session != NULL);
 
-    pomelo_webrtc_session_close(session);
+    if (pomelo_webrtc_session_ws_is_released(session)) {
+        // Session lives on without its websocket, free it right away
+        rtc_websocket_client_destroy(session->ws_client);
+        session->ws_client = NULL;
+    } else {
+        pomelo_webrtc_session_close(session);
+    }
     pomelo_webrtc_session_unref(session); // WS no longer references session
 }
@@ -48,6 +48,17 @@ void pomelo_webrtc_session_ws_cleanup(pomelo_webrtc_session_t * session);
 void pomelo_webrtc_session_ws_close(pomelo_webrtc_session_t * session);
 
 
+/// @brief Close WS part of session, but keep the session. Later signaling is
+/// carried by the system channel.
+void pomelo_webrtc_session_ws_release(pomelo_webrtc_session_t * session);
+
+
+/// @brief Stop resending the signaling messages over system channel
+void pomelo_webrtc_session_ws_discard_signals(
+    pomelo_webrtc_session_t * session
+);
+
+
 /// @brief Send description to client
 void pomelo_webrtc_session_ws_send_description(
     pomelo_webrtc_session_t * session,
@@ -64,6 +75,12 @@ void pomelo_webrtc_session_ws_send_candidate(
 );
 
 
+/// @brief Send all pending local candidates in a single frame
+void pomelo_webrtc_session_ws_flush_candidates(
+    pomelo_webrtc_session_t * session
+);
+
+
 /// @brief Send ready signal
 void pomelo_webrtc_session_ws_send_ready(pomelo_webrtc_session_t * session);
 
@@ -71,24 +88,45 @@ void pomelo_webrtc_session_ws_send_ready(pomelo_webrtc_session_t * session);
 /// @brief Send connected signal
 void pomelo_webrtc_session_ws_send_connected(pomelo_webrtc_session_t * session);
 
-/* -------------------------------------------------------------------------- */
-/*                                Private APIs                                */
-/* -------------------------------------------------------------------------- */
 
-/// @brief Receive authentication information
-void pomelo_webrtc_session_ws_recv_auth(
+/// @brief Send the signal that messages can be exchanged over websocket
+void pomelo_webrtc_session_ws_send_early(pomelo_webrtc_session_t * session);
+
+
+/// @brief Send a message of channel over websocket. The message does not
+/// include the headers of data channel.
+void pomelo_webrtc_session_ws_send_data(
     pomelo_webrtc_session_t * session,
-    const char * auth,
-    size_t auth_length
+    pomelo_webrtc_channel_t * channel,
+    const uint8_t * message,
+    size_t length
 );
 
 
-/// @brief Process auth result
-void pomelo_webrtc_session_ws_auth_result(
+/// @brief Get the remote address of websocket
+int pomelo_webrtc_session_ws_address(
     pomelo_webrtc_session_t * session,
-    pomelo_plugin_token_info_t * info
+    pomelo_address_t * address
+);
+
+/* -------------------------------------------------------------------------- */
+/*                                Module APIs                                 */
+/* -------------------------------------------------------------------------- */
+
+/// @brief Parse the comma-separated list of features from client. Unknown
+/// features are ignored.
+uint32_t pomelo_webrtc_ws_parse_features(const char * features, size_t length);
+
+
+/// @brief Append the comma-separated list of features to buffer
+void pomelo_webrtc_ws_append_features(
+    pomelo_string_buffer_t * buffer,
+    uint32_t features
 );
 
+/* -------------------------------------------------------------------------- */
+/*                                Private APIs                                */
+/* -------------------------------------------------------------------------- */
 
 /// @brief Send auth success
 void pomelo_webrtc_session_ws_send_auth_success(
@@ -96,6 +134,12 @@ void pomelo_webrtc_session_ws_send_auth_success(
 );
 
 
+/// @brief Send auth failure
+void pomelo_webrtc_session_ws_send_auth_failed(
+    pomelo_webrtc_session_t * session
+);
+
+
 /// @brief Process when received description from client
 void pomelo_webrtc_session_ws_recv_description(
     pomelo_webrtc_session_t * session,
@@ -112,28 +156,28 @@ void pomelo_webrtc_session_ws_recv_candidate(
 );
 
 
-/// @brief Process the message
-void pomelo_webrtc_session_ws_process_message(
+/// @brief Process a message of channel which has been received over
+/// websocket
+void pomelo_webrtc_session_ws_process_data(
     pomelo_webrtc_session_t * session,
-    const char * message,
-    size_t size
+    rtc_buffer_t * message
 );
 
 
-/// @brief Process WebSocket message when session state is authenticating
-void pomelo_webrtc_session_ws_on_message_unauthenticated(
+/// @brief Process a signaling frame which has been received over system
+/// channel, including its header byte
+void pomelo_webrtc_session_ws_process_signal(
     pomelo_webrtc_session_t * session,
-    const char * message,
-    size_t message_length
+    const uint8_t * message,
+    size_t length
 );
 
 
-/// @brief Process WebSocket message when session state is either exchanging or
-/// connected
-void pomelo_webrtc_session_ws_on_message_authenticated(
+/// @brief Process the message
+void pomelo_webrtc_session_ws_process_message(
     pomelo_webrtc_session_t * session,
     const char * message,
-    size_t message_length
+    size_t size
 );
 
 
@@ -153,6 +197,20 @@ void pomelo_webrtc_session_ws_process_candidate_message(
 );
 
 
+/// @brief Process the multi-candidate message
+void pomelo_webrtc_session_ws_process_candidates_message(
+    pomelo_webrtc_session_t * session,
+    const char * message,
+    size_t size
+);
+
+
+/// @brief Release the pending local candidates
+void pomelo_webrtc_session_ws_clear_candidates(
+    pomelo_webrtc_session_t * session
+);
+
+
 /// @brief Process when WS is closed
 void pomelo_webrtc_session_ws_on_closed(
     pomelo_webrtc_session_t * session
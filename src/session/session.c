@@ -7,9 +7,11 @@
 #include "socket/socket.h"
 #include "context.h"
 #include "channel/channel.h"
+#include "channel/channel-int.h"
 #include "session-ws.h"
 #include "session-pc.h"
 #include "session-plugin.h"
+#include "log/log.h"
 
 
 // Ping inteval
@@ -32,6 +34,12 @@
 
 #define SESSIONS_INIT_CHANNELS_CAPACITY 64
 
+// Number of pings between two samples of periodic statistics (1 second)
+#define STATS_PING_INTERVAL 10
+
+// 1 byte for header and 2 bytes for loss fraction
+#define SYS_LOSS_REPORT_LENGTH 3
+
 /// Activate the session
 #define pomelo_webrtc_session_set_active(session)                              \
 POMELO_SET_FLAG((session)->flags, POMELO_WEBRTC_SESSION_FLAG_ACTIVE)
@@ -58,6 +66,7 @@ int pomelo_webrtc_session_on_alloc(
 ) {
     assert(session != NULL);
     assert(context != NULL);
+    session->ws_owner = POMELO_WEBRTC_WS_OWNER_SESSION;
     session->context = context;
 
     pomelo_allocator_t * allocator = context->allocator;
@@ -70,18 +79,37 @@ int pomelo_webrtc_session_on_alloc(
 
     session->channels = pomelo_array_create(&options);
     if (!session->channels) return -1;
+
+    options.element_size = sizeof(rtc_buffer_t *);
+    session->signals = pomelo_array_create(&options);
+    if (!session->signals) return -1;
     return 0;
 }
 
 
 void pomelo_webrtc_session_on_free(pomelo_webrtc_session_t * session) {
     assert(session != NULL);
-    session->context = NULL;
 
     if (session->channels) {
         pomelo_array_destroy(session->channels);
         session->channels = NULL;
     }
+
+    if (session->signals) {
+        pomelo_array_destroy(session->signals);
+        session->signals = NULL;
+    }
+
+    if (session->channel_traffic) {
+        pomelo_allocator_free(
+            session->context->allocator,
+            session->channel_traffic
+        );
+        session->channel_traffic = NULL;
+        session->channel_traffic_capacity = 0;
+    }
+
+    session->context = NULL;
 }
 
 
@@ -101,29 +129,74 @@ int pomelo_webrtc_session_init(
         (pomelo_ref_finalize_cb) pomelo_webrtc_session_on_finalize
     );
 
-    // Update properties and initialize websocket
+    // Update properties
     session->socket = socket;
+    session->client_id = info->client_id;
+    session->connect_timeout = info->connect_timeout;
+    session->features = info->features;
+    if (!session->context->config.early_data) {
+        // Only reply the features which are enabled
+        session->features &= ~POMELO_WEBRTC_FEATURE_EARLY_DATA;
+    }
+    if (!session->context->config.ws_release) {
+        session->features &= ~POMELO_WEBRTC_FEATURE_WS_RELEASE;
+    }
+    session->held_front = NULL;
+    session->held_back = NULL;
+    session->held_bytes = 0;
+    session->held_overflow = false;
+    session->held_task = NULL;
+    session->signal_head = 0;
+    session->signal_send_sequence = 0;
+    session->signal_recv_sequence = 0;
+    session->signal_task = NULL;
+    pomelo_webrtc_traffic_reset(&session->traffic);
+    pomelo_webrtc_transport_reset(&session->transport);
+    pomelo_webrtc_clock_reset(&session->clock);
+    pomelo_webrtc_rtt_reset(&session->rtt_stats);
+    pomelo_webrtc_loss_reset(&session->ping_loss);
+    pomelo_atomic_uint64_store(&session->uplink_loss, 0);
+    pomelo_atomic_uint64_store(&session->downlink_loss, 0);
+    pomelo_atomic_uint64_store(&session->uplink_expected, 0);
+    pomelo_atomic_uint64_store(&session->uplink_lost, 0);
+    pomelo_webrtc_pacer_init(&session->pacer, session);
+    session->reassembly_bytes = 0;
+    session->liveness_timeout_ms = session->context->config.liveness_timeout_ms;
+    pomelo_webrtc_session_init_compression(session);
+    pomelo_webrtc_session_init_aggregation(session);
     pomelo_webrtc_session_set_active(session);
 
+    // Continue tracking the handshake of pre-auth record. From now on, this
+    // session is responsible for reporting its result.
+    if (info->handshake) {
+        session->handshake = *info->handshake;
+        pomelo_webrtc_context_finish_handshake(
+            session->context,
+            info->handshake,
+            POMELO_WEBRTC_HANDSHAKE_RESULT_TRANSFERRED
+        );
+    } else {
+        pomelo_webrtc_handshake_stats_begin(
+            &session->context->handshake_stats,
+            &session->handshake
+        );
+    }
+
     // New session references the socket
     pomelo_webrtc_socket_ref(socket);
 
-    // Initialize Websocket
-    int ret = pomelo_webrtc_session_ws_init(session, ws_client);
-    if (ret < 0) return -1;
-
     // Initialize PC
-    ret = pomelo_webrtc_session_pc_init(session);
+    int ret = pomelo_webrtc_session_pc_init(session);
     if (ret < 0) return -1;
 
     // Initialize session plugin
     ret = pomelo_webrtc_session_plugin_init(session);
     if (ret < 0) return -1;
 
-    // Schedule for authenticating
-    pomelo_webrtc_task_t * task =
-        pomelo_webrtc_session_schedule_timeout(session, POMELO_AUTH_TIMEOUT_MS);
-    if (!task) return -1;
+    // Take the websocket at last, so that the websocket is still owned by the
+    // pre-auth record if anything above fails.
+    ret = pomelo_webrtc_session_ws_init(session, ws_client);
+    if (ret < 0) return -1;
 
     return 0;
 }
@@ -139,6 +212,9 @@ void pomelo_webrtc_session_cleanup(pomelo_webrtc_session_t * session) {
     pomelo_webrtc_session_ws_cleanup(session);
     pomelo_webrtc_session_pc_cleanup(session);
     pomelo_webrtc_session_plugin_cleanup(session);
+    pomelo_webrtc_pacer_cleanup(&session->pacer);
+    pomelo_webrtc_session_discard_held(session);
+    pomelo_webrtc_session_cleanup_compression(session);
 
     if (session->task_timeout) {
         pomelo_webrtc_context_unschedule_task(context, session->task_timeout);
@@ -153,13 +229,64 @@ void pomelo_webrtc_session_cleanup(pomelo_webrtc_session_t * session) {
     session->opened_channels = 0;
     session->ping_task = NULL;
     pomelo_rtt_calculator_init(&session->rtt);
+    session->last_pong_time = 0;
+    session->unanswered_pings = 0;
+    session->liveness_timeout_ms = 0;
     session->client_id = 0;
+    session->connect_timeout = 0;
+    session->features = 0;
+    session->channel_traffic_size = 0;
+    session->aggregated_channels = 0;
+
+    // No-op if the result has been reported
+    pomelo_webrtc_session_finish_handshake(
+        session,
+        POMELO_WEBRTC_HANDSHAKE_RESULT_FAILED
+    );
 
     // This session no longer references the socket
     pomelo_webrtc_socket_unref(socket);
 }
 
 
+void pomelo_webrtc_session_start(pomelo_webrtc_session_t * session) {
+    assert(session != NULL);
+    if (!pomelo_webrtc_session_is_active(session)) {
+        return; // Session is deactivated
+    }
+
+    // Notify client about the auth result
+    pomelo_webrtc_session_ws_send_auth_success(session);
+
+    // Initialize channels
+    if (pomelo_webrtc_session_create_channels(session) < 0) {
+        pomelo_webrtc_session_close(session);
+        return; // Failed to init channels
+    }
+
+    // Schedule negotiating
+    int32_t timeout = session->connect_timeout;
+    if (timeout > 0) {
+        pomelo_webrtc_task_t * task =
+            pomelo_webrtc_session_schedule_timeout(session, 1000ULL * timeout);
+        if (!task) {
+            pomelo_webrtc_session_close(session);
+            return; // Failed to create timeout
+        }
+    }
+
+    // Start negotiating
+    pomelo_webrtc_session_pc_negotiate(session);
+
+    if (session->features & POMELO_WEBRTC_FEATURE_EARLY_DATA) {
+        // The address of peer connection is not known yet
+        pomelo_webrtc_session_ws_address(session, &session->address);
+        pomelo_webrtc_session_plugin_open(session);
+        // => pomelo_webrtc_session_on_connected
+    }
+}
+
+
 void pomelo_webrtc_session_close(pomelo_webrtc_session_t * session) {
     // Just request close all elements
     assert(session != NULL);
@@ -169,9 +296,20 @@ void pomelo_webrtc_session_close(pomelo_webrtc_session_t * session) {
     }
     pomelo_webrtc_session_unset_active(session);
 
+    // No-op if the result has been reported
+    pomelo_webrtc_session_finish_handshake(
+        session,
+        POMELO_WEBRTC_HANDSHAKE_RESULT_FAILED
+    );
+
     // Stop sending ping
     pomelo_webrtc_session_stop_ping(session);
 
+    // Drop the paced and held messages, they reference the channels
+    pomelo_webrtc_pacer_cleanup(&session->pacer);
+    pomelo_webrtc_session_discard_held(session);
+    pomelo_webrtc_session_ws_discard_signals(session);
+
     // Close all channels
     size_t nchannels = session->channels->size;
     for (size_t i = 0; i < nchannels; i++) {
@@ -253,6 +391,14 @@ void pomelo_webrtc_session_process_system_message(
                 session, data, length, recv_time
             );
             break;
+
+        case SYS_OPCODE_LOSS_REPORT:
+            pomelo_webrtc_session_process_loss_report(session, data, length);
+            break;
+
+        case SYS_OPCODE_SIGNAL:
+            pomelo_webrtc_session_ws_process_signal(session, data, length);
+            break;
         
         default:
             break;
@@ -260,55 +406,263 @@ void pomelo_webrtc_session_process_system_message(
 }
 
 
-void pomelo_webrtc_session_ref(pomelo_webrtc_session_t * session) {
+bool pomelo_webrtc_session_is_channel_sequenced(
+    pomelo_webrtc_session_t * session,
+    size_t channel_index
+) {
     assert(session != NULL);
-    pomelo_reference_ref(&session->ref);
+    if (!(session->features & POMELO_WEBRTC_FEATURE_SEQUENCE)) {
+        return false;
+    }
+
+    // Modes of socket do not change while it has sessions
+    pomelo_channel_mode mode = POMELO_CHANNEL_MODE_RELIABLE;
+    pomelo_array_get(session->socket->channel_modes, channel_index, &mode);
+    return mode != POMELO_CHANNEL_MODE_RELIABLE;
 }
 
 
-void pomelo_webrtc_session_unref(pomelo_webrtc_session_t * session) {
+bool pomelo_webrtc_session_is_channel_fragmented(
+    pomelo_webrtc_session_t * session,
+    size_t channel_index
+) {
     assert(session != NULL);
-    pomelo_reference_unref(&session->ref);
+    if (!(session->features & POMELO_WEBRTC_FEATURE_FRAGMENT)) {
+        return false;
+    }
+
+    // Only reliable channels keep fragments in order and complete
+    pomelo_channel_mode mode = POMELO_CHANNEL_MODE_UNRELIABLE;
+    pomelo_array_get(session->socket->channel_modes, channel_index, &mode);
+    return mode == POMELO_CHANNEL_MODE_RELIABLE;
 }
 
 
-/* -------------------------------------------------------------------------- */
-/*                               Module APIs                                  */
-/* -------------------------------------------------------------------------- */
+bool pomelo_webrtc_session_is_channel_compressed(
+    pomelo_webrtc_session_t * session,
+    size_t channel_index
+) {
+    assert(session != NULL);
+    if (channel_index >= POMELO_WEBRTC_CONFIG_MAX_CHANNELS) {
+        return false;
+    }
+    return (session->compressed_channels >> channel_index) & 1;
+}
 
-void pomelo_webrtc_session_on_auth_result(
+
+bool pomelo_webrtc_session_is_channel_aggregated(
     pomelo_webrtc_session_t * session,
-    pomelo_plugin_token_info_t * info
+    size_t channel_index
 ) {
     assert(session != NULL);
+    if (channel_index >= POMELO_WEBRTC_CONFIG_MAX_CHANNELS) {
+        return false;
+    }
+    return (session->aggregated_channels >> channel_index) & 1;
+}
 
-    // Clear auth timeout
-    pomelo_webrtc_session_unschedule_timeout(session);
 
-    if (!info) {
-        pomelo_webrtc_session_close(session);
-        return; // Authenciating failed
+/// @brief Close the session in the next loop iteration
+static void pomelo_webrtc_session_held_overflow_callback(
+    size_t argc,
+    pomelo_webrtc_variant_t * args
+) {
+    assert(argc == 1);
+    assert(args != NULL);
+
+    pomelo_webrtc_session_t * session = args[0].ptr;
+    pomelo_webrtc_session_close(session);
+    pomelo_webrtc_session_unref(session); // Task no longer references it
+}
+
+
+/// @brief Drop a message which cannot be held and close the session after
+/// the receiving path has returned, as it may still use the channel
+static void pomelo_webrtc_session_held_fail(
+    pomelo_webrtc_session_t * session,
+    pomelo_webrtc_recv_command_t * command
+) {
+    pomelo_webrtc_channel_count_recv_dropped(command->channel);
+    pomelo_webrtc_channel_discard_receive(command);
+    if (session->held_overflow) {
+        return; // Session is being closed
     }
+    session->held_overflow = true;
 
-    // Initialize channels
-    if (pomelo_webrtc_session_create_channels(session) < 0) {
-        pomelo_webrtc_session_close(session);
-        return; // Failed to init channels
+    pomelo_webrtc_session_ref(session);
+    pomelo_webrtc_variant_t args[] = {{ .ptr = session }};
+    pomelo_webrtc_task_t * task = pomelo_webrtc_context_submit_task(
+        session->context,
+        pomelo_webrtc_session_held_overflow_callback,
+        POMELO_ARRAY_LENGTH(args),
+        args
+    );
+    if (!task) {
+        pomelo_webrtc_session_unref(session);
     }
+}
 
-    // Schedule negotiating
-    int32_t timeout = *info->timeout;
-    if (timeout > 0) {
-        pomelo_webrtc_task_t * task =
-            pomelo_webrtc_session_schedule_timeout(session, 1000ULL * timeout);
-        if (!task) {
-            pomelo_webrtc_session_close(session);
-            return; // Failed to create timeout
+
+/// @brief The client has not switched from websocket in time
+static void pomelo_webrtc_session_held_timeout_callback(
+    size_t argc,
+    pomelo_webrtc_variant_t * args
+) {
+    assert(argc == 1);
+    assert(args != NULL);
+
+    pomelo_webrtc_session_t * session = args[0].ptr;
+    pomelo_webrtc_log_at(
+        POMELO_WEBRTC_LOG_LEVEL_DEBUG,
+        "Session %lld has not switched from websocket, closing",
+        (long long) session->client_id
+    );
+    pomelo_webrtc_session_close(session);
+}
+
+
+bool pomelo_webrtc_session_hold_received(
+    pomelo_webrtc_session_t * session,
+    pomelo_webrtc_recv_command_t * command
+) {
+    assert(session != NULL);
+    assert(command != NULL);
+    if (!(session->flags & POMELO_WEBRTC_SESSION_FLAG_EARLY_RECV)) {
+        return false;
+    }
+
+    pomelo_webrtc_context_t * context = session->context;
+    pomelo_webrtc_config_t * config = &context->config;
+    size_t max_bytes = (config->early_data_max_held_bytes > 0)
+        ? (size_t) config->early_data_max_held_bytes
+        : EARLY_DATA_DEFAULT_MAX_HELD_BYTES;
+    size_t size = rtc_buffer_size(command->message);
+    if (session->held_overflow || session->held_bytes + size > max_bytes) {
+        if (!session->held_overflow) {
+            pomelo_webrtc_log_at(
+                POMELO_WEBRTC_LOG_LEVEL_DEBUG,
+                "Session %lld has held too many messages, closing",
+                (long long) session->client_id
+            );
         }
+        pomelo_webrtc_session_held_fail(session, command);
+        return true;
     }
 
-    // Start negotiating
-    pomelo_webrtc_session_pc_negotiate(session);
+    if (!session->held_front) {
+        // The deadline is counted from the first held message
+        int timeout_ms = config->early_data_switch_timeout_ms;
+        pomelo_webrtc_variant_t args[] = {{ .ptr = session }};
+        session->held_task = pomelo_webrtc_context_schedule_task(
+            context,
+            pomelo_webrtc_session_held_timeout_callback,
+            POMELO_ARRAY_LENGTH(args),
+            args,
+            (timeout_ms > 0)
+                ? (uint64_t) timeout_ms
+                : EARLY_DATA_DEFAULT_SWITCH_TIMEOUT_MS
+        );
+        if (!session->held_task) {
+            // Without the deadline, the held messages could be kept forever
+            pomelo_webrtc_session_held_fail(session, command);
+            return true;
+        }
+    }
+
+    session->held_bytes += size;
+    command->next = NULL;
+    if (session->held_back) {
+        session->held_back->next = command;
+    } else {
+        session->held_front = command;
+    }
+    session->held_back = command;
+    return true;
+}
+
+
+pomelo_webrtc_dictionary_t * pomelo_webrtc_session_get_dictionary(
+    pomelo_webrtc_session_t * session,
+    size_t channel_index
+) {
+    assert(session != NULL);
+    if (channel_index >= POMELO_WEBRTC_CONFIG_MAX_CHANNELS) {
+        return NULL;
+    }
+    return session->dictionaries[channel_index];
+}
+
+
+void pomelo_webrtc_session_get_loss(
+    pomelo_webrtc_session_t * session,
+    pomelo_webrtc_loss_stats_t * stats
+) {
+    assert(session != NULL);
+    assert(stats != NULL);
+
+    stats->uplink_loss_ppm = pomelo_atomic_uint64_load(&session->uplink_loss);
+    stats->downlink_loss_ppm =
+        pomelo_atomic_uint64_load(&session->downlink_loss);
+    stats->uplink_expected =
+        pomelo_atomic_uint64_load(&session->uplink_expected);
+    stats->uplink_lost = pomelo_atomic_uint64_load(&session->uplink_lost);
+}
+
+
+void pomelo_webrtc_session_ref(pomelo_webrtc_session_t * session) {
+    assert(session != NULL);
+    pomelo_reference_ref(&session->ref);
+}
+
+
+void pomelo_webrtc_session_unref(pomelo_webrtc_session_t * session) {
+    assert(session != NULL);
+    pomelo_reference_unref(&session->ref);
+}
+
+
+void pomelo_webrtc_session_get_traffic(
+    pomelo_webrtc_session_t * session,
+    pomelo_webrtc_traffic_stats_t * stats
+) {
+    assert(session != NULL);
+    assert(stats != NULL);
+
+    memset(stats, 0, sizeof(pomelo_webrtc_traffic_stats_t));
+    for (size_t i = 0; i < session->channel_traffic_size; i++) {
+        pomelo_webrtc_traffic_fold(&session->channel_traffic[i], stats);
+    }
+    pomelo_webrtc_traffic_fold(&session->traffic, stats);
+}
+
+
+int pomelo_webrtc_session_get_channel_traffic(
+    pomelo_webrtc_session_t * session,
+    size_t channel_index,
+    pomelo_webrtc_traffic_stats_t * stats
+) {
+    assert(session != NULL);
+    assert(stats != NULL);
+
+    if (channel_index >= session->channel_traffic_size) {
+        return -1; // Invalid channel index
+    }
+
+    memset(stats, 0, sizeof(pomelo_webrtc_traffic_stats_t));
+    pomelo_webrtc_traffic_fold(&session->channel_traffic[channel_index], stats);
+    return 0;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/*                               Module APIs                                  */
+/* -------------------------------------------------------------------------- */
+
+void pomelo_webrtc_session_on_local_candidates_gathered(
+    pomelo_webrtc_session_t * session
+) {
+    assert(session != NULL);
+    pomelo_webrtc_session_ws_flush_candidates(session);
 }
 
 
@@ -329,6 +683,10 @@ void pomelo_webrtc_session_send_local_description(
 ) {
     assert(session != NULL);
     pomelo_webrtc_session_ws_send_description(session, sdp, type);
+    pomelo_webrtc_session_mark_phase(
+        session,
+        POMELO_WEBRTC_HANDSHAKE_PHASE_OFFER_SENT
+    );
 }
 
 
@@ -339,6 +697,10 @@ void pomelo_webrtc_session_recv_remote_description(
 ) {
     assert(session != NULL);
     pomelo_webrtc_session_pc_set_remote_description(session, sdp, type);
+    pomelo_webrtc_session_mark_phase(
+        session,
+        POMELO_WEBRTC_HANDSHAKE_PHASE_REMOTE_DESCRIPTION
+    );
 }
 
 
@@ -348,6 +710,10 @@ void pomelo_webrtc_session_recv_remote_candidate(
     const char * mid
 ) {
     assert(session != NULL);
+    pomelo_webrtc_session_mark_phase(
+        session,
+        POMELO_WEBRTC_HANDSHAKE_PHASE_FIRST_REMOTE_CANDIDATE
+    );
     pomelo_webrtc_session_pc_add_remote_candidate(session, cand, mid);
 }
 
@@ -359,6 +725,10 @@ void pomelo_webrtc_session_recv_ready(pomelo_webrtc_session_t * session) {
     }
 
     session->flags |= POMELO_WEBRTC_SESSION_FLAG_READY_SIGNAL_RECEIVED;
+    pomelo_webrtc_session_mark_phase(
+        session,
+        POMELO_WEBRTC_HANDSHAKE_PHASE_READY_RECEIVED
+    );
     if (pomelo_webrtc_session_is_connected(session)) {
         pomelo_webrtc_session_on_ready(session);
     }
@@ -390,6 +760,10 @@ void pomelo_webrtc_session_start_ping(pomelo_webrtc_session_t * session) {
         { .ptr = session }
     };
 
+    // The silence is counted from now
+    session->last_pong_time = uv_hrtime();
+    session->unanswered_pings = 0;
+
     // Schedule task
     session->ping_task = pomelo_webrtc_context_schedule_task(
         session->context,
@@ -418,6 +792,10 @@ void pomelo_webrtc_session_on_all_channels_opened(
     pomelo_webrtc_session_t * session
 ) {
     assert(session != NULL);
+    pomelo_webrtc_session_mark_phase(
+        session,
+        POMELO_WEBRTC_HANDSHAKE_PHASE_CHANNELS_OPENED
+    );
 
     // Send ready and start ping
     pomelo_webrtc_session_ws_send_ready(session);
@@ -430,14 +808,59 @@ void pomelo_webrtc_session_on_all_channels_opened(
 }
 
 
+/// @brief Check whether the client is still answering pings
+/// @return True if the client is considered dead
+static bool pomelo_webrtc_session_check_liveness(
+    pomelo_webrtc_session_t * session,
+    uint64_t now
+) {
+    int timeout_ms = session->liveness_timeout_ms;
+    if (timeout_ms <= 0) {
+        return false; // Disabled
+    }
+
+    if (!session->native_session) {
+        return false; // Pongs are not received until the session is opened
+    }
+
+    // Both conditions are required, so that a stall of the plugin loop which
+    // delays the pongs does not tear the session down.
+    uint64_t silence = now - session->last_pong_time;
+    uint64_t min_pings = (uint64_t) timeout_ms / PING_INTERVAL_MS;
+    return (
+        silence >= (uint64_t) timeout_ms * 1000000ULL &&
+        session->unanswered_pings >= min_pings
+    );
+}
+
+
 void pomelo_webrtc_session_send_ping(pomelo_webrtc_session_t * session) {
     assert(session != NULL);
 
     uint64_t now = uv_hrtime();
+    if (pomelo_webrtc_session_check_liveness(session, now)) {
+        pomelo_webrtc_log_at(
+            POMELO_WEBRTC_LOG_LEVEL_DEBUG,
+            "Session %lld has not answered %llu pings, closing",
+            (long long) session->client_id,
+            (unsigned long long) session->unanswered_pings
+        );
+        pomelo_webrtc_session_close(session);
+        return;
+    }
+    session->unanswered_pings++;
+
     pomelo_rtt_entry_t * entry =
         pomelo_rtt_calculator_next_entry(&session->rtt, now);
 
     uint64_t ping_sequence = entry->sequence;
+    if ((ping_sequence % STATS_PING_INTERVAL) == 0) {
+        if (session->pc) {
+            pomelo_webrtc_transport_update(&session->transport, session->pc);
+        }
+        pomelo_webrtc_session_update_loss(session);
+    }
+
     size_t bytes = pomelo_payload_calc_packed_uint64_bytes(ping_sequence);
 
     uint8_t data[SYS_PING_DATA_CAPACITY];
@@ -517,7 +940,9 @@ void pomelo_webrtc_session_send_pong(
 void pomelo_webrtc_session_recv_pong(
     pomelo_webrtc_session_t * session,
     uint64_t ping_sequence,
-    uint64_t recv_time
+    uint64_t recv_time,
+    uint64_t client_time,
+    bool has_client_time
 ) {
     assert(session != NULL);
 
@@ -527,7 +952,25 @@ void pomelo_webrtc_session_recv_pong(
         return; // Entry does not exist
     }
 
+    pomelo_webrtc_rtt_record(&session->rtt_stats, recv_time - entry->time);
+
+    if (has_client_time) {
+        // Convert the times of loop to socket time
+        pomelo_plugin_t * plugin = session->context->plugin;
+        uint64_t socket_time =
+            plugin->socket_time(plugin, session->socket->native_socket);
+        uint64_t now = uv_hrtime();
+        pomelo_webrtc_clock_record(
+            &session->clock,
+            socket_time - (now - entry->time),
+            socket_time - (now - recv_time),
+            client_time
+        );
+    }
+
     pomelo_rtt_calculator_submit_entry(&session->rtt, entry, recv_time, 0);
+    session->last_pong_time = recv_time;
+    session->unanswered_pings = 0;
 }
 
 
@@ -560,6 +1003,9 @@ void pomelo_webrtc_session_process_ping(
     );
     if (ret < 0) return; // Failed to decode sequence
 
+    // Pings of client are sequenced, they measure the loss of system channel
+    pomelo_webrtc_loss_record(&session->ping_loss, (uint16_t) ping_sequence);
+
     // Get the current socket time
     pomelo_plugin_t * plugin = session->context->plugin;
     uint64_t socket_time =
@@ -603,8 +1049,236 @@ void pomelo_webrtc_session_process_pong(
     );
     if (ret < 0) return; // Failed to decode sequence
 
-    // There may be client time at the end of payload, but it is ignored.
-    pomelo_webrtc_session_recv_pong(session, ping_sequence, recv_time);
+    // Client time is at the end of payload
+    size_t client_time_bytes = (header_byte & 0x07) + 1;
+    uint64_t client_time = 0;
+    ret = pomelo_payload_read_packed_uint64(
+        &payload,
+        client_time_bytes,
+        &client_time
+    );
+
+    pomelo_webrtc_session_recv_pong(
+        session,
+        ping_sequence,
+        recv_time,
+        client_time,
+        /* has_client_time = */ ret == 0
+    );
+}
+
+
+void pomelo_webrtc_session_init_compression(pomelo_webrtc_session_t * session) {
+    assert(session != NULL);
+    session->compressed_channels = 0;
+    session->compression_min_size = POMELO_WEBRTC_COMPRESS_DEFAULT_MIN_SIZE;
+    memset(session->dictionaries, 0, sizeof(session->dictionaries));
+    if (!(session->features & POMELO_WEBRTC_FEATURE_COMPRESSION)) {
+        return; // Client does not support compression
+    }
+
+    pomelo_webrtc_context_t * context = session->context;
+    pomelo_webrtc_config_t * config = &context->config;
+    if (config->compression_min_size > 0) {
+        session->compression_min_size = (size_t) config->compression_min_size;
+    }
+
+    for (int i = 0; i < config->channel_compression_count; i++) {
+        if (!config->channel_compression[i]) continue;
+        session->compressed_channels |= (1ULL << i);
+
+        pomelo_webrtc_dictionary_t * dictionary = context->dictionaries[i];
+        if (dictionary) {
+            pomelo_webrtc_dictionary_ref(dictionary);
+            session->dictionaries[i] = dictionary;
+        }
+    }
+}
+
+
+void pomelo_webrtc_session_cleanup_compression(
+    pomelo_webrtc_session_t * session
+) {
+    assert(session != NULL);
+    for (size_t i = 0; i < POMELO_WEBRTC_CONFIG_MAX_CHANNELS; i++) {
+        if (session->dictionaries[i]) {
+            pomelo_webrtc_dictionary_unref(session->dictionaries[i]);
+            session->dictionaries[i] = NULL;
+        }
+    }
+    session->compressed_channels = 0;
+}
+
+
+void pomelo_webrtc_session_init_aggregation(pomelo_webrtc_session_t * session) {
+    assert(session != NULL);
+    session->aggregated_channels = 0;
+    if (!(session->features & POMELO_WEBRTC_FEATURE_AGGREGATION)) {
+        return; // Client does not support aggregation
+    }
+
+    // Modes of socket do not change while it has sessions
+    pomelo_array_t * modes = session->socket->channel_modes;
+    pomelo_webrtc_config_t * config = &session->context->config;
+    for (int i = 0; i < config->channel_aggregation_count; i++) {
+        pomelo_channel_mode mode = POMELO_CHANNEL_MODE_RELIABLE;
+        pomelo_array_get(modes, (size_t) i, &mode);
+        if (
+            config->channel_aggregation[i] &&
+            mode != POMELO_CHANNEL_MODE_RELIABLE
+        ) {
+            session->aggregated_channels |= (1ULL << i);
+        }
+    }
+}
+
+
+/// @brief Stop the deadline of held messages
+static void pomelo_webrtc_session_unschedule_held(
+    pomelo_webrtc_session_t * session
+) {
+    if (!session->held_task) {
+        return;
+    }
+
+    pomelo_webrtc_context_unschedule_task(session->context, session->held_task);
+    session->held_task = NULL;
+}
+
+
+void pomelo_webrtc_session_recv_done(pomelo_webrtc_session_t * session) {
+    assert(session != NULL);
+    if (!(session->flags & POMELO_WEBRTC_SESSION_FLAG_EARLY_RECV)) {
+        return; // Not receiving over websocket
+    }
+    session->flags &= ~POMELO_WEBRTC_SESSION_FLAG_EARLY_RECV;
+
+    pomelo_webrtc_session_unschedule_held(session);
+
+    // Client has sent all of its websocket messages, release the messages
+    // of data channels in the order they have been received
+    pomelo_webrtc_recv_command_t * command = session->held_front;
+    session->held_front = NULL;
+    session->held_back = NULL;
+    session->held_bytes = 0;
+    while (command) {
+        pomelo_webrtc_recv_command_t * next = command->next;
+        pomelo_webrtc_channel_submit_receive(command);
+        command = next;
+    }
+
+    pomelo_webrtc_session_release_ws(session);
+}
+
+
+void pomelo_webrtc_session_discard_held(pomelo_webrtc_session_t * session) {
+    assert(session != NULL);
+    pomelo_webrtc_session_unschedule_held(session);
+
+    pomelo_webrtc_recv_command_t * command = session->held_front;
+    session->held_front = NULL;
+    session->held_back = NULL;
+    session->held_bytes = 0;
+    while (command) {
+        pomelo_webrtc_recv_command_t * next = command->next;
+        pomelo_webrtc_channel_count_recv_dropped(command->channel);
+        pomelo_webrtc_channel_discard_receive(command);
+        command = next;
+    }
+}
+
+
+void pomelo_webrtc_session_release_ws(pomelo_webrtc_session_t * session) {
+    assert(session != NULL);
+    if (!(session->features & POMELO_WEBRTC_FEATURE_WS_RELEASE)) {
+        return; // Client keeps the websocket
+    }
+
+    if (
+        !session->native_session ||
+        !pomelo_webrtc_session_is_connected(session)
+    ) {
+        return; // Not connected yet
+    }
+
+    if (session->flags & (
+        POMELO_WEBRTC_SESSION_FLAG_EARLY_RECV |
+        POMELO_WEBRTC_SESSION_FLAG_EARLY_SEND
+    )) {
+        return; // Messages are still exchanged over websocket
+    }
+
+    pomelo_webrtc_session_ws_release(session);
+}
+
+
+void pomelo_webrtc_session_update_loss(pomelo_webrtc_session_t * session) {
+    assert(session != NULL);
+
+    uint64_t expected = 0;
+    uint64_t lost = 0;
+    pomelo_webrtc_loss_sample(&session->ping_loss, &expected, &lost);
+
+    size_t nchannels = session->channels->size;
+    for (size_t i = 0; i < nchannels; i++) {
+        pomelo_webrtc_channel_t * channel = NULL;
+        pomelo_array_get(session->channels, i, &channel);
+        if (!channel || !pomelo_webrtc_channel_is_sequenced(channel)) {
+            continue;
+        }
+
+        uint64_t channel_expected = 0;
+        uint64_t channel_lost = 0;
+        pomelo_webrtc_loss_sample(
+            &channel->loss,
+            &channel_expected,
+            &channel_lost
+        );
+        expected += channel_expected;
+        lost += channel_lost;
+    }
+
+    if (expected == 0) {
+        return; // Nothing has been received in this interval
+    }
+
+    pomelo_atomic_uint64_store(
+        &session->uplink_loss,
+        lost * 1000000ULL / expected
+    );
+    pomelo_atomic_uint64_fetch_add(&session->uplink_expected, expected);
+    pomelo_atomic_uint64_fetch_add(&session->uplink_lost, lost);
+
+    if (!(session->features & POMELO_WEBRTC_FEATURE_SEQUENCE)) {
+        return; // Client does not understand the report
+    }
+
+    // Report the loss to client, so that it learns its uplink loss
+    uint64_t fraction = lost * POMELO_WEBRTC_LOSS_FRACTION_ONE / expected;
+    uint8_t data[SYS_LOSS_REPORT_LENGTH];
+    data[0] = (uint8_t) (SYS_OPCODE_LOSS_REPORT << 6);
+    data[1] = (uint8_t) (fraction >> 8);
+    data[2] = (uint8_t) fraction;
+    pomelo_webrtc_channel_send(session->system_channel, data, sizeof(data));
+}
+
+
+void pomelo_webrtc_session_process_loss_report(
+    pomelo_webrtc_session_t * session,
+    const uint8_t * message,
+    size_t length
+) {
+    assert(session != NULL);
+    assert(message != NULL);
+
+    if (length != SYS_LOSS_REPORT_LENGTH) {
+        return; // Invalid length, discard
+    }
+
+    uint64_t fraction = ((uint64_t) message[1] << 8) | message[2];
+    uint64_t loss_ppm = fraction * 1000000ULL / POMELO_WEBRTC_LOSS_FRACTION_ONE;
+    pomelo_atomic_uint64_store(&session->downlink_loss, loss_ppm);
+    pomelo_webrtc_pacer_on_loss(&session->pacer, loss_ppm);
 }
 
 
@@ -625,16 +1299,47 @@ int pomelo_webrtc_session_create_channels(pomelo_webrtc_session_t * session) {
     // Fill the channels array with NULL
     pomelo_array_fill_zero(channels);
 
+    // Prepare the traffic counters of channels
+    if (nchannels > session->channel_traffic_capacity) {
+        pomelo_webrtc_traffic_t * traffic = pomelo_allocator_malloc(
+            context->allocator,
+            nchannels * sizeof(pomelo_webrtc_traffic_t)
+        );
+        if (!traffic) return -1; // Failed to allocate counters
+
+        if (session->channel_traffic) {
+            pomelo_allocator_free(context->allocator, session->channel_traffic);
+        }
+        session->channel_traffic = traffic;
+        session->channel_traffic_capacity = nchannels;
+    }
+    for (size_t i = 0; i < nchannels; i++) {
+        pomelo_webrtc_traffic_reset(&session->channel_traffic[i]);
+    }
+    session->channel_traffic_size = nchannels;
+
     pomelo_webrtc_channel_t * channel;
     pomelo_channel_mode mode;
     pomelo_webrtc_channel_info_t info;
     info.session = session;
+    pomelo_webrtc_config_t * config = &context->config;
 
     // Create channels
     for (size_t i = 0; i < nchannels; i++) {
         pomelo_array_get(modes, i, &mode);
         info.channel_index = i;
         info.channel_mode = mode;
+        info.sequenced = pomelo_webrtc_session_is_channel_sequenced(session, i);
+        info.fragmented =
+            pomelo_webrtc_session_is_channel_fragmented(session, i);
+        info.compressed =
+            pomelo_webrtc_session_is_channel_compressed(session, i);
+        info.aggregated =
+            pomelo_webrtc_session_is_channel_aggregated(session, i);
+        info.traffic = &session->channel_traffic[i];
+        info.priority = ((int) i < config->channel_priorities_count)
+            ? config->channel_priorities[i]
+            : 0;
         channel = pomelo_webrtc_context_acquire_channel(context, &info);
         if (!channel) return -1;
 
@@ -644,6 +1349,12 @@ int pomelo_webrtc_session_create_channels(pomelo_webrtc_session_t * session) {
     // Create system channel
     info.channel_index = POMELO_WEBRTC_CHANNEL_SYSTEM_INDEX;
     info.channel_mode = POMELO_CHANNEL_MODE_UNRELIABLE;
+    info.traffic = &session->traffic;
+    info.sequenced = false; // Pings and pongs have their own sequences
+    info.fragmented = false;
+    info.compressed = false;
+    info.aggregated = false;
+    info.priority = POMELO_WEBRTC_CONFIG_CHANNEL_PRIORITY_LEVELS - 1;
     session->system_channel =
         pomelo_webrtc_context_acquire_channel(context, &info);
     if (!session->system_channel) return -1; // Failed to create system channel
@@ -656,8 +1367,16 @@ int pomelo_webrtc_session_create_channels(pomelo_webrtc_session_t * session) {
 
 
 void pomelo_webrtc_session_on_ready(pomelo_webrtc_session_t * session) {
-    // Clear connect timeout scheduler
-    pomelo_webrtc_session_unschedule_timeout(session);
+    // The connect timeout is kept until the native session is created
+    if (session->features & POMELO_WEBRTC_FEATURE_EARLY_DATA) {
+        if (session->native_session) {
+            // Switch from websocket to data channels
+            session->flags &= ~POMELO_WEBRTC_SESSION_FLAG_EARLY_SEND;
+            pomelo_webrtc_session_on_connected(session);
+        }
+        // Otherwise, the native session is being created
+        return;
+    }
 
     // Update the address of this session
     pomelo_webrtc_session_pc_address(session, &session->address);
@@ -671,6 +1390,24 @@ void pomelo_webrtc_session_on_ready(pomelo_webrtc_session_t * session) {
 void pomelo_webrtc_session_on_connected(pomelo_webrtc_session_t * session) {
     assert(session != NULL);
 
+    if (!pomelo_webrtc_session_is_connected(session)) {
+        // Created early, exchange messages over websocket until ready
+        session->flags |= (
+            POMELO_WEBRTC_SESSION_FLAG_EARLY_RECV |
+            POMELO_WEBRTC_SESSION_FLAG_EARLY_SEND
+        );
+        pomelo_webrtc_session_mark_phase(
+            session,
+            POMELO_WEBRTC_HANDSHAKE_PHASE_SESSION_CREATED
+        );
+        pomelo_webrtc_session_ws_send_early(session);
+        return;
+        // => pomelo_webrtc_session_on_ready
+    }
+
+    // Both the data channels and the native session are ready
+    pomelo_webrtc_session_unschedule_timeout(session);
+
     pomelo_array_t * channels = session->channels;
     size_t nchannels = channels->size;
     pomelo_webrtc_channel_t * channel;
@@ -681,9 +1418,24 @@ void pomelo_webrtc_session_on_connected(pomelo_webrtc_session_t * session) {
     }
     pomelo_webrtc_channel_enable_receiving(session->system_channel);
 
+    // Pongs are accepted from now, count the silence from here
+    session->last_pong_time = uv_hrtime();
+    session->unanswered_pings = 0;
+
+    pomelo_webrtc_session_mark_phase(
+        session,
+        POMELO_WEBRTC_HANDSHAKE_PHASE_SESSION_CREATED
+    );
+    pomelo_webrtc_session_finish_handshake(
+        session,
+        POMELO_WEBRTC_HANDSHAKE_RESULT_SUCCESS
+    );
+
     // Send ready message
     pomelo_webrtc_session_ws_send_connected(session);
     // Well done, we have the connection
+
+    pomelo_webrtc_session_release_ws(session);
 }
 
 
@@ -698,6 +1450,10 @@ void pomelo_webrtc_session_on_timeout(
     assert(session != NULL);
     pomelo_webrtc_session_unschedule_timeout(session);
 
+    pomelo_webrtc_session_finish_handshake(
+        session,
+        POMELO_WEBRTC_HANDSHAKE_RESULT_TIMEOUT
+    );
     pomelo_webrtc_session_close(session);
 }
 
@@ -7,6 +7,15 @@
 #include "utils/array.h"
 #include "utils/mutex.h"
 #include "utils/rtt.h"
+#include "utils/string-buffer.h"
+#include "stats/handshake-stats.h"
+#include "stats/traffic-stats.h"
+#include "stats/transport-stats.h"
+#include "stats/clock-stats.h"
+#include "stats/rtt-stats.h"
+#include "stats/loss-stats.h"
+#include "pacing/pacer.h"
+#include "compress/compress.h"
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -14,26 +23,69 @@ extern "C" {
 
 #define POMELO_WEBRTC_SESSION_FLAG_ACTIVE                (1 << 0)
 #define POMELO_WEBRTC_SESSION_FLAG_WS_ACTIVE             (1 << 1)
-#define POMELO_WEBRTC_SESSION_FLAG_WS_AUTHENTICATED      (1 << 2)
+/// Websocket has been closed on purpose, signaling is carried by the system
+/// channel
+#define POMELO_WEBRTC_SESSION_FLAG_WS_RELEASED           (1 << 2)
 #define POMELO_WEBRTC_SESSION_FLAG_PC_ACTIVE             (1 << 3)
 #define POMELO_WEBRTC_SESSION_FLAG_READY_SIGNAL_RECEIVED (1 << 4)
 #define POMELO_WEBRTC_SESSION_FLAG_ALL_CHANNELS_OPENED   (1 << 5)
+/// Client may still send messages over websocket, messages of data channels
+/// are held until it has switched
+#define POMELO_WEBRTC_SESSION_FLAG_EARLY_RECV            (1 << 6)
+/// Messages are sent over websocket
+#define POMELO_WEBRTC_SESSION_FLAG_EARLY_SEND            (1 << 7)
+
 #define POMELO_WEBRTC_SESSION_FLAG_CONNECTED (                                 \
     POMELO_WEBRTC_SESSION_FLAG_READY_SIGNAL_RECEIVED |                         \
     POMELO_WEBRTC_SESSION_FLAG_ALL_CHANNELS_OPENED                             \
 )
 
 
+/* Optional features which have been negotiated with client */
+
+/// Client accepts multiple candidates in a single frame
+#define POMELO_WEBRTC_FEATURE_CANDIDATES (1U << 0)
+/// Messages of non-reliable channels carry a 16-bit sequence number
+#define POMELO_WEBRTC_FEATURE_SEQUENCE (1U << 1)
+/// Messages of reliable channels carry a fragment header
+#define POMELO_WEBRTC_FEATURE_FRAGMENT (1U << 2)
+/// Messages of the configured channels carry a compression header
+#define POMELO_WEBRTC_FEATURE_COMPRESSION (1U << 3)
+/// Small messages of the configured unreliable channels are packed together
+#define POMELO_WEBRTC_FEATURE_AGGREGATION (1U << 4)
+/// Messages are exchanged over websocket until data channels are ready
+#define POMELO_WEBRTC_FEATURE_EARLY_DATA (1U << 5)
+/// Websocket is closed once connected
+#define POMELO_WEBRTC_FEATURE_WS_RELEASE (1U << 6)
+/// Client has sent the list of its features
+#define POMELO_WEBRTC_FEATURE_NEGOTIATED (1U << 31)
+
+
 struct pomelo_webrtc_session_info_s {
     /// @brief Socket
     pomelo_webrtc_socket_t * socket;
 
     /// @brief WebSocket client
     rtc_websocket_client_t * ws_client;
+
+    /// @brief Client ID from the connect token
+    int64_t client_id;
+
+    /// @brief Connect timeout in seconds from the connect token
+    int32_t connect_timeout;
+
+    /// @brief Features negotiated with client
+    uint32_t features;
+
+    /// @brief Handshake tracker of the pre-auth record (optional)
+    pomelo_webrtc_handshake_t * handshake;
 };
 
 
 struct pomelo_webrtc_session_s {
+    /// @brief Kind of websocket owner. This must be the first member.
+    pomelo_webrtc_ws_owner_kind ws_owner;
+
     /// @brief Reference
     pomelo_reference_t ref;
 
@@ -64,6 +116,21 @@ struct pomelo_webrtc_session_s {
     /// @brief Round trip time calculator
     pomelo_rtt_calculator_t rtt;
 
+    /// @brief Windowed statistics of round trip time
+    pomelo_webrtc_rtt_t rtt_stats;
+
+    /// @brief The last time a pong has been received, or pinging has started
+    uint64_t last_pong_time;
+
+    /// @brief Number of consecutive pings which have not been answered
+    uint64_t unanswered_pings;
+
+    /// @brief Liveness timeout in milliseconds, snapshotted from the config
+    int liveness_timeout_ms;
+
+    /// @brief Clock estimator of client
+    pomelo_webrtc_clock_t clock;
+
     /// @brief Native session
     pomelo_session_t * native_session;
 
@@ -81,6 +148,111 @@ struct pomelo_webrtc_session_s {
 
     /// @brief Connect timeout
     pomelo_webrtc_task_t * task_timeout;
+
+    /// @brief Connect timeout in seconds
+    int32_t connect_timeout;
+
+    /// @brief Handshake tracker
+    pomelo_webrtc_handshake_t handshake;
+
+    /// @brief Features negotiated with client
+    uint32_t features;
+
+    /// @brief Local candidates which are waiting to be sent in one frame
+    pomelo_string_buffer_t * pending_candidates;
+
+    /// @brief Number of pending local candidates
+    size_t pending_candidates_count;
+
+    /// @brief Task flushing the pending local candidates
+    pomelo_webrtc_task_t * task_candidates;
+
+    /// @brief Traffic of channels, indexed by channel index. It is only
+    /// replaced before the native session is opened.
+    pomelo_webrtc_traffic_t * channel_traffic;
+
+    /// @brief Number of channels in traffic array
+    size_t channel_traffic_size;
+
+    /// @brief Capacity of traffic array
+    size_t channel_traffic_capacity;
+
+    /// @brief Traffic of system channel and the outgoing messages which are
+    /// dropped before their channel is known
+    pomelo_webrtc_traffic_t traffic;
+
+    /// @brief Latest transport statistics of peer connection
+    pomelo_webrtc_transport_t transport;
+
+    /// @brief Loss estimator of the pings from client
+    pomelo_webrtc_loss_t ping_loss;
+
+    /// @brief Loss of messages from client in the last interval (ppm)
+    pomelo_atomic_uint64_t uplink_loss;
+
+    /// @brief Loss of messages to client, reported by client (ppm)
+    pomelo_atomic_uint64_t downlink_loss;
+
+    /// @brief Total expected messages from client
+    pomelo_atomic_uint64_t uplink_expected;
+
+    /// @brief Total lost messages from client
+    pomelo_atomic_uint64_t uplink_lost;
+
+    /// @brief Pacing of outgoing messages. Plugin thread only.
+    pomelo_webrtc_pacer_t pacer;
+
+    /// @brief Bytes of the messages which are being reassembled by channels.
+    /// Plugin thread only.
+    size_t reassembly_bytes;
+
+    /// @brief Bit mask of the channels whose messages are compressed. It is
+    /// set at initializing, so it can be read from any thread.
+    uint64_t compressed_channels;
+
+    /// @brief Shorter messages are not compressed
+    size_t compression_min_size;
+
+    /// @brief Dictionaries of compressed channels, referenced at initializing
+    pomelo_webrtc_dictionary_t *
+        dictionaries[POMELO_WEBRTC_CONFIG_MAX_CHANNELS];
+
+    /// @brief Bit mask of the channels whose messages are packed together.
+    /// It is set at initializing, so it can be read from any thread.
+    uint64_t aggregated_channels;
+
+    /// @brief The first message of data channels which is held until client
+    /// has stopped sending over websocket. Plugin thread only.
+    pomelo_webrtc_recv_command_t * held_front;
+
+    /// @brief The last held message
+    pomelo_webrtc_recv_command_t * held_back;
+
+    /// @brief Total bytes of the held messages
+    size_t held_bytes;
+
+    /// @brief Closing the session because a message could not be held
+    bool held_overflow;
+
+    /// @brief Deadline for the client to switch from websocket
+    pomelo_webrtc_task_t * held_task;
+
+    /// @brief Signaling messages which are sent over system channel after
+    /// websocket has been released, until they are acknowledged. Plugin
+    /// thread only.
+    pomelo_array_t * signals;
+
+    /// @brief Index of the first unacknowledged signaling message
+    size_t signal_head;
+
+    /// @brief Sequence of the next outgoing signaling message
+    uint16_t signal_send_sequence;
+
+    /// @brief Sequence of the next expected incoming signaling message
+    uint16_t signal_recv_sequence;
+
+    /// @brief Resending of the first unacknowledged signaling message
+    pomelo_webrtc_task_t * signal_task;
 };
 
 
@@ -111,6 +283,10 @@ int pomelo_webrtc_session_init(
 void pomelo_webrtc_session_cleanup(pomelo_webrtc_session_t * session);
 
 
+/// @brief Start negotiating with the authenticated client
+void pomelo_webrtc_session_start(pomelo_webrtc_session_t * session);
+
+
 /// @brief Close the connection
 void pomelo_webrtc_session_close(pomelo_webrtc_session_t * session);
 
@@ -137,6 +313,62 @@ void pomelo_webrtc_session_process_system_message(
 );
 
 
+/// @brief Check whether messages of a channel carry the sequence header.
+/// This is threadsafe.
+bool pomelo_webrtc_session_is_channel_sequenced(
+    pomelo_webrtc_session_t * session,
+    size_t channel_index
+);
+
+
+/// @brief Check whether messages of a channel carry the fragment header.
+/// This is threadsafe.
+bool pomelo_webrtc_session_is_channel_fragmented(
+    pomelo_webrtc_session_t * session,
+    size_t channel_index
+);
+
+
+/// @brief Check whether messages of a channel carry the compression header.
+/// This is threadsafe.
+bool pomelo_webrtc_session_is_channel_compressed(
+    pomelo_webrtc_session_t * session,
+    size_t channel_index
+);
+
+
+/// @brief Check whether messages of a channel are packed together. This is
+/// threadsafe.
+bool pomelo_webrtc_session_is_channel_aggregated(
+    pomelo_webrtc_session_t * session,
+    size_t channel_index
+);
+
+
+/// @brief Hold a message of data channels while client may still send over
+/// websocket. Plugin thread only.
+/// @return True if the message has been held
+bool pomelo_webrtc_session_hold_received(
+    pomelo_webrtc_session_t * session,
+    pomelo_webrtc_recv_command_t * command
+);
+
+
+/// @brief Get the compression dictionary of a channel. This is threadsafe.
+/// @return The dictionary or NULL
+pomelo_webrtc_dictionary_t * pomelo_webrtc_session_get_dictionary(
+    pomelo_webrtc_session_t * session,
+    size_t channel_index
+);
+
+
+/// @brief Get the loss statistics of session
+void pomelo_webrtc_session_get_loss(
+    pomelo_webrtc_session_t * session,
+    pomelo_webrtc_loss_stats_t * stats
+);
+
+
 /// @brief Increase reference counter of session
 void pomelo_webrtc_session_ref(pomelo_webrtc_session_t * session);
 
@@ -145,6 +377,24 @@ void pomelo_webrtc_session_ref(pomelo_webrtc_session_t * session);
 void pomelo_webrtc_session_unref(pomelo_webrtc_session_t * session);
 
 
+/// @brief Get the traffic of all channels of session. This can be called from
+/// any thread while the native session is alive.
+void pomelo_webrtc_session_get_traffic(
+    pomelo_webrtc_session_t * session,
+    pomelo_webrtc_traffic_stats_t * stats
+);
+
+
+/// @brief Get the traffic of a channel of session. This can be called from
+/// any thread while the native session is alive.
+/// @return 0 on success, or -1 if the channel index is invalid
+int pomelo_webrtc_session_get_channel_traffic(
+    pomelo_webrtc_session_t * session,
+    size_t channel_index,
+    pomelo_webrtc_traffic_stats_t * stats
+);
+
+
 #ifdef __cplusplus
 }
 #endif
@@ -9,10 +9,19 @@ extern "C" {
 /*                               Module APIs                                  */
 /* -------------------------------------------------------------------------- */
 
-/// @brief Create new session
+/// @brief Create new pre-auth record for an incoming websocket client. The
+/// record takes the admission slot of client.
+pomelo_webrtc_preauth_t * pomelo_webrtc_socket_create_preauth(
+    pomelo_webrtc_socket_t * socket,
+    rtc_websocket_client_t * ws_client,
+    uint64_t source
+);
+
+
+/// @brief Create new session for an authenticated client
 pomelo_webrtc_session_t * pomelo_webrtc_socket_create_session(
     pomelo_webrtc_socket_t * socket,
-    rtc_websocket_client_t * ws_client
+    pomelo_webrtc_session_info_t * info
 );
 
 
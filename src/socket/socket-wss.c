@@ -1,7 +1,6 @@
 #include <assert.h>
 #include <string.h>
 #include "utils/common-macro.h"
-#include "session/session.h"
 #include "socket-wss.h"
 #include "context.h"
 
@@ -37,7 +36,20 @@ static void pomelo_webrtc_socket_wss_on_client_callback(
         return;
     }
 
-    pomelo_webrtc_socket_create_session(socket, ws_client);
+    // Turn the client away before anything is allocated for it
+    uint64_t source = 0;
+    int ret = pomelo_webrtc_admission_accept(
+        &socket->context->admission,
+        ws_client,
+        &source
+    );
+    if (ret < 0) {
+        rtc_websocket_client_destroy(ws_client);
+        return;
+    }
+
+    // Only a lightweight record is created until the client is authenticated
+    pomelo_webrtc_socket_create_preauth(socket, ws_client, source);
 }
 
 
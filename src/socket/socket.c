@@ -2,8 +2,10 @@
 #include <string.h>
 #include "utils/macro.h"
 #include "session/session.h"
+#include "session/session-ws.h"
+#include "preauth/preauth.h"
 #include "context.h"
-#include "socket.h"
+#include "socket-int.h"
 #include "socket-plugin.h"
 #include "socket-wss.h"
 
@@ -39,6 +41,10 @@ int pomelo_webrtc_socket_on_alloc(
     socket->sessions = pomelo_list_create(&list_options);
     if (!socket->sessions) return -1;
 
+    list_options.element_size = sizeof(pomelo_webrtc_preauth_t *);
+    socket->preauths = pomelo_list_create(&list_options);
+    if (!socket->preauths) return -1;
+
     pomelo_array_options_t array_options = {
         .allocator = allocator,
         .initial_capacity = POMELO_WEBRTC_CHANNELS_INIT_CAPACITY,
@@ -60,6 +66,11 @@ void pomelo_webrtc_socket_on_free(pomelo_webrtc_socket_t * socket) {
         socket->sessions = NULL;
     }
 
+    if (socket->preauths) {
+        pomelo_list_destroy(socket->preauths);
+        socket->preauths = NULL;
+    }
+
     if (socket->channel_modes) {
         pomelo_array_destroy(socket->channel_modes);
         socket->channel_modes = NULL;
@@ -104,6 +115,7 @@ void pomelo_webrtc_socket_cleanup(pomelo_webrtc_socket_t * socket) {
 
     // Clear sessions
     pomelo_list_clear(socket->sessions);
+    pomelo_list_clear(socket->preauths);
     pomelo_array_clear(socket->channel_modes);
 
     socket->flags = 0;
@@ -140,6 +152,13 @@ void pomelo_webrtc_socket_close(pomelo_webrtc_socket_t * socket) {
         pomelo_webrtc_session_close(session);
     }
 
+    // Close all pending clients
+    pomelo_webrtc_preauth_t * preauth = NULL;
+    while (pomelo_list_pop_front(socket->preauths, &preauth) == 0) {
+        preauth->list_entry = NULL;
+        pomelo_webrtc_preauth_close(preauth);
+    }
+
     pomelo_webrtc_socket_wss_close(socket);
 
     // Unref itself
@@ -161,31 +180,79 @@ void pomelo_webrtc_socket_remove_session(
 }
 
 
+void pomelo_webrtc_socket_remove_preauth(
+    pomelo_webrtc_socket_t * socket,
+    pomelo_webrtc_preauth_t * preauth
+) {
+    assert(socket != NULL);
+    assert(preauth != NULL);
+
+    if (preauth->list_entry) {
+        pomelo_list_remove(socket->preauths, preauth->list_entry);
+        preauth->list_entry = NULL;
+    }
+}
+
+
 /* -------------------------------------------------------------------------- */
 /*                               Module APIs                                  */
 /* -------------------------------------------------------------------------- */
 
-pomelo_webrtc_session_t * pomelo_webrtc_socket_create_session(
+pomelo_webrtc_preauth_t * pomelo_webrtc_socket_create_preauth(
     pomelo_webrtc_socket_t * socket,
-    rtc_websocket_client_t * ws_client
+    rtc_websocket_client_t * ws_client,
+    uint64_t source
 ) {
     assert(socket != NULL);
     assert(ws_client != NULL);
 
-    pomelo_webrtc_session_info_t info = {
+    pomelo_webrtc_preauth_info_t info = {
         .socket = socket,
         .ws_client = ws_client
     };
 
+    // Create new pre-auth record
+    pomelo_webrtc_preauth_t * preauth =
+        pomelo_webrtc_context_acquire_preauth(socket->context, &info);
+    if (!preauth) {
+        // Failed to create new record, nobody owns the client now
+        pomelo_webrtc_admission_release(&socket->context->admission, source);
+        rtc_websocket_client_destroy(ws_client);
+        return NULL;
+    }
+
+    // The handshake of record holds the admission slot until it finishes
+    preauth->handshake.source = source;
+
+    // Add record to pre-auth list
+    preauth->list_entry = pomelo_list_push_back(socket->preauths, preauth);
+    if (!preauth->list_entry) {
+        // Failed to append new record to list
+        pomelo_webrtc_preauth_close(preauth);
+        return NULL;
+    }
+
+    return preauth;
+}
+
+
+pomelo_webrtc_session_t * pomelo_webrtc_socket_create_session(
+    pomelo_webrtc_socket_t * socket,
+    pomelo_webrtc_session_info_t * info
+) {
+    assert(socket != NULL);
+    assert(info != NULL);
+
     // Create new session
     pomelo_webrtc_session_t * session =
-        pomelo_webrtc_context_acquire_session(socket->context, &info);
+        pomelo_webrtc_context_acquire_session(socket->context, info);
     if (!session) return NULL; // Failed to create new session
 
     // Add session to sessions list
     session->list_entry = pomelo_list_push_back(socket->sessions, session);
     if (!session->list_entry) {
-        // Failed to append new session to list
+        // Failed to append new session to list, the session owns the WS now
+        pomelo_webrtc_session_ws_send_auth_failed(session);
         pomelo_webrtc_session_close(session);
         return NULL;
     }
@@ -44,6 +44,9 @@ struct pomelo_webrtc_socket_s {
     /// @brief All sessions
     pomelo_list_t * sessions;
 
+    /// @brief All websocket clients which have not been authenticated yet
+    pomelo_list_t * preauths;
+
     /// @brief Native socket
     pomelo_socket_t * native_socket;
 
@@ -96,6 +99,13 @@ void pomelo_webrtc_socket_remove_session(
     pomelo_webrtc_session_t * session
 );
 
+
+/// @brief Remove a pre-auth record from controlling list
+void pomelo_webrtc_socket_remove_preauth(
+    pomelo_webrtc_socket_t * socket,
+    pomelo_webrtc_preauth_t * preauth
+);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,143 @@
+#include <assert.h>
+#include <string.h>
+#include "clock-stats.h"
+
+
+/// @brief Update a smoothed value which has a single writer
+static void pomelo_webrtc_clock_smooth(
+    pomelo_atomic_uint64_t * value,
+    uint64_t sample,
+    bool first
+) {
+    if (first) {
+        pomelo_atomic_uint64_store(value, sample);
+        return;
+    }
+
+    uint64_t current = pomelo_atomic_uint64_load(value);
+    current = current
+        - (current >> POMELO_WEBRTC_CLOCK_DELAY_SMOOTHING_SHIFT)
+        + (sample >> POMELO_WEBRTC_CLOCK_DELAY_SMOOTHING_SHIFT);
+    pomelo_atomic_uint64_store(value, current);
+}
+
+
+void pomelo_webrtc_clock_reset(pomelo_webrtc_clock_t * clock) {
+    assert(clock != NULL);
+    memset(clock->samples, 0, sizeof(clock->samples));
+    clock->nsamples = 0;
+    pomelo_atomic_int64_store(&clock->offset, 0);
+    pomelo_atomic_int64_store(&clock->skew, 0);
+    pomelo_atomic_uint64_store(&clock->offset_error, 0);
+    pomelo_atomic_uint64_store(&clock->forward_delay, 0);
+    pomelo_atomic_uint64_store(&clock->backward_delay, 0);
+    pomelo_atomic_uint64_store(&clock->trusted_samples, 0);
+}
+
+
+void pomelo_webrtc_clock_record(
+    pomelo_webrtc_clock_t * clock,
+    uint64_t ping_time,
+    uint64_t pong_time,
+    uint64_t client_time
+) {
+    assert(clock != NULL);
+    if (pong_time < ping_time) {
+        return; // Invalid sample
+    }
+
+    pomelo_webrtc_clock_sample_t * latest =
+        &clock->samples[clock->nsamples % POMELO_WEBRTC_CLOCK_WINDOW];
+    latest->rtt = pong_time - ping_time;
+    latest->time = ping_time + latest->rtt / 2;
+    latest->offset = (int64_t) (client_time - latest->time);
+    bool first = (clock->nsamples == 0);
+    clock->nsamples++;
+
+    size_t nsamples = (clock->nsamples < POMELO_WEBRTC_CLOCK_WINDOW)
+        ? (size_t) clock->nsamples
+        : POMELO_WEBRTC_CLOCK_WINDOW;
+
+    // Clock filter: the sample with the lowest RTT has the smallest error
+    pomelo_webrtc_clock_sample_t * best = latest;
+    for (size_t i = 0; i < nsamples; i++) {
+        if (clock->samples[i].rtt < best->rtt) {
+            best = &clock->samples[i];
+        }
+    }
+    uint64_t margin = best->rtt >> POMELO_WEBRTC_CLOCK_FILTER_SHIFT;
+    if (margin < POMELO_WEBRTC_CLOCK_FILTER_MIN_MARGIN) {
+        margin = POMELO_WEBRTC_CLOCK_FILTER_MIN_MARGIN;
+    }
+    uint64_t threshold = best->rtt + margin;
+
+    // Fit a line through the trusted samples. Times are relative to the
+    // latest sample and offsets are relative to the best one, so that the
+    // sums keep their precision.
+    double sum_x = 0.0;
+    double sum_y = 0.0;
+    double sum_xx = 0.0;
+    double sum_xy = 0.0;
+    size_t trusted = 0;
+    for (size_t i = 0; i < nsamples; i++) {
+        pomelo_webrtc_clock_sample_t * sample = &clock->samples[i];
+        if (sample->rtt > threshold) continue;
+
+        double x = -(double) (int64_t) (latest->time - sample->time) / 1e9;
+        double y = (double) (sample->offset - best->offset);
+        sum_x += x;
+        sum_y += y;
+        sum_xx += x * x;
+        sum_xy += x * y;
+        trusted++;
+    }
+
+    int64_t offset = best->offset;
+    int64_t skew = 0;
+    double n = (double) trusted;
+    double sxx = sum_xx - sum_x * sum_x / n;
+    if (trusted >= POMELO_WEBRTC_CLOCK_MIN_SKEW_SAMPLES && sxx > 0.0) {
+        double slope = (sum_xy - sum_x * sum_y / n) / sxx;
+        double intercept = (sum_y - slope * sum_x) / n;
+        skew = (int64_t) slope;
+        offset = best->offset + (int64_t) intercept; // At the latest sample
+    }
+
+    pomelo_atomic_int64_store(&clock->offset, offset);
+    pomelo_atomic_int64_store(&clock->skew, skew);
+    pomelo_atomic_uint64_store(&clock->offset_error, best->rtt / 2);
+    pomelo_atomic_uint64_store(&clock->trusted_samples, trusted);
+
+    // Split the RTT of the latest sample with the estimated offset
+    uint64_t client_recv_time = client_time - (uint64_t) offset;
+    uint64_t forward = (client_recv_time > ping_time)
+        ? (client_recv_time - ping_time)
+        : 0;
+    if (forward > latest->rtt) forward = latest->rtt;
+
+    pomelo_webrtc_clock_smooth(&clock->forward_delay, forward, first);
+    pomelo_webrtc_clock_smooth(
+        &clock->backward_delay,
+        latest->rtt - forward,
+        first
+    );
+}
+
+
+void pomelo_webrtc_clock_get(
+    pomelo_webrtc_clock_t * clock,
+    pomelo_webrtc_clock_stats_t * stats
+) {
+    assert(clock != NULL);
+    assert(stats != NULL);
+
+    stats->offset_us = pomelo_atomic_int64_load(&clock->offset) / 1000;
+    stats->skew_ppb = pomelo_atomic_int64_load(&clock->skew);
+    stats->offset_error_us =
+        pomelo_atomic_uint64_load(&clock->offset_error) / 1000ULL;
+    stats->forward_delay_us =
+        pomelo_atomic_uint64_load(&clock->forward_delay) / 1000ULL;
+    stats->backward_delay_us =
+        pomelo_atomic_uint64_load(&clock->backward_delay) / 1000ULL;
+    stats->samples = pomelo_atomic_uint64_load(&clock->trusted_samples);
+}
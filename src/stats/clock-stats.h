@@ -0,0 +1,116 @@
+#ifndef POMELO_WEBRTC_CLOCK_STATS_H
+#define POMELO_WEBRTC_CLOCK_STATS_H
+#include "utils/atomic.h"
+#include "plugin.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Clock offset and one-way delay estimator (NTP style).
+    Each pong carries the client time, taken between the ping arrival and the
+    pong departure. Together with the send time of ping (t0) and the receive
+    time of pong (t3), a sample gives:
+
+        offset = client_time - (t0 + t3) / 2
+        rtt    = t3 - t0
+
+    The offset of a sample is exact only when both directions take the same
+    time, and its error is bounded by rtt / 2. So the samples with the lowest
+    RTT in the window are trusted (clock filter), and a line is fitted through
+    them to follow the drift (skew) of the client clock.
+
+    All times are in socket time (ns). Samples are recorded in plugin thread
+    only, the estimates can be read from any thread.
+*/
+
+
+/// @brief Number of samples in the window
+#define POMELO_WEBRTC_CLOCK_WINDOW 128 // 12.8s of pings
+
+/// @brief Samples with RTT up to the lowest one plus a margin are trusted.
+/// The margin is a fraction of the lowest RTT (1 / 2^N) but not less than
+/// the minimum margin (ns).
+#define POMELO_WEBRTC_CLOCK_FILTER_SHIFT 2
+#define POMELO_WEBRTC_CLOCK_FILTER_MIN_MARGIN 500000ULL // 0.5ms
+
+/// @brief Minimum number of trusted samples to estimate the skew
+#define POMELO_WEBRTC_CLOCK_MIN_SKEW_SAMPLES 8
+
+/// @brief Smoothing factor of delays (1 / 2^N)
+#define POMELO_WEBRTC_CLOCK_DELAY_SMOOTHING_SHIFT 3
+
+
+/// @brief Clock estimator
+typedef struct pomelo_webrtc_clock_s pomelo_webrtc_clock_t;
+
+/// @brief A sample of clock
+typedef struct pomelo_webrtc_clock_sample_s pomelo_webrtc_clock_sample_t;
+
+
+struct pomelo_webrtc_clock_sample_s {
+    /// @brief Midpoint of ping and pong in socket time (ns)
+    uint64_t time;
+
+    /// @brief Offset of client clock (ns)
+    int64_t offset;
+
+    /// @brief Round trip time (ns)
+    uint64_t rtt;
+};
+
+
+struct pomelo_webrtc_clock_s {
+    /// @brief Ring of samples. Plugin thread only.
+    pomelo_webrtc_clock_sample_t samples[POMELO_WEBRTC_CLOCK_WINDOW];
+
+    /// @brief Total number of recorded samples. Plugin thread only.
+    uint64_t nsamples;
+
+    /// @brief Estimated offset of client clock at the last sample (ns)
+    pomelo_atomic_int64_t offset;
+
+    /// @brief Estimated drift of client clock (ns per second)
+    pomelo_atomic_int64_t skew;
+
+    /// @brief Bound of offset error (ns)
+    pomelo_atomic_uint64_t offset_error;
+
+    /// @brief Smoothed delay from server to client (ns)
+    pomelo_atomic_uint64_t forward_delay;
+
+    /// @brief Smoothed delay from client to server (ns)
+    pomelo_atomic_uint64_t backward_delay;
+
+    /// @brief Number of trusted samples of the last estimate
+    pomelo_atomic_uint64_t trusted_samples;
+};
+
+
+/// @brief Reset the estimator
+void pomelo_webrtc_clock_reset(pomelo_webrtc_clock_t * clock);
+
+
+/// @brief Record a sample. Plugin thread only.
+/// @param ping_time Send time of ping in socket time (ns)
+/// @param pong_time Receive time of pong in socket time (ns)
+/// @param client_time Client time carried by pong (ns)
+void pomelo_webrtc_clock_record(
+    pomelo_webrtc_clock_t * clock,
+    uint64_t ping_time,
+    uint64_t pong_time,
+    uint64_t client_time
+);
+
+
+/// @brief Get the estimates
+void pomelo_webrtc_clock_get(
+    pomelo_webrtc_clock_t * clock,
+    pomelo_webrtc_clock_stats_t * stats
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // POMELO_WEBRTC_CLOCK_STATS_H
@@ -0,0 +1,112 @@
+#include <assert.h>
+#include <string.h>
+#include "uv.h"
+#include "handshake-stats.h"
+
+
+void pomelo_webrtc_handshake_stats_reset(
+    pomelo_webrtc_handshake_stats_t * stats
+) {
+    assert(stats != NULL);
+    for (int i = 0; i < POMELO_WEBRTC_HANDSHAKE_PHASE_COUNT; i++) {
+        pomelo_histogram_reset(&stats->durations[i]);
+        pomelo_atomic_uint64_store(&stats->failed[i], 0);
+        pomelo_atomic_uint64_store(&stats->timeout[i], 0);
+    }
+}
+
+
+void pomelo_webrtc_handshake_stats_begin(
+    pomelo_webrtc_handshake_stats_t * stats,
+    pomelo_webrtc_handshake_t * handshake
+) {
+    assert(stats != NULL);
+    assert(handshake != NULL);
+
+    memset(handshake, 0, sizeof(pomelo_webrtc_handshake_t));
+    pomelo_webrtc_handshake_stats_mark(
+        stats,
+        handshake,
+        POMELO_WEBRTC_HANDSHAKE_PHASE_WS_ACCEPTED
+    );
+}
+
+
+void pomelo_webrtc_handshake_stats_mark(
+    pomelo_webrtc_handshake_stats_t * stats,
+    pomelo_webrtc_handshake_t * handshake,
+    pomelo_webrtc_handshake_phase phase
+) {
+    assert(stats != NULL);
+    assert(handshake != NULL);
+    assert(phase < POMELO_WEBRTC_HANDSHAKE_PHASE_COUNT);
+
+    if (handshake->finished || handshake->times[phase] != 0) {
+        return; // Finished or already reached
+    }
+
+    uint64_t now = uv_hrtime();
+    handshake->times[phase] = now;
+    if (phase > handshake->phase) {
+        handshake->phase = phase;
+    }
+
+    uint64_t accepted =
+        handshake->times[POMELO_WEBRTC_HANDSHAKE_PHASE_WS_ACCEPTED];
+    uint64_t elapsed_us = (now - accepted) / 1000ULL;
+    pomelo_histogram_record(&stats->durations[phase], elapsed_us);
+}
+
+
+void pomelo_webrtc_handshake_stats_finish(
+    pomelo_webrtc_handshake_stats_t * stats,
+    pomelo_webrtc_handshake_t * handshake,
+    pomelo_webrtc_handshake_result result
+) {
+    assert(stats != NULL);
+    assert(handshake != NULL);
+
+    if (handshake->finished) {
+        return; // Already reported
+    }
+    handshake->finished = true;
+
+    switch (result) {
+        case POMELO_WEBRTC_HANDSHAKE_RESULT_FAILED:
+            pomelo_atomic_uint64_fetch_add(&stats->failed[handshake->phase], 1);
+            break;
+
+        case POMELO_WEBRTC_HANDSHAKE_RESULT_TIMEOUT:
+            pomelo_atomic_uint64_fetch_add(
+                &stats->timeout[handshake->phase], 1
+            );
+            break;
+
+        default:
+            // Successful or handed over to another owner
+            break;
+    }
+}
+
+
+void pomelo_webrtc_handshake_stats_get(
+    pomelo_webrtc_handshake_stats_t * stats,
+    pomelo_webrtc_handshake_phase phase,
+    pomelo_webrtc_handshake_phase_stats_t * phase_stats
+) {
+    assert(stats != NULL);
+    assert(phase < POMELO_WEBRTC_HANDSHAKE_PHASE_COUNT);
+    assert(phase_stats != NULL);
+
+    pomelo_histogram_t * histogram = &stats->durations[phase];
+    phase_stats->count = pomelo_histogram_count(histogram);
+    phase_stats->min_us = pomelo_histogram_min(histogram);
+    phase_stats->mean_us = pomelo_histogram_mean(histogram);
+    phase_stats->p50_us = pomelo_histogram_quantile(histogram, 0.5);
+    phase_stats->p90_us = pomelo_histogram_quantile(histogram, 0.9);
+    phase_stats->p99_us = pomelo_histogram_quantile(histogram, 0.99);
+    phase_stats->p999_us = pomelo_histogram_quantile(histogram, 0.999);
+    phase_stats->max_us = pomelo_histogram_max(histogram);
+    phase_stats->failed = pomelo_atomic_uint64_load(&stats->failed[phase]);
+    phase_stats->timeout = pomelo_atomic_uint64_load(&stats->timeout[phase]);
+}
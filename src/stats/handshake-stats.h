@@ -0,0 +1,103 @@
+#ifndef POMELO_WEBRTC_HANDSHAKE_STATS_H
+#define POMELO_WEBRTC_HANDSHAKE_STATS_H
+#include <stdbool.h>
+#include "utils/histogram.h"
+#include "plugin.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Handshake statistics.
+    Every pre-auth record/session carries a handshake tracker with the
+    monotonic time of each reached phase. When a phase is reached, the elapsed
+    time since websocket accepted is recorded into the histogram of that phase.
+    When a handshake dies before the native session is created, the failure is
+    counted for the furthest phase it has reached.
+*/
+
+
+/// @brief Handshake tracker of a single connection
+typedef struct pomelo_webrtc_handshake_s pomelo_webrtc_handshake_t;
+
+/// @brief Aggregated handshake statistics
+typedef struct pomelo_webrtc_handshake_stats_s pomelo_webrtc_handshake_stats_t;
+
+
+/// @brief Result of a handshake
+typedef enum pomelo_webrtc_handshake_result_e {
+    POMELO_WEBRTC_HANDSHAKE_RESULT_SUCCESS,
+    POMELO_WEBRTC_HANDSHAKE_RESULT_FAILED,
+    POMELO_WEBRTC_HANDSHAKE_RESULT_TIMEOUT,
+    POMELO_WEBRTC_HANDSHAKE_RESULT_TRANSFERRED
+} pomelo_webrtc_handshake_result;
+
+
+struct pomelo_webrtc_handshake_s {
+    /// @brief Monotonic time (ns) of reached phases. Zero if not reached.
+    uint64_t times[POMELO_WEBRTC_HANDSHAKE_PHASE_COUNT];
+
+    /// @brief The furthest reached phase
+    pomelo_webrtc_handshake_phase phase;
+
+    /// @brief Whether the result of handshake has been reported
+    bool finished;
+
+    /// @brief Admission slot of source address, zero if it is not tracked
+    uint64_t source;
+};
+
+
+struct pomelo_webrtc_handshake_stats_s {
+    /// @brief Durations of phases (in microseconds)
+    pomelo_histogram_t durations[POMELO_WEBRTC_HANDSHAKE_PHASE_COUNT];
+
+    /// @brief Failed handshakes by phase
+    pomelo_atomic_uint64_t failed[POMELO_WEBRTC_HANDSHAKE_PHASE_COUNT];
+
+    /// @brief Timed out handshakes by phase
+    pomelo_atomic_uint64_t timeout[POMELO_WEBRTC_HANDSHAKE_PHASE_COUNT];
+};
+
+
+/// @brief Reset the aggregated statistics
+void pomelo_webrtc_handshake_stats_reset(
+    pomelo_webrtc_handshake_stats_t * stats
+);
+
+
+/// @brief Start tracking a handshake. The first phase is marked as reached.
+void pomelo_webrtc_handshake_stats_begin(
+    pomelo_webrtc_handshake_stats_t * stats,
+    pomelo_webrtc_handshake_t * handshake
+);
+
+
+/// @brief Mark a phase as reached. Only the first time is recorded.
+void pomelo_webrtc_handshake_stats_mark(
+    pomelo_webrtc_handshake_stats_t * stats,
+    pomelo_webrtc_handshake_t * handshake,
+    pomelo_webrtc_handshake_phase phase
+);
+
+
+/// @brief Report the result of handshake. Only the first result is recorded.
+void pomelo_webrtc_handshake_stats_finish(
+    pomelo_webrtc_handshake_stats_t * stats,
+    pomelo_webrtc_handshake_t * handshake,
+    pomelo_webrtc_handshake_result result
+);
+
+
+/// @brief Get the statistic of a phase
+void pomelo_webrtc_handshake_stats_get(
+    pomelo_webrtc_handshake_stats_t * stats,
+    pomelo_webrtc_handshake_phase phase,
+    pomelo_webrtc_handshake_phase_stats_t * phase_stats
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // POMELO_WEBRTC_HANDSHAKE_STATS_H
@@ -0,0 +1,202 @@
+#include <assert.h>
+#include <string.h>
+#include "uv.h"
+#include "loop-stats.h"
+
+
+/// @brief Fill the distribution from histogram
+static void pomelo_webrtc_loop_monitor_distribution(
+    pomelo_histogram_t * histogram,
+    pomelo_webrtc_distribution_t * distribution
+) {
+    distribution->count = pomelo_histogram_count(histogram);
+    distribution->mean = pomelo_histogram_mean(histogram);
+    distribution->p50 = pomelo_histogram_quantile(histogram, 0.5);
+    distribution->p90 = pomelo_histogram_quantile(histogram, 0.9);
+    distribution->p99 = pomelo_histogram_quantile(histogram, 0.99);
+    distribution->p999 = pomelo_histogram_quantile(histogram, 0.999);
+    distribution->max = pomelo_histogram_max(histogram);
+}
+
+
+void pomelo_webrtc_loop_monitor_reset(pomelo_webrtc_loop_monitor_t * monitor) {
+    assert(monitor != NULL);
+    pomelo_webrtc_loop_monitor_reset_distributions(monitor);
+    pomelo_atomic_uint64_store(&monitor->queue_depth, 0);
+    pomelo_atomic_uint64_store(&monitor->lag, 0);
+    pomelo_atomic_uint64_store(&monitor->busy_since, 0);
+    monitor->last_check = 0;
+    monitor->last_prepare = 0;
+    monitor->waiting = false;
+    monitor->callbacks_time = 0;
+}
+
+
+void pomelo_webrtc_loop_monitor_reset_distributions(
+    pomelo_webrtc_loop_monitor_t * monitor
+) {
+    assert(monitor != NULL);
+    pomelo_histogram_reset(&monitor->busy);
+    pomelo_histogram_reset(&monitor->iteration);
+    pomelo_histogram_reset(&monitor->task_latency);
+    pomelo_histogram_reset(&monitor->tasks_per_drain);
+    pomelo_atomic_uint64_store(
+        &monitor->queue_depth_max,
+        pomelo_atomic_uint64_load(&monitor->queue_depth)
+    );
+}
+
+
+void pomelo_webrtc_loop_monitor_on_prepare(
+    pomelo_webrtc_loop_monitor_t * monitor
+) {
+    assert(monitor != NULL);
+    uint64_t now = uv_hrtime();
+
+    if (monitor->last_check != 0) {
+        // Callbacks of the last wait + everything after the wait
+        uint64_t busy = monitor->callbacks_time + (now - monitor->last_check);
+        pomelo_histogram_record(&monitor->busy, busy / 1000ULL);
+
+        uint64_t lag = pomelo_atomic_uint64_load(&monitor->lag);
+        lag = lag - (lag >> POMELO_WEBRTC_LOOP_LAG_SMOOTHING_SHIFT)
+            + (busy >> POMELO_WEBRTC_LOOP_LAG_SMOOTHING_SHIFT);
+        pomelo_atomic_uint64_store(&monitor->lag, lag);
+    }
+
+    if (monitor->last_prepare != 0) {
+        pomelo_histogram_record(
+            &monitor->iteration,
+            (now - monitor->last_prepare) / 1000ULL
+        );
+    }
+
+    monitor->last_prepare = now;
+    monitor->callbacks_time = 0;
+    monitor->waiting = true;
+    pomelo_atomic_uint64_store(&monitor->busy_since, 0);
+}
+
+
+void pomelo_webrtc_loop_monitor_on_check(
+    pomelo_webrtc_loop_monitor_t * monitor
+) {
+    assert(monitor != NULL);
+    uint64_t now = uv_hrtime();
+    monitor->last_check = now;
+    monitor->waiting = false;
+    pomelo_atomic_uint64_store(&monitor->busy_since, now);
+}
+
+
+uint64_t pomelo_webrtc_loop_monitor_begin_callbacks(
+    pomelo_webrtc_loop_monitor_t * monitor
+) {
+    assert(monitor != NULL);
+    uint64_t now = uv_hrtime();
+    if (monitor->waiting) {
+        pomelo_atomic_uint64_store(&monitor->busy_since, now);
+    }
+    return now;
+}
+
+
+void pomelo_webrtc_loop_monitor_end_callbacks(
+    pomelo_webrtc_loop_monitor_t * monitor,
+    uint64_t start
+) {
+    assert(monitor != NULL);
+    if (!monitor->waiting) {
+        return; // Outside of the wait, it is counted from the check
+    }
+
+    monitor->callbacks_time += uv_hrtime() - start;
+    pomelo_atomic_uint64_store(&monitor->busy_since, 0);
+}
+
+
+void pomelo_webrtc_loop_monitor_on_submit(
+    pomelo_webrtc_loop_monitor_t * monitor
+) {
+    assert(monitor != NULL);
+    uint64_t depth =
+        pomelo_atomic_uint64_fetch_add(&monitor->queue_depth, 1) + 1;
+
+    uint64_t max = pomelo_atomic_uint64_load(&monitor->queue_depth_max);
+    while (depth > max) {
+        if (pomelo_atomic_uint64_compare_exchange(
+            &monitor->queue_depth_max, max, depth
+        )) {
+            break;
+        }
+        max = pomelo_atomic_uint64_load(&monitor->queue_depth_max);
+    }
+}
+
+
+void pomelo_webrtc_loop_monitor_on_task(
+    pomelo_webrtc_loop_monitor_t * monitor,
+    uint64_t submit_time,
+    uint64_t now
+) {
+    assert(monitor != NULL);
+    pomelo_atomic_uint64_fetch_sub(&monitor->queue_depth, 1);
+
+    uint64_t latency = (now > submit_time) ? (now - submit_time) : 0;
+    pomelo_histogram_record(&monitor->task_latency, latency / 1000ULL);
+}
+
+
+void pomelo_webrtc_loop_monitor_on_drain(
+    pomelo_webrtc_loop_monitor_t * monitor,
+    uint64_t ntasks
+) {
+    assert(monitor != NULL);
+    pomelo_histogram_record(&monitor->tasks_per_drain, ntasks);
+}
+
+
+void pomelo_webrtc_loop_monitor_get(
+    pomelo_webrtc_loop_monitor_t * monitor,
+    pomelo_webrtc_loop_stats_t * stats
+) {
+    assert(monitor != NULL);
+    assert(stats != NULL);
+
+    stats->lag_us = pomelo_webrtc_loop_monitor_lag(monitor);
+    stats->queue_depth = pomelo_atomic_uint64_load(&monitor->queue_depth);
+    stats->queue_depth_max =
+        pomelo_atomic_uint64_load(&monitor->queue_depth_max);
+
+    pomelo_webrtc_loop_monitor_distribution(&monitor->busy, &stats->busy_us);
+    pomelo_webrtc_loop_monitor_distribution(
+        &monitor->iteration,
+        &stats->iteration_us
+    );
+    pomelo_webrtc_loop_monitor_distribution(
+        &monitor->task_latency,
+        &stats->task_latency_us
+    );
+    pomelo_webrtc_loop_monitor_distribution(
+        &monitor->tasks_per_drain,
+        &stats->tasks_per_drain
+    );
+}
+
+
+uint64_t pomelo_webrtc_loop_monitor_lag(
+    pomelo_webrtc_loop_monitor_t * monitor
+) {
+    assert(monitor != NULL);
+    uint64_t lag = pomelo_atomic_uint64_load(&monitor->lag);
+
+    // A long running iteration is reported before it finishes
+    uint64_t busy_since = pomelo_atomic_uint64_load(&monitor->busy_since);
+    if (busy_since != 0) {
+        uint64_t now = uv_hrtime();
+        uint64_t current = (now > busy_since) ? (now - busy_since) : 0;
+        if (current > lag) lag = current;
+    }
+
+    return lag / 1000ULL;
+}
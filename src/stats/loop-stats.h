@@ -0,0 +1,147 @@
+#ifndef POMELO_WEBRTC_LOOP_STATS_H
+#define POMELO_WEBRTC_LOOP_STATS_H
+#include <stdbool.h>
+#include "utils/histogram.h"
+#include "plugin.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Loop health monitor.
+    A prepare handle marks the moment the loop starts waiting for I/O and a
+    check handle marks the moment it stops. The time outside of waiting is the
+    busy time of an iteration. The task queue is drained inside the I/O phase,
+    so the time spent in plugin callbacks of that phase is added explicitly.
+
+    Every async task is stamped when it is submitted, so the latency until it
+    runs and the depth of task queue can be measured.
+
+    Recording functions are called in plugin thread only, the statistics can
+    be read from any thread.
+*/
+
+
+/// @brief Smoothing factor of lag (1 / 2^N)
+#define POMELO_WEBRTC_LOOP_LAG_SMOOTHING_SHIFT 3
+
+
+/// @brief Loop health monitor
+typedef struct pomelo_webrtc_loop_monitor_s pomelo_webrtc_loop_monitor_t;
+
+
+struct pomelo_webrtc_loop_monitor_s {
+    /// @brief Busy time of iterations (us)
+    pomelo_histogram_t busy;
+
+    /// @brief Duration of iterations (us)
+    pomelo_histogram_t iteration;
+
+    /// @brief Latency from submitting to running (us)
+    pomelo_histogram_t task_latency;
+
+    /// @brief Number of tasks per drain
+    pomelo_histogram_t tasks_per_drain;
+
+    /// @brief Number of pending tasks
+    pomelo_atomic_uint64_t queue_depth;
+
+    /// @brief The highest number of pending tasks
+    pomelo_atomic_uint64_t queue_depth_max;
+
+    /// @brief Smoothed busy time (ns)
+    pomelo_atomic_uint64_t lag;
+
+    /// @brief Monotonic time (ns) since the loop has been busy, zero while
+    /// the loop is waiting
+    pomelo_atomic_uint64_t busy_since;
+
+    /// @brief The last time of leaving the wait (ns). Plugin thread only.
+    uint64_t last_check;
+
+    /// @brief The last time of entering the wait (ns). Plugin thread only.
+    uint64_t last_prepare;
+
+    /// @brief Whether the loop is in its I/O phase. Plugin thread only.
+    bool waiting;
+
+    /// @brief Time of callbacks during the current wait (ns). Plugin thread
+    /// only.
+    uint64_t callbacks_time;
+};
+
+
+/// @brief Reset the monitor
+void pomelo_webrtc_loop_monitor_reset(pomelo_webrtc_loop_monitor_t * monitor);
+
+
+/// @brief Reset the distributions and the highest queue depth
+void pomelo_webrtc_loop_monitor_reset_distributions(
+    pomelo_webrtc_loop_monitor_t * monitor
+);
+
+
+/// @brief Called when the loop is going to wait for I/O
+void pomelo_webrtc_loop_monitor_on_prepare(
+    pomelo_webrtc_loop_monitor_t * monitor
+);
+
+
+/// @brief Called when the loop has stopped waiting for I/O
+void pomelo_webrtc_loop_monitor_on_check(
+    pomelo_webrtc_loop_monitor_t * monitor
+);
+
+
+/// @brief Called when plugin callbacks start running inside the I/O phase
+/// @return The start time
+uint64_t pomelo_webrtc_loop_monitor_begin_callbacks(
+    pomelo_webrtc_loop_monitor_t * monitor
+);
+
+
+/// @brief Called when plugin callbacks inside the I/O phase have finished
+void pomelo_webrtc_loop_monitor_end_callbacks(
+    pomelo_webrtc_loop_monitor_t * monitor,
+    uint64_t start
+);
+
+
+/// @brief Called when a task has been submitted. This is threadsafe.
+void pomelo_webrtc_loop_monitor_on_submit(
+    pomelo_webrtc_loop_monitor_t * monitor
+);
+
+
+/// @brief Called when a submitted task is going to run
+void pomelo_webrtc_loop_monitor_on_task(
+    pomelo_webrtc_loop_monitor_t * monitor,
+    uint64_t submit_time,
+    uint64_t now
+);
+
+
+/// @brief Called when the task queue has been drained
+void pomelo_webrtc_loop_monitor_on_drain(
+    pomelo_webrtc_loop_monitor_t * monitor,
+    uint64_t ntasks
+);
+
+
+/// @brief Get the statistics
+void pomelo_webrtc_loop_monitor_get(
+    pomelo_webrtc_loop_monitor_t * monitor,
+    pomelo_webrtc_loop_stats_t * stats
+);
+
+
+/// @brief Get the current lag (us)
+uint64_t pomelo_webrtc_loop_monitor_lag(
+    pomelo_webrtc_loop_monitor_t * monitor
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // POMELO_WEBRTC_LOOP_STATS_H
@@ -0,0 +1,82 @@
+#include <assert.h>
+#include <string.h>
+#include "loss-stats.h"
+
+
+/// Number of sequences tracked by the bitmap
+#define POMELO_WEBRTC_LOSS_BITMAP_BITS 64
+
+
+void pomelo_webrtc_loss_reset(pomelo_webrtc_loss_t * loss) {
+    assert(loss != NULL);
+    memset(loss, 0, sizeof(pomelo_webrtc_loss_t));
+}
+
+
+void pomelo_webrtc_loss_record(
+    pomelo_webrtc_loss_t * loss,
+    uint16_t sequence
+) {
+    assert(loss != NULL);
+
+    if (!loss->started) {
+        // Shift by one cycle, so that the base of the first interval does
+        // not underflow
+        loss->started = true;
+        loss->highest = (uint64_t) sequence + (1ULL << 16);
+        loss->bitmap = 1;
+        loss->interval_base = loss->highest - 1;
+        loss->interval_received = 1;
+        return;
+    }
+
+    // Distance to the highest sequence, the stream wraps at 16 bits
+    int16_t delta = (int16_t) (uint16_t) (sequence - (uint16_t) loss->highest);
+    if (delta > 0) {
+        loss->bitmap = (delta < POMELO_WEBRTC_LOSS_BITMAP_BITS)
+            ? ((loss->bitmap << delta) | 1)
+            : 1;
+        loss->highest += (uint64_t) delta;
+        loss->interval_received++;
+        return;
+    }
+
+    uint64_t distance = (uint64_t) (-(int32_t) delta);
+    if (distance >= POMELO_WEBRTC_LOSS_BITMAP_BITS) {
+        return; // Too old to be told from a duplicate
+    }
+
+    uint64_t bit = 1ULL << distance;
+    if (loss->bitmap & bit) {
+        return; // Duplicate
+    }
+
+    // Late arrival, it is not lost
+    loss->bitmap |= bit;
+    loss->interval_received++;
+}
+
+
+void pomelo_webrtc_loss_sample(
+    pomelo_webrtc_loss_t * loss,
+    uint64_t * expected,
+    uint64_t * lost
+) {
+    assert(loss != NULL);
+    assert(expected != NULL);
+    assert(lost != NULL);
+
+    if (!loss->started) {
+        *expected = 0;
+        *lost = 0;
+        return;
+    }
+
+    *expected = loss->highest - loss->interval_base;
+    *lost = (*expected > loss->interval_received)
+        ? (*expected - loss->interval_received)
+        : 0; // Late arrivals of the previous interval
+
+    loss->interval_base = loss->highest;
+    loss->interval_received = 0;
+}
@@ -0,0 +1,68 @@
+#ifndef POMELO_WEBRTC_LOSS_STATS_H
+#define POMELO_WEBRTC_LOSS_STATS_H
+#include <stdbool.h>
+#include "utils/atomic.h"
+#include "plugin.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Loss estimator of a stream of 16-bit sequence numbers.
+    Sequences are extended to 64 bits, and a bitmap of the last 64 sequences
+    tells duplicates from late arrivals. As in RFC 3550, the loss of an
+    interval is the number of expected messages (the growth of the highest
+    sequence) minus the number of received ones.
+
+    Recording functions are called in plugin thread only.
+*/
+
+
+/// @brief Maximum value of loss fraction
+#define POMELO_WEBRTC_LOSS_FRACTION_ONE 0xFFFF
+
+
+/// @brief Loss estimator
+typedef struct pomelo_webrtc_loss_s pomelo_webrtc_loss_t;
+
+
+struct pomelo_webrtc_loss_s {
+    /// @brief Whether a sequence has been received
+    bool started;
+
+    /// @brief The highest extended sequence
+    uint64_t highest;
+
+    /// @brief Received sequences, bit N is (highest - N)
+    uint64_t bitmap;
+
+    /// @brief Extended sequence before the current interval
+    uint64_t interval_base;
+
+    /// @brief Received messages of the current interval
+    uint64_t interval_received;
+};
+
+
+/// @brief Reset the estimator
+void pomelo_webrtc_loss_reset(pomelo_webrtc_loss_t * loss);
+
+
+/// @brief Record a received sequence
+void pomelo_webrtc_loss_record(pomelo_webrtc_loss_t * loss, uint16_t sequence);
+
+
+/// @brief Finish the current interval and start the next one
+/// @param expected Output number of expected messages of the interval
+/// @param lost Output number of lost messages of the interval
+void pomelo_webrtc_loss_sample(
+    pomelo_webrtc_loss_t * loss,
+    uint64_t * expected,
+    uint64_t * lost
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // POMELO_WEBRTC_LOSS_STATS_H
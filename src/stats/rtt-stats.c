@@ -0,0 +1,77 @@
+#include <assert.h>
+#include <string.h>
+#include "rtt-stats.h"
+
+
+void pomelo_webrtc_rtt_reset(pomelo_webrtc_rtt_t * rtt) {
+    assert(rtt != NULL);
+    memset(rtt->samples, 0, sizeof(rtt->samples));
+    rtt->nsamples = 0;
+    rtt->jitter_scaled = 0;
+    pomelo_atomic_uint64_store(&rtt->last, 0);
+    pomelo_atomic_uint64_store(&rtt->min, 0);
+    pomelo_atomic_uint64_store(&rtt->p50, 0);
+    pomelo_atomic_uint64_store(&rtt->p95, 0);
+    pomelo_atomic_uint64_store(&rtt->jitter, 0);
+    pomelo_atomic_uint64_store(&rtt->window_samples, 0);
+}
+
+
+void pomelo_webrtc_rtt_record(pomelo_webrtc_rtt_t * rtt, uint64_t sample) {
+    assert(rtt != NULL);
+
+    // Jitter, the same integer form as the sample code of RFC 3550
+    if (rtt->nsamples > 0) {
+        uint64_t last = pomelo_atomic_uint64_load(&rtt->last);
+        uint64_t d = (sample > last) ? (sample - last) : (last - sample);
+        uint64_t rounding = 1ULL << (POMELO_WEBRTC_RTT_JITTER_SHIFT - 1);
+        rtt->jitter_scaled += d - (
+            (rtt->jitter_scaled + rounding) >> POMELO_WEBRTC_RTT_JITTER_SHIFT
+        );
+    }
+    pomelo_atomic_uint64_store(&rtt->last, sample);
+    pomelo_atomic_uint64_store(
+        &rtt->jitter,
+        rtt->jitter_scaled >> POMELO_WEBRTC_RTT_JITTER_SHIFT
+    );
+
+    rtt->samples[rtt->nsamples % POMELO_WEBRTC_RTT_WINDOW] = sample;
+    rtt->nsamples++;
+
+    size_t nsamples = (rtt->nsamples < POMELO_WEBRTC_RTT_WINDOW)
+        ? (size_t) rtt->nsamples
+        : POMELO_WEBRTC_RTT_WINDOW;
+
+    // Insertion sort, the window is small
+    uint64_t sorted[POMELO_WEBRTC_RTT_WINDOW];
+    for (size_t i = 0; i < nsamples; i++) {
+        uint64_t value = rtt->samples[i];
+        size_t j = i;
+        while (j > 0 && sorted[j - 1] > value) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = value;
+    }
+
+    pomelo_atomic_uint64_store(&rtt->min, sorted[0]);
+    pomelo_atomic_uint64_store(&rtt->p50, sorted[(nsamples - 1) * 50 / 100]);
+    pomelo_atomic_uint64_store(&rtt->p95, sorted[(nsamples - 1) * 95 / 100]);
+    pomelo_atomic_uint64_store(&rtt->window_samples, nsamples);
+}
+
+
+void pomelo_webrtc_rtt_get(
+    pomelo_webrtc_rtt_t * rtt,
+    pomelo_webrtc_rtt_stats_t * stats
+) {
+    assert(rtt != NULL);
+    assert(stats != NULL);
+
+    stats->last_us = pomelo_atomic_uint64_load(&rtt->last) / 1000ULL;
+    stats->min_us = pomelo_atomic_uint64_load(&rtt->min) / 1000ULL;
+    stats->p50_us = pomelo_atomic_uint64_load(&rtt->p50) / 1000ULL;
+    stats->p95_us = pomelo_atomic_uint64_load(&rtt->p95) / 1000ULL;
+    stats->jitter_us = pomelo_atomic_uint64_load(&rtt->jitter) / 1000ULL;
+    stats->samples = pomelo_atomic_uint64_load(&rtt->window_samples);
+}
@@ -0,0 +1,85 @@
+#ifndef POMELO_WEBRTC_RTT_STATS_H
+#define POMELO_WEBRTC_RTT_STATS_H
+#include "utils/atomic.h"
+#include "plugin.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Robust RTT statistics of a session.
+    The RTT calculator of the core only provides the mean and the variance,
+    so a single spike moves them for seconds. This keeps a window of the most
+    recent RTT samples and derives:
+    - The minimum RTT of the window, the best estimate of the path delay.
+    - The 50th and 95th percentiles of the window.
+    - The interarrival jitter of RFC 3550, J += (|D| - J) / 16, where D is the
+      difference between two consecutive RTT samples.
+
+    With 10 pings per second, the window is short enough to sort on every
+    sample. Samples are recorded in plugin thread only, the statistics can be
+    read from any thread.
+*/
+
+
+/// @brief Number of samples in the window
+#define POMELO_WEBRTC_RTT_WINDOW 64 // 6.4s of pings
+
+/// @brief Gain of jitter estimate (1 / 2^N)
+#define POMELO_WEBRTC_RTT_JITTER_SHIFT 4
+
+
+/// @brief RTT statistics
+typedef struct pomelo_webrtc_rtt_s pomelo_webrtc_rtt_t;
+
+
+struct pomelo_webrtc_rtt_s {
+    /// @brief Ring of RTT samples (ns). Plugin thread only.
+    uint64_t samples[POMELO_WEBRTC_RTT_WINDOW];
+
+    /// @brief Total number of recorded samples. Plugin thread only.
+    uint64_t nsamples;
+
+    /// @brief Jitter (ns) scaled by 2^POMELO_WEBRTC_RTT_JITTER_SHIFT. Plugin
+    /// thread only.
+    uint64_t jitter_scaled;
+
+    /// @brief The latest RTT (ns)
+    pomelo_atomic_uint64_t last;
+
+    /// @brief Minimum RTT of the window (ns)
+    pomelo_atomic_uint64_t min;
+
+    /// @brief Median RTT of the window (ns)
+    pomelo_atomic_uint64_t p50;
+
+    /// @brief 95th percentile RTT of the window (ns)
+    pomelo_atomic_uint64_t p95;
+
+    /// @brief Jitter (ns)
+    pomelo_atomic_uint64_t jitter;
+
+    /// @brief Number of samples in the window
+    pomelo_atomic_uint64_t window_samples;
+};
+
+
+/// @brief Reset the statistics
+void pomelo_webrtc_rtt_reset(pomelo_webrtc_rtt_t * rtt);
+
+
+/// @brief Record a RTT sample (ns). Plugin thread only.
+void pomelo_webrtc_rtt_record(pomelo_webrtc_rtt_t * rtt, uint64_t sample);
+
+
+/// @brief Get the statistics. The mean and variance are not filled.
+void pomelo_webrtc_rtt_get(
+    pomelo_webrtc_rtt_t * rtt,
+    pomelo_webrtc_rtt_stats_t * stats
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // POMELO_WEBRTC_RTT_STATS_H
@@ -0,0 +1,80 @@
+#include <assert.h>
+#include "traffic-stats.h"
+
+
+/// @brief Increase a counter which has a single writer
+static void pomelo_webrtc_traffic_add(
+    pomelo_atomic_uint64_t * counter,
+    uint64_t value
+) {
+    pomelo_atomic_uint64_store(
+        counter,
+        pomelo_atomic_uint64_load(counter) + value
+    );
+}
+
+
+void pomelo_webrtc_traffic_reset(pomelo_webrtc_traffic_t * traffic) {
+    assert(traffic != NULL);
+    pomelo_atomic_uint64_store(&traffic->messages_in, 0);
+    pomelo_atomic_uint64_store(&traffic->bytes_in, 0);
+    pomelo_atomic_uint64_store(&traffic->messages_out, 0);
+    pomelo_atomic_uint64_store(&traffic->bytes_out, 0);
+    pomelo_atomic_uint64_store(&traffic->recv_dropped, 0);
+    pomelo_atomic_uint64_store(&traffic->send_dropped, 0);
+    pomelo_atomic_uint64_store(&traffic->send_failed, 0);
+}
+
+
+void pomelo_webrtc_traffic_on_recv(
+    pomelo_webrtc_traffic_t * traffic,
+    size_t bytes
+) {
+    assert(traffic != NULL);
+    pomelo_webrtc_traffic_add(&traffic->messages_in, 1);
+    pomelo_webrtc_traffic_add(&traffic->bytes_in, bytes);
+}
+
+
+void pomelo_webrtc_traffic_on_send(
+    pomelo_webrtc_traffic_t * traffic,
+    size_t bytes
+) {
+    assert(traffic != NULL);
+    pomelo_webrtc_traffic_add(&traffic->messages_out, 1);
+    pomelo_webrtc_traffic_add(&traffic->bytes_out, bytes);
+}
+
+
+void pomelo_webrtc_traffic_on_recv_dropped(pomelo_webrtc_traffic_t * traffic) {
+    assert(traffic != NULL);
+    pomelo_atomic_uint64_fetch_add(&traffic->recv_dropped, 1);
+}
+
+
+void pomelo_webrtc_traffic_on_send_dropped(pomelo_webrtc_traffic_t * traffic) {
+    assert(traffic != NULL);
+    pomelo_atomic_uint64_fetch_add(&traffic->send_dropped, 1);
+}
+
+
+void pomelo_webrtc_traffic_on_send_failed(pomelo_webrtc_traffic_t * traffic) {
+    assert(traffic != NULL);
+    pomelo_atomic_uint64_fetch_add(&traffic->send_failed, 1);
+}
+
+
+void pomelo_webrtc_traffic_fold(
+    pomelo_webrtc_traffic_t * traffic,
+    pomelo_webrtc_traffic_stats_t * stats
+) {
+    assert(traffic != NULL);
+    assert(stats != NULL);
+    stats->messages_in += pomelo_atomic_uint64_load(&traffic->messages_in);
+    stats->bytes_in += pomelo_atomic_uint64_load(&traffic->bytes_in);
+    stats->messages_out += pomelo_atomic_uint64_load(&traffic->messages_out);
+    stats->bytes_out += pomelo_atomic_uint64_load(&traffic->bytes_out);
+    stats->recv_dropped += pomelo_atomic_uint64_load(&traffic->recv_dropped);
+    stats->send_dropped += pomelo_atomic_uint64_load(&traffic->send_dropped);
+    stats->send_failed += pomelo_atomic_uint64_load(&traffic->send_failed);
+}
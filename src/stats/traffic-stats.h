@@ -0,0 +1,89 @@
+#ifndef POMELO_WEBRTC_TRAFFIC_STATS_H
+#define POMELO_WEBRTC_TRAFFIC_STATS_H
+#include "utils/atomic.h"
+#include "plugin.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Traffic counters.
+    Messages and bytes are only counted in plugin thread. Each of them has a
+    single writer, so it is updated by a plain load and store instead of an
+    atomic read-modify-write. Drops may be reported from the executor or the
+    native threads, they are rare and counted atomically.
+
+    Counters are never combined on the hot path: a session keeps one set per
+    channel and they are folded when the statistics are queried.
+*/
+
+
+/// @brief Traffic counters
+typedef struct pomelo_webrtc_traffic_s pomelo_webrtc_traffic_t;
+
+
+struct pomelo_webrtc_traffic_s {
+    /// @brief Received messages. Plugin thread only.
+    pomelo_atomic_uint64_t messages_in;
+
+    /// @brief Received bytes. Plugin thread only.
+    pomelo_atomic_uint64_t bytes_in;
+
+    /// @brief Sent messages. Plugin thread only.
+    pomelo_atomic_uint64_t messages_out;
+
+    /// @brief Sent bytes. Plugin thread only.
+    pomelo_atomic_uint64_t bytes_out;
+
+    /// @brief Received messages which have not reached the native session
+    pomelo_atomic_uint64_t recv_dropped;
+
+    /// @brief Outgoing messages which have not reached the data channel
+    pomelo_atomic_uint64_t send_dropped;
+
+    /// @brief Outgoing messages which have been rejected by the data channel
+    pomelo_atomic_uint64_t send_failed;
+};
+
+
+/// @brief Reset all counters
+void pomelo_webrtc_traffic_reset(pomelo_webrtc_traffic_t * traffic);
+
+
+/// @brief Count a received message. Plugin thread only.
+void pomelo_webrtc_traffic_on_recv(
+    pomelo_webrtc_traffic_t * traffic,
+    size_t bytes
+);
+
+
+/// @brief Count a sent message. Plugin thread only.
+void pomelo_webrtc_traffic_on_send(
+    pomelo_webrtc_traffic_t * traffic,
+    size_t bytes
+);
+
+
+/// @brief Count a dropped received message. This is threadsafe.
+void pomelo_webrtc_traffic_on_recv_dropped(pomelo_webrtc_traffic_t * traffic);
+
+
+/// @brief Count a dropped outgoing message. This is threadsafe.
+void pomelo_webrtc_traffic_on_send_dropped(pomelo_webrtc_traffic_t * traffic);
+
+
+/// @brief Count a failed outgoing message. This is threadsafe.
+void pomelo_webrtc_traffic_on_send_failed(pomelo_webrtc_traffic_t * traffic);
+
+
+/// @brief Add the counters to the statistics
+void pomelo_webrtc_traffic_fold(
+    pomelo_webrtc_traffic_t * traffic,
+    pomelo_webrtc_traffic_stats_t * stats
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // POMELO_WEBRTC_TRAFFIC_STATS_H
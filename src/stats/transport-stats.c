@@ -0,0 +1,99 @@
+#include <assert.h>
+#include "transport-stats.h"
+
+
+/// @brief Convert the candidate type of RTC library
+static pomelo_webrtc_candidate_type pomelo_webrtc_transport_candidate_type(
+    rtc_candidate_type type
+) {
+    switch (type) {
+        case RTC_CANDIDATE_TYPE_HOST:
+            return POMELO_WEBRTC_CANDIDATE_TYPE_HOST;
+
+        case RTC_CANDIDATE_TYPE_SERVER_REFLEXIVE:
+            return POMELO_WEBRTC_CANDIDATE_TYPE_SERVER_REFLEXIVE;
+
+        case RTC_CANDIDATE_TYPE_PEER_REFLEXIVE:
+            return POMELO_WEBRTC_CANDIDATE_TYPE_PEER_REFLEXIVE;
+
+        case RTC_CANDIDATE_TYPE_RELAYED:
+            return POMELO_WEBRTC_CANDIDATE_TYPE_RELAYED;
+
+        default:
+            return POMELO_WEBRTC_CANDIDATE_TYPE_UNKNOWN;
+    }
+}
+
+
+void pomelo_webrtc_transport_reset(pomelo_webrtc_transport_t * transport) {
+    assert(transport != NULL);
+    pomelo_atomic_uint64_store(&transport->rtt, 0);
+    pomelo_atomic_uint64_store(&transport->bytes_sent, 0);
+    pomelo_atomic_uint64_store(&transport->bytes_received, 0);
+    pomelo_atomic_uint64_store(
+        &transport->local_candidate,
+        POMELO_WEBRTC_CANDIDATE_TYPE_UNKNOWN
+    );
+    pomelo_atomic_uint64_store(
+        &transport->remote_candidate,
+        POMELO_WEBRTC_CANDIDATE_TYPE_UNKNOWN
+    );
+}
+
+
+int pomelo_webrtc_transport_update(
+    pomelo_webrtc_transport_t * transport,
+    rtc_peer_connection_t * pc
+) {
+    assert(transport != NULL);
+    assert(pc != NULL);
+
+    rtc_peer_connection_stats_t stats;
+    if (rtc_peer_connection_get_stats(pc, &stats) < 0) {
+        return -1;
+    }
+
+    // Keep the last known RTT if SCTP has no estimate at the moment
+    if (stats.rtt_ms > 0) {
+        pomelo_atomic_uint64_store(
+            &transport->rtt,
+            (uint64_t) stats.rtt_ms * 1000000ULL
+        );
+    }
+    pomelo_atomic_uint64_store(&transport->bytes_sent, stats.bytes_sent);
+    pomelo_atomic_uint64_store(
+        &transport->bytes_received,
+        stats.bytes_received
+    );
+
+    if (stats.has_selected_pair) {
+        pomelo_atomic_uint64_store(
+            &transport->local_candidate,
+            pomelo_webrtc_transport_candidate_type(stats.local.type)
+        );
+        pomelo_atomic_uint64_store(
+            &transport->remote_candidate,
+            pomelo_webrtc_transport_candidate_type(stats.remote.type)
+        );
+    }
+
+    return 0;
+}
+
+
+void pomelo_webrtc_transport_get(
+    pomelo_webrtc_transport_t * transport,
+    pomelo_webrtc_transport_stats_t * stats
+) {
+    assert(transport != NULL);
+    assert(stats != NULL);
+
+    stats->rtt_us = pomelo_atomic_uint64_load(&transport->rtt) / 1000ULL;
+    stats->bytes_sent = pomelo_atomic_uint64_load(&transport->bytes_sent);
+    stats->bytes_received =
+        pomelo_atomic_uint64_load(&transport->bytes_received);
+    stats->local_candidate = (pomelo_webrtc_candidate_type)
+        pomelo_atomic_uint64_load(&transport->local_candidate);
+    stats->remote_candidate = (pomelo_webrtc_candidate_type)
+        pomelo_atomic_uint64_load(&transport->remote_candidate);
+}
@@ -0,0 +1,63 @@
+#ifndef POMELO_WEBRTC_TRANSPORT_STATS_H
+#define POMELO_WEBRTC_TRANSPORT_STATS_H
+#include "utils/atomic.h"
+#include "rtc-api/rtc-api.h"
+#include "plugin.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Transport statistics of a peer connection.
+    Querying the peer connection takes locks inside the RTC library, so it is
+    not done per message. The plugin thread samples the statistics
+    periodically and keeps the latest sample here, it can be read from any
+    thread without touching the peer connection.
+*/
+
+
+/// @brief Latest sample of transport statistics
+typedef struct pomelo_webrtc_transport_s pomelo_webrtc_transport_t;
+
+
+struct pomelo_webrtc_transport_s {
+    /// @brief Round trip time measured by SCTP (ns), zero if not available
+    pomelo_atomic_uint64_t rtt;
+
+    /// @brief Bytes sent through the transport
+    pomelo_atomic_uint64_t bytes_sent;
+
+    /// @brief Bytes received through the transport
+    pomelo_atomic_uint64_t bytes_received;
+
+    /// @brief Type of local candidate of the selected pair
+    pomelo_atomic_uint64_t local_candidate;
+
+    /// @brief Type of remote candidate of the selected pair
+    pomelo_atomic_uint64_t remote_candidate;
+};
+
+
+/// @brief Reset the sample
+void pomelo_webrtc_transport_reset(pomelo_webrtc_transport_t * transport);
+
+
+/// @brief Sample the statistics of peer connection. Plugin thread only.
+/// @return 0 on success or -1 on failure
+int pomelo_webrtc_transport_update(
+    pomelo_webrtc_transport_t * transport,
+    rtc_peer_connection_t * pc
+);
+
+
+/// @brief Get the latest sample
+void pomelo_webrtc_transport_get(
+    pomelo_webrtc_transport_t * transport,
+    pomelo_webrtc_transport_stats_t * stats
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // POMELO_WEBRTC_TRANSPORT_STATS_H
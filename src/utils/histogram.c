@@ -0,0 +1,150 @@
+#include <assert.h>
+#include "histogram.h"
+
+
+/// Values below this are recorded exactly
+#define LINEAR_LIMIT POMELO_HISTOGRAM_SUB_BUCKETS
+
+
+/// @brief Get the index of highest set bit of value
+static size_t histogram_msb(uint64_t value) {
+    size_t msb = 0;
+    while (value >>= 1) {
+        msb++;
+    }
+    return msb;
+}
+
+
+/// @brief Get the bucket index of value
+static size_t histogram_index(uint64_t value) {
+    if (value < LINEAR_LIMIT) {
+        return (size_t) value;
+    }
+
+    size_t msb = histogram_msb(value);
+    size_t shift = msb - POMELO_HISTOGRAM_SUB_BUCKET_BITS;
+    size_t sub = (size_t) (value >> shift) & (POMELO_HISTOGRAM_SUB_BUCKETS - 1);
+    return (shift + 1) * POMELO_HISTOGRAM_SUB_BUCKETS + sub;
+}
+
+
+/// @brief Get the lowest value of bucket
+static uint64_t histogram_lower_bound(size_t index) {
+    if (index < LINEAR_LIMIT) {
+        return index;
+    }
+
+    size_t shift = index / POMELO_HISTOGRAM_SUB_BUCKETS - 1;
+    uint64_t sub = index % POMELO_HISTOGRAM_SUB_BUCKETS;
+    return (LINEAR_LIMIT + sub) << shift;
+}
+
+
+/// @brief Get the representative value (middle) of bucket
+static uint64_t histogram_bucket_value(size_t index) {
+    if (index < LINEAR_LIMIT) {
+        return index;
+    }
+
+    size_t shift = index / POMELO_HISTOGRAM_SUB_BUCKETS - 1;
+    uint64_t width = ((uint64_t) 1) << shift;
+    return histogram_lower_bound(index) + (width >> 1);
+}
+
+
+void pomelo_histogram_reset(pomelo_histogram_t * histogram) {
+    assert(histogram != NULL);
+    pomelo_atomic_uint64_store(&histogram->count, 0);
+    pomelo_atomic_uint64_store(&histogram->sum, 0);
+    pomelo_atomic_uint64_store(&histogram->max, 0);
+    for (size_t i = 0; i < POMELO_HISTOGRAM_BUCKETS; i++) {
+        pomelo_atomic_uint64_store(&histogram->buckets[i], 0);
+    }
+}
+
+
+void pomelo_histogram_record(pomelo_histogram_t * histogram, uint64_t value) {
+    assert(histogram != NULL);
+
+    pomelo_atomic_uint64_fetch_add(
+        &histogram->buckets[histogram_index(value)], 1
+    );
+    pomelo_atomic_uint64_fetch_add(&histogram->sum, value);
+    pomelo_atomic_uint64_fetch_add(&histogram->count, 1);
+
+    uint64_t max = pomelo_atomic_uint64_load(&histogram->max);
+    while (value > max) {
+        if (pomelo_atomic_uint64_compare_exchange(
+            &histogram->max, max, value
+        )) {
+            break;
+        }
+        max = pomelo_atomic_uint64_load(&histogram->max);
+    }
+}
+
+
+uint64_t pomelo_histogram_count(pomelo_histogram_t * histogram) {
+    assert(histogram != NULL);
+    return pomelo_atomic_uint64_load(&histogram->count);
+}
+
+
+uint64_t pomelo_histogram_mean(pomelo_histogram_t * histogram) {
+    assert(histogram != NULL);
+    uint64_t count = pomelo_atomic_uint64_load(&histogram->count);
+    if (count == 0) return 0;
+    return pomelo_atomic_uint64_load(&histogram->sum) / count;
+}
+
+
+uint64_t pomelo_histogram_max(pomelo_histogram_t * histogram) {
+    assert(histogram != NULL);
+    return pomelo_atomic_uint64_load(&histogram->max);
+}
+
+
+uint64_t pomelo_histogram_min(pomelo_histogram_t * histogram) {
+    assert(histogram != NULL);
+    for (size_t i = 0; i < POMELO_HISTOGRAM_BUCKETS; i++) {
+        if (pomelo_atomic_uint64_load(&histogram->buckets[i]) > 0) {
+            return histogram_lower_bound(i);
+        }
+    }
+    return 0;
+}
+
+
+uint64_t pomelo_histogram_quantile(
+    pomelo_histogram_t * histogram,
+    double quantile
+) {
+    assert(histogram != NULL);
+
+    // Sum the buckets instead of reading the counter, so that the result is
+    // consistent even when values are recorded concurrently.
+    uint64_t total = 0;
+    for (size_t i = 0; i < POMELO_HISTOGRAM_BUCKETS; i++) {
+        total += pomelo_atomic_uint64_load(&histogram->buckets[i]);
+    }
+    if (total == 0) return 0;
+
+    if (quantile < 0.0) quantile = 0.0;
+    if (quantile > 1.0) quantile = 1.0;
+
+    uint64_t rank = (uint64_t) (quantile * (double) total);
+    if (rank == 0) rank = 1;
+
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < POMELO_HISTOGRAM_BUCKETS; i++) {
+        cumulative += pomelo_atomic_uint64_load(&histogram->buckets[i]);
+        if (cumulative >= rank) {
+            uint64_t value = histogram_bucket_value(i);
+            uint64_t max = pomelo_atomic_uint64_load(&histogram->max);
+            return (value > max && max > 0) ? max : value;
+        }
+    }
+
+    return pomelo_atomic_uint64_load(&histogram->max);
+}
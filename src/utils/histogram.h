@@ -0,0 +1,85 @@
+#ifndef POMELO_UTILS_HISTOGRAM_SRC_H
+#define POMELO_UTILS_HISTOGRAM_SRC_H
+#include <stdint.h>
+#include <stddef.h>
+#include "utils/atomic.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    HDR-style histogram with fixed memory. Values are grouped by their highest
+    bit (major bucket) and each major bucket is divided into linear sub-buckets,
+    so that the relative error of every recorded value is bounded by
+    1 / POMELO_HISTOGRAM_SUB_BUCKETS.
+    Recording is lock-free, so the histogram can be read from other threads
+    while it is being updated.
+*/
+
+/// Number of bits of sub-buckets
+#define POMELO_HISTOGRAM_SUB_BUCKET_BITS 3
+
+/// Number of sub-buckets of every major bucket
+#define POMELO_HISTOGRAM_SUB_BUCKETS (1 << POMELO_HISTOGRAM_SUB_BUCKET_BITS)
+
+/// Total number of buckets, enough for all 64-bit values
+#define POMELO_HISTOGRAM_BUCKETS                                               \
+    ((64 - POMELO_HISTOGRAM_SUB_BUCKET_BITS + 1) * POMELO_HISTOGRAM_SUB_BUCKETS)
+
+
+struct pomelo_histogram_s;
+
+/// @brief The histogram
+typedef struct pomelo_histogram_s pomelo_histogram_t;
+
+
+struct pomelo_histogram_s {
+    /// @brief Number of recorded values
+    pomelo_atomic_uint64_t count;
+
+    /// @brief Sum of recorded values
+    pomelo_atomic_uint64_t sum;
+
+    /// @brief Maximum recorded value
+    pomelo_atomic_uint64_t max;
+
+    /// @brief Counters of buckets
+    pomelo_atomic_uint64_t buckets[POMELO_HISTOGRAM_BUCKETS];
+};
+
+
+/// @brief Reset the histogram
+void pomelo_histogram_reset(pomelo_histogram_t * histogram);
+
+
+/// @brief Record a value
+void pomelo_histogram_record(pomelo_histogram_t * histogram, uint64_t value);
+
+
+/// @brief Get the number of recorded values
+uint64_t pomelo_histogram_count(pomelo_histogram_t * histogram);
+
+
+/// @brief Get the mean of recorded values
+uint64_t pomelo_histogram_mean(pomelo_histogram_t * histogram);
+
+
+/// @brief Get the maximum recorded value
+uint64_t pomelo_histogram_max(pomelo_histogram_t * histogram);
+
+
+/// @brief Get the approximate minimum recorded value
+uint64_t pomelo_histogram_min(pomelo_histogram_t * histogram);
+
+
+/// @brief Get the approximate value at the quantile (0.0 - 1.0)
+uint64_t pomelo_histogram_quantile(
+    pomelo_histogram_t * histogram,
+    double quantile
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // POMELO_UTILS_HISTOGRAM_SRC_H
@@ -0,0 +1,315 @@
+#include <assert.h>
+#include <string.h>
+#include <stdbool.h>
+#include "lz.h"
+
+
+/// Number of entries of hash table
+#define LZ_HASH_SIZE (1 << POMELO_LZ_HASH_BITS)
+
+/// Number of bytes at the end of input which are always literals
+#define LZ_LAST_LITERALS 5
+
+/// Number of bytes at the end of input where no match may start
+#define LZ_MATCH_FIND_LIMIT 12
+
+/// Maximum value of a length nibble
+#define LZ_NIBBLE_MAX 15
+
+
+/// @brief Input of compressor, the dictionary followed by the data
+typedef struct lz_source_s {
+    const uint8_t * dictionary;
+    size_t dictionary_size;
+    const uint8_t * input;
+} lz_source_t;
+
+
+/// @brief Get a byte of source
+static inline uint8_t lz_byte(const lz_source_t * source, size_t position) {
+    return (position < source->dictionary_size)
+        ? source->dictionary[position]
+        : source->input[position - source->dictionary_size];
+}
+
+
+/// @brief Read 4 bytes of source
+static inline uint32_t lz_read32(const lz_source_t * source, size_t position) {
+    uint32_t value;
+    if (position >= source->dictionary_size) {
+        memcpy(&value, source->input + position - source->dictionary_size, 4);
+        return value;
+    }
+
+    uint8_t bytes[4];
+    for (size_t i = 0; i < 4; i++) {
+        bytes[i] = lz_byte(source, position + i);
+    }
+    memcpy(&value, bytes, 4);
+    return value;
+}
+
+
+/// @brief Hash 4 bytes
+static inline uint32_t lz_hash(uint32_t value) {
+    return (value * 2654435761U) >> (32 - POMELO_LZ_HASH_BITS);
+}
+
+
+/// @brief Write a length continuation
+/// @return The new position or capacity + 1 if it does not fit
+static size_t lz_write_length(
+    uint8_t * output,
+    size_t position,
+    size_t capacity,
+    size_t length
+) {
+    while (length >= 255) {
+        if (position >= capacity) return capacity + 1;
+        output[position++] = 255;
+        length -= 255;
+    }
+    if (position >= capacity) return capacity + 1;
+    output[position++] = (uint8_t) length;
+    return position;
+}
+
+
+/// @brief Write a sequence. The match is skipped when match_length is 0.
+/// @return The new position or capacity + 1 if it does not fit
+static size_t lz_write_sequence(
+    uint8_t * output,
+    size_t position,
+    size_t capacity,
+    const uint8_t * literals,
+    size_t literal_length,
+    size_t offset,
+    size_t match_length
+) {
+    if (position >= capacity) return capacity + 1;
+    size_t match_code = (match_length > 0)
+        ? match_length - POMELO_LZ_MIN_MATCH
+        : 0;
+    uint8_t literal_nibble = (literal_length < LZ_NIBBLE_MAX)
+        ? (uint8_t) literal_length
+        : LZ_NIBBLE_MAX;
+    uint8_t match_nibble = (match_code < LZ_NIBBLE_MAX)
+        ? (uint8_t) match_code
+        : LZ_NIBBLE_MAX;
+    output[position++] = (uint8_t) ((literal_nibble << 4) | match_nibble);
+
+    if (literal_nibble == LZ_NIBBLE_MAX) {
+        position = lz_write_length(
+            output,
+            position,
+            capacity,
+            literal_length - LZ_NIBBLE_MAX
+        );
+        if (position > capacity) return position;
+    }
+
+    if (literal_length > capacity - position) return capacity + 1;
+    memcpy(output + position, literals, literal_length);
+    position += literal_length;
+
+    if (match_length == 0) {
+        return position; // The last sequence
+    }
+
+    if (capacity - position < 2) return capacity + 1;
+    output[position++] = (uint8_t) offset;
+    output[position++] = (uint8_t) (offset >> 8);
+
+    if (match_nibble == LZ_NIBBLE_MAX) {
+        position = lz_write_length(
+            output,
+            position,
+            capacity,
+            match_code - LZ_NIBBLE_MAX
+        );
+    }
+    return position;
+}
+
+
+size_t pomelo_lz_compress(
+    const uint8_t * input,
+    size_t input_size,
+    const uint8_t * dictionary,
+    size_t dictionary_size,
+    uint8_t * output,
+    size_t capacity
+) {
+    assert(input != NULL || input_size == 0);
+    assert(dictionary != NULL || dictionary_size == 0);
+    assert(output != NULL);
+
+    lz_source_t source = {
+        .dictionary = dictionary,
+        .dictionary_size = dictionary_size,
+        .input = input
+    };
+
+    // Positions are stored plus one, zero means empty
+    uint32_t table[LZ_HASH_SIZE];
+    memset(table, 0, sizeof(table));
+
+    // Only the end of dictionary is reachable
+    size_t base = (dictionary_size > POMELO_LZ_MAX_OFFSET)
+        ? dictionary_size - POMELO_LZ_MAX_OFFSET
+        : 0;
+    for (size_t p = base; p + 4 <= dictionary_size; p++) {
+        table[lz_hash(lz_read32(&source, p))] = (uint32_t) (p - base + 1);
+    }
+
+    // As required by LZ4 block format, the last match starts at least 12
+    // bytes before the end and ends at least 5 bytes before the end
+    size_t end = dictionary_size + input_size;
+    bool matchable = (input_size >= LZ_MATCH_FIND_LIMIT);
+    size_t start_limit = matchable ? end - LZ_MATCH_FIND_LIMIT : 0;
+    size_t match_limit = matchable ? end - LZ_LAST_LITERALS : 0;
+    size_t anchor = dictionary_size;
+    size_t position = dictionary_size;
+    size_t written = 0;
+
+    while (matchable && position <= start_limit) {
+        uint32_t sequence = lz_read32(&source, position);
+        uint32_t hash = lz_hash(sequence);
+        size_t entry = table[hash];
+        table[hash] = (uint32_t) (position - base + 1);
+
+        if (entry == 0) {
+            position++;
+            continue;
+        }
+
+        size_t reference = entry - 1 + base;
+        if (
+            position - reference > POMELO_LZ_MAX_OFFSET ||
+            lz_read32(&source, reference) != sequence
+        ) {
+            position++;
+            continue;
+        }
+
+        size_t length = POMELO_LZ_MIN_MATCH;
+        while (
+            position + length < match_limit &&
+            lz_byte(&source, reference + length) ==
+                lz_byte(&source, position + length)
+        ) {
+            length++;
+        }
+
+        written = lz_write_sequence(
+            output,
+            written,
+            capacity,
+            input + (anchor - dictionary_size),
+            position - anchor,
+            position - reference,
+            length
+        );
+        if (written > capacity) return 0;
+
+        position += length;
+        anchor = position;
+    }
+
+    written = lz_write_sequence(
+        output,
+        written,
+        capacity,
+        input + (anchor - dictionary_size),
+        end - anchor,
+        0,
+        0
+    );
+    return (written > capacity) ? 0 : written;
+}
+
+
+/// @brief Read a length continuation
+/// @return 0 on success or -1 on failure
+static int lz_read_length(
+    const uint8_t * input,
+    size_t input_size,
+    size_t * position,
+    size_t * length
+) {
+    uint8_t byte;
+    do {
+        if (*position >= input_size) return -1;
+        byte = input[(*position)++];
+        *length += byte;
+        if (*length > input_size * 255) return -1; // Corrupted
+    } while (byte == 255);
+    return 0;
+}
+
+
+int64_t pomelo_lz_decompress(
+    const uint8_t * input,
+    size_t input_size,
+    const uint8_t * dictionary,
+    size_t dictionary_size,
+    uint8_t * output,
+    size_t capacity
+) {
+    assert(input != NULL || input_size == 0);
+    assert(dictionary != NULL || dictionary_size == 0);
+    assert(output != NULL);
+
+    size_t in = 0;
+    size_t out = 0;
+    while (in < input_size) {
+        uint8_t token = input[in++];
+
+        size_t literal_length = token >> 4;
+        if (literal_length == LZ_NIBBLE_MAX) {
+            if (lz_read_length(input, input_size, &in, &literal_length) < 0) {
+                return -1;
+            }
+        }
+        if (
+            literal_length > input_size - in ||
+            literal_length > capacity - out
+        ) {
+            return -1; // Truncated or too large
+        }
+        memcpy(output + out, input + in, literal_length);
+        in += literal_length;
+        out += literal_length;
+
+        if (in == input_size) {
+            break; // The last sequence
+        }
+
+        if (input_size - in < 2) return -1;
+        size_t offset = (size_t) input[in] | ((size_t) input[in + 1] << 8);
+        in += 2;
+        if (offset == 0 || offset > out + dictionary_size) {
+            return -1; // Out of window
+        }
+
+        size_t match_length = token & LZ_NIBBLE_MAX;
+        if (match_length == LZ_NIBBLE_MAX) {
+            if (lz_read_length(input, input_size, &in, &match_length) < 0) {
+                return -1;
+            }
+        }
+        match_length += POMELO_LZ_MIN_MATCH;
+        if (match_length > capacity - out) {
+            return -1; // Too large
+        }
+
+        // Byte by byte, the match may overlap its own output
+        for (size_t i = 0; i < match_length; i++, out++) {
+            output[out] = (offset > out)
+                ? dictionary[dictionary_size - (offset - out)]
+                : output[out - offset];
+        }
+    }
+
+    return (int64_t) out;
+}
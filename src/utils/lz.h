@@ -0,0 +1,69 @@
+#ifndef POMELO_UTILS_LZ_SRC_H
+#define POMELO_UTILS_LZ_SRC_H
+#include <stdint.h>
+#include <stddef.h>
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Small LZ77 codec with the block format of LZ4. A block is a series of
+    sequences:
+        [token][literal length..][literals][offset, 2 bytes LE][match length..]
+    The high nibble of token is the literal length and the low nibble is the
+    match length minus 4, the value 15 is continued by bytes which are added
+    until a byte is not 255. The last sequence only has literals, no match
+    starts in the last 12 bytes of input and the last 5 bytes are always
+    literals.
+
+    An optional dictionary is treated as the data preceding the input, so
+    matches may reach back into it. Both sides must use the same dictionary.
+    The codec is stateless and can be used from any thread.
+*/
+
+/// Minimum length of a match
+#define POMELO_LZ_MIN_MATCH 4
+
+/// Maximum distance of a match
+#define POMELO_LZ_MAX_OFFSET 65535
+
+/// Number of bits of the match finder hash table
+#define POMELO_LZ_HASH_BITS 12
+
+/// @brief Maximum size of the compressed output of input size
+#define pomelo_lz_bound(size) ((size) + (size) / 255 + 16)
+
+/// @brief Maximum size of the decompressed output of a block size. Every
+/// byte of block expands to at most 255 bytes.
+#define pomelo_lz_max_output(size) ((size) * 255)
+
+
+/// @brief Compress input with an optional dictionary
+/// @return Size of the output, or 0 if it does not fit in capacity
+size_t pomelo_lz_compress(
+    const uint8_t * input,
+    size_t input_size,
+    const uint8_t * dictionary,
+    size_t dictionary_size,
+    uint8_t * output,
+    size_t capacity
+);
+
+
+/// @brief Decompress a block with the dictionary which has compressed it
+/// @return Size of the output, or -1 if the block is invalid or it does not
+/// fit in capacity
+int64_t pomelo_lz_decompress(
+    const uint8_t * input,
+    size_t input_size,
+    const uint8_t * dictionary,
+    size_t dictionary_size,
+    uint8_t * output,
+    size_t capacity
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // POMELO_UTILS_LZ_SRC_H